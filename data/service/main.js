@@ -75,6 +75,17 @@ const weatherState = {
   historyCap: 7000,
   lastFetch: 0,
   lastPayload: null,
+  reuseMs: 5000,
+};
+
+// Indoor series downsampled on the device (/api/weather/history); the local
+// history above only fills in outdoor values and the newest readings.
+const deviceHistoryState = {
+  refreshMs: 5 * 60 * 1000,
+  windows: {
+    day: { hours: 24, points: 300, series: [], lastFetch: 0 },
+    week: { hours: 24 * 7, points: 400, series: [], lastFetch: 0 },
+  },
 };
 
 const resourceState = {
@@ -82,6 +93,16 @@ const resourceState = {
   timer: 0,
 };
 
+// Server-sent events from /api/events. While connected, readings and
+// resources arrive as the device produces them and the poll timers only
+// drive outdoor fetches and chart history; on failure polling takes over.
+const liveState = {
+  source: null,
+  connected: false,
+  failures: 0,
+  maxFailures: 3,
+};
+
 const clockState = {
   timer: 0,
   config: null,
@@ -92,6 +113,7 @@ const outdoorState = {
   metrics: null,
   lastFetch: 0,
   lastPush: 0,
+  configApplied: null,
   fetching: false,
   selection: null,
   searchResults: [],
@@ -150,6 +172,49 @@ function historyWindow(hours) {
   return weatherState.history.filter((entry) => Number.isFinite(entry.timestamp) && entry.timestamp >= cutoff);
 }
 
+async function fetchDeviceHistory(key, force = false) {
+  const win = deviceHistoryState.windows[key];
+  if (!win) return;
+  if (!force && win.lastFetch && Date.now() - win.lastFetch < deviceHistoryState.refreshMs) return;
+  win.lastFetch = Date.now();
+  const to = Math.floor(Date.now() / 1000);
+  const from = to - win.hours * 60 * 60;
+  const query = (metric) => fetchJSON(`/api/weather/history?metric=${metric}&from=${from}&to=${to}&points=${win.points}`);
+  try {
+    const [temp, hum, press] = await Promise.all([query("temperature"), query("humidity"), query("pressure")]);
+    const entries = [];
+    (temp?.points || []).forEach(([t, v]) => entries.push({ timestamp: t * 1000, temperatureC: v }));
+    (hum?.points || []).forEach(([t, v]) => entries.push({ timestamp: t * 1000, humidity: v }));
+    (press?.points || []).forEach(([t, v]) => entries.push({ timestamp: t * 1000, pressureHpa: v, pressureMmHg: v / 1.33322 }));
+    win.series = entries.sort((a, b) => a.timestamp - b.timestamp);
+  } catch (_) {
+    // Clock not synced yet or older firmware: charts fall back to local history.
+    win.series = [];
+  }
+}
+
+function chartHistory(key) {
+  const win = deviceHistoryState.windows[key];
+  const local = historyWindow(win.hours);
+  if (!win.series.length) return local;
+  const lastDeviceTs = win.series[win.series.length - 1].timestamp;
+  const merged = [...win.series];
+  local.forEach((entry) => {
+    if (entry.timestamp > lastDeviceTs) {
+      merged.push(entry);
+    } else if (Number.isFinite(entry.temperatureOutC) || Number.isFinite(entry.humidityOut) || Number.isFinite(entry.pressureOutMmHg)) {
+      merged.push({
+        timestamp: entry.timestamp,
+        temperatureOutC: entry.temperatureOutC,
+        humidityOut: entry.humidityOut,
+        pressureOutHpa: entry.pressureOutHpa,
+        pressureOutMmHg: entry.pressureOutMmHg,
+      });
+    }
+  });
+  return merged.sort((a, b) => a.timestamp - b.timestamp);
+}
+
 function loadChartVisibility() {
   try {
     const raw = localStorage.getItem("chartVisibility");
@@ -465,21 +530,34 @@ function saveOutdoorConfig(cfg) {
   } catch (_) {
     /* ignore */
   }
-  try {
-    fetchJSON("/api/outdoor/config", {
-      method: "POST",
-      headers: { "Content-Type": "application/json" },
-      body: JSON.stringify({
-        enabled: true,
-        lat: cfg.lat,
-        lon: cfg.lon,
-        city: cfg.city,
-        country: cfg.country,
-        timezone: cfg.timezone,
-      }),
+  // Cache pushes wait for this, so the device's reset for the new location
+  // cannot drop them.
+  outdoorState.configApplied = fetchJSON("/api/outdoor/config", {
+    method: "POST",
+    headers: { "Content-Type": "application/json" },
+    body: JSON.stringify({
+      enabled: true,
+      lat: cfg.lat,
+      lon: cfg.lon,
+      city: cfg.city,
+      country: cfg.country,
+      timezone: cfg.timezone,
+    }),
+  })
+    .then((queued) => waitForOutdoorConfig(queued?.configRevision))
+    .catch(() => {
+      /* non-blocking */
     });
-  } catch (_) {
-    /* non-blocking */
+}
+
+// The device applies a saved config on its loop task; poll until the
+// returned revision shows up (about 2 s at most).
+async function waitForOutdoorConfig(revision) {
+  if (!Number.isFinite(revision)) return;
+  for (let attempt = 0; attempt < 10; attempt += 1) {
+    await new Promise((resolve) => setTimeout(resolve, 200));
+    const cfg = await fetchJSON("/api/outdoor/config");
+    if (Number.isFinite(cfg?.configRevision) && cfg.configRevision >= revision) return;
   }
 }
 
@@ -1024,7 +1102,7 @@ function pushWeatherHistory(payload, timestamp) {
 function renderWeatherChart(options = {}) {
   const {
     canvas = selectors.weatherChart(),
-    history = historyWindow(24),
+    history = chartHistory("day"),
     metaKey = "weatherMain",
     emptyLabel = "Collecting 24-hour history…",
   } = options;
@@ -1205,7 +1283,7 @@ function renderWeatherChart(options = {}) {
 function renderPressureChart(options = {}) {
   const {
     canvas = selectors.pressureChart(),
-    history = historyWindow(24),
+    history = chartHistory("day"),
     metaKey = "pressureMain",
     emptyLabel = "Collecting pressure history…",
   } = options;
@@ -1369,6 +1447,13 @@ function nearestHistoryEntry(ts, history, predicate) {
   return best;
 }
 
+// Device series carry one metric per entry, so tooltip values are looked up per field.
+function nearestHistoryValue(ts, history, key, toleranceMs) {
+  const entry = nearestHistoryEntry(ts, history, (e) => Number.isFinite(e[key]));
+  if (!entry || Math.abs(entry.timestamp - ts) > toleranceMs) return NaN;
+  return entry[key];
+}
+
 function ensureTooltip(canvas) {
   if (!canvas) return null;
   const parent = canvas.parentElement;
@@ -1435,23 +1520,29 @@ function buildWeatherTooltip(event, metaKey) {
     (chartVisibility.humOut && Number.isFinite(e.humidityOut))
   ));
   if (!entry) return;
+  const tolerance = Math.max(60 * 1000, domain / 50);
+  const valueAt = (key) => nearestHistoryValue(entry.timestamp, meta.history || [], key, tolerance);
 
   const timeLabel = new Date(entry.timestamp).toLocaleTimeString([], { hour: "2-digit", minute: "2-digit", second: "2-digit" });
   const parts = [`<div class="tip-time">${timeLabel}</div>`];
   if (chartVisibility.tempIn) {
-    const label = Number.isFinite(entry.temperatureC) ? `${entry.temperatureC.toFixed(1)}°C` : "—";
+    const value = valueAt("temperatureC");
+    const label = Number.isFinite(value) ? `${value.toFixed(1)}°C` : "—";
     parts.push(`<div class="tip-value">Temp in: ${label}</div>`);
   }
   if (chartVisibility.tempOut) {
-    const label = Number.isFinite(entry.temperatureOutC) ? `${entry.temperatureOutC.toFixed(1)}°C` : "—";
+    const value = valueAt("temperatureOutC");
+    const label = Number.isFinite(value) ? `${value.toFixed(1)}°C` : "—";
     parts.push(`<div class="tip-value">Temp out: ${label}</div>`);
   }
   if (chartVisibility.humIn) {
-    const label = Number.isFinite(entry.humidity) ? `${entry.humidity.toFixed(1)}%` : "—";
+    const value = valueAt("humidity");
+    const label = Number.isFinite(value) ? `${value.toFixed(1)}%` : "—";
     parts.push(`<div class="tip-value">Hum in: ${label}</div>`);
   }
   if (chartVisibility.humOut) {
-    const label = Number.isFinite(entry.humidityOut) ? `${entry.humidityOut.toFixed(1)}%` : "—";
+    const value = valueAt("humidityOut");
+    const label = Number.isFinite(value) ? `${value.toFixed(1)}%` : "—";
     parts.push(`<div class="tip-value">Hum out: ${label}</div>`);
   }
   tip.innerHTML = parts.join("");
@@ -1482,17 +1573,23 @@ function buildPressureTooltip(event, metaKey) {
     (chartVisibility.pressOut && Number.isFinite(e.pressureOutMmHg))
   ));
   if (!entry) return;
+  const tolerance = Math.max(60 * 1000, domain / 50);
+  const valueAt = (key) => nearestHistoryValue(entry.timestamp, meta.history || [], key, tolerance);
 
   const timeLabel = new Date(entry.timestamp).toLocaleTimeString([], { hour: "2-digit", minute: "2-digit", second: "2-digit" });
   const parts = [`<div class="tip-time">${timeLabel}</div>`];
   if (chartVisibility.pressIn) {
-    const mmHgInLabel = Number.isFinite(entry.pressureMmHg) ? `${entry.pressureMmHg.toFixed(1)} mmHg` : "—";
-    const hpaInLabel = Number.isFinite(entry.pressureHpa) ? `${entry.pressureHpa.toFixed(1)} hPa` : "—";
+    const mmHgIn = valueAt("pressureMmHg");
+    const hpaIn = valueAt("pressureHpa");
+    const mmHgInLabel = Number.isFinite(mmHgIn) ? `${mmHgIn.toFixed(1)} mmHg` : "—";
+    const hpaInLabel = Number.isFinite(hpaIn) ? `${hpaIn.toFixed(1)} hPa` : "—";
     parts.push(`<div class="tip-value">Indoor: ${mmHgInLabel} (${hpaInLabel})</div>`);
   }
   if (chartVisibility.pressOut) {
-    const mmHgOutLabel = Number.isFinite(entry.pressureOutMmHg) ? `${entry.pressureOutMmHg.toFixed(1)} mmHg` : "—";
-    const hpaOutLabel = Number.isFinite(entry.pressureOutHpa) ? `${entry.pressureOutHpa.toFixed(1)} hPa` : "—";
+    const mmHgOut = valueAt("pressureOutMmHg");
+    const hpaOut = valueAt("pressureOutHpa");
+    const mmHgOutLabel = Number.isFinite(mmHgOut) ? `${mmHgOut.toFixed(1)} mmHg` : "—";
+    const hpaOutLabel = Number.isFinite(hpaOut) ? `${hpaOut.toFixed(1)} hPa` : "—";
     parts.push(`<div class="tip-value">Outdoor: ${mmHgOutLabel} (${hpaOutLabel})</div>`);
   }
   tip.innerHTML = parts.join("");
@@ -1583,7 +1680,7 @@ function renderCharts() {
 }
 
 function renderHistoryCharts() {
-  const weekHistory = historyWindow(24 * 7);
+  const weekHistory = chartHistory("week");
   renderWeatherChart({
     canvas: selectors.historyTempChart(),
     history: weekHistory,
@@ -1607,6 +1704,9 @@ function openHistoryModal() {
   if (!modal) return;
   modal.hidden = false;
   renderHistoryCharts();
+  fetchDeviceHistory("week").then(() => {
+    if (!modal.hidden) renderHistoryCharts();
+  });
 }
 
 function closeHistoryModal() {
@@ -1618,13 +1718,18 @@ function closeHistoryModal() {
 async function fetchWeatherMetrics() {
   const statusEl = selectors.weatherStatus();
   try {
-    const payload = await fetchJSON("/api/weather/metrics");
+    // The live stream (or the dashboard load just now) keeps lastPayload
+    // current; only poll without it.
+    const cached = weatherState.lastPayload &&
+      (liveState.connected || Date.now() - weatherState.lastFetch < weatherState.reuseMs);
+    const payload = cached ? weatherState.lastPayload : await fetchJSON("/api/weather/metrics");
     const timestamp = Date.now();
-    weatherState.lastFetch = timestamp;
+    if (!cached) weatherState.lastFetch = timestamp;
     weatherState.lastPayload = payload || {};
     await fetchOutdoorWeather(true);
     updateWeatherTiles(weatherState.lastPayload);
     pushWeatherHistory(weatherState.lastPayload, timestamp);
+    await fetchDeviceHistory("day");
     hideBanner(statusEl);
     renderCharts();
   } catch (error) {
@@ -1740,13 +1845,17 @@ function pushOutdoorCache() {
   };
 
   outdoorState.lastPush = now;
-  fetchJSON("/api/outdoor/cache", {
-    method: "POST",
-    headers: { "Content-Type": "application/json" },
-    body: JSON.stringify(payload),
-  }).catch(() => {
-    /* optional */
-  });
+  Promise.resolve(outdoorState.configApplied)
+    .then(() =>
+      fetchJSON("/api/outdoor/cache", {
+        method: "POST",
+        headers: { "Content-Type": "application/json" },
+        body: JSON.stringify(payload),
+      }),
+    )
+    .catch(() => {
+      /* optional */
+    });
 }
 
 function updateResourceCards(payload) {
@@ -1811,6 +1920,27 @@ function updateResourceCards(payload) {
   }
 }
 
+// Everything the page shows on load in one request; sections not listed
+// are not built by the device.
+async function loadDashboard() {
+  try {
+    return (await fetchJSON("/api/dashboard?fields=indoor,outdoor.config,resources,version")) || {};
+  } catch (_) {
+    return {};
+  }
+}
+
+function applyDashboard(data) {
+  if (data.indoor) {
+    weatherState.lastFetch = Date.now();
+    weatherState.lastPayload = data.indoor;
+    updateWeatherTiles(data.indoor);
+  }
+  updateResourceCards(data.resources || null);
+  const fwVerEl = document.getElementById("fw-version");
+  if (fwVerEl) fwVerEl.textContent = data.version || "unknown";
+}
+
 async function fetchResources() {
   try {
     const payload = await fetchJSON("/api/system/resources");
@@ -1823,11 +1953,86 @@ async function fetchResources() {
 function scheduleResourcePoll() {
   clearTimeout(resourceState.timer);
   resourceState.timer = setTimeout(async () => {
-    await fetchResources();
+    if (!liveState.connected) await fetchResources();
     scheduleResourcePoll();
   }, resourceState.intervalMs);
 }
 
+function parseEventData(event) {
+  try {
+    return JSON.parse(event.data);
+  } catch (_) {
+    return null;
+  }
+}
+
+function applyDeviceOutdoor(payload) {
+  // Pages that fetch outdoor data themselves keep their own (richer) values;
+  // others show what another dashboard pushed to the device cache.
+  const current = payload?.current;
+  if (!current || outdoorState.lastFetch) return;
+  if (!Number.isFinite(current.temperatureC) && !Number.isFinite(current.humidity)) return;
+  outdoorState.metrics = {
+    ...(outdoorState.metrics || { conditionKey: "unknown", conditionLabel: "Outdoor status" }),
+    temperatureC: toNumber(current.temperatureC),
+    humidity: toNumber(current.humidity),
+    pressureHpa: toNumber(current.pressureHpa),
+    pressureMmHg: toNumber(current.pressureMmHg),
+    altitudeM: toNumber(current.altitudeM),
+    windSpeed: toNumber(current.windSpeed),
+  };
+  updateWeatherTiles(weatherState.lastPayload || {});
+}
+
+function startLiveStream() {
+  if (typeof EventSource === "undefined" || liveState.source) return;
+  if (liveState.failures >= liveState.maxFailures) return;
+  const source = new EventSource("/api/events");
+  liveState.source = source;
+  const received = () => {
+    liveState.connected = true;
+    liveState.failures = 0;
+  };
+  source.addEventListener("metrics", (event) => {
+    const payload = parseEventData(event);
+    if (!payload) return;
+    received();
+    weatherState.lastFetch = Date.now();
+    weatherState.lastPayload = payload;
+    updateWeatherTiles(payload);
+    hideBanner(selectors.weatherStatus());
+  });
+  source.addEventListener("resources", (event) => {
+    const payload = parseEventData(event);
+    if (!payload) return;
+    received();
+    updateResourceCards(payload);
+  });
+  source.addEventListener("outdoor", (event) => {
+    const payload = parseEventData(event);
+    if (!payload) return;
+    received();
+    applyDeviceOutdoor(payload);
+  });
+  source.addEventListener("error", () => {
+    // EventSource reconnects by itself; polling covers the gap. A refused or
+    // repeatedly failing stream is given up until the page is shown again.
+    liveState.connected = false;
+    liveState.failures += 1;
+    if (source.readyState === EventSource.CLOSED || liveState.failures >= liveState.maxFailures) {
+      stopLiveStream();
+    }
+  });
+}
+
+function stopLiveStream() {
+  if (liveState.source) {
+    liveState.source.close();
+    liveState.source = null;
+  }
+  liveState.connected = false;
+}
+
 async function pollWeatherOnce() {
   weatherState.timer = 0;
   await fetchWeatherMetrics();
@@ -1852,7 +2057,10 @@ function handleWeatherVisibility() {
   if (document.hidden) {
     clearWeatherTimer();
     stopClockLoop();
+    stopLiveStream();
   } else {
+    liveState.failures = 0;
+    startLiveStream();
     startWeatherLoop(false);
     startClockLoop();
   }
@@ -1887,22 +2095,26 @@ function initServicePage() {
   loadChartVisibility();
   loadWeatherHistory();
   updateForecastCards();
-  fetchResources();
+  const dashboard = loadDashboard();
+  dashboard.then(applyDashboard);
   scheduleResourcePoll();
+  startLiveStream();
 
   renderCharts();
-  startWeatherLoop(true);
+  dashboard.finally(() => startWeatherLoop(true));
   document.addEventListener("visibilitychange", handleWeatherVisibility);
   window.addEventListener("resize", renderCharts);
   window.addEventListener("beforeunload", () => {
     clearWeatherTimer();
     clearResourceTimer();
+    stopLiveStream();
   });
   attachLegendToggles();
 
   // Pull stored location from device before starting the clock to avoid timezone flicker.
-  fetchJSON("/api/outdoor/config")
-    .then((cfg) => {
+  dashboard
+    .then((data) => {
+      const cfg = data.outdoor?.config;
       if (!cfg) return;
       const merged = {
         provider: "open-meteo",
@@ -2035,15 +2247,6 @@ function initServicePage() {
 
 document.addEventListener("DOMContentLoaded", () => {
   if (document.body.dataset.page === "service") {
-    // Show firmware version on all pages with #fw-version
-    const fwVerEl = document.getElementById("fw-version");
-    if (fwVerEl) {
-      fetch("/api/version").then(r => r.json()).then(data => {
-        fwVerEl.textContent = data.version || "unknown";
-      }).catch(() => {
-        fwVerEl.textContent = "unknown";
-      });
-    }
     initServicePage();
   }
 });
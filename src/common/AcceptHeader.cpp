@@ -0,0 +1,89 @@
+#include "AcceptHeader.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+namespace {
+bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+const char *skipSpace(const char *p, const char *end) {
+  while (p < end && isSpace(*p)) ++p;
+  return p;
+}
+
+const char *trimEnd(const char *begin, const char *p) {
+  while (p > begin && isSpace(p[-1])) --p;
+  return p;
+}
+
+bool equalsIgnoreCase(const char *a, size_t n, const char *b) {
+  return strlen(b) == n && strncasecmp(a, b, n) == 0;
+}
+
+// How specifically range [r, rEnd) matches type: 3 exact, 2 "type/*",
+// 1 "*/*", 0 not at all.
+int matchLevel(const char *r, const char *rEnd, const char *type) {
+  const char *slash = static_cast<const char *>(memchr(r, '/', rEnd - r));
+  const char *typeSlash = strchr(type, '/');
+  if (!slash || !typeSlash) return 0;
+  const size_t mainLen = slash - r;
+  const size_t subLen = rEnd - slash - 1;
+  if (mainLen == 1 && *r == '*') return subLen == 1 && slash[1] == '*' ? 1 : 0;
+  if (mainLen != static_cast<size_t>(typeSlash - type) || strncasecmp(r, type, mainLen) != 0) return 0;
+  if (subLen == 1 && slash[1] == '*') return 2;
+  return equalsIgnoreCase(slash + 1, subLen, typeSlash + 1) ? 3 : 0;
+}
+
+// q parameter of the parameters in [p, end); 1 when absent or malformed.
+float qualityParam(const char *p, const char *end) {
+  while (p < end) {
+    const char *next = static_cast<const char *>(memchr(p, ';', end - p));
+    if (!next) next = end;
+    const char *name = skipSpace(p, next);
+    if (next - name >= 2 && (name[0] == 'q' || name[0] == 'Q') && name[1] == '=') {
+      char tmp[8] = {};
+      const size_t n = static_cast<size_t>(next - name - 2) < sizeof(tmp) - 1 ? next - name - 2 : sizeof(tmp) - 1;
+      memcpy(tmp, name + 2, n);
+      char *parsed = nullptr;
+      const float q = strtof(tmp, &parsed);
+      if (parsed == tmp) return 1.0f;
+      return q < 0.0f ? 0.0f : (q > 1.0f ? 1.0f : q);
+    }
+    p = next + 1;
+  }
+  return 1.0f;
+}
+}
+
+float acceptQuality(const char *accept, const char *type) {
+  if (!accept) return 1.0f;
+  const char *p = skipSpace(accept, accept + strlen(accept));
+  if (!*p) return 1.0f;
+  int bestLevel = 0;
+  float best = 0.0f;
+  while (*p) {
+    const char *end = strchr(p, ',');
+    if (!end) end = p + strlen(p);
+    const char *params = static_cast<const char *>(memchr(p, ';', end - p));
+    const char *rangeBegin = skipSpace(p, end);
+    const char *rangeEnd = trimEnd(rangeBegin, params ? params : end);
+    const int level = matchLevel(rangeBegin, rangeEnd, type);
+    if (level > bestLevel) {
+      bestLevel = level;
+      best = params ? qualityParam(params + 1, end) : 1.0f;
+    }
+    p = *end ? end + 1 : end;
+  }
+  return best;
+}
+
+bool prefersMsgPack(const char *accept) {
+  static const char *const MSGPACK_TYPES[] = {"application/msgpack", "application/x-msgpack", "application/vnd.msgpack"};
+  float msgpack = 0.0f;
+  for (const char *type : MSGPACK_TYPES) {
+    const float q = acceptQuality(accept, type);
+    if (q > msgpack) msgpack = q;
+  }
+  return msgpack > 0.0f && msgpack > acceptQuality(accept, "application/json");
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Content negotiation on the Accept request header (RFC 9110 12.5.1).
+
+// Quality (0..1) that the Accept value gives type ("application/json"):
+// the q of the most specific media range matching it, 1 when q is absent,
+// 0 when no range matches. An empty or missing header accepts everything.
+float acceptQuality(const char *accept, const char *type);
+
+// True when accept ranks a MessagePack type (application/msgpack,
+// x-msgpack or vnd.msgpack) strictly above application/json; JSON wins
+// ties, so "*/*" and "application/msgpack;q=0" both get JSON.
+bool prefersMsgPack(const char *accept);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+// Bounded lock-free multi-producer, single-consumer queue. Any task may
+// post(); only the task that owns the target state calls drain(), so
+// commands are applied in its own context, in posting order, and the state
+// needs no lock. Each cell carries a sequence number (Vyukov's bounded
+// queue): producers claim a position with one CAS and publish the cell by
+// bumping its sequence, so a slow producer never blocks the others.
+template <typename T, size_t N>
+class CommandQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  CommandQueue() {
+    for (size_t i = 0; i < N; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // False when the queue is full; the command is dropped.
+  bool post(T cmd) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells[pos & (N - 1)];
+      const size_t seq = cell.seq.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(cmd);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Owner task only. Calls apply(T &) for up to max commands; returns how
+  // many ran. A command posted meanwhile waits for the next drain.
+  template <typename Fn>
+  size_t drain(Fn apply, size_t max = N) {
+    // Positions claimed after this point belong to the next drain, so an
+    // apply() that posts cannot keep this one going.
+    const size_t end = head.load(std::memory_order_relaxed);
+    size_t n = 0;
+    while (n < max && tail != end) {
+      Cell &cell = cells[tail & (N - 1)];
+      if (cell.seq.load(std::memory_order_acquire) != tail + 1) break;
+      T cmd = std::move(cell.value);
+      cell.value = T();
+      cell.seq.store(tail + N, std::memory_order_release);
+      ++tail;
+      ++n;
+      apply(cmd);
+    }
+    return n;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  Cell cells[N];
+  std::atomic<size_t> head{0};
+  size_t tail = 0;
+};
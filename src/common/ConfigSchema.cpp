@@ -0,0 +1,248 @@
+#include "ConfigSchema.h"
+
+namespace {
+bool inRange(double v, int32_t min, int32_t max) { return v >= min && v <= max; }
+
+template <typename U>
+bool readInteger(void *value, JsonVariantConst in, int32_t min, int32_t max) {
+  if (!in.is<double>()) return false;
+  const double v = in.as<double>();
+  if (!inRange(v, min, max)) return false;
+  *static_cast<U *>(value) = static_cast<U>(v);
+  return true;
+}
+
+template <typename U>
+void keepInRange(U *value, U stored, int32_t min, int32_t max) {
+  if (inRange(stored, min, max)) *value = stored;
+}
+
+constexpr size_t PACKED_HEADER = 3; // hash (LE) + type
+
+// Fixed value size per type; strings carry a length byte instead.
+size_t packedSize(ConfigType type) {
+  switch (type) {
+    case ConfigType::Bool:
+    case ConfigType::U8:
+      return 1;
+    case ConfigType::U16:
+      return 2;
+    case ConfigType::U32:
+      return 4;
+    case ConfigType::Double:
+      return 8;
+    case ConfigType::Str:
+    case ConfigType::Rgb:
+      break;
+  }
+  return 0;
+}
+}
+
+namespace ConfigBinding {
+
+bool read(ConfigType type, void *value, JsonVariantConst in, int32_t min, int32_t max) {
+  switch (type) {
+    case ConfigType::Bool:
+      if (!in.is<bool>()) return false;
+      *static_cast<bool *>(value) = in.as<bool>();
+      return true;
+    case ConfigType::U8:
+      return readInteger<uint8_t>(value, in, min, max);
+    case ConfigType::U16:
+      return readInteger<uint16_t>(value, in, min, max);
+    case ConfigType::U32:
+      return readInteger<uint32_t>(value, in, min, max);
+    case ConfigType::Double: {
+      if (!in.is<double>()) return false;
+      const double v = in.as<double>();
+      if (isnan(v) || !inRange(v, min, max)) return false;
+      *static_cast<double *>(value) = v;
+      return true;
+    }
+    case ConfigType::Str: {
+      if (!in.is<const char *>()) return false;
+      const char *s = in.as<const char *>();
+      if (max > 0 && strlen(s) > static_cast<size_t>(max)) return false;
+      *static_cast<String *>(value) = s;
+      return true;
+    }
+    case ConfigType::Rgb: {
+      if (!in.is<JsonArrayConst>()) return false;
+      JsonArrayConst arr = in.as<JsonArrayConst>();
+      if (arr.size() < 3) return false;
+      uint8_t *rgb = static_cast<uint8_t *>(value);
+      for (size_t i = 0; i < 3; ++i) {
+        const uint32_t c = arr[i].as<uint32_t>();
+        rgb[i] = c > 255 ? 255 : static_cast<uint8_t>(c);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void write(ConfigType type, const void *value, JsonVariant out) {
+  switch (type) {
+    case ConfigType::Bool:
+      out.set(*static_cast<const bool *>(value));
+      break;
+    case ConfigType::U8:
+      out.set(*static_cast<const uint8_t *>(value));
+      break;
+    case ConfigType::U16:
+      out.set(*static_cast<const uint16_t *>(value));
+      break;
+    case ConfigType::U32:
+      out.set(*static_cast<const uint32_t *>(value));
+      break;
+    case ConfigType::Double:
+      out.set(*static_cast<const double *>(value));
+      break;
+    case ConfigType::Str:
+      out.set(*static_cast<const String *>(value));
+      break;
+    case ConfigType::Rgb: {
+      const uint8_t *rgb = static_cast<const uint8_t *>(value);
+      JsonArray arr = out.to<JsonArray>();
+      arr.add(rgb[0]);
+      arr.add(rgb[1]);
+      arr.add(rgb[2]);
+      break;
+    }
+  }
+}
+
+void load(ConfigType type, void *value, Preferences &prefs, const char *key, int32_t min, int32_t max) {
+  switch (type) {
+    case ConfigType::Bool: {
+      bool *v = static_cast<bool *>(value);
+      *v = prefs.getBool(key, *v);
+      break;
+    }
+    case ConfigType::U8: {
+      uint8_t *v = static_cast<uint8_t *>(value);
+      keepInRange(v, prefs.getUChar(key, *v), min, max);
+      break;
+    }
+    case ConfigType::U16: {
+      uint16_t *v = static_cast<uint16_t *>(value);
+      keepInRange(v, prefs.getUShort(key, *v), min, max);
+      break;
+    }
+    case ConfigType::U32: {
+      uint32_t *v = static_cast<uint32_t *>(value);
+      keepInRange(v, static_cast<uint32_t>(prefs.getULong(key, *v)), min, max);
+      break;
+    }
+    case ConfigType::Double: {
+      double *v = static_cast<double *>(value);
+      const double stored = prefs.getDouble(key, *v);
+      if (!isnan(stored) && inRange(stored, min, max)) *v = stored;
+      break;
+    }
+    case ConfigType::Str: {
+      String *v = static_cast<String *>(value);
+      String stored = prefs.getString(key, *v);
+      if (max <= 0 || stored.length() <= static_cast<size_t>(max)) *v = stored;
+      break;
+    }
+    case ConfigType::Rgb:
+      break;
+  }
+}
+
+void save(ConfigType type, const void *value, Preferences &prefs, const char *key) {
+  switch (type) {
+    case ConfigType::Bool:
+      prefs.putBool(key, *static_cast<const bool *>(value));
+      break;
+    case ConfigType::U8:
+      prefs.putUChar(key, *static_cast<const uint8_t *>(value));
+      break;
+    case ConfigType::U16:
+      prefs.putUShort(key, *static_cast<const uint16_t *>(value));
+      break;
+    case ConfigType::U32:
+      prefs.putULong(key, *static_cast<const uint32_t *>(value));
+      break;
+    case ConfigType::Double:
+      prefs.putDouble(key, *static_cast<const double *>(value));
+      break;
+    case ConfigType::Str:
+      prefs.putString(key, *static_cast<const String *>(value));
+      break;
+    case ConfigType::Rgb:
+      break;
+  }
+}
+
+size_t pack(ConfigType type, const void *value, uint16_t hash, uint8_t *out, size_t room) {
+  if (type == ConfigType::Rgb) return 0;
+  const String *str = type == ConfigType::Str ? static_cast<const String *>(value) : nullptr;
+  if (str && str->length() > 255) return 0;
+  const size_t n = str ? 1 + str->length() : packedSize(type);
+  if (room < PACKED_HEADER + n) return 0;
+  out[0] = static_cast<uint8_t>(hash);
+  out[1] = static_cast<uint8_t>(hash >> 8);
+  out[2] = static_cast<uint8_t>(type);
+  if (str) {
+    out[3] = static_cast<uint8_t>(str->length());
+    memcpy(out + 4, str->c_str(), str->length());
+  } else {
+    memcpy(out + PACKED_HEADER, value, n); // native order; only this chip reads it back
+  }
+  return PACKED_HEADER + n;
+}
+
+size_t nextPacked(const uint8_t *in, size_t len, uint16_t &hash, ConfigType &type, const uint8_t *&value) {
+  if (len < PACKED_HEADER + 1) return 0;
+  hash = static_cast<uint16_t>(in[0] | (in[1] << 8));
+  type = static_cast<ConfigType>(in[2]);
+  value = in + PACKED_HEADER;
+  size_t n = packedSize(type);
+  if (type == ConfigType::Str) n = 1 + in[PACKED_HEADER];
+  if (!n || len < PACKED_HEADER + n) return 0;
+  return PACKED_HEADER + n;
+}
+
+void unpack(ConfigType type, void *value, const uint8_t *in, int32_t min, int32_t max) {
+  switch (type) {
+    case ConfigType::Bool:
+      *static_cast<bool *>(value) = in[0] != 0;
+      break;
+    case ConfigType::U8:
+      keepInRange(static_cast<uint8_t *>(value), in[0], min, max);
+      break;
+    case ConfigType::U16: {
+      uint16_t v;
+      memcpy(&v, in, sizeof(v));
+      keepInRange(static_cast<uint16_t *>(value), v, min, max);
+      break;
+    }
+    case ConfigType::U32: {
+      uint32_t v;
+      memcpy(&v, in, sizeof(v));
+      keepInRange(static_cast<uint32_t *>(value), v, min, max);
+      break;
+    }
+    case ConfigType::Double: {
+      double v;
+      memcpy(&v, in, sizeof(v));
+      if (!isnan(v) && inRange(v, min, max)) *static_cast<double *>(value) = v;
+      break;
+    }
+    case ConfigType::Str: {
+      const size_t n = in[0];
+      if (max > 0 && n > static_cast<size_t>(max)) break;
+      String &dst = *static_cast<String *>(value);
+      dst = String();
+      dst.concat(reinterpret_cast<const char *>(in + 1), n);
+      break;
+    }
+    case ConfigType::Rgb:
+      break;
+  }
+}
+
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <string.h>
+#include <type_traits>
+
+// Table-driven binding between a config struct and its JSON, MQTT command
+// and NVS representations. Each struct gets one constexpr ConfigField table
+// (built with CONFIG_FIELD / CONFIG_RGB) naming the member, its keys and its
+// accepted range; ConfigSchema walks that table for every direction, so the
+// HTTP API, MQTT commands and persistence cannot drift apart.
+//
+// Values outside [min, max] (or of the wrong JSON type) are ignored and the
+// member keeps its previous value; on load the same rule applies to whatever
+// is stored in NVS. Keys that are not in the table are left to the caller.
+//
+// encode()/decode() give the packed form ConfigStore keeps as one NVS blob:
+// per persisted field a 16-bit hash of its NVS key, the type and the value.
+// Entries are matched by hash and type, so fields can be added or dropped
+// without invalidating blobs written by other firmware versions.
+enum class ConfigType : uint8_t {
+  Bool,
+  U8,     // also uint8_t-backed enums
+  U16,
+  U32,
+  Double,
+  Str,    // max is the length limit, 0 for none
+  Rgb,    // three consecutive uint8_t members as [r, g, b], JSON only
+};
+
+// Which key a payload is matched against.
+enum class ConfigKeys : uint8_t {
+  Json,
+  Mqtt,
+};
+
+template <typename T>
+struct ConfigField {
+  const char *json;  // HTTP API key; null if not exposed
+  const char *mqtt;  // short MQTT command key; null if not settable over MQTT
+  const char *nvs;   // Preferences key (max 15 chars); null if not persisted
+  uint16_t nvsHash;  // configKeyHash(nvs), the field's id in the packed form
+  ConfigType type;
+  void *(*ref)(T &cfg);
+  int32_t min;
+  int32_t max;
+};
+
+template <typename M, bool = std::is_enum<M>::value>
+struct ConfigTypeOf;
+template <typename M>
+struct ConfigTypeOf<M, true> : ConfigTypeOf<typename std::underlying_type<M>::type> {};
+template <> struct ConfigTypeOf<bool, false> { static constexpr ConfigType value = ConfigType::Bool; };
+template <> struct ConfigTypeOf<uint8_t, false> { static constexpr ConfigType value = ConfigType::U8; };
+template <> struct ConfigTypeOf<uint16_t, false> { static constexpr ConfigType value = ConfigType::U16; };
+template <> struct ConfigTypeOf<uint32_t, false> { static constexpr ConfigType value = ConfigType::U32; };
+template <> struct ConfigTypeOf<double, false> { static constexpr ConfigType value = ConfigType::Double; };
+template <> struct ConfigTypeOf<String, false> { static constexpr ConfigType value = ConfigType::Str; };
+
+template <typename T, typename M, M T::*P>
+void *configMember(T &cfg) { return &(cfg.*P); }
+
+// FNV-1a folded to 16 bits.
+constexpr uint32_t configFnv(const char *s, uint32_t h) {
+  return *s ? configFnv(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619u) : h;
+}
+constexpr uint16_t configFold(uint32_t h) { return static_cast<uint16_t>(h ^ (h >> 16)); }
+constexpr uint16_t configKeyHash(const char *key) { return key ? configFold(configFnv(key, 2166136261u)) : 0; }
+
+// The type tag follows the member's declared type, so a table entry cannot
+// disagree with the struct.
+#define CONFIG_FIELD(T, member, json, mqtt, nvs, lo, hi) \
+  ConfigField<T>{json, mqtt, nvs, configKeyHash(nvs), ConfigTypeOf<decltype(T::member)>::value, \
+                 &configMember<T, decltype(T::member), &T::member>, lo, hi}
+#define CONFIG_RGB(T, first, json, mqtt) \
+  ConfigField<T>{json, mqtt, nullptr, 0, ConfigType::Rgb, &configMember<T, uint8_t, &T::first>, 0, 255}
+
+// Per-field conversions behind ConfigSchema; value points at the member.
+namespace ConfigBinding {
+bool read(ConfigType type, void *value, JsonVariantConst in, int32_t min, int32_t max);
+void write(ConfigType type, const void *value, JsonVariant out);
+void load(ConfigType type, void *value, Preferences &prefs, const char *key, int32_t min, int32_t max);
+void save(ConfigType type, const void *value, Preferences &prefs, const char *key);
+// Packed entries; pack returns the bytes written, 0 if out does not fit.
+size_t pack(ConfigType type, const void *value, uint16_t hash, uint8_t *out, size_t room);
+// Splits off the entry at in; returns its total size, 0 if malformed.
+size_t nextPacked(const uint8_t *in, size_t len, uint16_t &hash, ConfigType &type, const uint8_t *&value);
+void unpack(ConfigType type, void *value, const uint8_t *in, int32_t min, int32_t max);
+}
+
+struct ConfigApplyResult {
+  uint8_t applied = 0;
+  uint8_t rejected = 0;
+};
+
+template <typename T>
+class ConfigSchema {
+public:
+  // Fixes up a decoded config written under an older version; needed only
+  // when a field's meaning changes, not when fields come or go.
+  typedef void (*Migration)(T &cfg, uint8_t fromVersion);
+
+  template <size_t N>
+  constexpr ConfigSchema(const ConfigField<T> (&table)[N], uint8_t version = 1, Migration migrate = nullptr)
+      : fields(table), count(N), ver(version), migration(migrate) {}
+
+  uint8_t version() const { return ver; }
+  void migrate(T &cfg, uint8_t fromVersion) const {
+    if (migration && fromVersion < ver) migration(cfg, fromVersion);
+  }
+
+  // One pass over obj: each member whose key names a field is range-checked
+  // and stored into cfg.
+  ConfigApplyResult apply(JsonObjectConst obj, T &cfg, ConfigKeys keys = ConfigKeys::Json) const {
+    ConfigApplyResult result;
+    for (JsonPairConst kv : obj) {
+      const ConfigField<T> *f = find(kv.key().c_str(), keys);
+      if (!f) continue;
+      if (ConfigBinding::read(f->type, f->ref(cfg), kv.value(), f->min, f->max)) {
+        ++result.applied;
+      } else {
+        ++result.rejected;
+      }
+    }
+    return result;
+  }
+
+  // Adds every field with a JSON key to obj, in table order.
+  void write(JsonObject obj, const T &cfg) const {
+    T &src = const_cast<T &>(cfg);
+    for (size_t i = 0; i < count; ++i) {
+      const ConfigField<T> &f = fields[i];
+      if (f.json) ConfigBinding::write(f.type, f.ref(src), obj[f.json].template to<JsonVariant>());
+    }
+  }
+
+  // Persisted fields; load keeps the current value for absent keys. prefs
+  // must already be open on the owner's namespace.
+  void load(Preferences &prefs, T &cfg) const {
+    for (size_t i = 0; i < count; ++i) {
+      const ConfigField<T> &f = fields[i];
+      if (f.nvs) ConfigBinding::load(f.type, f.ref(cfg), prefs, f.nvs, f.min, f.max);
+    }
+  }
+  void save(Preferences &prefs, const T &cfg) const {
+    T &src = const_cast<T &>(cfg);
+    for (size_t i = 0; i < count; ++i) {
+      const ConfigField<T> &f = fields[i];
+      if (f.nvs) ConfigBinding::save(f.type, f.ref(src), prefs, f.nvs);
+    }
+  }
+
+  // Packs every persisted field; 0 when out is too small.
+  size_t encode(const T &cfg, uint8_t *out, size_t cap) const {
+    T &src = const_cast<T &>(cfg);
+    size_t len = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const ConfigField<T> &f = fields[i];
+      if (!f.nvs) continue;
+      const size_t n = ConfigBinding::pack(f.type, f.ref(src), f.nvsHash, out + len, cap - len);
+      if (!n) return 0;
+      len += n;
+    }
+    return len;
+  }
+  // Unknown or mistyped entries are skipped; fields without one keep their value.
+  void decode(const uint8_t *in, size_t len, T &cfg) const {
+    size_t pos = 0;
+    while (pos < len) {
+      uint16_t hash;
+      ConfigType type;
+      const uint8_t *value;
+      const size_t n = ConfigBinding::nextPacked(in + pos, len - pos, hash, type, value);
+      if (!n) break;
+      for (size_t i = 0; i < count; ++i) {
+        const ConfigField<T> &f = fields[i];
+        if (f.nvs && f.nvsHash == hash && f.type == type) {
+          ConfigBinding::unpack(type, f.ref(cfg), value, f.min, f.max);
+          break;
+        }
+      }
+      pos += n;
+    }
+  }
+
+  // Over MQTT a settable field answers to its MQTT key and its JSON key.
+  const ConfigField<T> *find(const char *key, ConfigKeys keys) const {
+    for (size_t i = 0; i < count; ++i) {
+      const ConfigField<T> &f = fields[i];
+      if (keys == ConfigKeys::Mqtt) {
+        if (!f.mqtt) continue;
+        if (strcmp(f.mqtt, key) == 0) return &f;
+      }
+      if (f.json && strcmp(f.json, key) == 0) return &f;
+    }
+    return nullptr;
+  }
+
+private:
+  const ConfigField<T> *fields;
+  size_t count;
+  uint8_t ver;
+  Migration migration;
+};
@@ -0,0 +1,109 @@
+#include "ConfigStore.h"
+
+#include "Crc32.h"
+
+namespace {
+constexpr const char *BLOB_KEY = "cfg";
+constexpr uint8_t MAGIC = 0xC5;
+}
+
+bool ConfigStore::begin() {
+  if (!mutex) mutex = xSemaphoreCreateMutex();
+  return mutex != nullptr;
+}
+
+bool ConfigStore::readBlob(uint8_t *raw, size_t &len, uint8_t &version) {
+  Preferences prefs;
+  if (!prefs.begin(ns, true)) return false;
+  const size_t n = prefs.getBytes(BLOB_KEY, raw, HEADER + CAPACITY);
+  prefs.end();
+  if (n < HEADER || raw[0] != MAGIC) return false;
+  len = raw[2] | (raw[3] << 8);
+  uint32_t crc;
+  memcpy(&crc, raw + 4, sizeof(crc));
+  if (HEADER + len != n || crc32(raw + HEADER, len) != crc) {
+    Serial.printf("ConfigStore: %s blob corrupt, using per-key settings\n", ns);
+    return false;
+  }
+  version = raw[1];
+  persistedLen = len;
+  persistedCrc = crc;
+  persistedVersion = version;
+  return true;
+}
+
+void ConfigStore::settle(size_t len, uint8_t version) {
+  if (!len) {
+    Serial.printf("ConfigStore: %s config exceeds %u bytes, not saved\n", ns, static_cast<unsigned>(CAPACITY));
+    dirty = false;
+    return;
+  }
+  stagedLen = len;
+  stagedVersion = version;
+  if (len == persistedLen && version == persistedVersion && crc32(staged, len) == persistedCrc) {
+    dirty = false; // back to what flash holds
+    return;
+  }
+  const unsigned long now = millis();
+  if (!dirty) firstDirtyMs = now;
+  lastDirtyMs = now;
+  dirty = true;
+}
+
+void ConfigStore::loop() {
+  if (!dirty) return;
+  const unsigned long now = millis();
+  if (now - lastDirtyMs < DEBOUNCE_MS && now - firstDirtyMs < MAX_DEFER_MS) return;
+  commit();
+}
+
+void ConfigStore::flush() {
+  if (dirty) commit();
+}
+
+bool ConfigStore::commit() {
+  uint8_t raw[HEADER + CAPACITY];
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (!dirty) {
+    xSemaphoreGive(mutex);
+    return true;
+  }
+  const size_t len = stagedLen;
+  const uint8_t version = stagedVersion;
+  memcpy(raw + HEADER, staged, len);
+  const uint32_t crc = crc32(raw + HEADER, len);
+  // Count it as persisted already, so a stage() racing the write compares
+  // against what flash is about to hold.
+  persistedLen = len;
+  persistedCrc = crc;
+  persistedVersion = version;
+  dirty = false;
+  xSemaphoreGive(mutex);
+
+  raw[0] = MAGIC;
+  raw[1] = version;
+  raw[2] = static_cast<uint8_t>(len);
+  raw[3] = static_cast<uint8_t>(len >> 8);
+  memcpy(raw + 4, &crc, sizeof(crc));
+
+  Preferences prefs;
+  bool ok = prefs.begin(ns, false);
+  if (ok) {
+    ok = prefs.putBytes(BLOB_KEY, raw, HEADER + len) == HEADER + len;
+    prefs.end();
+  }
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (ok) {
+    ++written;
+  } else {
+    // Flash content is unknown now. Retry after another debounce window;
+    // staged holds this payload or a newer one.
+    Serial.printf("ConfigStore: writing %s failed\n", ns);
+    persistedLen = 0;
+    if (!dirty) firstDirtyMs = lastDirtyMs = millis();
+    dirty = true;
+  }
+  xSemaphoreGive(mutex);
+  return ok;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "ConfigSchema.h"
+
+// One config struct persisted as a single NVS blob under key "cfg" in the
+// owner's namespace: an 8-byte header (magic, schema version, payload
+// length, CRC-32 of the payload) followed by ConfigSchema::encode() output.
+// Boot reads it with one getBytes(); a missing or corrupt blob falls back
+// to the per-key layout of older firmware and is rewritten at once.
+//
+// stage() encodes the new config and only marks the store dirty when the
+// payload differs from what flash holds. loop() commits once no update
+// arrived for DEBOUNCE_MS (or MAX_DEFER_MS after the first one), so a burst
+// of slider moves costs one NVS write. stage() may run on any task; the NVS
+// write happens on the caller of loop() or flush().
+class ConfigStore {
+public:
+  static constexpr size_t CAPACITY = 768;         // payload bytes
+  static constexpr uint32_t DEBOUNCE_MS = 1500;
+  static constexpr uint32_t MAX_DEFER_MS = 10000;
+
+  explicit ConfigStore(const char *ns) : ns(ns) {}
+
+  template <typename T>
+  void load(const ConfigSchema<T> &schema, T &cfg);
+  template <typename T>
+  void stage(const ConfigSchema<T> &schema, const T &cfg);
+
+  void loop();
+  // Commits a staged config now, e.g. before a restart.
+  void flush();
+  bool pending() const { return dirty; }
+  uint32_t commits() const { return written; }
+
+private:
+  static constexpr size_t HEADER = 8;
+
+  bool begin();
+  // One NVS read into raw (HEADER + CAPACITY); false if absent or corrupt.
+  bool readBlob(uint8_t *raw, size_t &len, uint8_t &version);
+  // Settles the payload just encoded into staged (len 0: did not fit).
+  void settle(size_t len, uint8_t version);
+  bool commit();
+
+  const char *ns;
+  SemaphoreHandle_t mutex = nullptr;
+  uint8_t staged[CAPACITY];
+  size_t stagedLen = 0;
+  uint8_t stagedVersion = 0;
+  volatile bool dirty = false;
+  unsigned long firstDirtyMs = 0;
+  unsigned long lastDirtyMs = 0;
+
+  size_t persistedLen = 0;
+  uint32_t persistedCrc = 0;
+  uint8_t persistedVersion = 0;
+  uint32_t written = 0;
+};
+
+template <typename T>
+void ConfigStore::load(const ConfigSchema<T> &schema, T &cfg) {
+  if (!begin()) return;
+  uint8_t raw[HEADER + CAPACITY];
+  size_t len = 0;
+  uint8_t version = 0;
+  if (readBlob(raw, len, version)) {
+    schema.decode(raw + HEADER, len, cfg);
+    schema.migrate(cfg, version);
+    // Re-encoding also picks up fields added since the blob was written.
+    stage(schema, cfg);
+    return;
+  }
+  Preferences prefs;
+  if (prefs.begin(ns, true)) {
+    schema.load(prefs, cfg);
+    prefs.end();
+  }
+  stage(schema, cfg);
+  flush();
+}
+
+template <typename T>
+void ConfigStore::stage(const ConfigSchema<T> &schema, const T &cfg) {
+  if (!begin()) return;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const size_t len = schema.encode(cfg, staged, CAPACITY);
+  settle(len, schema.version());
+  xSemaphoreGive(mutex);
+}
@@ -0,0 +1,293 @@
+#include "JsonStreamParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+bool isNumberChar(char c) { return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; }
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+}
+
+void JsonStreamParser::begin(Callback cb, void *ctx) {
+  *this = JsonStreamParser();
+  callback = cb;
+  context = ctx;
+}
+
+bool JsonStreamParser::feed(const char *data, size_t len) {
+  for (size_t i = 0; i < len && state != State::Error; ++i) {
+    while (!step(data[i])) {
+    }
+    ++consumed;
+  }
+  return state != State::Error;
+}
+
+bool JsonStreamParser::finish() {
+  if (state == State::Number) {
+    finishNumber();
+  } else if (state == State::Literal) {
+    finishLiteral();
+  }
+  if (state == State::Done) return true;
+  if (state != State::Error) fail("unexpected end of input");
+  return false;
+}
+
+void JsonStreamParser::fail(const char *message) {
+  if (state == State::Error) return;
+  state = State::Error;
+  err = message;
+}
+
+bool JsonStreamParser::step(char c) {
+  switch (state) {
+    case State::Value:
+    case State::ValueOrEnd:
+      if (isSpace(c)) return true;
+      if (state == State::ValueOrEnd && c == ']') {
+        pop(true);
+        return true;
+      }
+      tokenLen = 0;
+      token[0] = '\0';
+      tokenTruncated = false;
+      if (c == '{') {
+        push(false);
+      } else if (c == '[') {
+        push(true);
+      } else if (c == '"') {
+        stringIsKey = false;
+        state = State::String;
+      } else if (c == '-' || (c >= '0' && c <= '9')) {
+        appendToken(c);
+        state = State::Number;
+      } else if (c == 't' || c == 'f' || c == 'n') {
+        appendToken(c);
+        state = State::Literal;
+      } else {
+        fail("unexpected character");
+      }
+      return true;
+
+    case State::KeyOrEnd:
+    case State::Key:
+      if (isSpace(c)) return true;
+      if (state == State::KeyOrEnd && c == '}') {
+        pop(false);
+      } else if (c == '"') {
+        tokenLen = 0;
+        token[0] = '\0';
+        tokenTruncated = false;
+        stringIsKey = true;
+        state = State::String;
+      } else {
+        fail("expected key");
+      }
+      return true;
+
+    case State::Colon:
+      if (isSpace(c)) return true;
+      if (c == ':') {
+        state = State::Value;
+      } else {
+        fail("expected ':'");
+      }
+      return true;
+
+    case State::AfterValue: {
+      if (isSpace(c)) return true;
+      const bool inArray = stack[levels - 1].array;
+      if (c == ',') {
+        state = inArray ? State::Value : State::Key;
+      } else if (c == (inArray ? ']' : '}')) {
+        pop(inArray);
+      } else {
+        fail(inArray ? "expected ',' or ']'" : "expected ',' or '}'");
+      }
+      return true;
+    }
+
+    case State::String:
+      if (c == '"') {
+        if (stringIsKey) {
+          Level &top = stack[levels - 1];
+          if (tokenTruncated || tokenLen >= MAX_KEY) {
+            top.key[0] = '\0';
+          } else {
+            memcpy(top.key, token, tokenLen + 1);
+          }
+          state = State::Colon;
+        } else {
+          emitScalar(ValueType::String);
+        }
+      } else if (c == '\\') {
+        state = State::Escape;
+      } else if (static_cast<uint8_t>(c) < 0x20) {
+        fail("control character in string");
+      } else {
+        appendToken(c);
+      }
+      return true;
+
+    case State::Escape:
+      state = State::String;
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          appendToken(c);
+          break;
+        case 'b':
+          appendToken('\b');
+          break;
+        case 'f':
+          appendToken('\f');
+          break;
+        case 'n':
+          appendToken('\n');
+          break;
+        case 'r':
+          appendToken('\r');
+          break;
+        case 't':
+          appendToken('\t');
+          break;
+        case 'u':
+          unicode = 0;
+          unicodeDigits = 0;
+          state = State::Unicode;
+          break;
+        default:
+          fail("bad escape");
+      }
+      return true;
+
+    case State::Unicode: {
+      const int v = hexValue(c);
+      if (v < 0) {
+        fail("bad unicode escape");
+        return true;
+      }
+      unicode = static_cast<uint16_t>((unicode << 4) | v);
+      if (++unicodeDigits == 4) {
+        appendUtf8(unicode);
+        state = State::String;
+      }
+      return true;
+    }
+
+    case State::Number:
+      if (isNumberChar(c)) {
+        appendToken(c);
+        if (tokenTruncated) fail("number too long");
+        return true;
+      }
+      return !finishNumber();
+
+    case State::Literal:
+      if (c >= 'a' && c <= 'z') {
+        appendToken(c);
+        if (tokenTruncated) fail("bad literal");
+        return true;
+      }
+      return !finishLiteral();
+
+    case State::Done:
+      if (!isSpace(c)) fail("trailing data");
+      return true;
+
+    case State::Error:
+      return true;
+  }
+  return true;
+}
+
+void JsonStreamParser::push(bool array) {
+  if (levels == MAX_DEPTH) {
+    fail("nested too deep");
+    return;
+  }
+  Level &level = stack[levels++];
+  level.array = array;
+  level.index = 0;
+  level.key[0] = '\0';
+  state = array ? State::ValueOrEnd : State::KeyOrEnd;
+  if (callback) callback(context, *this, array ? Event::BeginArray : Event::BeginObject);
+}
+
+void JsonStreamParser::pop(bool array) {
+  if (callback) callback(context, *this, array ? Event::EndArray : Event::EndObject);
+  --levels;
+  valueDone();
+}
+
+void JsonStreamParser::valueDone() {
+  if (!levels) {
+    state = State::Done;
+    return;
+  }
+  Level &top = stack[levels - 1];
+  if (top.array) ++top.index;
+  state = State::AfterValue;
+}
+
+void JsonStreamParser::emitScalar(ValueType t) {
+  valueType = t;
+  if (callback) callback(context, *this, Event::Value);
+  valueDone();
+}
+
+void JsonStreamParser::appendToken(char c) {
+  if (tokenLen < MAX_TOKEN) {
+    token[tokenLen++] = c;
+    token[tokenLen] = '\0';
+  } else {
+    tokenTruncated = true;
+  }
+}
+
+void JsonStreamParser::appendUtf8(uint16_t cp) {
+  if (cp >= 0xD800 && cp <= 0xDFFF) {
+    appendToken('?'); // surrogate halves are not recombined
+  } else if (cp < 0x80) {
+    appendToken(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    appendToken(static_cast<char>(0xC0 | (cp >> 6)));
+    appendToken(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    appendToken(static_cast<char>(0xE0 | (cp >> 12)));
+    appendToken(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    appendToken(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+bool JsonStreamParser::finishNumber() {
+  char *end = nullptr;
+  num = strtod(token, &end);
+  if (!tokenLen || end != token + tokenLen) {
+    fail("bad number");
+    return false;
+  }
+  emitScalar(ValueType::Number);
+  return true;
+}
+
+bool JsonStreamParser::finishLiteral() {
+  if (strcmp(token, "true") == 0 || strcmp(token, "false") == 0) {
+    flag = token[0] == 't';
+    emitScalar(ValueType::Bool);
+  } else if (strcmp(token, "null") == 0) {
+    emitScalar(ValueType::Null);
+  } else {
+    fail("bad literal");
+    return false;
+  }
+  return true;
+}
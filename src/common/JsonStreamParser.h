@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Push-style JSON tokenizer for request bodies that arrive in chunks: feed()
+// takes any split of the text and reports containers and scalars through a
+// callback as soon as they complete. Nothing is buffered beyond the current
+// token, so memory is fixed no matter how long the document is. Inside the
+// callback the path to the event is available per nesting level: the
+// member key for objects, the element index for arrays.
+//
+// Keys longer than MAX_KEY - 1 read back as "", string values longer than
+// MAX_TOKEN are truncated (truncated() is set). The object is trivially
+// destructible, so it can live in raw request storage.
+class JsonStreamParser {
+public:
+  static constexpr uint8_t MAX_DEPTH = 8;
+  static constexpr size_t MAX_KEY = 24;
+  static constexpr size_t MAX_TOKEN = 63;
+
+  enum class Event : uint8_t {
+    BeginObject,
+    EndObject,
+    BeginArray,
+    EndArray,
+    Value,
+  };
+
+  enum class ValueType : uint8_t {
+    Null,
+    Bool,
+    Number,
+    String,
+  };
+
+  typedef void (*Callback)(void *ctx, const JsonStreamParser &parser, Event event);
+
+  void begin(Callback cb, void *ctx);
+  // False once the input is malformed; later chunks are ignored.
+  bool feed(const char *data, size_t len);
+  // True if exactly one complete value was seen.
+  bool finish();
+
+  bool failed() const { return state == State::Error; }
+  const char *error() const { return err; }
+  size_t offset() const { return consumed; }
+
+  // Path of the current event. depth() counts the open containers, for
+  // Begin*/End* including the one the event is about; level 0 is the
+  // outermost container and the event sits in level depth() - 1 (or, for
+  // Begin*/End*, depth() - 2).
+  uint8_t depth() const { return levels; }
+  bool isArray(uint8_t level) const { return level < levels && stack[level].array; }
+  const char *key(uint8_t level) const { return level < levels && !stack[level].array ? stack[level].key : ""; }
+  uint16_t index(uint8_t level) const { return level < levels ? stack[level].index : 0; }
+
+  // The scalar of a Value event.
+  ValueType type() const { return valueType; }
+  double number() const { return num; }
+  bool boolean() const { return flag; }
+  const char *string() const { return token; }
+  bool truncated() const { return tokenTruncated; }
+
+private:
+  enum class State : uint8_t {
+    Value,        // a value is required
+    ValueOrEnd,   // after '['
+    KeyOrEnd,     // after '{'
+    Key,          // after ',' in an object
+    Colon,
+    AfterValue,   // ',' or the closing bracket
+    String,
+    Escape,
+    Unicode,
+    Number,
+    Literal,
+    Done,
+    Error,
+  };
+
+  struct Level {
+    bool array;
+    uint16_t index;
+    char key[MAX_KEY];
+  };
+
+  // Returns false if c must be looked at again in the new state.
+  bool step(char c);
+  void fail(const char *message);
+  void push(bool array);
+  void pop(bool array);
+  void valueDone();
+  void emitScalar(ValueType t);
+  void appendToken(char c);
+  void appendUtf8(uint16_t cp);
+  bool finishNumber();
+  bool finishLiteral();
+
+  Callback callback = nullptr;
+  void *context = nullptr;
+  State state = State::Value;
+  bool stringIsKey = false;
+  bool tokenTruncated = false;
+  ValueType valueType = ValueType::Null;
+  bool flag = false;
+  uint8_t levels = 0;
+  uint8_t tokenLen = 0;
+  uint8_t unicodeDigits = 0;
+  uint16_t unicode = 0;
+  double num = 0;
+  size_t consumed = 0;
+  const char *err = nullptr;
+  char token[MAX_TOKEN + 1] = {};
+  Level stack[MAX_DEPTH] = {};
+};
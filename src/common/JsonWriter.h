@@ -0,0 +1,258 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#if defined(ARDUINO)
+#include <WString.h>
+#endif
+
+// Streaming JSON writer over a caller-provided buffer: no heap, no document
+// tree. Keys and values are emitted in call order and commas are inserted
+// from a per-level bitmask. Floats always take an explicit number of
+// decimals and NaN/inf become null. On overflow further output is dropped
+// and ok() turns false; the written part stays NUL-terminated.
+//
+// rebind() moves to a new buffer but keeps the nesting state, so a single
+// document can be produced piecewise across stream records.
+class JsonWriter {
+public:
+  static constexpr uint8_t MAX_DEPTH = 16;
+
+  JsonWriter() = default;
+  JsonWriter(char *buffer, size_t capacity) { rebind(buffer, capacity); }
+
+  void rebind(char *buffer, size_t capacity) {
+    buf = buffer;
+    cap = capacity;
+    len = 0;
+    if (buf && cap) buf[0] = '\0';
+  }
+
+  JsonWriter &beginObject() { return open('{'); }
+  JsonWriter &beginObject(const char *k) { return key(k).open('{'); }
+  JsonWriter &endObject() { return close('}'); }
+  JsonWriter &beginArray() { return open('['); }
+  JsonWriter &beginArray(const char *k) { return key(k).open('['); }
+  JsonWriter &endArray() { return close(']'); }
+
+  JsonWriter &key(const char *k) {
+    comma();
+    string(k);
+    put(':');
+    afterKey = true;
+    return *this;
+  }
+
+  // Values. Integers are written exactly; floats need their decimals.
+  template <typename T>
+  JsonWriter &value(T v) {
+    static_assert(!std::is_floating_point<T>::value, "floats need a decimals argument");
+    static_assert(std::is_integral<T>::value, "unsupported JSON value type");
+    separator();
+    if (negative(v, std::is_signed<T>())) {
+      put('-');
+      // Negated as unsigned so INT64_MIN does not overflow.
+      integer(0 - static_cast<uint64_t>(static_cast<int64_t>(v)));
+    } else {
+      integer(static_cast<uint64_t>(v));
+    }
+    return *this;
+  }
+  JsonWriter &value(bool v) {
+    separator();
+    return raw(v ? "true" : "false");
+  }
+  JsonWriter &value(const char *s) {
+    separator();
+    if (s) {
+      string(s);
+    } else {
+      raw("null");
+    }
+    return *this;
+  }
+#if defined(ARDUINO)
+  JsonWriter &value(const String &s) { return value(s.c_str()); }
+#endif
+  JsonWriter &value(double v, uint8_t decimals) {
+    separator();
+    fixed(v, decimals);
+    return *this;
+  }
+  JsonWriter &null() {
+    separator();
+    return raw("null");
+  }
+  // Pre-serialized JSON as one value.
+  JsonWriter &json(const char *text, size_t n) {
+    separator();
+    return raw(text, n);
+  }
+
+  // Object members.
+  template <typename T>
+  JsonWriter &field(const char *k, const T &v) {
+    key(k);
+    return value(v);
+  }
+  JsonWriter &field(const char *k, double v, uint8_t decimals) {
+    key(k);
+    return value(v, decimals);
+  }
+  // Omits the member entirely when v is NaN.
+  JsonWriter &fieldIfFinite(const char *k, double v, uint8_t decimals) {
+    if (isnan(v) || isinf(v)) return *this;
+    return field(k, v, decimals);
+  }
+  // Member whose value fill(dst, room) writes as pre-serialized JSON and
+  // returns its length; 0 writes null.
+  template <typename Fn>
+  JsonWriter &jsonField(const char *k, Fn fill) {
+    key(k);
+    separator();
+    const size_t room = cap > len + 1 ? cap - len - 1 : 0;
+    const size_t n = room ? fill(buf + len, room) : 0;
+    if (n && n <= room) {
+      len += n;
+      buf[len] = '\0';
+    } else {
+      if (n > room) overflow = true;
+      if (buf && cap > len) buf[len] = '\0';
+      raw("null");
+    }
+    return *this;
+  }
+
+  // Unchecked text, e.g. the continuation of a split pre-serialized value.
+  JsonWriter &raw(const char *text) { return raw(text, strlen(text)); }
+  JsonWriter &raw(const char *text, size_t n) {
+    for (size_t i = 0; i < n; ++i) put(text[i]);
+    return *this;
+  }
+
+  const char *c_str() const { return buf ? buf : ""; }
+  size_t size() const { return len; }
+  bool ok() const { return !overflow; }
+  uint8_t level() const { return depth; }
+
+private:
+  template <typename T>
+  static bool negative(T v, std::true_type) { return v < 0; }
+  template <typename T>
+  static bool negative(T, std::false_type) { return false; }
+
+  JsonWriter &open(char c) {
+    separator();
+    put(c);
+    if (depth < MAX_DEPTH) {
+      ++depth;
+      items &= ~(1u << depth);
+    } else {
+      overflow = true;
+    }
+    return *this;
+  }
+
+  JsonWriter &close(char c) {
+    put(c);
+    if (depth) --depth;
+    afterKey = false;
+    return *this;
+  }
+
+  void comma() {
+    if (depth && (items & (1u << depth))) put(',');
+    items |= 1u << depth;
+  }
+
+  // Before a value: members already had their comma written with the key.
+  void separator() {
+    if (afterKey) {
+      afterKey = false;
+      return;
+    }
+    comma();
+  }
+
+  void put(char c) {
+    if (!buf || len + 1 >= cap) {
+      overflow = true;
+      return;
+    }
+    buf[len++] = c;
+    buf[len] = '\0';
+  }
+
+  void string(const char *s) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    put('"');
+    for (const char *p = s; *p; ++p) {
+      const unsigned char c = static_cast<unsigned char>(*p);
+      if (c == '"' || c == '\\') {
+        put('\\');
+        put(static_cast<char>(c));
+      } else if (c == '\n') {
+        put('\\');
+        put('n');
+      } else if (c < 0x20) {
+        raw("\\u00");
+        put(HEX_DIGITS[c >> 4]);
+        put(HEX_DIGITS[c & 0xF]);
+      } else {
+        put(static_cast<char>(c));
+      }
+    }
+    put('"');
+  }
+
+  void integer(uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+      tmp[n++] = static_cast<char>('0' + v % 10);
+      v /= 10;
+    } while (v);
+    while (n) put(tmp[--n]);
+  }
+
+  // Rounds to `decimals` places without printf; very large values fall back to it.
+  void fixed(double v, uint8_t decimals) {
+    static const uint32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    if (isnan(v) || isinf(v)) {
+      raw("null");
+      return;
+    }
+    if (decimals > 6) decimals = 6;
+    const double scaled = fabs(v) * POW10[decimals] + 0.5;
+    if (scaled >= 1e18) {
+      char tmp[40];
+      const int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+      if (n > 0) raw(tmp, static_cast<size_t>(n) < sizeof(tmp) ? n : sizeof(tmp) - 1);
+      return;
+    }
+    const uint64_t units = static_cast<uint64_t>(scaled);
+    if (v < 0 && units) put('-');
+    integer(units / POW10[decimals]);
+    if (!decimals) return;
+    put('.');
+    uint32_t frac = static_cast<uint32_t>(units % POW10[decimals]);
+    for (uint8_t d = decimals; d > 0; --d) {
+      const uint32_t div = POW10[d - 1];
+      put(static_cast<char>('0' + frac / div));
+      frac %= div;
+    }
+  }
+
+  char *buf = nullptr;
+  size_t cap = 0;
+  size_t len = 0;
+  uint32_t items = 0; // bit n: level n already has an element
+  uint8_t depth = 0;
+  bool afterKey = false;
+  bool overflow = false;
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#if defined(ARDUINO)
+#include <WString.h>
+#endif
+
+// MessagePack counterpart of JsonWriter with the same member functions, so
+// a payload builder templated on the writer produces either encoding. The
+// whole document goes into one caller-provided buffer: maps and arrays get
+// a 16-bit count that is filled in when they close. Floats are rounded to
+// the decimals the JSON form would print and sent as float32 when that
+// keeps them exact to those decimals, float64 otherwise; NaN/inf become nil.
+// On overflow further output is dropped and ok() turns false.
+class MsgPackWriter {
+public:
+  static constexpr uint8_t MAX_DEPTH = 16;
+
+  MsgPackWriter() = default;
+  MsgPackWriter(uint8_t *buffer, size_t capacity) : buf(buffer), cap(capacity) {}
+
+  MsgPackWriter &beginObject() { return open(0xDE); }
+  MsgPackWriter &beginObject(const char *k) { return key(k).open(0xDE); }
+  MsgPackWriter &endObject() { return close(); }
+  MsgPackWriter &beginArray() { return open(0xDC); }
+  MsgPackWriter &beginArray(const char *k) { return key(k).open(0xDC); }
+  MsgPackWriter &endArray() { return close(); }
+
+  MsgPackWriter &key(const char *k) {
+    element();
+    string(k);
+    afterKey = true;
+    return *this;
+  }
+
+  template <typename T>
+  MsgPackWriter &value(T v) {
+    static_assert(!std::is_floating_point<T>::value, "floats need a decimals argument");
+    static_assert(std::is_integral<T>::value, "unsupported MessagePack value type");
+    separator();
+    if (negative(v, std::is_signed<T>())) {
+      signedInteger(static_cast<int64_t>(v));
+    } else {
+      unsignedInteger(static_cast<uint64_t>(v));
+    }
+    return *this;
+  }
+  MsgPackWriter &value(bool v) {
+    separator();
+    put(v ? 0xC3 : 0xC2);
+    return *this;
+  }
+  MsgPackWriter &value(const char *s) {
+    separator();
+    if (s) {
+      string(s);
+    } else {
+      put(0xC0);
+    }
+    return *this;
+  }
+#if defined(ARDUINO)
+  MsgPackWriter &value(const String &s) { return value(s.c_str()); }
+#endif
+  MsgPackWriter &value(double v, uint8_t decimals) {
+    separator();
+    number(v, decimals);
+    return *this;
+  }
+  MsgPackWriter &null() {
+    separator();
+    put(0xC0);
+    return *this;
+  }
+  // Value that fill(dst, room) writes as pre-encoded MessagePack and
+  // returns its length; 0 writes nil.
+  template <typename Fn>
+  MsgPackWriter &packed(Fn fill) {
+    separator();
+    const size_t room = cap > len ? cap - len : 0;
+    const size_t n = room ? fill(buf + len, room) : 0;
+    if (n && n <= room) {
+      len += n;
+    } else {
+      if (n > room) overflow = true;
+      put(0xC0);
+    }
+    return *this;
+  }
+
+  template <typename T>
+  MsgPackWriter &field(const char *k, const T &v) {
+    key(k);
+    return value(v);
+  }
+  MsgPackWriter &field(const char *k, double v, uint8_t decimals) {
+    key(k);
+    return value(v, decimals);
+  }
+  MsgPackWriter &fieldIfFinite(const char *k, double v, uint8_t decimals) {
+    if (isnan(v) || isinf(v)) return *this;
+    return field(k, v, decimals);
+  }
+  template <typename Fn>
+  MsgPackWriter &packedField(const char *k, Fn fill) {
+    key(k);
+    return packed(fill);
+  }
+
+  const uint8_t *data() const { return buf; }
+  size_t size() const { return len; }
+  bool ok() const { return !overflow; }
+  uint8_t level() const { return depth; }
+
+private:
+  template <typename T>
+  static bool negative(T v, std::true_type) { return v < 0; }
+  template <typename T>
+  static bool negative(T, std::false_type) { return false; }
+
+  MsgPackWriter &open(uint8_t marker) {
+    separator();
+    if (depth >= MAX_DEPTH) {
+      overflow = true;
+      return *this;
+    }
+    ++depth;
+    start[depth] = len;
+    count[depth] = 0;
+    put(marker);
+    put(0);
+    put(0);
+    return *this;
+  }
+
+  MsgPackWriter &close() {
+    if (!depth) return *this;
+    // A container cut short by overflow has no count to patch.
+    if (start[depth] + 3 <= len) {
+      buf[start[depth] + 1] = static_cast<uint8_t>(count[depth] >> 8);
+      buf[start[depth] + 2] = static_cast<uint8_t>(count[depth]);
+    }
+    --depth;
+    afterKey = false;
+    return *this;
+  }
+
+  // Counts a map member (at its key) or an array element.
+  void element() {
+    if (!depth) return;
+    if (count[depth] == UINT16_MAX) {
+      overflow = true;
+      return;
+    }
+    ++count[depth];
+  }
+
+  void separator() {
+    if (afterKey) {
+      afterKey = false;
+      return;
+    }
+    element();
+  }
+
+  void put(uint8_t b) {
+    if (!buf || len >= cap) {
+      overflow = true;
+      return;
+    }
+    buf[len++] = b;
+  }
+
+  void bigEndian(uint64_t v, uint8_t bytes) {
+    while (bytes) put(static_cast<uint8_t>(v >> (8 * --bytes)));
+  }
+
+  void string(const char *s) {
+    const size_t n = strlen(s);
+    if (n < 32) {
+      put(static_cast<uint8_t>(0xA0 | n));
+    } else if (n <= UINT8_MAX) {
+      put(0xD9);
+      bigEndian(n, 1);
+    } else if (n <= UINT16_MAX) {
+      put(0xDA);
+      bigEndian(n, 2);
+    } else {
+      put(0xDB);
+      bigEndian(n, 4);
+    }
+    for (size_t i = 0; i < n; ++i) put(static_cast<uint8_t>(s[i]));
+  }
+
+  void unsignedInteger(uint64_t v) {
+    if (v < 0x80) {
+      put(static_cast<uint8_t>(v));
+    } else if (v <= UINT8_MAX) {
+      put(0xCC);
+      bigEndian(v, 1);
+    } else if (v <= UINT16_MAX) {
+      put(0xCD);
+      bigEndian(v, 2);
+    } else if (v <= UINT32_MAX) {
+      put(0xCE);
+      bigEndian(v, 4);
+    } else {
+      put(0xCF);
+      bigEndian(v, 8);
+    }
+  }
+
+  void signedInteger(int64_t v) {
+    if (v >= -32) {
+      put(static_cast<uint8_t>(v));
+    } else if (v >= INT8_MIN) {
+      put(0xD0);
+      bigEndian(static_cast<uint64_t>(v), 1);
+    } else if (v >= INT16_MIN) {
+      put(0xD1);
+      bigEndian(static_cast<uint64_t>(v), 2);
+    } else if (v >= INT32_MIN) {
+      put(0xD2);
+      bigEndian(static_cast<uint64_t>(v), 4);
+    } else {
+      put(0xD3);
+      bigEndian(static_cast<uint64_t>(v), 8);
+    }
+  }
+
+  // Zero decimals give an integer, as the JSON form would parse back.
+  void number(double v, uint8_t decimals) {
+    static const double POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    if (isnan(v) || isinf(v)) {
+      put(0xC0);
+      return;
+    }
+    if (decimals > 6) decimals = 6;
+    const double rounded = round(v * POW10[decimals]) / POW10[decimals];
+    if (!decimals && fabs(rounded) < 9.2e18) {
+      const int64_t i = static_cast<int64_t>(rounded);
+      if (i < 0) {
+        signedInteger(i);
+      } else {
+        unsignedInteger(static_cast<uint64_t>(i));
+      }
+      return;
+    }
+    const float narrow = static_cast<float>(rounded);
+    if (fabs(static_cast<double>(narrow) - rounded) * POW10[decimals] < 0.01) {
+      uint32_t bits;
+      memcpy(&bits, &narrow, sizeof(bits));
+      put(0xCA);
+      bigEndian(bits, 4);
+    } else {
+      uint64_t bits;
+      memcpy(&bits, &rounded, sizeof(bits));
+      put(0xCB);
+      bigEndian(bits, 8);
+    }
+  }
+
+  uint8_t *buf = nullptr;
+  size_t cap = 0;
+  size_t len = 0;
+  size_t start[MAX_DEPTH + 1] = {};   // offset of each open container's header
+  uint16_t count[MAX_DEPTH + 1] = {}; // members or elements so far, per level
+  uint8_t depth = 0;
+  bool afterKey = false;
+  bool overflow = false;
+};
@@ -0,0 +1,134 @@
+#include "PerfStats.h"
+
+#include <esp_timer.h>
+
+PerfStats perfStats;
+
+namespace {
+size_t bucketOf(uint32_t us) {
+  const size_t b = us ? 31 - __builtin_clz(us) : 0;
+  return b < RoutePerf::BUCKETS ? b : RoutePerf::BUCKETS - 1;
+}
+}
+
+RoutePerf *PerfStats::route(const char *label) {
+  for (size_t i = 0; i < used; ++i) {
+    if (strcmp(routes[i].label, label) == 0) return &routes[i];
+  }
+  if (used == MAX_ROUTES) {
+    Serial.printf("PerfStats: no slot for %s\n", label);
+    return nullptr;
+  }
+  routes[used].label = label;
+  return &routes[used++];
+}
+
+void PerfStats::enter(RoutePerf *slot) {
+  portENTER_CRITICAL(&lock);
+  ++slot->inFlight;
+  active = slot;
+  portEXIT_CRITICAL(&lock);
+}
+
+void PerfStats::leave(RoutePerf *slot, uint32_t elapsedUs, int32_t heapDelta) {
+  portENTER_CRITICAL(&lock);
+  ++slot->count;
+  ++slot->buckets[bucketOf(elapsedUs)];
+  if (elapsedUs > slot->maxUs) slot->maxUs = elapsedUs;
+  slot->heapDeltaSum += heapDelta;
+  if (heapDelta < slot->heapDeltaMin) slot->heapDeltaMin = heapDelta;
+  if (slot->inFlight) --slot->inFlight;
+  active = nullptr;
+  portEXIT_CRITICAL(&lock);
+}
+
+void PerfStats::hold(RoutePerf *slot) {
+  if (!slot) return;
+  portENTER_CRITICAL(&lock);
+  ++slot->inFlight;
+  portEXIT_CRITICAL(&lock);
+}
+
+void PerfStats::release(RoutePerf *slot) {
+  if (!slot) return;
+  portENTER_CRITICAL(&lock);
+  if (slot->inFlight) --slot->inFlight;
+  portEXIT_CRITICAL(&lock);
+}
+
+void PerfStats::addBytes(RoutePerf *slot, size_t n) {
+  if (!slot) return;
+  portENTER_CRITICAL(&lock);
+  slot->bytes += n;
+  portEXIT_CRITICAL(&lock);
+}
+
+bool PerfStats::summary(size_t index, RoutePerfSummary &out) const {
+  if (index >= used) return false;
+  portENTER_CRITICAL(&lock);
+  const RoutePerf row = routes[index];
+  portEXIT_CRITICAL(&lock);
+
+  out = RoutePerfSummary();
+  out.label = row.label;
+  out.count = row.count;
+  out.inFlight = row.inFlight;
+  out.maxUs = row.maxUs;
+  out.bytes = row.bytes;
+  out.heapDeltaMin = row.heapDeltaMin;
+  if (row.count) {
+    out.heapDeltaAvg = static_cast<int32_t>(row.heapDeltaSum / static_cast<int64_t>(row.count));
+    out.p50Us = percentile(row.buckets, row.count, row.maxUs, 500);
+    out.p95Us = percentile(row.buckets, row.count, row.maxUs, 950);
+    out.p99Us = percentile(row.buckets, row.count, row.maxUs, 990);
+  }
+  return true;
+}
+
+void PerfStats::reset() {
+  portENTER_CRITICAL(&lock);
+  for (size_t i = 0; i < used; ++i) {
+    RoutePerf &r = routes[i];
+    const uint32_t inFlight = r.inFlight;
+    const char *label = r.label;
+    r = RoutePerf();
+    r.label = label;
+    r.inFlight = inFlight;
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+uint32_t PerfStats::percentile(const uint32_t *buckets, uint32_t count, uint32_t maxUs, uint32_t permille) {
+  // Rank of the wanted sample, 1-based, rounded up.
+  const uint64_t rank = (static_cast<uint64_t>(count) * permille + 999) / 1000;
+  uint64_t seen = 0;
+  for (size_t b = 0; b < RoutePerf::BUCKETS; ++b) {
+    if (!buckets[b]) continue;
+    if (seen + buckets[b] < rank) {
+      seen += buckets[b];
+      continue;
+    }
+    // The bucket holding the maximum ends at it, which tightens the tail.
+    const uint64_t lo = b ? 1ULL << b : 0;
+    uint64_t hi = b + 1 < RoutePerf::BUCKETS ? 1ULL << (b + 1) : UINT64_MAX;
+    if (hi > static_cast<uint64_t>(maxUs) + 1) hi = static_cast<uint64_t>(maxUs) + 1;
+    if (hi <= lo) return maxUs;
+    const uint64_t us = lo + (hi - lo) * (rank - seen) / buckets[b];
+    return us < maxUs ? static_cast<uint32_t>(us) : maxUs;
+  }
+  return maxUs;
+}
+
+PerfScope::PerfScope(RoutePerf *slot) : slot(slot), startUs(0), startHeap(0) {
+  if (!slot) return;
+  perfStats.enter(slot);
+  startHeap = ESP.getFreeHeap();
+  startUs = esp_timer_get_time();
+}
+
+PerfScope::~PerfScope() {
+  if (!slot) return;
+  const uint32_t elapsed = static_cast<uint32_t>(esp_timer_get_time() - startUs);
+  const int32_t heapDelta = static_cast<int32_t>(ESP.getFreeHeap()) - static_cast<int32_t>(startHeap);
+  perfStats.leave(slot, elapsed, heapDelta);
+}
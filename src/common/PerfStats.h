@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <utility>
+
+// Per-route HTTP instrumentation. Handlers wrapped with timed() count calls,
+// time the handler body with esp_timer_get_time() into a log2 histogram and
+// record the heap it leaves allocated (negative delta = held, e.g. a queued
+// response). Response bytes are added by the response helpers while the
+// route is current, including chunks of streamed responses sent later.
+// In-flight covers the handler call and, for streamed responses, the body
+// until the response is released; the request's own handlers stay untouched.
+//
+// Slots are claimed while routes are registered and never released; updates
+// run on the async_tcp task under a spinlock, so readers on other tasks see
+// consistent rows.
+struct RoutePerf {
+  static constexpr size_t BUCKETS = 24; // bucket i: [2^i, 2^(i+1)) us, the last one open
+
+  const char *label = nullptr;          // "GET /api/..." (static storage)
+  uint32_t count = 0;
+  uint32_t inFlight = 0;
+  uint32_t maxUs = 0;
+  uint32_t bytes = 0;
+  int64_t heapDeltaSum = 0;
+  int32_t heapDeltaMin = 0;
+  uint32_t buckets[BUCKETS] = {};
+};
+
+// One route, reduced for reporting. Percentiles are interpolated linearly
+// inside their histogram bucket and capped at maxUs.
+struct RoutePerfSummary {
+  const char *label = nullptr;
+  uint32_t count = 0;
+  uint32_t inFlight = 0;
+  uint32_t p50Us = 0;
+  uint32_t p95Us = 0;
+  uint32_t p99Us = 0;
+  uint32_t maxUs = 0;
+  uint32_t bytes = 0;
+  int32_t heapDeltaAvg = 0;
+  int32_t heapDeltaMin = 0;
+};
+
+class PerfStats {
+public:
+  static constexpr size_t MAX_ROUTES = 48;
+
+  // Returns the slot for label, claiming one on first use; null when full.
+  RoutePerf *route(const char *label);
+
+  // Handler entry and exit; the route is current in between.
+  void enter(RoutePerf *slot);
+  void leave(RoutePerf *slot, uint32_t elapsedUs, int32_t heapDelta);
+  // Keeps slot in flight past the handler, e.g. for a streamed body, until
+  // the matching release(). Both accept null.
+  void hold(RoutePerf *slot);
+  void release(RoutePerf *slot);
+  // Adds response bytes to slot, or to the route whose handler is running.
+  void addBytes(RoutePerf *slot, size_t n);
+  void addBytes(size_t n) { addBytes(active, n); }
+  RoutePerf *current() const { return active; }
+
+  size_t size() const { return used; }
+  bool summary(size_t index, RoutePerfSummary &out) const;
+  void reset();
+
+private:
+  static uint32_t percentile(const uint32_t *buckets, uint32_t count, uint32_t maxUs, uint32_t permille);
+
+  RoutePerf routes[MAX_ROUTES];
+  size_t used = 0;
+  RoutePerf *active = nullptr;
+  mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern PerfStats perfStats;
+
+// Times one handler call; see PerfStats.
+class PerfScope {
+public:
+  explicit PerfScope(RoutePerf *slot);
+  ~PerfScope();
+
+private:
+  RoutePerf *slot;
+  int64_t startUs;
+  uint32_t startHeap;
+};
+
+template <typename Fn>
+class TimedHandler {
+public:
+  TimedHandler(RoutePerf *slot, Fn fn) : slot(slot), fn(std::move(fn)) {}
+
+  // Matches every handler signature that starts with the request.
+  template <typename... Args>
+  auto operator()(AsyncWebServerRequest *request, Args &&...args) const
+      -> decltype(std::declval<const Fn &>()(request, std::forward<Args>(args)...), void()) {
+    PerfScope scope(slot);
+    fn(request, std::forward<Args>(args)...);
+  }
+
+private:
+  RoutePerf *slot;
+  Fn fn;
+};
+
+// Wraps a route handler so its calls are recorded under label.
+template <typename Fn>
+TimedHandler<Fn> timed(const char *label, Fn fn) {
+  return TimedHandler<Fn>(perfStats.route(label), std::move(fn));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+// Read-copy-update cell for state that one task replaces and others read,
+// including types that own heap memory (String members). Readers pin the
+// current version with read() and use it in place: no lock, no retry, no
+// copy. publish()/update() build the next version in the spare slot, swap
+// it in with one atomic store and then wait for the readers that may still
+// hold the old version before the slot is reused, so a pinned version never
+// changes underneath its reader.
+//
+// Readers are counted per grace period (epoch parity): a reader that
+// starts after a swap lands in the other counter, so a steady stream of
+// short reads cannot hold up a writer. Writers are serialised by a mutex
+// and may sleep; keep read() guards short and never publish while the same
+// task holds one.
+//
+// Cost: the cell holds two T, and every publish()/update() copies a whole
+// T into the spare slot before editing it, however little changes. Fine
+// for configs; for large T keep updates rare.
+template <typename T>
+class RcuSnapshot {
+public:
+  class Reader {
+  public:
+    Reader(Reader &&other) : owner(other.owner), value(other.value), parity(other.parity) { other.owner = nullptr; }
+    ~Reader() {
+      if (owner) owner->readers[parity].fetch_sub(1, std::memory_order_release);
+    }
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    const T &operator*() const { return *value; }
+    const T *operator->() const { return value; }
+
+  private:
+    friend class RcuSnapshot;
+    Reader(const RcuSnapshot *o, const T *v, uint8_t p) : owner(o), value(v), parity(p) {}
+
+    const RcuSnapshot *owner;
+    const T *value;
+    uint8_t parity;
+  };
+
+  RcuSnapshot() : current(&slots[0]) {}
+  explicit RcuSnapshot(const T &initial) : current(&slots[0]) { slots[0] = initial; }
+
+  Reader read() const {
+    for (;;) {
+      const uint32_t e = epoch.load();
+      readers[e & 1].fetch_add(1);
+      // A writer that flipped the epoch in between may already have
+      // checked this counter; step back and join the new period instead.
+      if (epoch.load() == e) return Reader(this, current.load(), e & 1);
+      readers[e & 1].fetch_sub(1);
+    }
+  }
+
+  T get() const { return *read(); }
+
+  // Bumped by every publish; 0 until the first one.
+  uint32_t version() const { return published.load(std::memory_order_acquire); }
+
+  uint32_t publish(const T &next) {
+    return update([&next](T &value) { value = next; });
+  }
+
+  // edit(value) starts from a copy of the current version. Returns the new
+  // version number.
+  template <typename Fn>
+  uint32_t update(Fn edit) {
+    std::lock_guard<std::mutex> lock(writer);
+    const T *old = current.load();
+    T *next = old == &slots[0] ? &slots[1] : &slots[0];
+    *next = *old;
+    edit(*next);
+    current.store(next);
+    const uint32_t e = epoch.fetch_add(1);
+    const uint32_t v = published.fetch_add(1, std::memory_order_release) + 1;
+    // Every reader still counted in the old period may hold old.
+    while (readers[e & 1].load() != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return v;
+  }
+
+private:
+  T slots[2];
+  std::atomic<const T *> current;
+  std::atomic<uint32_t> epoch{0};
+  std::atomic<uint32_t> published{0};
+  mutable std::atomic<uint32_t> readers[2] = {{0}, {0}};
+  std::mutex writer;
+};
@@ -1,8 +1,229 @@
 #include "ResponseHelpers.h"
 
+#include <math.h>
+#include <memory>
+#include <new>
+#include <stdarg.h>
+
+#include "AcceptHeader.h"
+#include "PerfStats.h"
+
+namespace {
+constexpr const char *MSGPACK_TYPE = "application/msgpack";
+// sendMsgPack() starts here and doubles up to the limit.
+constexpr size_t MSGPACK_INITIAL_BYTES = 1024;
+constexpr size_t MSGPACK_MAX_BYTES = 16384;
+}
+
+bool wantsMsgPack(AsyncWebServerRequest *request) {
+  if (!request->hasHeader("Accept")) return false;
+  return prefersMsgPack(request->getHeader("Accept")->value().c_str());
+}
+
+void sendDocument(AsyncWebServerRequest *request, const JsonDocument &doc, int code) {
+  if (wantsMsgPack(request)) {
+    AsyncResponseStream *response = request->beginResponseStream(MSGPACK_TYPE);
+    response->setCode(code);
+    response->addHeader("Vary", "Accept");
+    perfStats.addBytes(serializeMsgPack(doc, *response));
+    request->send(response);
+    return;
+  }
+  String body;
+  serializeJson(doc, body);
+  perfStats.addBytes(body.length());
+  AsyncWebServerResponse *response = request->beginResponse(code, "application/json", body);
+  response->addHeader("Vary", "Accept");
+  request->send(response);
+}
+
 void sendJson(AsyncWebServerRequest *request, std::function<void(JsonVariant)> fn) {
+  if (wantsMsgPack(request)) {
+    JsonDocument doc;
+    JsonVariant root = doc.to<JsonVariant>();
+    root.to<JsonObject>();
+    fn(root);
+    sendDocument(request, doc);
+    return;
+  }
   AsyncJsonResponse *response = new AsyncJsonResponse(false);
   fn(response->getRoot());
-  response->setLength();
+  perfStats.addBytes(response->setLength());
+  response->addHeader("Vary", "Accept");
+  request->send(response);
+}
+
+void sendMsgPack(AsyncWebServerRequest *request, MsgPackBuilder build) {
+  for (size_t capacity = MSGPACK_INITIAL_BYTES; capacity <= MSGPACK_MAX_BYTES; capacity *= 2) {
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[capacity]);
+    if (!buffer) break;
+    MsgPackWriter w(buffer.get(), capacity);
+    build(w);
+    if (!w.ok()) continue;
+    AsyncResponseStream *response = request->beginResponseStream(MSGPACK_TYPE, w.size());
+    response->addHeader("Vary", "Accept");
+    response->write(w.data(), w.size());
+    perfStats.addBytes(w.size());
+    request->send(response);
+    return;
+  }
+  request->send(500, "application/json", "{\"error\":\"encode failed\"}");
+}
+
+bool StreamRecord::grow(size_t capacity) {
+  if (capacity > MAX_CAPACITY) return false;
+  // Doubling keeps a record that grows piece by piece to a few copies.
+  if (capacity < cap * 2) capacity = cap * 2 < MAX_CAPACITY ? cap * 2 : MAX_CAPACITY;
+  std::unique_ptr<char[]> bigger(new (std::nothrow) char[capacity]);
+  if (!bigger) return false;
+  memcpy(bigger.get(), buf, len);
+  heap = std::move(bigger);
+  buf = heap.get();
+  cap = capacity;
+  return true;
+}
+
+void StreamRecord::append(const char *text) {
+  const size_t n = strlen(text);
+  if (len + n + 1 > cap && !grow(len + n + 1)) {
+    append(text, n);
+    overflow = true;
+    return;
+  }
+  memcpy(buf + len, text, n);
+  len += n;
+}
+
+size_t StreamRecord::append(const char *text, size_t n) {
+  const size_t room = cap - 1 - len;
+  if (n > room) n = room;
+  memcpy(buf + len, text, n);
+  len += n;
+  return n;
+}
+
+void StreamRecord::appendf(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  va_list retry;
+  va_copy(retry, args);
+  int n = vsnprintf(buf + len, cap - len, fmt, args);
+  va_end(args);
+  if (n >= 0 && static_cast<size_t>(n) >= cap - len && grow(len + n + 1)) {
+    n = vsnprintf(buf + len, cap - len, fmt, retry);
+  }
+  va_end(retry);
+  if (n < 0) return;
+  if (static_cast<size_t>(n) >= cap - len) {
+    overflow = true;
+    len = cap - 1;
+  } else {
+    len += n;
+  }
+}
+
+void StreamRecord::appendFloat(float value, uint8_t decimals, const char *missing) {
+  if (isnan(value) || isinf(value)) {
+    append(missing);
+  } else {
+    appendf("%.*f", decimals, static_cast<double>(value));
+  }
+}
+
+void StreamRecord::appendJsonString(const char *text) {
+  append("\"");
+  for (const char *p = text; *p; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      const char escaped[3] = {'\\', static_cast<char>(c), 0};
+      append(escaped);
+    } else if (c < 0x20) {
+      appendf("\\u%04x", c);
+    } else {
+      const char plain[2] = {static_cast<char>(c), 0};
+      append(plain);
+    }
+  }
+  append("\"");
+}
+
+namespace {
+// Lives as long as the chunked response's filler, so the route stays in
+// flight until the server drops the response, whichever way it ends.
+struct StreamState {
+  explicit StreamState(RoutePerf *perf) : perf(perf) { perfStats.hold(perf); }
+  ~StreamState() { perfStats.release(perf); }
+
+  RecordGenerator next;
+  RoutePerf *perf;
+  StreamRecord record;
+  size_t offset = 0;
+  bool done = false;
+};
+}
+
+namespace {
+AsyncWebServerResponse *beginStream(AsyncWebServerRequest *request, const char *contentType, RecordGenerator next) {
+  // Chunks are pulled after the handler returned; keep the route to credit.
+  auto state = std::make_shared<StreamState>(perfStats.current());
+  state->next = std::move(next);
+  return request->beginChunkedResponse(contentType, [state](uint8_t *buffer, size_t maxLen, size_t) -> size_t {
+    size_t written = 0;
+    while (written < maxLen) {
+      if (state->offset >= state->record.size()) {
+        if (state->done) break;
+        state->record.clear();
+        state->offset = 0;
+        state->done = !state->next(state->record);
+        if (state->record.truncated()) {
+          // The rest of the document would not match what was sent; stop
+          // here rather than send a cut record.
+          Serial.printf("Stream: record over %u bytes, response cut short\n", static_cast<unsigned>(StreamRecord::MAX_CAPACITY));
+          state->record.clear();
+          state->done = true;
+          break;
+        }
+        if (!state->record.size()) continue;
+      }
+      // A record larger than the window is carried over to the next chunk.
+      size_t n = state->record.size() - state->offset;
+      if (n > maxLen - written) n = maxLen - written;
+      memcpy(buffer + written, state->record.data() + state->offset, n);
+      state->offset += n;
+      written += n;
+    }
+    perfStats.addBytes(state->perf, written);
+    return written; // 0 ends the chunked response
+  });
+}
+}
+
+void sendStream(AsyncWebServerRequest *request, const char *contentType, RecordGenerator next) {
+  request->send(beginStream(request, contentType, std::move(next)));
+}
+
+void sendJsonStream(AsyncWebServerRequest *request, RecordGenerator next, MsgPackBuilder pack) {
+  if (wantsMsgPack(request)) {
+    sendMsgPack(request, std::move(pack));
+    return;
+  }
+  AsyncWebServerResponse *response = beginStream(request, "application/json", std::move(next));
+  response->addHeader("Vary", "Accept");
   request->send(response);
 }
+
+String renderRecords(RecordGenerator next) {
+  String out;
+  StreamRecord record;
+  bool more = true;
+  while (more) {
+    record.clear();
+    more = next(record);
+    if (record.truncated()) {
+      Serial.printf("Stream: record over %u bytes, payload dropped\n", static_cast<unsigned>(StreamRecord::MAX_CAPACITY));
+      return String();
+    }
+    out.concat(record.data(), record.size());
+  }
+  return out;
+}
@@ -1,8 +1,108 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <AsyncJson.h>
 #include <ESPAsyncWebServer.h>
 
-// Sends a JSON response using the provided serializer callback.
+#include "JsonWriter.h"
+#include "MsgPackWriter.h"
+
+// True when the Accept header ranks MessagePack above JSON; see
+// prefersMsgPack(). Anything else, CBOR included, gets JSON. Every response
+// that went through this choice carries "Vary: Accept".
+bool wantsMsgPack(AsyncWebServerRequest *request);
+
+// Sends a JSON response using the provided serializer callback, or the same
+// document as MessagePack when the client asked for it.
 void sendJson(AsyncWebServerRequest *request, std::function<void(JsonVariant)> fn);
+
+// Sends doc as MessagePack or JSON, per wantsMsgPack().
+void sendDocument(AsyncWebServerRequest *request, const JsonDocument &doc, int code = 200);
+
+// Scratch buffer holding one streamed record (a JSON element or a CSV
+// line). Records fit the inline CAPACITY bytes; a larger one moves to the
+// heap, up to MAX_CAPACITY. Past that (or out of memory) the record is
+// truncated and flagged, and the stream it belongs to is abandoned.
+class StreamRecord {
+public:
+  static constexpr size_t CAPACITY = 256;
+  static constexpr size_t MAX_CAPACITY = 4096;
+
+  StreamRecord() = default;
+  StreamRecord(const StreamRecord &) = delete;
+  StreamRecord &operator=(const StreamRecord &) = delete;
+
+  void clear() {
+    len = 0;
+    overflow = false;
+    if (heap) {
+      heap.reset();
+      buf = inlineBuf;
+      cap = CAPACITY;
+    }
+  }
+  void append(const char *text);
+  // Appends up to n bytes of text without growing; returns how many fit.
+  size_t append(const char *text, size_t n);
+  void appendf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  // Writes value with the given decimals, or `missing` when it is NaN.
+  void appendFloat(float value, uint8_t decimals, const char *missing = "null");
+  // Quoted and escaped JSON string.
+  void appendJsonString(const char *text);
+  // Writes through w into the free part of the record. w keeps its nesting
+  // state between records, so one document can span many of them. If the
+  // record has to grow, fn runs again from the writer state it started with.
+  template <typename Fn>
+  void json(JsonWriter &w, Fn fn) {
+    const JsonWriter before = w;
+    w.rebind(buf + len, cap - len);
+    fn(w);
+    while (!w.ok() && before.ok() && cap < MAX_CAPACITY && grow(cap + 1)) {
+      w = before;
+      w.rebind(buf + len, cap - len);
+      fn(w);
+    }
+    len += w.size();
+    if (!w.ok()) overflow = true;
+  }
+
+  const char *data() const { return buf; }
+  size_t size() const { return len; }
+  bool truncated() const { return overflow; }
+
+private:
+  // Moves to a heap buffer of at least capacity bytes; false when that is
+  // over MAX_CAPACITY or the allocation fails.
+  bool grow(size_t capacity);
+
+  char inlineBuf[CAPACITY];
+  std::unique_ptr<char[]> heap;
+  char *buf = inlineBuf;
+  size_t cap = CAPACITY;
+  size_t len = 0;
+  bool overflow = false;
+};
+
+// Produces the next record into out (already cleared); returns false once
+// the stream is complete. Whatever was written on the final call is still sent.
+using RecordGenerator = std::function<bool(StreamRecord &out)>;
+
+// Streams a chunked response, pulling records only as the TCP send window
+// frees up. Peak memory is one chunk plus one record, whatever the length.
+void sendStream(AsyncWebServerRequest *request, const char *contentType, RecordGenerator next);
+
+// Writes one whole MessagePack document.
+using MsgPackBuilder = std::function<void(MsgPackWriter &w)>;
+
+// Sends what build writes as MessagePack. The encoding needs its length up
+// front, so it goes into one heap buffer that is regrown while it overflows.
+void sendMsgPack(AsyncWebServerRequest *request, MsgPackBuilder build);
+
+// Streams the JSON generator, or for MessagePack clients sends the same
+// document as pack writes it. Only the chosen one is run.
+void sendJsonStream(AsyncWebServerRequest *request, RecordGenerator next, MsgPackBuilder pack);
+
+// Runs a generator to completion into one String, for payloads that are
+// built once and sent to several consumers. Empty if a record was truncated.
+String renderRecords(RecordGenerator next);
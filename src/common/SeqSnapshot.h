@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Double-buffered, sequence-numbered snapshot for trivially copyable values.
+// One writer task publishes; any number of readers copy without locks. The
+// sequence selects the slot readers see, so a publish only ever writes into
+// the slot that is not currently exposed. Readers retry if the writer lapped
+// them during their copy (at most once per sample interval in practice).
+template <typename T>
+class SeqSnapshot {
+public:
+  // Single writer only.
+  uint32_t publish(const T &value) {
+    const uint32_t next = seq.load(std::memory_order_relaxed) + 1;
+    // This slot is the one the previous-but-one publish exposed. Order the
+    // last seq store before writing into it, so a reader that sees any of
+    // the new bytes also sees seq move on and retries; pairs with the
+    // acquire fence in read().
+    std::atomic_thread_fence(std::memory_order_release);
+    slots[next & 1] = value;
+    seq.store(next, std::memory_order_release);
+    return next;
+  }
+
+  // Copies the latest value into out and returns its sequence (0 = never published).
+  uint32_t read(T &out) const {
+    for (;;) {
+      const uint32_t before = seq.load(std::memory_order_acquire);
+      out = slots[before & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq.load(std::memory_order_relaxed) == before) return before;
+    }
+  }
+
+  uint32_t sequence() const { return seq.load(std::memory_order_acquire); }
+
+private:
+  T slots[2] = {};
+  std::atomic<uint32_t> seq{0};
+};
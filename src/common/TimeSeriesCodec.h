@@ -0,0 +1,253 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Gorilla-style bit-packed encoding for (epoch seconds, N x uint16) series.
+// Timestamps are stored as delta-of-delta, channels as zig-zagged deltas
+// against the previous point, each with a short prefix code:
+//
+//   timestamp dod   '0' = 0 | '10' 7b | '110' 9b | '1110' 12b | '1111' 32b raw delta
+//   channel delta   '0' = 0 | '10' 4b | '110' 8b | '1110' 12b | '1111' 16b raw value
+//
+// The first point of a block is written verbatim. Blocks are independent, so
+// any block can be decoded on its own. No Arduino dependencies; builds on host.
+namespace tscodec {
+
+inline uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+class BitWriter {
+public:
+  void reset(uint8_t *buffer, size_t capacityBytes) {
+    buf = buffer;
+    capBits = capacityBytes * 8;
+    pos = 0;
+  }
+
+  // MSB first; callers check room() beforehand.
+  void write(uint32_t value, uint8_t bits) {
+    while (bits) {
+      const size_t byte = pos >> 3;
+      const uint8_t used = pos & 7;
+      const uint8_t take = (8 - used) < bits ? (8 - used) : bits;
+      const uint8_t chunk = static_cast<uint8_t>((value >> (bits - take)) & ((1u << take) - 1));
+      const uint8_t shift = 8 - used - take;
+      const uint8_t mask = static_cast<uint8_t>(((1u << take) - 1) << shift);
+      buf[byte] = static_cast<uint8_t>((buf[byte] & ~mask) | (chunk << shift));
+      pos += take;
+      bits -= take;
+    }
+  }
+
+  size_t room() const { return capBits - pos; }
+  size_t bits() const { return pos; }
+
+private:
+  uint8_t *buf = nullptr;
+  size_t capBits = 0;
+  size_t pos = 0;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t *buffer, size_t sizeBytes) : buf(buffer), capBits(sizeBytes * 8) {}
+
+  uint32_t read(uint8_t bits) {
+    uint32_t value = 0;
+    while (bits) {
+      if (pos >= capBits) {
+        overrun = true;
+        return 0;
+      }
+      const uint8_t used = pos & 7;
+      const uint8_t take = (8 - used) < bits ? (8 - used) : bits;
+      const uint8_t shift = 8 - used - take;
+      value = (value << take) | ((buf[pos >> 3] >> shift) & ((1u << take) - 1));
+      pos += take;
+      bits -= take;
+    }
+    return value;
+  }
+
+  // Counts leading 1 bits of a prefix code, up to max.
+  uint8_t prefix(uint8_t max) {
+    uint8_t ones = 0;
+    while (ones < max && read(1)) ++ones;
+    return ones;
+  }
+
+  bool ok() const { return !overrun; }
+
+private:
+  const uint8_t *buf;
+  size_t capBits;
+  size_t pos = 0;
+  bool overrun = false;
+};
+
+constexpr uint8_t DOD_BITS[4] = {0, 7, 9, 12};
+constexpr uint8_t DELTA_BITS[4] = {0, 4, 8, 12};
+
+inline uint8_t dodClass(int64_t dod) {
+  if (dod == 0) return 0;
+  if (dod >= -64 && dod < 64) return 1;
+  if (dod >= -256 && dod < 256) return 2;
+  if (dod >= -2048 && dod < 2048) return 3;
+  return 4;
+}
+
+inline uint8_t deltaClass(uint32_t zz) {
+  if (zz == 0) return 0;
+  if (zz < 16) return 1;
+  if (zz < 256) return 2;
+  if (zz < 4096) return 3;
+  return 4;
+}
+
+// Prefix length plus payload for class c (class 4 is the raw escape).
+inline uint8_t codeBits(uint8_t c, const uint8_t *payloadBits, uint8_t rawBits) {
+  return c == 4 ? 4 + rawBits : c + 1 + payloadBits[c];
+}
+
+inline void writePrefix(BitWriter &w, uint8_t c) {
+  // c ones then a terminating zero; class 4 ('1111') has no terminator.
+  if (c == 4) {
+    w.write(0xF, 4);
+  } else {
+    w.write(((1u << c) - 1) << 1, c + 1);
+  }
+}
+
+} // namespace tscodec
+
+template <size_t Channels>
+class TimeSeriesEncoder {
+public:
+  // Largest possible encoding of one non-first point.
+  static constexpr size_t MAX_POINT_BITS = 36 + 20 * Channels;
+
+  // Starts a new block in buffer; previous contents are overwritten as bits are written.
+  void reset(uint8_t *buffer, size_t capacityBytes) {
+    writer.reset(buffer, capacityBytes);
+    points = 0;
+    prevT = 0;
+    prevDelta = 0;
+    memset(prevV, 0, sizeof(prevV));
+  }
+
+  // Appends one point; returns false (and leaves the block untouched) if it does not fit.
+  bool append(uint32_t t, const uint16_t *values) {
+    using namespace tscodec;
+    if (!points) {
+      if (writer.room() < 32 + 16 * Channels) return false;
+      writer.write(t, 32);
+      for (size_t c = 0; c < Channels; ++c) writer.write(values[c], 16);
+    } else {
+      const int64_t delta = static_cast<int64_t>(t) - prevT;
+      const int64_t dod = delta - prevDelta;
+      const uint8_t tc = dodClass(dod);
+      uint8_t vc[Channels];
+      uint32_t zz[Channels];
+      size_t need = codeBits(tc, DOD_BITS, 32);
+      for (size_t c = 0; c < Channels; ++c) {
+        zz[c] = zigzag(static_cast<int32_t>(values[c]) - static_cast<int32_t>(prevV[c]));
+        vc[c] = deltaClass(zz[c]);
+        need += codeBits(vc[c], DELTA_BITS, 16);
+      }
+      if (writer.room() < need) return false;
+
+      writePrefix(writer, tc);
+      if (tc == 4) {
+        writer.write(static_cast<uint32_t>(delta), 32);
+      } else if (tc) {
+        writer.write(static_cast<uint32_t>(dod) & ((1u << DOD_BITS[tc]) - 1), DOD_BITS[tc]);
+      }
+      for (size_t c = 0; c < Channels; ++c) {
+        writePrefix(writer, vc[c]);
+        if (vc[c] == 4) {
+          writer.write(values[c], 16);
+        } else if (vc[c]) {
+          writer.write(zz[c], DELTA_BITS[vc[c]]);
+        }
+      }
+      prevDelta = delta;
+    }
+    prevT = t;
+    memcpy(prevV, values, sizeof(prevV));
+    ++points;
+    return true;
+  }
+
+  size_t count() const { return points; }
+  size_t bytes() const { return (writer.bits() + 7) / 8; }
+  size_t bits() const { return writer.bits(); }
+  // True once another append could fail; lets callers flush ahead of time.
+  bool nearlyFull() const { return writer.room() < MAX_POINT_BITS; }
+
+private:
+  tscodec::BitWriter writer;
+  size_t points = 0;
+  uint32_t prevT = 0;
+  int64_t prevDelta = 0;
+  uint16_t prevV[Channels] = {};
+};
+
+template <size_t Channels>
+class TimeSeriesDecoder {
+public:
+  TimeSeriesDecoder(const uint8_t *buffer, size_t sizeBytes, size_t count) : reader(buffer, sizeBytes), remaining(count) {}
+
+  // Decodes the next point; false at the end of the block or on a malformed stream.
+  bool next(uint32_t &t, uint16_t *values) {
+    using namespace tscodec;
+    if (!remaining) return false;
+    if (first) {
+      prevT = reader.read(32);
+      for (size_t c = 0; c < Channels; ++c) prevV[c] = static_cast<uint16_t>(reader.read(16));
+      first = false;
+    } else {
+      const uint8_t tc = reader.prefix(4);
+      int64_t delta;
+      if (tc == 4) {
+        delta = reader.read(32);
+      } else {
+        int64_t dod = 0;
+        if (tc) {
+          // Sign-extend the two's complement payload.
+          const uint8_t n = DOD_BITS[tc];
+          const uint32_t rawDod = reader.read(n);
+          dod = (rawDod & (1u << (n - 1))) ? static_cast<int64_t>(rawDod) - (1ll << n) : rawDod;
+        }
+        delta = prevDelta + dod;
+      }
+      prevDelta = delta;
+      prevT = static_cast<uint32_t>(prevT + delta);
+      for (size_t c = 0; c < Channels; ++c) {
+        const uint8_t vc = reader.prefix(4);
+        if (vc == 4) {
+          prevV[c] = static_cast<uint16_t>(reader.read(16));
+        } else if (vc) {
+          prevV[c] = static_cast<uint16_t>(prevV[c] + unzigzag(reader.read(DELTA_BITS[vc])));
+        }
+      }
+    }
+    if (!reader.ok()) {
+      remaining = 0;
+      return false;
+    }
+    --remaining;
+    t = prevT;
+    memcpy(values, prevV, sizeof(prevV));
+    return true;
+  }
+
+private:
+  tscodec::BitReader reader;
+  size_t remaining;
+  bool first = true;
+  uint32_t prevT = 0;
+  int64_t prevDelta = 0;
+  uint16_t prevV[Channels] = {};
+};
@@ -4,14 +4,22 @@
 #include <ESPAsyncWebServer.h>
 #include <LittleFS.h>
 #include <Wire.h>
+#include <atomic>
 #include "setup/ManagedWiFi.h"
 #include "setup/SetupRoutes.h"
+#include "setup/FwUpdateService.h"
 #include "assets/favicon.h"
 #include "service/ServiceRoutes.h"
 #include "service/WeatherService.h"
+#include "service/WeatherHistory.h"
+#include "service/HistoryLog.h"
 #include "setup/MqttService.h"
 #include "service/OutdoorService.h"
+#include "service/OpenMeteoProvider.h"
 #include "service/WeatherMqttPublisher.h"
+#include "service/TelemetryFrameCache.h"
+#include "service/LiveEventStream.h"
+#include "service/MetricsExporter.h"
 
 #include "service/MatrixDisplayService.h"
 #include "assets/firmware_version.h"
@@ -19,22 +27,41 @@
 ManagedWiFi wifiManager;
 AsyncWebServer server(80);
 WeatherService weatherService;
+WeatherHistory weatherHistory;
+HistoryLog historyLog;
+TelemetryFrameCache frameCache;
+LiveEventStream liveEvents;
+MetricsExporter metricsExporter;
 OutdoorService outdoorService;
+OpenMeteoProvider openMeteo;
 MqttService mqttService;
 WeatherMqttPublisher mqttPublisher;
 MatrixDisplayService matrixService;
-static bool otaRestartPending = false;
-static unsigned long otaRestartAt = 0;
+extern FwUpdateService fwUpdateService; // defined in SetupRoutes.cpp
+// Set from HTTP handlers and the fw_update task; the loop task restarts.
+static std::atomic<bool> otaRestartPending{false};
+static std::atomic<unsigned long> otaRestartAt{0};
 
 void scheduleRestart(uint32_t delayMs = 2000){
-  otaRestartPending = true;
   otaRestartAt = millis() + delayMs;
+  otaRestartPending = true;
+}
+
+// Commits everything still buffered for flash: history and debounced config.
+// Loop task only: it owns the history log, cache and config writers.
+void flushBeforeRestart(){
+  historyLog.flush();
+  matrixService.flushConfig();
+  outdoorService.flushConfig();
+  outdoorService.flushCache();
+  mqttService.flushConfig();
 }
 
 void handlePendingRestart(){
   if(otaRestartPending && millis() >= otaRestartAt){
     Serial.println("Restarting after OTA update...");
     otaRestartPending = false;
+    flushBeforeRestart();
     ESP.restart();
   }
 }
@@ -59,16 +86,25 @@ void setup(){
   }
 
   wifiManager.begin();
+  // Wall-clock time stamps history points; SNTP retries until Wi-Fi is up.
+  configTime(0, 0, "pool.ntp.org", "time.google.com");
   weatherService.begin();
-  outdoorService.begin(&wifiManager);
+  frameCache.begin(&weatherService);
+  weatherHistory.begin(&weatherService);
+  historyLog.begin(&weatherHistory);
+  outdoorService.begin(&wifiManager, &openMeteo);
   mqttService.begin(&wifiManager);
-  mqttPublisher.begin(&mqttService, &weatherService, &outdoorService);
+  mqttPublisher.begin(&mqttService, &weatherService, &outdoorService, &frameCache);
   matrixService.attachMqtt(&mqttService);
   matrixService.begin(&weatherService, &outdoorService);
+  liveEvents.begin(&frameCache, &outdoorService, &weatherHistory);
+  metricsExporter.begin(&weatherService, &outdoorService, &matrixService, &mqttService);
 
   // Register all HTTP API routes, including firmware update
-  registerServiceRoutes(server, weatherService, outdoorService, matrixService);
+  registerServiceRoutes(server, weatherService, weatherHistory, frameCache, liveEvents, outdoorService, matrixService);
   registerSetupRoutes(server, wifiManager, [](){ scheduleRestart(); }, &mqttService);
+  metricsExporter.registerRoutes(server);
+  fwUpdateService.requestRestart = [](){ scheduleRestart(); };
   server.on("/", HTTP_GET, handleRoot);
 
   server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request){
@@ -80,16 +116,15 @@ void setup(){
 }
 
 
-#include "setup/FwUpdateService.h"
-
-extern FwUpdateService fwUpdateService; // defined in SetupRoutes.cpp
-
 void loop(){
   wifiManager.loop();
+  weatherHistory.loop();
+  historyLog.loop();
   outdoorService.loop();
   mqttService.loop();
   mqttPublisher.loop();
   matrixService.loop();
+  liveEvents.loop();
   handlePendingRestart();
 
   static unsigned long lastAutoCheck = 0;
@@ -0,0 +1,197 @@
+#include "Bmp580Driver.h"
+
+namespace {
+constexpr uint8_t REG_INT_CONFIG = 0x14;
+constexpr uint8_t REG_INT_SOURCE = 0x15;
+constexpr uint8_t REG_FIFO_CONFIG = 0x16;
+constexpr uint8_t REG_FIFO_COUNT = 0x17;
+constexpr uint8_t REG_FIFO_SEL = 0x18;
+constexpr uint8_t REG_TEMP_DATA_XLSB = 0x1D;
+constexpr uint8_t REG_INT_STATUS = 0x27;
+constexpr uint8_t REG_FIFO_DATA = 0x29;
+constexpr uint8_t REG_OSR_CONFIG = 0x36;
+constexpr uint8_t REG_ODR_CONFIG = 0x37;
+
+constexpr uint8_t INT_SOURCE_DRDY = 0x01;
+constexpr uint8_t INT_STATUS_DRDY = 0x01;
+constexpr uint8_t INT_CONFIG_POL_HIGH = 0x02;
+constexpr uint8_t INT_CONFIG_EN = 0x08;
+constexpr uint8_t INT_CONFIG_MASK = 0x0F;
+constexpr uint8_t OSR_PRESS_EN = 0x40;
+constexpr uint8_t ODR_PWR_MODE_MASK = 0x03;
+constexpr uint8_t ODR_DEEP_DIS = 0x80;
+constexpr uint8_t ODR_RATE_MASK = 0x7C;
+constexpr uint8_t FIFO_SEL_TEMP_PRESS = 0x03;
+constexpr uint8_t FIFO_COUNT_MASK = 0x3F;
+constexpr uint8_t FIFO_EMPTY_BYTE = 0x7F;
+// Stay below the 128 byte Wire buffer per burst; a full FIFO is one burst.
+constexpr size_t FIFO_FRAMES_PER_BURST = 20;
+// Datasheet ODR table in mHz, indexed by ODR code.
+constexpr uint32_t ODR_MILLIHZ[32] = {
+  240000, 218500, 199100, 179200, 160000, 149300, 140000, 129800,
+  120000, 110100, 100200, 89600, 80000, 70000, 60000, 50000,
+  45000, 40000, 35000, 30000, 25000, 20000, 15000, 10000,
+  5000, 4000, 3000, 2000, 1000, 500, 250, 125,
+};
+
+float decodeTemperature(const uint8_t *raw) {
+  int32_t value = static_cast<int32_t>((static_cast<uint32_t>(raw[2]) << 24) | (static_cast<uint32_t>(raw[1]) << 16) | (static_cast<uint32_t>(raw[0]) << 8)) >> 8;
+  return value / 65536.0f;
+}
+
+float decodePressure(const uint8_t *raw) {
+  uint32_t value = (static_cast<uint32_t>(raw[2]) << 16) | (static_cast<uint32_t>(raw[1]) << 8) | raw[0];
+  return value / 64.0f;
+}
+}
+
+void Bmp580Driver::FifoAccumulator::add(float temperatureC, float pressurePa) {
+  ++frames;
+  tempSum += temperatureC;
+  pressSum += pressurePa;
+  if (pressurePa < pressMin) {
+    pressMin = pressurePa;
+    tempAtPressMin = temperatureC;
+  }
+  if (pressurePa > pressMax) {
+    pressMax = pressurePa;
+    tempAtPressMax = temperatureC;
+  }
+}
+
+bool Bmp580Driver::FifoAccumulator::result(float &temperatureC, float &pressurePa) const {
+  if (!frames) return false;
+  if (frames >= 5) {
+    const uint16_t kept = frames - 2;
+    pressurePa = static_cast<float>((pressSum - pressMin - pressMax) / kept);
+    temperatureC = static_cast<float>((tempSum - tempAtPressMin - tempAtPressMax) / kept);
+  } else {
+    pressurePa = static_cast<float>(pressSum / frames);
+    temperatureC = static_cast<float>(tempSum / frames);
+  }
+  return true;
+}
+
+uint32_t Bmp580Driver::fifoFramesPer(uint8_t odr, uint32_t intervalMs) {
+  const uint64_t microFrames = static_cast<uint64_t>(ODR_MILLIHZ[odr & ODR_SLOWEST]) * intervalMs;
+  return static_cast<uint32_t>((microFrames + 999999) / 1000000);
+}
+
+uint8_t Bmp580Driver::fifoOdrFor(uint8_t odr, uint32_t intervalMs) {
+  odr &= ODR_SLOWEST;
+  while (odr < ODR_SLOWEST && fifoFramesPer(odr, intervalMs) > FIFO_DEPTH) ++odr;
+  return odr;
+}
+
+size_t Bmp580Driver::decodeFifo(const uint8_t *data, size_t len, FifoAccumulator &acc) {
+  size_t frames = 0;
+  for (size_t off = 0; off + FIFO_FRAME_BYTES <= len; off += FIFO_FRAME_BYTES) {
+    const uint8_t *frame = data + off;
+    if (frame[0] == FIFO_EMPTY_BYTE && frame[1] == FIFO_EMPTY_BYTE && frame[2] == FIFO_EMPTY_BYTE) continue;
+    float pressurePa = decodePressure(frame + 3);
+    if (pressurePa <= 0.0f) continue;
+    acc.add(decodeTemperature(frame), pressurePa);
+    ++frames;
+  }
+  return frames;
+}
+
+bool Bmp580Driver::begin(TwoWire *wire, uint8_t address) {
+  wireRef = wire;
+  addr = address;
+  if (!wireRef) return false;
+  // Standby with deep standby disabled keeps the config registers alive
+  // between forced conversions.
+  bool ok = updateReg(REG_ODR_CONFIG, ODR_PWR_MODE_MASK | ODR_DEEP_DIS, ODR_DEEP_DIS | static_cast<uint8_t>(PowerMode::Standby));
+  ok = ok && updateReg(REG_OSR_CONFIG, OSR_PRESS_EN, OSR_PRESS_EN);
+  ok = ok && updateReg(REG_INT_SOURCE, INT_SOURCE_DRDY, INT_SOURCE_DRDY);
+  uint8_t discard = 0;
+  ok = ok && readRegs(REG_INT_STATUS, &discard, 1);
+  if (!ok) wireRef = nullptr;
+  return ok;
+}
+
+bool Bmp580Driver::setPowerMode(PowerMode mode) {
+  return updateReg(REG_ODR_CONFIG, ODR_PWR_MODE_MASK, static_cast<uint8_t>(mode));
+}
+
+bool Bmp580Driver::triggerForced() {
+  uint8_t discard = 0;
+  // Clear a stale data-ready flag so the next poll reflects this conversion.
+  if (!readRegs(REG_INT_STATUS, &discard, 1)) return false;
+  return setPowerMode(PowerMode::Forced);
+}
+
+bool Bmp580Driver::pollDataReady(bool &ready) {
+  uint8_t status = 0;
+  if (!readRegs(REG_INT_STATUS, &status, 1)) return false;
+  ready = (status & INT_STATUS_DRDY) != 0;
+  return true;
+}
+
+bool Bmp580Driver::readData(float &temperatureC, float &pressurePa) {
+  uint8_t raw[6] = {};
+  if (!readRegs(REG_TEMP_DATA_XLSB, raw, sizeof(raw))) return false;
+  temperatureC = decodeTemperature(raw);
+  pressurePa = decodePressure(raw + 3);
+  return pressurePa > 0.0f;
+}
+
+bool Bmp580Driver::startFifo(uint8_t odr) {
+  // FIFO and ODR settings only take effect from standby.
+  bool ok = setPowerMode(PowerMode::Standby);
+  ok = ok && writeReg(REG_FIFO_SEL, FIFO_SEL_TEMP_PRESS);
+  ok = ok && writeReg(REG_FIFO_CONFIG, 0x00); // streaming, no threshold
+  ok = ok && updateReg(REG_ODR_CONFIG, ODR_RATE_MASK, static_cast<uint8_t>((odr & 0x1F) << 2));
+  ok = ok && setPowerMode(PowerMode::Normal);
+  return ok;
+}
+
+bool Bmp580Driver::drainFifo(FifoAccumulator &acc) {
+  uint8_t count = 0;
+  if (!readRegs(REG_FIFO_COUNT, &count, 1)) return false;
+  count &= FIFO_COUNT_MASK;
+  if (count > FIFO_DEPTH) count = FIFO_DEPTH;
+
+  uint8_t buf[FIFO_FRAMES_PER_BURST * FIFO_FRAME_BYTES];
+  while (count) {
+    const size_t frames = count < FIFO_FRAMES_PER_BURST ? count : FIFO_FRAMES_PER_BURST;
+    const size_t len = frames * FIFO_FRAME_BYTES;
+    if (!readRegs(REG_FIFO_DATA, buf, len)) return false;
+    decodeFifo(buf, len, acc);
+    count -= static_cast<uint8_t>(frames);
+  }
+  return true;
+}
+
+bool Bmp580Driver::enableDataReadyInterrupt(bool enable) {
+  uint8_t value = enable ? (INT_CONFIG_EN | INT_CONFIG_POL_HIGH) : 0;
+  return updateReg(REG_INT_CONFIG, INT_CONFIG_MASK, value);
+}
+
+bool Bmp580Driver::readRegs(uint8_t reg, uint8_t *buf, size_t len) {
+  if (!wireRef) return false;
+  wireRef->beginTransmission(addr);
+  wireRef->write(reg);
+  if (wireRef->endTransmission(false) != 0) return false;
+  size_t got = wireRef->requestFrom(addr, static_cast<uint8_t>(len));
+  if (got != len) return false;
+  for (size_t i = 0; i < len; ++i) {
+    buf[i] = static_cast<uint8_t>(wireRef->read());
+  }
+  return true;
+}
+
+bool Bmp580Driver::writeReg(uint8_t reg, uint8_t value) {
+  if (!wireRef) return false;
+  wireRef->beginTransmission(addr);
+  wireRef->write(reg);
+  wireRef->write(value);
+  return wireRef->endTransmission() == 0;
+}
+
+bool Bmp580Driver::updateReg(uint8_t reg, uint8_t mask, uint8_t value) {
+  uint8_t current = 0;
+  if (!readRegs(reg, &current, 1)) return false;
+  return writeReg(reg, static_cast<uint8_t>((current & ~mask) | (value & mask)));
+}
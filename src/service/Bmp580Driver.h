@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Minimal register-level BMP580 access that splits a forced conversion into
+// trigger and poll/collect steps so callers never busy-wait on the sensor.
+// Detection and oversampling/IIR setup still go through Adafruit_BMP5xx.
+class Bmp580Driver {
+public:
+  enum class PowerMode : uint8_t {
+    Standby = 0,
+    Normal = 1,
+    Forced = 2,
+    Continuous = 3,
+  };
+
+  static constexpr size_t FIFO_FRAME_BYTES = 6; // temperature + pressure, 24 bit each
+  static constexpr uint8_t FIFO_DEPTH = 16;     // 96 byte FIFO / 6 byte frames with both channels enabled
+  static constexpr uint8_t ODR_SLOWEST = 0x1F;  // 0.125 Hz; lower codes are faster
+
+  // Running decimation of drained FIFO frames: trimmed mean drops the single
+  // highest and lowest pressure frame once enough frames are available.
+  struct FifoAccumulator {
+    uint16_t frames = 0;
+    double tempSum = 0.0;
+    double pressSum = 0.0;
+    float pressMin = INFINITY;
+    float pressMax = -INFINITY;
+    float tempAtPressMin = NAN;
+    float tempAtPressMax = NAN;
+
+    void add(float temperatureC, float pressurePa);
+    bool result(float &temperatureC, float &pressurePa) const;
+  };
+
+  // Decodes raw FIFO bytes (whole frames only) into the accumulator; empty
+  // frames are skipped. Returns the number of frames consumed.
+  static size_t decodeFifo(const uint8_t *data, size_t len, FifoAccumulator &acc);
+
+  // Frames queued at ODR code odr over intervalMs, rounded up.
+  static uint32_t fifoFramesPer(uint8_t odr, uint32_t intervalMs);
+  // odr, or the fastest slower code whose frames per intervalMs fit the
+  // FIFO; ODR_SLOWEST when none does.
+  static uint8_t fifoOdrFor(uint8_t odr, uint32_t intervalMs);
+
+  bool begin(TwoWire *wire, uint8_t address);
+  bool attached() const { return wireRef != nullptr; }
+
+  // Starts one forced conversion and returns immediately.
+  bool triggerForced();
+  // Reads (and clears) the data-ready flag.
+  bool pollDataReady(bool &ready);
+  // Reads the latest conversion result from the data registers.
+  bool readData(float &temperatureC, float &pressurePa);
+
+  // Normal mode at the given ODR code with temperature+pressure frames
+  // streaming into the on-chip FIFO.
+  bool startFifo(uint8_t odr);
+  // Reads every queued frame in burst transactions and decimates them.
+  bool drainFifo(FifoAccumulator &acc);
+
+  // Routes data-ready to the INT pin (push-pull, active high, pulsed).
+  bool enableDataReadyInterrupt(bool enable);
+  bool setPowerMode(PowerMode mode);
+
+private:
+  bool readRegs(uint8_t reg, uint8_t *buf, size_t len);
+  bool writeReg(uint8_t reg, uint8_t value);
+  bool updateReg(uint8_t reg, uint8_t mask, uint8_t value);
+
+  TwoWire *wireRef = nullptr;
+  uint8_t addr = 0;
+};
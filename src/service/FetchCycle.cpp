@@ -0,0 +1,47 @@
+#include "FetchCycle.h"
+
+namespace {
+uint32_t capSleep(unsigned long ms) {
+  return ms < FetchSchedule::IDLE_CHECK_MS ? ms : FetchSchedule::IDLE_CHECK_MS;
+}
+}
+
+bool FetchSchedule::due(unsigned long now, unsigned long intervalMs, unsigned long lastAttemptMs, uint32_t ageS,
+                        uint32_t &sleepMs) {
+  if (pending) {
+    if (lastAttemptMs && now - lastAttemptMs < MIN_SPACING_MS) {
+      sleepMs = capSleep(MIN_SPACING_MS - (now - lastAttemptMs));
+      return false;
+    }
+  } else {
+    if (!intervalMs) {
+      sleepMs = IDLE_CHECK_MS;
+      return false;
+    }
+    if (static_cast<long>(nextAt - now) > 0) {
+      sleepMs = capSleep(nextAt - now);
+      return false;
+    }
+    // Data pushed more recently than one interval ago needs no fetch.
+    if (!fetchFailures && ageS != AGE_UNKNOWN && ageS < intervalMs / 1000) {
+      nextAt = now + intervalMs - ageS * 1000UL;
+      sleepMs = capSleep(nextAt - now);
+      return false;
+    }
+  }
+  pending = false;
+  return true;
+}
+
+uint32_t FetchSchedule::finished(unsigned long now, bool ok, unsigned long intervalMs) {
+  if (ok) {
+    fetchFailures = 0;
+    nextAt = now + intervalMs;
+    return capSleep(intervalMs ? intervalMs : IDLE_CHECK_MS);
+  }
+  if (fetchFailures < 8) ++fetchFailures;
+  const unsigned long backoff = RETRY_BASE_MS << (fetchFailures - 1);
+  const unsigned long retryMs = backoff < RETRY_MAX_MS ? backoff : RETRY_MAX_MS;
+  nextAt = now + retryMs;
+  return capSleep(retryMs);
+}
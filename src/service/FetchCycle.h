@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OutdoorProvider.h"
+
+// The parts of OutdoorService's fetch task that do not touch the network
+// stack, with time and the body stream passed in so they can be driven by
+// a fake clock and a scripted stream in native tests.
+
+// When the fetch task fetches next. Fetch task only.
+class FetchSchedule {
+public:
+  // Failed fetches retry after 30 s, doubling up to an hour.
+  static constexpr unsigned long RETRY_BASE_MS = 30UL * 1000UL;
+  static constexpr unsigned long RETRY_MAX_MS = 60UL * 60UL * 1000UL;
+  // Requested fetches (config change, ?force) are still spaced this far apart.
+  static constexpr unsigned long MIN_SPACING_MS = 30UL * 1000UL;
+  // Longest the fetch task sleeps before looking at config and Wi-Fi again.
+  static constexpr unsigned long IDLE_CHECK_MS = 60UL * 1000UL;
+  static constexpr uint32_t AGE_UNKNOWN = UINT32_MAX;
+
+  // Asks for a fetch as soon as MIN_SPACING_MS allows; kept until one runs.
+  void request() { pending = true; }
+  // True when a fetch should run now; otherwise sleepMs is how long the
+  // task may sleep. lastAttemptMs is the last failed attempt (0 if none)
+  // and ageS the age of the cached data, which pushes keep low.
+  bool due(unsigned long now, unsigned long intervalMs, unsigned long lastAttemptMs, uint32_t ageS, uint32_t &sleepMs);
+  // Records how the fetch due() asked for went; returns the sleep.
+  uint32_t finished(unsigned long now, bool ok, unsigned long intervalMs);
+
+  bool requested() const { return pending; }
+  uint8_t failures() const { return fetchFailures; }
+  unsigned long nextFetchMs() const { return nextAt; }
+
+private:
+  unsigned long nextAt = 0;
+  uint8_t fetchFailures = 0;
+  bool pending = false;
+};
+
+enum class BodyEnd : uint8_t {
+  Complete,       // all of it, or the provider stopped reading
+  ConnectionLost, // closed before Content-Length bytes
+  Timeout,        // FETCH_BODY_TIMEOUT_MS passed
+};
+
+// Whole body, however slowly it trickles in.
+constexpr unsigned long FETCH_BODY_TIMEOUT_MS = 15000;
+constexpr size_t FETCH_CHUNK_BYTES = 512;
+
+// Streams a response body into provider until it ends or the provider
+// gives up. Stream has available(), connected() and read(buf, len), as
+// WiFiClient does; remaining is the Content-Length, -1 if none was sent.
+// Clock has now() in ms and wait(ms) for when nothing is buffered.
+template <typename Stream, typename Clock>
+BodyEnd streamBody(Stream &stream, int remaining, OutdoorProvider &provider, Clock &clock) {
+  uint8_t chunk[FETCH_CHUNK_BYTES];
+  const unsigned long started = clock.now();
+  while (remaining != 0) {
+    const int available = stream.available();
+    if (available <= 0) {
+      if (!stream.connected()) return remaining > 0 ? BodyEnd::ConnectionLost : BodyEnd::Complete;
+      if (clock.now() - started > FETCH_BODY_TIMEOUT_MS) return BodyEnd::Timeout;
+      clock.wait(10);
+      continue;
+    }
+    size_t want = static_cast<size_t>(available) < sizeof(chunk) ? available : sizeof(chunk);
+    if (remaining > 0 && static_cast<size_t>(remaining) < want) want = remaining;
+    const int n = stream.read(chunk, want);
+    if (n <= 0) continue;
+    if (remaining > 0) remaining -= n;
+    if (!provider.feed(chunk, n)) break;
+  }
+  return BodyEnd::Complete;
+}
@@ -0,0 +1,137 @@
+#include "HistoryDownsampler.h"
+
+#include <math.h>
+
+HistoryDownsampler::HistoryDownsampler(DownsampleMode mode, uint32_t from, uint32_t to, size_t points, const Emit &emit)
+    : mode(mode), from(from), to(to < from ? from : to), out(emit) {
+  if (points < 3) points = 3;
+  if (points > MAX_POINTS) points = MAX_POINTS;
+  // LTTB always keeps the first and last point; min/max emits two per bucket.
+  bucketCount = mode == DownsampleMode::Lttb ? points - 2 : points / 2;
+}
+
+void HistoryDownsampler::Bucket::reset(size_t idx) {
+  index = idx;
+  count = 0;
+  seen = 0;
+  stride = 1;
+  sumT = 0;
+  sumV = 0;
+  min = Candidate{0, NAN};
+  max = Candidate{0, NAN};
+}
+
+void HistoryDownsampler::Bucket::add(const Candidate &c, float minValue, float maxValue) {
+  sumT += c.t;
+  sumV += c.v;
+  if (isnan(min.v) || minValue < min.v) min = Candidate{c.t, minValue};
+  if (isnan(max.v) || maxValue > max.v) max = Candidate{c.t, maxValue};
+  if (seen++ % stride) return;
+  if (count == MAX_CANDIDATES) {
+    // Keep every other candidate and halve the sampling rate from here on.
+    for (size_t i = 0; i < MAX_CANDIDATES / 2; ++i) items[i] = items[i * 2];
+    count = MAX_CANDIDATES / 2;
+    stride *= 2;
+    if ((seen - 1) % stride) return;
+  }
+  items[count++] = c;
+}
+
+size_t HistoryDownsampler::bucketOf(uint32_t t) const {
+  const uint64_t span = static_cast<uint64_t>(to - from) + 1;
+  const uint64_t offset = t > from ? t - from : 0;
+  const size_t idx = static_cast<size_t>(offset * bucketCount / span);
+  return idx < bucketCount ? idx : bucketCount - 1;
+}
+
+void HistoryDownsampler::add(const HistorySample &sample) {
+  if (isnan(sample.mean) || sample.t < from || sample.t > to) return;
+  ++samples;
+  const Candidate c{sample.t, sample.mean};
+
+  if (mode == DownsampleMode::Lttb) {
+    if (!haveFirst) {
+      haveFirst = true;
+      anchor = c;
+      emit(c);
+      return;
+    }
+    last = c;
+  }
+
+  const size_t idx = bucketOf(c.t);
+  if (current.index != idx) {
+    closeBucket();
+    current.reset(idx);
+  }
+  // Aggregated tiers carry their own bucket extremes; min/max mode uses them.
+  const bool extremes = mode == DownsampleMode::MinMax;
+  const float minValue = extremes && !isnan(sample.min) ? sample.min : sample.mean;
+  const float maxValue = extremes && !isnan(sample.max) ? sample.max : sample.mean;
+  current.add(c, minValue, maxValue);
+}
+
+void HistoryDownsampler::closeBucket() {
+  if (current.index == SIZE_MAX || !current.seen) return;
+  if (mode == DownsampleMode::MinMax) {
+    emitMinMax(current);
+  } else {
+    if (pending.index != SIZE_MAX && pending.seen) {
+      const Candidate next{static_cast<uint32_t>(current.sumT / current.seen), static_cast<float>(current.sumV / current.seen)};
+      selectLttb(pending, &next);
+    }
+    pending = current;
+  }
+  current.index = SIZE_MAX;
+}
+
+void HistoryDownsampler::finish() {
+  closeBucket();
+  if (mode == DownsampleMode::Lttb && haveFirst) {
+    if (pending.index != SIZE_MAX && pending.seen) selectLttb(pending, &last);
+    pending.index = SIZE_MAX;
+    if (!isnan(last.v)) emit(last);
+  }
+}
+
+void HistoryDownsampler::emitMinMax(const Bucket &b) {
+  if (b.min.t <= b.max.t) {
+    emit(b.min);
+    emit(b.max);
+  } else {
+    emit(b.max);
+    emit(b.min);
+  }
+}
+
+void HistoryDownsampler::selectLttb(const Bucket &b, const Candidate *next) {
+  // Times are taken relative to from to keep float precision.
+  const double ax = static_cast<double>(anchor.t) - from;
+  const double ay = anchor.v;
+  const double cx = static_cast<double>(next->t) - from;
+  const double cy = next->v;
+  const Candidate *best = nullptr;
+  double bestArea = -1.0;
+  auto consider = [&](const Candidate &p) {
+    const double px = static_cast<double>(p.t) - from;
+    const double area = fabs((ax - cx) * (p.v - ay) - (ax - px) * (cy - ay));
+    if (area > bestArea) {
+      bestArea = area;
+      best = &p;
+    }
+  };
+  for (size_t i = 0; i < b.count; ++i) consider(b.items[i]);
+  // Extremes always compete, even when the bucket was stride-sampled.
+  consider(b.min);
+  consider(b.max);
+  if (!best) return;
+  anchor = *best;
+  emit(*best);
+}
+
+void HistoryDownsampler::emit(const Candidate &c) {
+  if (emitted && c.t <= lastEmittedT) return;
+  out(c.t, c.v);
+  lastEmittedT = c.t;
+  emitted = true;
+}
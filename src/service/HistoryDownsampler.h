@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+#include "WeatherHistory.h"
+
+enum class DownsampleMode : uint8_t {
+  Lttb = 0,   // largest-triangle-three-buckets, one point per bucket
+  MinMax = 1, // min and max of every bucket, in time order
+};
+
+// Streaming downsampler for one metric. Samples are fed oldest first (e.g.
+// straight from WeatherHistory::visit) and reduced into time buckets over
+// [from, to] as they arrive, so the full-resolution series is never held in
+// memory. LTTB runs one bucket behind: it keeps the candidates of the bucket
+// being decided plus a bounded set for the bucket after it, whose mean is the
+// third triangle vertex.
+class HistoryDownsampler {
+public:
+  using Emit = std::function<void(uint32_t t, float value)>;
+
+  static constexpr size_t MAX_POINTS = 500;
+  static constexpr size_t MAX_CANDIDATES = 48; // per bucket; larger buckets are stride-sampled
+
+  HistoryDownsampler(DownsampleMode mode, uint32_t from, uint32_t to, size_t points, const Emit &emit);
+
+  void add(const HistorySample &sample);
+  // Flushes the open buckets and the final point.
+  void finish();
+
+  size_t consumed() const { return samples; }
+
+private:
+  struct Candidate {
+    uint32_t t;
+    float v;
+  };
+
+  struct Bucket {
+    size_t index = SIZE_MAX;
+    Candidate items[MAX_CANDIDATES];
+    size_t count = 0;
+    size_t seen = 0;
+    size_t stride = 1;
+    double sumT = 0;
+    double sumV = 0;
+    Candidate min{0, NAN};
+    Candidate max{0, NAN};
+
+    void reset(size_t idx);
+    void add(const Candidate &c, float minValue, float maxValue);
+  };
+
+  size_t bucketOf(uint32_t t) const;
+  void closeBucket();
+  void emitMinMax(const Bucket &b);
+  void selectLttb(const Bucket &b, const Candidate *next);
+  void emit(const Candidate &c);
+
+  DownsampleMode mode;
+  uint32_t from;
+  uint32_t to;
+  size_t bucketCount;
+  Emit out;
+
+  size_t samples = 0;
+  bool haveFirst = false;
+  Candidate first{0, NAN};
+  Candidate last{0, NAN};
+  Candidate anchor{0, NAN}; // last emitted point (LTTB vertex A)
+  uint32_t lastEmittedT = 0;
+  bool emitted = false;
+
+  // LTTB: pending is decided once current closes; MinMax only uses current.
+  Bucket pending;
+  Bucket current;
+};
@@ -0,0 +1,268 @@
+#include "HistoryLog.h"
+
+#include <LittleFS.h>
+#include <algorithm>
+
+#include "../common/Crc32.h"
+
+namespace {
+constexpr const char *LOG_DIR = "/history";
+constexpr uint32_t SEGMENT_MAGIC = 0x4C485857; // "WXHL"
+constexpr uint16_t SEGMENT_VERSION = 2;       // 2: compressed block payloads
+constexpr uint16_t BLOCK_MAGIC = 0x4248;       // "HB"
+constexpr uint32_t QUARTER_S = 15 * 60;
+// LittleFS block (erase unit) on the ESP32 flash partitions.
+constexpr uint32_t FS_BLOCK_BYTES = 4096;
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t pointSize;
+  uint32_t seq;
+  uint32_t firstTs;
+  uint32_t crc; // over the fields above
+};
+
+struct BlockHeader {
+  uint16_t magic;
+  uint16_t count;
+  uint32_t firstTs;
+  uint32_t lastTs;
+  uint32_t crc; // over the header fields above and the whole payload
+};
+
+static_assert(sizeof(BlockHeader) == HistoryLog::BLOCK_HEADER_BYTES, "block header size");
+static_assert(sizeof(SegmentHeader) <= HistoryLog::BLOCK_BYTES, "segment header size");
+
+uint32_t blockCrc(const BlockHeader &h, const uint8_t *payload) {
+  uint32_t crc = crc32Update(0, reinterpret_cast<const uint8_t *>(&h), offsetof(BlockHeader, crc));
+  return crc32Update(crc, payload, HistoryLog::PAYLOAD_BYTES);
+}
+}
+
+bool HistoryLog::begin(WeatherHistory *history, const HistoryLogConfig &cfg) {
+  historyRef = history;
+  config = cfg;
+  if (config.segmentBlocks < 2) config.segmentBlocks = 2;
+  if (!historyRef || !historyRef->ready()) return false;
+  if (!LittleFS.exists(LOG_DIR) && !LittleFS.mkdir(LOG_DIR)) {
+    Serial.println("HistoryLog: cannot create /history");
+    return false;
+  }
+
+  recover();
+  historyRef->attachLog(this);
+  historyRef->setMinuteSink([this](const HistoryPoint &p) { enqueue(p); });
+  ready = true;
+  return true;
+}
+
+void HistoryLog::loop() {
+  if (!ready || !encoder.count()) return;
+  if (encoder.nearlyFull() || millis() - firstPendingAt >= config.flushIntervalMs) {
+    writeBlock();
+  }
+}
+
+void HistoryLog::flush() {
+  if (ready && encoder.count()) writeBlock();
+}
+
+void HistoryLog::enqueue(const HistoryPoint &point) {
+  uint16_t ch[HistoryBlockRing::CHANNELS];
+  HistoryBlockRing::toChannels(point, ch);
+  if (encoder.count() && encoder.append(point.t, ch)) {
+    pendingLastTs = point.t;
+    return;
+  }
+  // Block full before loop() drained it: write through. On a flash error the
+  // point is dropped rather than stalling the loop.
+  if (encoder.count() && !writeBlock()) return;
+  encoder.reset(pending + BLOCK_HEADER_BYTES, PAYLOAD_BYTES);
+  encoder.append(point.t, ch);
+  pendingFirstTs = point.t;
+  pendingLastTs = point.t;
+  firstPendingAt = millis();
+}
+
+bool HistoryLog::writeBlock() {
+  if (!encoder.count()) return true;
+  if ((!activeOpen || activeBlocks >= config.segmentBlocks) && !openSegment(pendingFirstTs)) return false;
+
+  uint8_t *payload = pending + BLOCK_HEADER_BYTES;
+  memset(payload + encoder.bytes(), 0, PAYLOAD_BYTES - encoder.bytes());
+  BlockHeader h;
+  h.magic = BLOCK_MAGIC;
+  h.count = static_cast<uint16_t>(encoder.count());
+  h.firstTs = pendingFirstTs;
+  h.lastTs = pendingLastTs;
+  h.crc = blockCrc(h, payload);
+  memcpy(pending, &h, sizeof(h));
+
+  // Appending after a sync copies the file's partly filled tail block first.
+  const uint32_t tail = activeBytes % FS_BLOCK_BYTES;
+  const size_t written = activeFile.write(pending, BLOCK_BYTES);
+  activeFile.flush();
+  counters.copiedBytes += tail;
+  if (written != BLOCK_BYTES) {
+    // A partial block fails its CRC on recovery; start over in a new segment.
+    Serial.println("HistoryLog: short write, rotating segment");
+    closeSegment();
+    ++activeSeq;
+    return false;
+  }
+
+  ++activeBlocks;
+  activeBytes += BLOCK_BYTES;
+  counters.bytesWritten += BLOCK_BYTES;
+  if (!segments.empty()) segments.back().bytes += BLOCK_BYTES;
+  encoder.reset(payload, PAYLOAD_BYTES);
+  prune();
+  return true;
+}
+
+bool HistoryLog::openSegment(uint32_t firstTs) {
+  const uint32_t seq = activeOpen ? activeSeq + 1 : activeSeq;
+  uint8_t block[BLOCK_BYTES] = {};
+  SegmentHeader h;
+  h.magic = SEGMENT_MAGIC;
+  h.version = SEGMENT_VERSION;
+  h.pointSize = sizeof(HistoryPoint);
+  h.seq = seq;
+  h.firstTs = firstTs;
+  h.crc = crc32(&h, offsetof(SegmentHeader, crc));
+  memcpy(block, &h, sizeof(h));
+
+  closeSegment();
+  // A failed open is retried under the same number, never the old segment's.
+  activeSeq = seq;
+  File f = LittleFS.open(segmentPath(seq), "w");
+  if (!f) {
+    Serial.println("HistoryLog: cannot open segment");
+    return false;
+  }
+  const size_t written = f.write(block, sizeof(block));
+  f.flush();
+  if (written != sizeof(block)) {
+    f.close();
+    return false;
+  }
+
+  activeFile = f;
+  activeOpen = true;
+  activeBlocks = 0;
+  activeBytes = sizeof(block);
+  counters.bytesWritten += sizeof(block);
+  SegmentInfo info;
+  info.seq = seq;
+  info.firstTs = firstTs;
+  info.bytes = sizeof(block);
+  segments.push_back(info);
+  return true;
+}
+
+void HistoryLog::closeSegment() {
+  if (activeFile) activeFile.close();
+  activeFile = File();
+  activeOpen = false;
+}
+
+void HistoryLog::scanSegments(std::vector<SegmentInfo> &out) {
+  out.clear();
+  File dir = LittleFS.open(LOG_DIR);
+  if (!dir || !dir.isDirectory()) return;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    String path = String(LOG_DIR) + "/" + f.name();
+    SegmentHeader h;
+    bool valid = !f.isDirectory() && f.read(reinterpret_cast<uint8_t *>(&h), sizeof(h)) == sizeof(h) &&
+                 h.magic == SEGMENT_MAGIC && h.version == SEGMENT_VERSION && h.pointSize == sizeof(HistoryPoint) &&
+                 h.crc == crc32(&h, offsetof(SegmentHeader, crc));
+    SegmentInfo info;
+    info.seq = h.seq;
+    info.firstTs = h.firstTs;
+    info.bytes = f.size();
+    f.close();
+    if (!valid) {
+      // Unreadable header (torn create or old format): nothing to replay.
+      LittleFS.remove(path);
+      ++counters.corruptBlocks;
+      continue;
+    }
+    out.push_back(info);
+  }
+  std::sort(out.begin(), out.end(), [](const SegmentInfo &a, const SegmentInfo &b) { return a.seq < b.seq; });
+}
+
+void HistoryLog::recover() {
+  const uint32_t started = micros();
+  scanSegments(segments);
+  if (!segments.empty()) activeSeq = segments.back().seq + 1;
+
+  // Only segments whose data can still reach the 15-minute tier are replayed;
+  // a segment is skipped when the next one already starts before the cut-off.
+  const HistoryTierStats quarterStats = historyRef->stats(HistoryTier::Quarter);
+  const uint32_t window = static_cast<uint32_t>(quarterStats.capacity) * QUARTER_S;
+  const uint32_t newest = segments.empty() ? 0 : segments.back().firstTs;
+  const uint32_t cutoff = newest > window ? newest - window : 0;
+
+  uint8_t block[BLOCK_BYTES];
+  for (size_t i = 0; i < segments.size(); ++i) {
+    if (i + 1 < segments.size() && segments[i + 1].firstTs < cutoff) continue;
+    File f = LittleFS.open(segmentPath(segments[i].seq), "r");
+    if (!f || !f.seek(BLOCK_BYTES)) continue;
+    while (f.read(block, sizeof(block)) == sizeof(block)) {
+      BlockHeader h;
+      memcpy(&h, block, sizeof(h));
+      const uint8_t *payload = block + BLOCK_HEADER_BYTES;
+      if (h.magic != BLOCK_MAGIC || h.count == 0 || h.crc != blockCrc(h, payload)) {
+        // Blocks are appended in order, so nothing after a bad one is trusted.
+        ++counters.corruptBlocks;
+        break;
+      }
+      TimeSeriesDecoder<HistoryBlockRing::CHANNELS> decoder(payload, PAYLOAD_BYTES, h.count);
+      HistoryPoint point;
+      uint16_t ch[HistoryBlockRing::CHANNELS];
+      while (decoder.next(point.t, ch)) {
+        HistoryBlockRing::fromChannels(ch, point);
+        historyRef->restoreMinute(point);
+        ++counters.restoredPoints;
+      }
+    }
+    f.close();
+  }
+  counters.recoveryUs = micros() - started;
+  Serial.printf("HistoryLog: %u points from %u segments in %u us\n", static_cast<unsigned>(counters.restoredPoints),
+                static_cast<unsigned>(segments.size()), static_cast<unsigned>(counters.recoveryUs));
+  prune();
+}
+
+void HistoryLog::prune() {
+  uint32_t total = 0;
+  for (const SegmentInfo &s : segments) total += s.bytes;
+  // Never delete the segment currently being appended to.
+  while (total > config.maxBytes && segments.size() > 1) {
+    const SegmentInfo oldest = segments.front();
+    if (activeOpen && oldest.seq == activeSeq) break;
+    LittleFS.remove(segmentPath(oldest.seq));
+    total -= oldest.bytes;
+    segments.erase(segments.begin());
+  }
+}
+
+HistoryLogStats HistoryLog::stats() const {
+  HistoryLogStats st = counters;
+  st.segments = static_cast<uint16_t>(segments.size());
+  st.pendingPoints = static_cast<uint16_t>(encoder.count());
+  const uint32_t upMs = millis();
+  if (upMs > 0) {
+    const uint64_t flashBytes = static_cast<uint64_t>(counters.bytesWritten) + counters.copiedBytes;
+    st.bytesPerDay = static_cast<uint32_t>(flashBytes * 86400000ULL / upMs);
+  }
+  return st;
+}
+
+String HistoryLog::segmentPath(uint32_t seq) const {
+  char name[24];
+  snprintf(name, sizeof(name), "%s/%08lx.seg", LOG_DIR, static_cast<unsigned long>(seq));
+  return String(name);
+}
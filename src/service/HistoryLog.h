@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+#include "WeatherHistory.h"
+
+struct HistoryLogConfig {
+  uint32_t flushIntervalMs = 30UL * 60UL * 1000UL; // Batch window before a block hits flash
+  uint16_t segmentBlocks = 64;                      // Blocks per segment file before rotating
+  uint32_t maxBytes = 256UL * 1024UL;               // Oldest segments are deleted above this
+};
+
+struct HistoryLogStats {
+  uint32_t recoveryUs = 0;
+  uint32_t restoredPoints = 0;
+  uint16_t segments = 0;
+  uint16_t corruptBlocks = 0;
+  uint32_t bytesWritten = 0;
+  uint32_t copiedBytes = 0; // tail-block copies LittleFS made on top (estimate)
+  uint32_t bytesPerDay = 0; // bytesWritten + copiedBytes extrapolated over uptime
+  uint16_t pendingPoints = 0;
+};
+
+// Append-only, CRC-framed segment log of 1-minute history points on
+// LittleFS. Points are batched in RAM, compressed with TimeSeriesCodec and
+// written as fixed 512 byte blocks, so a torn write costs at most one block. Every boot starts a fresh
+// segment; recovery only reads segment headers to pick the files that can
+// still land in the in-RAM tiers, then replays their valid blocks.
+//
+// The active segment stays open and is synced once per block. Each sync
+// still makes LittleFS copy the partly filled 4 KB tail of the file into a
+// fresh block on the next append; stats() counts those copies, so
+// bytesPerDay is the flash traffic, not just the log's own bytes.
+class HistoryLog {
+public:
+  static constexpr size_t BLOCK_BYTES = 512;
+  static constexpr size_t BLOCK_HEADER_BYTES = 16;
+  static constexpr size_t PAYLOAD_BYTES = BLOCK_BYTES - BLOCK_HEADER_BYTES;
+
+  bool begin(WeatherHistory *history, const HistoryLogConfig &cfg = HistoryLogConfig{});
+  void loop();
+  // Writes any pending points now (e.g. before a planned restart).
+  void flush();
+
+  HistoryLogStats stats() const;
+
+private:
+  struct SegmentInfo {
+    uint32_t seq = 0;
+    uint32_t firstTs = 0;
+    uint32_t bytes = 0;
+  };
+
+  void enqueue(const HistoryPoint &point);
+  bool writeBlock();
+  bool openSegment(uint32_t firstTs);
+  void closeSegment();
+  void scanSegments(std::vector<SegmentInfo> &out);
+  void recover();
+  void prune();
+  String segmentPath(uint32_t seq) const;
+
+  WeatherHistory *historyRef = nullptr;
+  HistoryLogConfig config;
+  bool ready = false;
+
+  // Pending block; filled by the history sink and drained in loop(), both on the loop task.
+  uint8_t pending[BLOCK_BYTES] = {};
+  TimeSeriesEncoder<HistoryBlockRing::CHANNELS> encoder;
+  uint32_t pendingFirstTs = 0;
+  uint32_t pendingLastTs = 0;
+  unsigned long firstPendingAt = 0;
+
+  uint32_t activeSeq = 0;
+  bool activeOpen = false;
+  File activeFile;
+  uint32_t activeBytes = 0;
+  uint16_t activeBlocks = 0;
+  std::vector<SegmentInfo> segments;
+
+  HistoryLogStats counters;
+};
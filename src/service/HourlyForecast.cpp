@@ -0,0 +1,215 @@
+#include "HourlyForecast.h"
+
+float OutdoorSnapshot::*const FORECAST_FIELD_MEMBERS[FORECAST_FIELD_COUNT] = {
+  &OutdoorSnapshot::temperatureC,
+  &OutdoorSnapshot::humidity,
+  &OutdoorSnapshot::pressureHpa,
+  &OutdoorSnapshot::pressureMmHg,
+  &OutdoorSnapshot::altitudeM,
+  &OutdoorSnapshot::windSpeed,
+};
+
+namespace {
+float catmullRom(float p0, float p1, float p2, float p3, float t) {
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                 (3.0f * (p1 - p2) + p3 - p0) * t3);
+}
+}
+
+void HourlyForecast::clear() {
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    for (uint16_t h = 0; h < SLOTS; ++h) values[f][h] = NAN;
+    first[f] = SLOTS;
+    last[f] = 0;
+  }
+  memset(pushed, 0, sizeof(pushed));
+}
+
+uint8_t HourlyForecast::assign(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours) {
+  if (hours > MAX_FORECAST_HOURS) hours = MAX_FORECAST_HOURS;
+  uint8_t changed = 0;
+  float before[SLOTS];
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    memcpy(before, values[f], sizeof(before));
+    set(f, 0, current.*FORECAST_FIELD_MEMBERS[f]);
+    for (size_t h = 1; h <= hours; ++h) set(f, h, hourly[h - 1].*FORECAST_FIELD_MEMBERS[f]);
+    for (size_t h = hours + 1; h < SLOTS; ++h) set(f, h, NAN);
+    fillGaps(f);
+    // Bitwise, so NaN compares equal to NaN.
+    if (memcmp(before, values[f], sizeof(before))) changed |= 1u << f;
+  }
+  return changed;
+}
+
+uint8_t HourlyForecast::merge(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours,
+                              uint8_t currentFields, uint8_t hourlyFields) {
+  if (hours > MAX_FORECAST_HOURS) hours = MAX_FORECAST_HOURS;
+  uint8_t changed = 0;
+  float before[SLOTS];
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    const uint8_t bit = 1u << f;
+    bool touched = false;
+    memcpy(before, values[f], sizeof(before));
+    if (currentFields & bit) {
+      const float v = current.*FORECAST_FIELD_MEMBERS[f];
+      if (!isnan(v)) {
+        set(f, 0, v);
+        touched = true;
+      }
+    }
+    if (hourlyFields & bit) {
+      for (size_t h = 1; h <= hours; ++h) {
+        const float v = hourly[h - 1].*FORECAST_FIELD_MEMBERS[f];
+        if (isnan(v)) continue;
+        set(f, h, v);
+        touched = true;
+      }
+    }
+    if (!touched) continue;
+    fillGaps(f);
+    if (memcmp(before, values[f], sizeof(before))) changed |= bit;
+  }
+  return changed;
+}
+
+uint8_t HourlyForecast::dropLeading(uint16_t hours) {
+  if (!hours) return 0;
+  const uint8_t moved = fieldMask();
+  if (hours >= SLOTS) {
+    clear();
+    return moved;
+  }
+  const uint16_t keep = SLOTS - hours;
+  memmove(pushed, pushed + hours, keep);
+  memset(pushed + keep, 0, hours);
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    if (!(moved & (1u << f))) continue;
+    memmove(values[f], values[f] + hours, keep * sizeof(float));
+    for (uint16_t h = keep; h < SLOTS; ++h) values[f][h] = NAN;
+    set(f, 0, values[f][0]);
+    fillGaps(f);
+  }
+  return moved;
+}
+
+void HourlyForecast::set(size_t field, uint16_t hour, float value) {
+  values[field][hour] = value;
+  if (isnan(value)) {
+    pushed[hour] &= ~(1u << field);
+  } else {
+    pushed[hour] |= 1u << field;
+  }
+}
+
+void HourlyForecast::fillGaps(size_t field) {
+  float *column = values[field];
+  const uint8_t bit = 1u << field;
+  first[field] = SLOTS;
+  last[field] = 0;
+  for (uint16_t h = 0; h < SLOTS; ++h) {
+    // Left over from an earlier fill; redrawn below if still inside the span.
+    if (!(pushed[h] & bit)) {
+      column[h] = NAN;
+      continue;
+    }
+    if (first[field] == SLOTS) {
+      first[field] = h;
+    } else if (h - last[field] > 1) {
+      const uint16_t from = last[field];
+      const float a = column[from];
+      const float slope = (column[h] - a) / (h - from);
+      for (uint16_t g = from + 1; g < h; ++g) column[g] = a + slope * (g - from);
+    }
+    last[field] = h;
+  }
+}
+
+OutdoorSnapshot HourlyForecast::at(uint16_t hour) const {
+  OutdoorSnapshot snap;
+  if (hour >= SLOTS) return snap;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) snap.*FORECAST_FIELD_MEMBERS[f] = values[f][hour];
+  return snap;
+}
+
+OutdoorSnapshot HourlyForecast::at(float hours, ForecastInterp mode) const {
+  OutdoorSnapshot snap;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    snap.*FORECAST_FIELD_MEMBERS[f] = value(static_cast<ForecastField>(f), hours, mode);
+  }
+  return snap;
+}
+
+float HourlyForecast::value(ForecastField field, float hours, ForecastInterp mode) const {
+  const size_t f = static_cast<size_t>(field);
+  if (f >= FORECAST_FIELD_COUNT || isnan(hours)) return NAN;
+  const uint16_t lo = first[f];
+  const uint16_t hi = last[f];
+  if (lo > hi || hours < lo || hours > hi) return NAN;
+  const float *column = values[f];
+  const uint16_t i = static_cast<uint16_t>(hours);
+  const float t = hours - i;
+  if (t == 0.0f || i == hi) return column[i];
+  if (mode == ForecastInterp::Linear) return column[i] + (column[i + 1] - column[i]) * t;
+  // Neighbours outside the known span are clamped to its ends.
+  const float p0 = column[i > lo ? i - 1 : i];
+  const float p3 = column[i + 2 <= hi ? i + 2 : i + 1];
+  return catmullRom(p0, column[i], column[i + 1], p3, t);
+}
+
+ForecastWindow HourlyForecast::window(ForecastField field, uint16_t fromHour, uint16_t toHour) const {
+  ForecastWindow out;
+  const size_t f = static_cast<size_t>(field);
+  if (f >= FORECAST_FIELD_COUNT) return out;
+  if (fromHour < first[f]) fromHour = first[f];
+  if (toHour > last[f]) toHour = last[f];
+  if (fromHour > toHour) return out;
+  // The span has no NaN, so this is a straight min/max/sum the compiler can
+  // unroll; nothing here needs a per-element check.
+  const float *column = values[f] + fromHour;
+  const uint16_t n = toHour - fromHour + 1;
+  float mn = column[0];
+  float mx = column[0];
+  float sum = 0.0f;
+  for (uint16_t i = 0; i < n; ++i) {
+    const float v = column[i];
+    mn = v < mn ? v : mn;
+    mx = v > mx ? v : mx;
+    sum += v;
+  }
+  out.min = mn;
+  out.max = mx;
+  out.mean = sum / n;
+  out.hours = n;
+  return out;
+}
+
+uint8_t HourlyForecast::fieldMask() const {
+  uint8_t mask = 0;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    if (first[f] <= last[f]) mask |= 1u << f;
+  }
+  return mask;
+}
+
+uint16_t HourlyForecast::usedSlots() const {
+  return fieldMask() ? horizon() + 1 : 0;
+}
+
+void HourlyForecast::setColumn(ForecastField field, const float *data, uint16_t slots) {
+  const size_t f = static_cast<size_t>(field);
+  if (f >= FORECAST_FIELD_COUNT) return;
+  if (slots > SLOTS) slots = SLOTS;
+  for (uint16_t h = 0; h < slots; ++h) set(f, h, data[h]);
+  for (uint16_t h = slots; h < SLOTS; ++h) set(f, h, NAN);
+  fillGaps(f);
+}
+
+uint16_t HourlyForecast::horizon() const {
+  uint16_t h = 0;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    if (first[f] <= last[f] && last[f] > h) h = last[f];
+  }
+  return h;
+}
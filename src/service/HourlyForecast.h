@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct OutdoorSnapshot {
+  float temperatureC = NAN;
+  float humidity = NAN;
+  float pressureHpa = NAN;
+  float pressureMmHg = NAN;
+  float altitudeM = NAN;
+  float windSpeed = NAN;
+};
+
+constexpr uint16_t OUTLOOK_HORIZONS[] = {1, 3, 6, 12, 24, 48, 72, 96};
+constexpr size_t OUTLOOK_HORIZON_COUNT = sizeof(OUTLOOK_HORIZONS) / sizeof(OUTLOOK_HORIZONS[0]);
+// Longest forecast the cache accepts, in hours ahead.
+constexpr uint16_t MAX_FORECAST_HOURS = 168;
+// Window of the "next12h" summary published next to the outlook.
+constexpr uint16_t OUTLOOK_SUMMARY_HOURS = 12;
+
+// Sources send hPa; mmHg is filled in when they do not send it as well.
+inline void derivePressureMmHg(OutdoorSnapshot &s) {
+  if (isnan(s.pressureMmHg) && !isnan(s.pressureHpa)) s.pressureMmHg = s.pressureHpa / 1.33322f;
+}
+
+// Index into HourlyForecast's per-field arrays; same order as OutdoorSnapshot.
+enum class ForecastField : uint8_t {
+  TemperatureC,
+  Humidity,
+  PressureHpa,
+  PressureMmHg,
+  AltitudeM,
+  WindSpeed,
+};
+constexpr size_t FORECAST_FIELD_COUNT = 6;
+// The OutdoorSnapshot member behind each ForecastField.
+extern float OutdoorSnapshot::*const FORECAST_FIELD_MEMBERS[FORECAST_FIELD_COUNT];
+
+enum class ForecastInterp : uint8_t {
+  Linear,
+  Cubic, // Catmull-Rom through the neighbouring hours
+};
+
+// min/max/mean over the known hours of a window; hours == 0 if none.
+struct ForecastWindow {
+  float min = NAN;
+  float max = NAN;
+  float mean = NAN;
+  uint16_t hours = 0;
+};
+
+// Fixed-size hourly forecast, one contiguous float array per field. Slot 0
+// holds the current conditions and slot h the forecast h hours ahead.
+// assign() fills the hours between two pushed values linearly, so within a
+// field's known span every slot is finite: lookups by hour are a single
+// index, interpolation only touches adjacent slots and window() runs over
+// a plain array. Outside the span a field reads as NaN. The pushed slots
+// are remembered apart from the interpolated ones, so merge() can replace
+// a few hours and redraw only the lines between pushed values.
+class HourlyForecast {
+public:
+  static constexpr uint16_t SLOTS = MAX_FORECAST_HOURS + 1;
+
+  HourlyForecast() { clear(); }
+
+  void clear();
+  // hourly[i] is the forecast i + 1 hours ahead; NaN fields are gaps.
+  // Both return the fields whose column changed, one bit per ForecastField.
+  uint8_t assign(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours);
+  // Writes only the finite values, slot 0 from current for the fields in
+  // currentFields and the hours ahead for those in hourlyFields; every
+  // other slot keeps what it was pushed.
+  uint8_t merge(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours,
+                uint8_t currentFields, uint8_t hourlyFields);
+  // Moves the table hours slots towards 0 as time passes: slot h takes
+  // slot h + hours and the end fills with NaN. A value that lands in slot 0
+  // counts as pushed, so later merges keep it. Returns the fields that moved.
+  uint8_t dropLeading(uint16_t hours);
+
+  OutdoorSnapshot at(uint16_t hour) const;
+  OutdoorSnapshot at(float hours, ForecastInterp mode) const;
+  float value(ForecastField field, float hours, ForecastInterp mode = ForecastInterp::Linear) const;
+  // Hours [fromHour, toHour], both inclusive.
+  ForecastWindow window(ForecastField field, uint16_t fromHour, uint16_t toHour) const;
+  // Last hour ahead with any forecast value; 0 when only "current" is known.
+  uint16_t horizon() const;
+
+  // Raw columns for persistence. fieldMask() has bit f set for every field
+  // with data; usedSlots() covers all of them (0 when the table is empty).
+  uint8_t fieldMask() const;
+  uint16_t usedSlots() const;
+  const float *column(ForecastField field) const { return values[static_cast<size_t>(field)]; }
+  // Replaces one field with slots values from column(); the rest is NaN.
+  // Every finite value counts as pushed, interpolated ones included.
+  void setColumn(ForecastField field, const float *data, uint16_t slots);
+
+private:
+  float values[FORECAST_FIELD_COUNT][SLOTS];
+  // Bit f of pushed[h] is set when values[f][h] was pushed, not filled in.
+  uint8_t pushed[SLOTS];
+  // Known span per field; first > last when the field has no data.
+  uint16_t first[FORECAST_FIELD_COUNT];
+  uint16_t last[FORECAST_FIELD_COUNT];
+
+  void set(size_t field, uint16_t hour, float value);
+  void fillGaps(size_t field);
+};
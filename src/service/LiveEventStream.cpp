@@ -0,0 +1,161 @@
+#include "LiveEventStream.h"
+
+#include <ArduinoJson.h>
+
+#include "TelemetryFrameCache.h"
+#include "OutdoorService.h"
+#include "WeatherHistory.h"
+#include "ServicePayloads.h"
+
+namespace {
+constexpr const char *KIND_NAMES[] = {"metrics", "outdoor", "resources"};
+constexpr uint8_t ALL_KINDS = 0x07;
+
+uint8_t bitCount(uint8_t v) {
+  uint8_t n = 0;
+  for (; v; v &= v - 1) ++n;
+  return n;
+}
+}
+
+void LiveEventStream::begin(TelemetryFrameCache *frames, OutdoorService *outdoor, const WeatherHistory *history) {
+  framesRef = frames;
+  outdoorRef = outdoor;
+  historyRef = history;
+  if (!mutex) mutex = xSemaphoreCreateMutex();
+
+  // Refused connections get a 403, which makes browsers stop retrying and
+  // fall back to polling instead of reconnecting in a loop.
+  source.authorizeConnect([this](AsyncWebServerRequest *) {
+    lock();
+    const bool room = subscribers.size() < MAX_CLIENTS;
+    if (!room) ++rejected;
+    unlock();
+    return room;
+  });
+  source.onConnect([this](AsyncEventSourceClient *client) {
+    // The first loop() pass after connecting sends every current payload.
+    lock();
+    Subscriber sub;
+    sub.client = client;
+    sub.stale = ALL_KINDS;
+    subscribers.push_back(sub);
+    unlock();
+  });
+  source.onDisconnect([this](AsyncEventSourceClient *client) {
+    lock();
+    for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+      if (it->client == client) {
+        subscribers.erase(it);
+        break;
+      }
+    }
+    unlock();
+  });
+}
+
+void LiveEventStream::loop() {
+  if (!mutex) return;
+  lock();
+  const bool idle = subscribers.empty();
+  unlock();
+  // Nothing is serialized while nobody listens.
+  if (idle) return;
+
+  const uint8_t changed = rebuild();
+
+  lock();
+  bool uniform = true;
+  for (const Subscriber &sub : subscribers) {
+    if (sub.stale || sub.client->packetsWaiting() >= MAX_BACKLOG) {
+      uniform = false;
+      break;
+    }
+  }
+  if (uniform) {
+    // Common case: every client is caught up, so each frame is formatted
+    // once and shared by all of them.
+    for (uint8_t k = 0; k < KIND_COUNT; ++k) {
+      if (!(changed & (1u << k))) continue;
+      source.send(payload[k].c_str(), KIND_NAMES[k], ++eventId);
+      sent += subscribers.size();
+    }
+  } else {
+    for (Subscriber &sub : subscribers) {
+      const uint8_t due = sub.stale | changed;
+      if (!due) continue;
+      if (sub.client->packetsWaiting() >= MAX_BACKLOG) {
+        // Drop-to-latest: a kind that is already owed is simply replaced.
+        dropped += bitCount(changed & sub.stale);
+        sub.stale = due;
+        continue;
+      }
+      sent += sendTo(sub.client, due);
+      sub.stale = 0;
+    }
+  }
+  unlock();
+}
+
+uint8_t LiveEventStream::rebuild() {
+  uint8_t changed = 0;
+  if (framesRef) {
+    const uint32_t generation = framesRef->refresh();
+    if (!built[Metrics] || generation != metricsGeneration) {
+      String etag;
+      built[Metrics] = framesRef->metricsBody(payload[Metrics], etag);
+      metricsGeneration = generation;
+      if (built[Metrics]) changed |= 1u << Metrics;
+    }
+  }
+  if (outdoorRef) {
+    const uint32_t revision = outdoorRef->revision();
+    if (!built[Outdoor] || revision != outdoorRevision) {
+      payload[Outdoor] = renderRecords(outdoorForecastRecords(*outdoorRef));
+      outdoorRevision = revision;
+      built[Outdoor] = payload[Outdoor].length() > 0;
+      if (built[Outdoor]) changed |= 1u << Outdoor;
+    }
+  }
+  if (historyRef) {
+    const unsigned long now = millis();
+    if (!built[Resources] || now - resourcesAt >= RESOURCES_INTERVAL_MS) {
+      JsonDocument doc;
+      buildResourcesJson(doc.to<JsonObject>(), *historyRef, this);
+      payload[Resources] = String();
+      serializeJson(doc, payload[Resources]);
+      resourcesAt = now;
+      built[Resources] = true;
+      changed |= 1u << Resources;
+    }
+  }
+  return changed;
+}
+
+size_t LiveEventStream::sendTo(AsyncEventSourceClient *client, uint8_t kinds) {
+  size_t queued = 0;
+  for (uint8_t k = 0; k < KIND_COUNT; ++k) {
+    if (!(kinds & (1u << k)) || !built[k]) continue;
+    if (client->send(payload[k].c_str(), KIND_NAMES[k], ++eventId)) ++queued;
+  }
+  return queued;
+}
+
+LiveEventStats LiveEventStream::stats() const {
+  LiveEventStats st;
+  if (mutex) lock();
+  st.clients = static_cast<uint16_t>(subscribers.size());
+  st.rejected = rejected;
+  if (mutex) unlock();
+  st.sent = sent;
+  st.dropped = dropped;
+  return st;
+}
+
+void LiveEventStream::lock() const {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void LiveEventStream::unlock() const {
+  xSemaphoreGive(mutex);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+class TelemetryFrameCache;
+class OutdoorService;
+class WeatherHistory;
+
+struct LiveEventStats {
+  uint16_t clients = 0;
+  uint32_t sent = 0;      // frames queued to clients
+  uint32_t dropped = 0;   // frames superseded while a client was backed up
+  uint32_t rejected = 0;  // connections refused over MAX_CLIENTS
+};
+
+// Server-sent events at /api/events. Each payload (metrics per sample, the
+// outdoor cache per update, resources every RESOURCES_INTERVAL_MS) is
+// serialized once in loop() and the same buffer is queued to every
+// subscriber, so the device does one build per change however many
+// dashboards are open. A client with MAX_BACKLOG frames still unsent is
+// skipped; once it drains it gets only the newest payload of each kind.
+class LiveEventStream {
+public:
+  static constexpr size_t MAX_CLIENTS = 4;
+  static constexpr size_t MAX_BACKLOG = 4;
+  static constexpr uint32_t RESOURCES_INTERVAL_MS = 10000;
+
+  void begin(TelemetryFrameCache *frames, OutdoorService *outdoor, const WeatherHistory *history);
+  void loop();
+
+  AsyncEventSource &handler() { return source; }
+  LiveEventStats stats() const;
+
+private:
+  enum Kind : uint8_t { Metrics = 0, Outdoor = 1, Resources = 2, KIND_COUNT = 3 };
+
+  struct Subscriber {
+    AsyncEventSourceClient *client = nullptr;
+    uint8_t stale = 0; // kinds owed to this client, one bit per Kind
+  };
+
+  uint8_t rebuild();
+  size_t sendTo(AsyncEventSourceClient *client, uint8_t kinds);
+  void lock() const;
+  void unlock() const;
+
+  AsyncEventSource source{"/api/events"};
+  TelemetryFrameCache *framesRef = nullptr;
+  OutdoorService *outdoorRef = nullptr;
+  const WeatherHistory *historyRef = nullptr;
+  SemaphoreHandle_t mutex = nullptr;
+
+  // Touched by the async_tcp task (connect/disconnect) and loop(); guarded by mutex.
+  std::vector<Subscriber> subscribers;
+  uint32_t rejected = 0;
+
+  // Owned by loop().
+  String payload[KIND_COUNT];
+  bool built[KIND_COUNT] = {};
+  uint32_t metricsGeneration = 0;
+  uint32_t outdoorRevision = 0;
+  unsigned long resourcesAt = 0;
+  uint32_t eventId = 0;
+  uint32_t sent = 0;
+  uint32_t dropped = 0;
+};
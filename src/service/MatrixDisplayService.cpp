@@ -8,14 +8,58 @@
 #include "setup/MqttService.h"
 
 namespace {
-constexpr const char *NS = "matrix";
-constexpr unsigned long STALE_MS = 15UL * 60UL * 1000UL; // 15 minutes
+constexpr uint32_t STALE_S = 15UL * 60UL; // 15 minutes
 constexpr uint16_t DEFAULT_NIGHT_START = 23 * 60; // 11pm
 constexpr uint16_t DEFAULT_NIGHT_END = 7 * 60;    // 7am
 
 uint8_t clamp8(uint32_t v) { return v > 255 ? 255 : static_cast<uint8_t>(v); }
-uint16_t clamp16(uint32_t v, uint16_t maxV) { return v > maxV ? maxV : static_cast<uint16_t>(v); }
-MatrixDisplayService *ACTIVE_MATRIX = nullptr;
+
+// Data restored from flash before SNTP has set the clock has no known age
+// yet; it is shown until the clock says otherwise.
+bool outdoorStale(const OutdoorData &outdoor) {
+  if (!OutdoorService::hasData(outdoor)) return true;
+  const uint32_t age = OutdoorService::ageSeconds(outdoor);
+  return age != OutdoorService::AGE_UNKNOWN && age > STALE_S;
+}
+
+static_assert(offsetof(MatrixConfig, color1B) == offsetof(MatrixConfig, color1R) + 2 &&
+                  offsetof(MatrixConfig, color2B) == offsetof(MatrixConfig, color2R) + 2,
+              "CONFIG_RGB needs the colour channels adjacent");
+
+// The MQTT keys are the short names the command topic has always accepted.
+// Scene order is fixed to the clock (see saveConfig), so s0..s3 are not stored.
+constexpr ConfigField<MatrixConfig> MATRIX_FIELDS[] = {
+  CONFIG_FIELD(MatrixConfig, enabled, "enabled", "enabled", "enabled", 0, 1),
+  CONFIG_FIELD(MatrixConfig, pin, "pin", nullptr, "pin", 0, 255),
+  CONFIG_FIELD(MatrixConfig, width, "width", nullptr, "w", 1, 256),
+  CONFIG_FIELD(MatrixConfig, height, "height", nullptr, "h", 1, 256),
+  CONFIG_FIELD(MatrixConfig, serpentine, "serpentine", nullptr, "serp", 0, 1),
+  CONFIG_FIELD(MatrixConfig, startBottom, "startBottom", nullptr, "bottom", 0, 1),
+  CONFIG_FIELD(MatrixConfig, flipX, "flipX", nullptr, "flipx", 0, 1),
+  CONFIG_FIELD(MatrixConfig, orientation, "orientationIndex", nullptr, "orient", 0, 3),
+  CONFIG_FIELD(MatrixConfig, brightness, "brightness", "brightness", "bright", 0, 255),
+  CONFIG_FIELD(MatrixConfig, maxBrightness, "maxBrightness", "maxBrightness", "maxb", 0, 255),
+  CONFIG_FIELD(MatrixConfig, nightEnabled, "nightEnabled", "night", "night", 0, 1),
+  CONFIG_FIELD(MatrixConfig, nightStartMin, "nightStartMin", "nightStart", "nstart", 0, 1440),
+  CONFIG_FIELD(MatrixConfig, nightEndMin, "nightEndMin", "nightEnd", "nend", 0, 1440),
+  CONFIG_FIELD(MatrixConfig, nightBrightness, "nightBrightness", "nightBrightness", "nbright", 0, 255),
+  CONFIG_FIELD(MatrixConfig, fps, "fps", nullptr, "fps", 1, 200),
+  CONFIG_FIELD(MatrixConfig, sceneDwellMs, "sceneDwellMs", nullptr, "dwell", 0, 60000),
+  CONFIG_FIELD(MatrixConfig, transitionMs, "transitionMs", nullptr, "transition", 0, 5000),
+  CONFIG_FIELD(MatrixConfig, sceneCount, "sceneCount", nullptr, "scenes", 1, 4),
+  CONFIG_FIELD(MatrixConfig, clockUse12h, "clockUse12h", "use12h", "use12h", 0, 1),
+  CONFIG_FIELD(MatrixConfig, clockShowSeconds, "clockShowSeconds", "showSeconds", "showSec", 0, 1),
+  CONFIG_FIELD(MatrixConfig, clockShowMillis, "clockShowMillis", "showMillis", "showMs", 0, 1),
+  CONFIG_FIELD(MatrixConfig, colorMode, "colorMode", "colorMode", "cMode", 0, 2),
+  CONFIG_RGB(MatrixConfig, color1R, "color1", "color1"),
+  CONFIG_RGB(MatrixConfig, color2R, "color2", "color2"),
+  CONFIG_FIELD(MatrixConfig, color1R, nullptr, nullptr, "c1r", 0, 255),
+  CONFIG_FIELD(MatrixConfig, color1G, nullptr, nullptr, "c1g", 0, 255),
+  CONFIG_FIELD(MatrixConfig, color1B, nullptr, nullptr, "c1b", 0, 255),
+  CONFIG_FIELD(MatrixConfig, color2R, nullptr, nullptr, "c2r", 0, 255),
+  CONFIG_FIELD(MatrixConfig, color2G, nullptr, nullptr, "c2g", 0, 255),
+  CONFIG_FIELD(MatrixConfig, color2B, nullptr, nullptr, "c2b", 0, 255),
+};
 
 struct Glyph {
   char ch;
@@ -37,6 +81,7 @@ constexpr Glyph FONT[] = {
   {'-', {0b000, 0b000, 0b111, 0b000, 0b000}},
   {'.', {0b000, 0b000, 0b000, 0b000, 0b010}},
   {':', {0b000, 0b010, 0b000, 0b010, 0b000}},
+  {'^', {0b010, 0b101, 0b000, 0b000, 0b000}},
   {' ', {0b000, 0b000, 0b000, 0b000, 0b000}},
   {'A', {0b111, 0b101, 0b111, 0b101, 0b101}},
   {'B', {0b110, 0b101, 0b110, 0b101, 0b110}},
@@ -67,10 +112,12 @@ const Glyph *lookupGlyph(char c) {
 }
 }
 
+const ConfigSchema<MatrixConfig> matrixConfigSchema(MATRIX_FIELDS);
+
 void MatrixDisplayService::begin(WeatherService *weather, OutdoorService *outdoor) {
-  ACTIVE_MATRIX = this;
   weatherRef = weather;
   outdoorRef = outdoor;
+  if (mqttRef) mqttRef->subscribe("matrix/cmd", &MatrixDisplayService::onMqttMessage, this);
   loadConfig();
   ensureStrip();
   sceneStartMs = millis();
@@ -100,6 +147,13 @@ void MatrixDisplayService::clearStrip() {
 }
 
 bool MatrixDisplayService::saveConfig(const MatrixConfig &next) {
+  MatrixCommand cmd;
+  cmd.kind = MatrixCommand::Kind::SetConfig;
+  cmd.config = next;
+  return commands.post(std::move(cmd));
+}
+
+void MatrixDisplayService::applyConfig(const MatrixConfig &next) {
   MatrixConfig sanitized = next;
   sanitized.sceneCount = 1;
   sanitized.sceneOrder[0] = 0;
@@ -115,81 +169,33 @@ bool MatrixDisplayService::saveConfig(const MatrixConfig &next) {
     sanitized.colorMode = MatrixColorMode::Solid;
   }
 
-  prefs.begin(NS, false);
-  prefs.putBool("enabled", sanitized.enabled);
-  prefs.putUChar("pin", sanitized.pin);
-  prefs.putUShort("w", sanitized.width);
-  prefs.putUShort("h", sanitized.height);
-  prefs.putBool("serp", sanitized.serpentine);
-  prefs.putBool("bottom", sanitized.startBottom);
-  prefs.putBool("flipx", sanitized.flipX);
-  prefs.putUChar("orient", static_cast<uint8_t>(sanitized.orientation));
-  prefs.putUChar("bright", sanitized.brightness);
-  prefs.putUChar("maxb", sanitized.maxBrightness);
-  prefs.putBool("night", sanitized.nightEnabled);
-  prefs.putUShort("nstart", sanitized.nightStartMin);
-  prefs.putUShort("nend", sanitized.nightEndMin);
-  prefs.putUChar("nbright", sanitized.nightBrightness);
-  prefs.putUShort("fps", sanitized.fps);
-  prefs.putUShort("dwell", sanitized.sceneDwellMs);
-  prefs.putUShort("transition", sanitized.transitionMs);
-  prefs.putUChar("scenes", sanitized.sceneCount);
-  prefs.putUChar("s0", sanitized.sceneOrder[0]);
-  prefs.putUChar("s1", sanitized.sceneOrder[1]);
-  prefs.putUChar("s2", sanitized.sceneOrder[2]);
-  prefs.putUChar("s3", sanitized.sceneOrder[3]);
-  prefs.putBool("use12h", sanitized.clockUse12h);
-  prefs.putBool("showSec", sanitized.clockShowSeconds);
-  prefs.putBool("showMs", sanitized.clockShowMillis);
-  prefs.putUChar("cMode", static_cast<uint8_t>(sanitized.colorMode));
-  prefs.putUChar("c1r", sanitized.color1R);
-  prefs.putUChar("c1g", sanitized.color1G);
-  prefs.putUChar("c1b", sanitized.color1B);
-  prefs.putUChar("c2r", sanitized.color2R);
-  prefs.putUChar("c2g", sanitized.color2G);
-  prefs.putUChar("c2b", sanitized.color2B);
-  prefs.end();
   config = sanitized;
+  sharedConfig.publish(config);
+  store.stage(matrixConfigSchema, config);
   ensureStrip();
   publishState();
-  return true;
+}
+
+void MatrixDisplayService::applyCommand(MatrixCommand &cmd) {
+  switch (cmd.kind) {
+    case MatrixCommand::Kind::SetConfig:
+      applyConfig(cmd.config);
+      break;
+    case MatrixCommand::Kind::Action:
+      if (cmd.action == MatrixAction::Test) {
+        testUntilMs = millis() + 3000;
+      } else {
+        testUntilMs = 0;
+        clearStrip();
+      }
+      break;
+    case MatrixCommand::Kind::None:
+      break;
+  }
 }
 
 void MatrixDisplayService::loadConfig() {
-  prefs.begin(NS, true);
-  config.enabled = prefs.getBool("enabled", config.enabled);
-  config.pin = prefs.getUChar("pin", config.pin);
-  config.width = prefs.getUShort("w", config.width);
-  config.height = prefs.getUShort("h", config.height);
-  config.serpentine = prefs.getBool("serp", config.serpentine);
-  config.startBottom = prefs.getBool("bottom", config.startBottom);
-  config.flipX = prefs.getBool("flipx", config.flipX);
-  config.orientation = static_cast<MatrixOrientation>(prefs.getUChar("orient", static_cast<uint8_t>(config.orientation)));
-  config.brightness = prefs.getUChar("bright", config.brightness);
-  config.maxBrightness = prefs.getUChar("maxb", config.maxBrightness);
-  config.nightEnabled = prefs.getBool("night", config.nightEnabled);
-  config.nightStartMin = prefs.getUShort("nstart", config.nightStartMin);
-  config.nightEndMin = prefs.getUShort("nend", config.nightEndMin);
-  config.nightBrightness = prefs.getUChar("nbright", config.nightBrightness);
-  config.fps = prefs.getUShort("fps", config.fps);
-  config.sceneDwellMs = prefs.getUShort("dwell", config.sceneDwellMs);
-  config.transitionMs = prefs.getUShort("transition", config.transitionMs);
-  config.sceneCount = prefs.getUChar("scenes", config.sceneCount);
-  config.sceneOrder[0] = prefs.getUChar("s0", config.sceneOrder[0]);
-  config.sceneOrder[1] = prefs.getUChar("s1", config.sceneOrder[1]);
-  config.sceneOrder[2] = prefs.getUChar("s2", config.sceneOrder[2]);
-  config.sceneOrder[3] = prefs.getUChar("s3", config.sceneOrder[3]);
-  config.clockUse12h = prefs.getBool("use12h", config.clockUse12h);
-  config.clockShowSeconds = prefs.getBool("showSec", config.clockShowSeconds);
-  config.clockShowMillis = prefs.getBool("showMs", config.clockShowMillis);
-  config.colorMode = static_cast<MatrixColorMode>(prefs.getUChar("cMode", static_cast<uint8_t>(config.colorMode)) % 3);
-  config.color1R = prefs.getUChar("c1r", config.color1R);
-  config.color1G = prefs.getUChar("c1g", config.color1G);
-  config.color1B = prefs.getUChar("c1b", config.color1B);
-  config.color2R = prefs.getUChar("c2r", config.color2R);
-  config.color2G = prefs.getUChar("c2g", config.color2G);
-  config.color2B = prefs.getUChar("c2b", config.color2B);
-  prefs.end();
+  store.load(matrixConfigSchema, config);
 
   config.sceneCount = 1;
   config.sceneOrder[0] = 0;
@@ -201,6 +207,7 @@ void MatrixDisplayService::loadConfig() {
   config.nightStartMin = DEFAULT_NIGHT_START;
   config.nightEndMin = DEFAULT_NIGHT_END;
   // keep user clock prefs as loaded; defaults already applied
+  sharedConfig.publish(config);
 }
 
 uint16_t MatrixDisplayService::pixelIndex(uint16_t x, uint16_t y) const {
@@ -248,18 +255,14 @@ void MatrixDisplayService::refreshData() {
   lastSampleMs = now;
 
   if (weatherRef) {
-    WeatherReading reading;
-    // Use a non-blocking read if available; fallback to latest snapshot when read fails.
-    if (weatherRef->read(reading)) {
-      indoorSample = reading;
-    } else {
-      indoorSample = weatherRef->latest();
-    }
+    // Snapshot copy from the sampler task; keeps the render path off the I2C bus.
+    indoorSample = weatherRef->latest();
   }
 
   if (outdoorRef) {
-    outdoorSample = outdoorRef->current();
-    outdoorSampleMs = outdoorRef->lastFetchMs();
+    OutdoorService::DataReader outdoor = outdoorRef->data();
+    outdoorSample = outdoor->current;
+    outdoorSampleStale = outdoorStale(*outdoor);
   }
 }
 
@@ -269,12 +272,6 @@ bool MatrixDisplayService::timeValid() const {
   return now > 1104537600;
 }
 
-bool outdoorStale(unsigned long sampleMs) {
-  if (sampleMs == 0) return true;
-  unsigned long now = millis();
-  return now - sampleMs > STALE_MS;
-}
-
 static bool isMinutesInRange(uint16_t startMin, uint16_t endMin, uint16_t nowMin) {
   if (startMin == endMin) return false; // disabled window
   if (startMin < endMin) {
@@ -375,16 +372,17 @@ void MatrixDisplayService::drawFloat(uint16_t x, uint16_t y, float value, uint8_
   drawText(x, y, s, color);
 }
 
-void MatrixDisplayService::performAction(const String &action) {
+bool MatrixDisplayService::performAction(const String &action) {
+  MatrixCommand cmd;
+  cmd.kind = MatrixCommand::Kind::Action;
   if (action.equalsIgnoreCase("test")) {
-    testUntilMs = millis() + 3000;
-    return;
-  }
-  if (action.equalsIgnoreCase("clear")) {
-    testUntilMs = 0;
-    clearStrip();
-    return;
+    cmd.action = MatrixAction::Test;
+  } else if (action.equalsIgnoreCase("clear")) {
+    cmd.action = MatrixAction::Clear;
+  } else {
+    return true; // unknown actions are ignored
   }
+  return commands.post(std::move(cmd));
 }
 
 String MatrixDisplayService::stateTopic() const {
@@ -392,11 +390,6 @@ String MatrixDisplayService::stateTopic() const {
   return DeviceHelpers::makeTopic(mqttRef->baseTopic(), "matrix/state");
 }
 
-String MatrixDisplayService::commandTopic() const {
-  if (!mqttRef) return String();
-  return DeviceHelpers::makeTopic(mqttRef->baseTopic(), "matrix/cmd");
-}
-
 void MatrixDisplayService::publishState() {
   if (!mqttRef || !mqttRef->isConnected()) return;
   JsonDocument doc;
@@ -428,119 +421,46 @@ void MatrixDisplayService::publishState() {
   mqttRef->publish(stateTopic(), payload, true);
 }
 
-void MatrixDisplayService::onMqttMessage(char *topic, uint8_t *payload, unsigned int length) {
-  if (!mqttRef) return;
-  String incomingTopic(topic);
-  if (incomingTopic != commandTopic()) return;
+void MatrixDisplayService::onMqttMessage(void *ctx, const uint8_t *payload, unsigned int length) {
+  static_cast<MatrixDisplayService *>(ctx)->handleCommand(payload, length);
+}
 
+void MatrixDisplayService::handleCommand(const uint8_t *payload, unsigned int length) {
   JsonDocument doc;
   DeserializationError err = deserializeJson(doc, payload, length);
   if (err) return;
-  JsonObject obj = doc.as<JsonObject>();
+  JsonObjectConst obj = doc.as<JsonObjectConst>();
 
-  bool changed = false;
-  MatrixConfig next = config;
+  MatrixConfig next = currentConfig();
+  const bool changed = matrixConfigSchema.apply(obj, next, ConfigKeys::Mqtt).applied > 0;
 
-  if (obj["enabled"].is<bool>()) {
-    next.enabled = obj["enabled"].as<bool>();
-    changed = true;
-  }
-  if (obj["maxBrightness"].is<uint32_t>()) {
-    uint32_t mb = obj["maxBrightness"].as<uint32_t>();
-    next.maxBrightness = clamp8(mb);
-    changed = true;
-  }
-  if (obj["night"].is<bool>()) {
-    next.nightEnabled = obj["night"].as<bool>();
-    changed = true;
-  }
-  if (obj["nightBrightness"].is<uint32_t>()) {
-    next.nightBrightness = clamp8(obj["nightBrightness"].as<uint32_t>());
-    changed = true;
-  }
-  if (obj["nightStart"].is<uint32_t>()) {
-    next.nightStartMin = clamp16(obj["nightStart"].as<uint32_t>(), 1440);
-    changed = true;
-  }
-  if (obj["nightEnd"].is<uint32_t>()) {
-    next.nightEndMin = clamp16(obj["nightEnd"].as<uint32_t>(), 1440);
-    changed = true;
-  }
-  if (obj["brightness"].is<uint32_t>()) {
-    uint32_t b = obj["brightness"].as<uint32_t>();
-    next.brightness = clamp8(b);
-    changed = true;
-  }
   if (obj["scene"].is<int>()) {
     int s = obj["scene"].as<int>();
     activeScene = s >= 0 ? (s % 4) : 0;
     sceneStartMs = millis();
   }
-  if (obj["use12h"].is<bool>()) {
-    next.clockUse12h = obj["use12h"].as<bool>();
-    changed = true;
-  }
-  if (obj["showSeconds"].is<bool>()) {
-    next.clockShowSeconds = obj["showSeconds"].as<bool>();
-    changed = true;
-  }
-  if (obj["showMillis"].is<bool>()) {
-    next.clockShowMillis = obj["showMillis"].as<bool>();
-    changed = true;
-  }
   if (obj["action"].is<const char *>()) {
     performAction(obj["action"].as<const char *>());
   }
 
-  if (obj["colorMode"].is<int>()) {
-    int m = obj["colorMode"].as<int>();
-    if (m >= 0 && m <= 2) {
-      next.colorMode = static_cast<MatrixColorMode>(m);
-      changed = true;
-    }
-  }
-  if (obj["color1"].is<JsonArray>()) {
-    JsonArray c1 = obj["color1"].as<JsonArray>();
-    if (c1.size() >= 3) {
-      next.color1R = clamp8(c1[0].as<uint32_t>());
-      next.color1G = clamp8(c1[1].as<uint32_t>());
-      next.color1B = clamp8(c1[2].as<uint32_t>());
-      changed = true;
-    }
-  }
-  if (obj["color2"].is<JsonArray>()) {
-    JsonArray c2 = obj["color2"].as<JsonArray>();
-    if (c2.size() >= 3) {
-      next.color2R = clamp8(c2[0].as<uint32_t>());
-      next.color2G = clamp8(c2[1].as<uint32_t>());
-      next.color2B = clamp8(c2[2].as<uint32_t>());
-      changed = true;
-    }
-  }
-
+  // Already on the render task, so the change is applied directly.
   if (changed) {
-    saveConfig(next);
+    applyConfig(next); // publishes the new state
+  } else {
+    publishState();
   }
-  publishState();
 }
 
 void MatrixDisplayService::handleMqtt() {
   if (!mqttRef) return;
   if (!mqttRef->isConnected()) {
-    mqttSubscribed = false;
+    statePublished = false;
     return;
   }
-
-  PubSubClient &client = mqttRef->client();
-  if (!mqttCallbackSet) {
-    client.setCallback([](char *topic, uint8_t *payload, unsigned int length) {
-      if (ACTIVE_MATRIX) ACTIVE_MATRIX->onMqttMessage(topic, payload, length);
-    });
-    mqttCallbackSet = true;
-  }
-  if (!mqttSubscribed) {
-    client.subscribe(commandTopic().c_str());
-    mqttSubscribed = true;
+  // MqttService resubscribes matrix/cmd itself; the retained state is
+  // refreshed once per connection.
+  if (!statePublished) {
+    statePublished = true;
     publishState();
   }
 }
@@ -644,7 +564,7 @@ void MatrixDisplayService::renderWeatherScene(float phase01) {
   float inHum = indoorSample.humidity;
   float outTemp = outdoorSample.temperatureC;
   float outWind = outdoorSample.windSpeed;
-  bool outStale = outdoorStale(outdoorSampleMs);
+  bool outStale = outdoorSampleStale;
 
   const uint32_t tempColor = strip->Color(255, 170, 90);
   const uint32_t humColor = strip->Color(120, 200, 255);
@@ -686,7 +606,7 @@ void MatrixDisplayService::renderForecastScene(float phase01) {
   if (!strip) return;
   strip->clear();
 
-  bool stale = outdoorStale(outdoorSampleMs);
+  bool stale = outdoorSampleStale;
 
   if (!outdoorRef || stale) {
     drawTextCentered(1, "NO OUT", strip->Color(255, 120, 120));
@@ -695,13 +615,19 @@ void MatrixDisplayService::renderForecastScene(float phase01) {
 
   uint16_t chosen = 0;
   OutdoorSnapshot snap{};
-  for (uint16_t h : OUTLOOK_HORIZONS) {
-    OutdoorSnapshot candidate = outdoorRef->forecastFor(h);
-    if (!isnan(candidate.temperatureC)) {
-      chosen = h;
-      snap = candidate;
-      break;
+  ForecastWindow next;
+  {
+    // One version for the headline hour and the 12 h high.
+    OutdoorService::DataReader outdoor = outdoorRef->data();
+    for (uint16_t h : OUTLOOK_HORIZONS) {
+      OutdoorSnapshot candidate = outdoor->forecast.at(h);
+      if (!isnan(candidate.temperatureC)) {
+        chosen = h;
+        snap = candidate;
+        break;
+      }
     }
+    next = outdoor->forecast.window(ForecastField::TemperatureC, 1, OUTLOOK_SUMMARY_HOURS);
   }
 
   if (chosen == 0) {
@@ -722,6 +648,12 @@ void MatrixDisplayService::renderForecastScene(float phase01) {
   drawText(0, y2, "H", humColor);
   drawFloat(4, y2, snap.humidity, 0, humColor);
 
+  // High of the next 12 h, when there is room next to the humidity.
+  if (config.width >= 32 && next.hours) {
+    drawText(4 * 4, y2, "^", tempColor);
+    drawFloat(4 * 5, y2, next.max, 0, tempColor);
+  }
+
   // gentle bar to show phase
   uint16_t idxBar = pixelIndex(static_cast<uint16_t>(phase01 * config.width) % config.width, config.height > 0 ? config.height - 1 : 0);
   if (idxBar != UINT16_MAX) strip->setPixelColor(idxBar, strip->Color(60, 120, 200));
@@ -803,6 +735,8 @@ void MatrixDisplayService::renderFrame() {
 }
 
 void MatrixDisplayService::loop() {
+  store.loop();
+  commands.drain([this](MatrixCommand &cmd) { applyCommand(cmd); });
   handleMqtt();
   if (!config.enabled) {
     return;
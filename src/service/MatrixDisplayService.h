@@ -2,11 +2,14 @@
 
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
-#include <Preferences.h>
 #include <memory>
 
 #include "WeatherService.h"
 #include "OutdoorService.h"
+#include "common/ConfigSchema.h"
+#include "common/CommandQueue.h"
+#include "common/ConfigStore.h"
+#include "common/RcuSnapshot.h"
 
 class MqttService;
 
@@ -58,19 +61,42 @@ struct MatrixConfig {
   uint8_t color2B = 255;
 };
 
+// Keys and ranges for the HTTP API, MQTT commands and NVS. sceneOrder and
+// orientationDegrees are JSON-only views handled next to it.
+extern const ConfigSchema<MatrixConfig> matrixConfigSchema;
+
+enum class MatrixAction : uint8_t {
+  Test,  // full test pattern for 3 s
+  Clear,
+};
+
+// A change posted from another task and applied by loop() between frames.
+struct MatrixCommand {
+  enum class Kind : uint8_t { None, SetConfig, Action };
+  Kind kind = Kind::None;
+  MatrixConfig config;
+  MatrixAction action = MatrixAction::Test;
+};
+
 class MatrixDisplayService {
 public:
   void begin(WeatherService *weather, OutdoorService *outdoor);
   void loop();
   void attachMqtt(MqttService *mqtt) { mqttRef = mqtt; }
 
-  MatrixConfig currentConfig() const { return config; }
+  // The config as last applied, safe from any task.
+  MatrixConfig currentConfig() const { return sharedConfig.get(); }
+  // Safe from any task: queues next and returns at once; loop() applies it
+  // before the next frame. False when the queue is full.
+  // The NVS write is debounced (see ConfigStore).
   bool saveConfig(const MatrixConfig &next);
   void loadConfig();
+  void flushConfig() { store.flush(); }
 
   void showSolid(uint32_t color);
   void shutdown();
-  void performAction(const String &action);
+  // "test" or "clear", queued like saveConfig(); false if the queue is full.
+  bool performAction(const String &action);
 
 private:
   void ensureStrip();
@@ -93,13 +119,20 @@ private:
   void drawNumber(uint16_t x, uint16_t y, int value, uint32_t color, int width = 0, bool signedFlag = false);
   void drawFloat(uint16_t x, uint16_t y, float value, uint8_t decimals, uint32_t color, int width = 0);
   void handleMqtt();
-  void onMqttMessage(char *topic, uint8_t *payload, unsigned int length);
+  static void onMqttMessage(void *ctx, const uint8_t *payload, unsigned int length);
+  void handleCommand(const uint8_t *payload, unsigned int length);
   void publishState();
+  // Render task only.
+  void applyCommand(MatrixCommand &cmd);
+  void applyConfig(const MatrixConfig &next);
   String stateTopic() const;
-  String commandTopic() const;
 
-  Preferences prefs;
+  ConfigStore store{"matrix"};
+  // config and strip belong to the render task; other tasks read
+  // sharedConfig and change things through commands.
   MatrixConfig config;
+  RcuSnapshot<MatrixConfig> sharedConfig;
+  CommandQueue<MatrixCommand, 8> commands;
   std::unique_ptr<Adafruit_NeoPixel> strip;
   unsigned long lastFrameMs = 0;
   unsigned long sceneStartMs = 0;
@@ -108,10 +141,9 @@ private:
   WeatherService *weatherRef = nullptr;
   OutdoorService *outdoorRef = nullptr;
   MqttService *mqttRef = nullptr;
-  bool mqttSubscribed = false;
-  bool mqttCallbackSet = false;
+  bool statePublished = false;
   WeatherReading indoorSample;
   OutdoorSnapshot outdoorSample;
-  unsigned long outdoorSampleMs = 0;
+  bool outdoorSampleStale = true;
   unsigned long testUntilMs = 0;
 };
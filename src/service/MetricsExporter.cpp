@@ -0,0 +1,194 @@
+#include "MetricsExporter.h"
+
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <esp32/spiram.h>
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+
+#include "WeatherService.h"
+#include "OutdoorService.h"
+#include "MatrixDisplayService.h"
+#include "setup/MqttService.h"
+#include "common/PerfStats.h"
+#include "assets/firmware_version.h"
+
+namespace {
+constexpr const char *OPENMETRICS_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+constexpr const char *TEXT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+}
+
+bool MetricsExporter::begin(WeatherService *weather, OutdoorService *outdoor, MatrixDisplayService *matrix, MqttService *mqtt) {
+  weatherRef = weather;
+  outdoorRef = outdoor;
+  matrixRef = matrix;
+  mqttRef = mqtt;
+  if (!mutex) mutex = xSemaphoreCreateMutex();
+  return mutex != nullptr;
+}
+
+void MetricsExporter::registerRoutes(AsyncWebServer &server) {
+  server.on("/metrics", HTTP_GET, timed("GET /metrics", [this](AsyncWebServerRequest *request) {
+    String body;
+    if (!render(body)) {
+      request->send(503, "text/plain", "metrics unavailable\n");
+      return;
+    }
+    perfStats.addBytes(body.length());
+    const bool openMetrics = request->hasHeader("Accept") &&
+                             request->getHeader("Accept")->value().indexOf("application/openmetrics-text") >= 0;
+    request->send(200, openMetrics ? OPENMETRICS_TYPE : TEXT_TYPE, body);
+  }));
+}
+
+bool MetricsExporter::render(String &out) {
+  if (!mutex || !weatherRef || !outdoorRef) return false;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  if (!text) {
+    text = static_cast<char *>(heap_caps_malloc(CAPACITY, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    if (!text) text = static_cast<char *>(heap_caps_malloc(CAPACITY, MALLOC_CAP_8BIT));
+    if (!text) {
+      xSemaphoreGive(mutex);
+      return false;
+    }
+  }
+  const uint32_t seq = weatherRef->sequence();
+  const uint32_t revision = outdoorRef->revision();
+  if (!built || seq != builtSequence || revision != builtRevision || millis() - builtAt >= MAX_AGE_MS) {
+    builtSequence = seq;
+    builtRevision = revision;
+    build();
+  }
+  out = String();
+  out.reserve(textLen);
+  out.concat(text, textLen);
+  xSemaphoreGive(mutex);
+  return textLen > 0;
+}
+
+void MetricsExporter::build() {
+  textLen = 0;
+  overflow = false;
+  const unsigned long now = millis();
+
+  WeatherReading reading;
+  const bool ok = weatherRef->read(reading);
+  family("weatherstation_indoor_temperature_celsius", "Indoor temperature (SHT31).");
+  if (!isnan(reading.temperatureC)) sample("weatherstation_indoor_temperature_celsius", reading.temperatureC, 2);
+  family("weatherstation_indoor_humidity_percent", "Indoor relative humidity.");
+  if (!isnan(reading.humidity)) sample("weatherstation_indoor_humidity_percent", reading.humidity, 2);
+  family("weatherstation_indoor_dew_point_celsius", "Indoor dew point.");
+  if (!isnan(reading.dewPointC)) sample("weatherstation_indoor_dew_point_celsius", reading.dewPointC, 2);
+  family("weatherstation_indoor_pressure_pascals", "Barometric pressure (BMP580).");
+  if (!isnan(reading.pressurePa)) sample("weatherstation_indoor_pressure_pascals", reading.pressurePa, 1);
+  family("weatherstation_indoor_altitude_meters", "Altitude derived from pressure and the sea-level reference.");
+  if (!isnan(reading.altitudeM)) sample("weatherstation_indoor_altitude_meters", reading.altitudeM, 1);
+  family("weatherstation_sea_level_pressure_pascals", "Sea-level reference pressure used for altitude.");
+  sample("weatherstation_sea_level_pressure_pascals", weatherRef->seaLevelPressure() * 100.0, 0);
+  family("weatherstation_sample_ok", "1 if the latest sample succeeded.");
+  sample("weatherstation_sample_ok", ok ? 1 : 0);
+  family("weatherstation_sample_sequence", "Sequence number of the latest sample.");
+  sample("weatherstation_sample_sequence", reading.sequence);
+  family("weatherstation_sample_age_seconds", "Time since the latest sample was collected.");
+  if (reading.sequence) sample("weatherstation_sample_age_seconds", (now - reading.collectedAtMs) / 1000.0, 3);
+  family("weatherstation_sensor_present", "1 if the sensor was detected at boot.");
+  sample("weatherstation_sensor_present", weatherRef->hasSHT() ? 1 : 0, 0, "sensor=\"sht31\"");
+  sample("weatherstation_sensor_present", weatherRef->hasBMP() ? 1 : 0, 0, "sensor=\"bmp580\"");
+  family("weatherstation_sensor_ok", "1 if the sensor delivered the latest sample.");
+  sample("weatherstation_sensor_ok", reading.shtOk ? 1 : 0, 0, "sensor=\"sht31\"");
+  sample("weatherstation_sensor_ok", reading.bmpOk ? 1 : 0, 0, "sensor=\"bmp580\"");
+  family("weatherstation_barometer_failures", "Consecutive failed barometer conversions.");
+  sample("weatherstation_barometer_failures", weatherRef->barometerFailures());
+
+  const OutdoorSnapshot outdoor = outdoorRef->current();
+  family("weatherstation_outdoor_enabled", "1 if the outdoor cache is enabled.");
+  sample("weatherstation_outdoor_enabled", outdoorRef->currentConfig().enabled ? 1 : 0);
+  family("weatherstation_outdoor_temperature_celsius", "Cached outdoor temperature.");
+  if (!isnan(outdoor.temperatureC)) sample("weatherstation_outdoor_temperature_celsius", outdoor.temperatureC, 2);
+  family("weatherstation_outdoor_humidity_percent", "Cached outdoor relative humidity.");
+  if (!isnan(outdoor.humidity)) sample("weatherstation_outdoor_humidity_percent", outdoor.humidity, 2);
+  family("weatherstation_outdoor_pressure_pascals", "Cached outdoor pressure.");
+  if (!isnan(outdoor.pressureHpa)) sample("weatherstation_outdoor_pressure_pascals", outdoor.pressureHpa * 100.0, 0);
+  family("weatherstation_outdoor_wind_speed_meters_per_second", "Cached outdoor wind speed.");
+  if (!isnan(outdoor.windSpeed)) sample("weatherstation_outdoor_wind_speed_meters_per_second", outdoor.windSpeed, 2);
+  family("weatherstation_outdoor_cache_age_seconds", "Time since the outdoor cache was last updated.");
+  const uint32_t outdoorAge = outdoorRef->ageSeconds();
+  if (outdoorAge != OutdoorService::AGE_UNKNOWN) sample("weatherstation_outdoor_cache_age_seconds", outdoorAge, 0);
+
+  family("weatherstation_uptime_seconds", "Time since boot.");
+  sample("weatherstation_uptime_seconds", now / 1000.0, 3);
+  family("weatherstation_heap_free_bytes", "Free internal heap.");
+  sample("weatherstation_heap_free_bytes", ESP.getFreeHeap());
+  family("weatherstation_heap_min_free_bytes", "Lowest free internal heap since boot.");
+  sample("weatherstation_heap_min_free_bytes", ESP.getMinFreeHeap());
+  family("weatherstation_heap_max_alloc_bytes", "Largest allocatable internal heap block.");
+  sample("weatherstation_heap_max_alloc_bytes", ESP.getMaxAllocHeap());
+  family("weatherstation_heap_size_bytes", "Total internal heap.");
+  sample("weatherstation_heap_size_bytes", ESP.getHeapSize());
+  const bool hasPsram = psramFound() && ESP.getPsramSize() > 0;
+  family("weatherstation_psram_size_bytes", "Total PSRAM, 0 without PSRAM.");
+  sample("weatherstation_psram_size_bytes", hasPsram ? ESP.getPsramSize() : 0);
+  family("weatherstation_psram_free_bytes", "Free PSRAM.");
+  sample("weatherstation_psram_free_bytes", hasPsram ? ESP.getFreePsram() : 0);
+  family("weatherstation_fs_total_bytes", "LittleFS capacity.");
+  sample("weatherstation_fs_total_bytes", LittleFS.totalBytes());
+  family("weatherstation_fs_used_bytes", "LittleFS space in use.");
+  sample("weatherstation_fs_used_bytes", LittleFS.usedBytes());
+
+  const bool wifiUp = WiFi.isConnected();
+  family("weatherstation_wifi_connected", "1 if the station interface is connected.");
+  sample("weatherstation_wifi_connected", wifiUp ? 1 : 0);
+  family("weatherstation_wifi_rssi_dbm", "Station RSSI.");
+  if (wifiUp) sample("weatherstation_wifi_rssi_dbm", WiFi.RSSI());
+  family("weatherstation_mqtt_connected", "1 if connected to the MQTT broker.");
+  sample("weatherstation_mqtt_connected", mqttRef && mqttRef->isConnected() ? 1 : 0);
+
+  if (matrixRef) {
+    const MatrixConfig matrix = matrixRef->currentConfig();
+    family("weatherstation_matrix_enabled", "1 if the LED matrix is enabled.");
+    sample("weatherstation_matrix_enabled", matrix.enabled ? 1 : 0);
+    family("weatherstation_matrix_brightness", "Configured matrix brightness (0-255).");
+    sample("weatherstation_matrix_brightness", matrix.brightness);
+    family("weatherstation_matrix_fps", "Configured matrix frame rate.");
+    sample("weatherstation_matrix_fps", matrix.fps);
+  }
+
+  family("weatherstation_build_info", "Firmware version.");
+  appendf("weatherstation_build_info{version=\"%s\"} 1\n", FW_VERSION);
+  appendf("# EOF\n");
+
+  if (overflow) {
+    Serial.println("Metrics: exposition truncated, raise MetricsExporter::CAPACITY");
+    // Cut back to the last complete line so the body stays parseable.
+    while (textLen && text[textLen - 1] != '\n') --textLen;
+  }
+  builtAt = now;
+  built = true;
+  ++generation;
+}
+
+void MetricsExporter::family(const char *name, const char *help) {
+  appendf("# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+}
+
+void MetricsExporter::sample(const char *name, double value, uint8_t decimals, const char *labels) {
+  if (labels) {
+    appendf("%s{%s} %.*f\n", name, labels, decimals, value);
+  } else {
+    appendf("%s %.*f\n", name, decimals, value);
+  }
+}
+
+void MetricsExporter::appendf(const char *fmt, ...) {
+  if (overflow) return;
+  va_list args;
+  va_start(args, fmt);
+  const int n = vsnprintf(text + textLen, CAPACITY - textLen, fmt, args);
+  va_end(args);
+  if (n < 0 || static_cast<size_t>(n) >= CAPACITY - textLen) {
+    overflow = true;
+    text[textLen] = '\0';
+    return;
+  }
+  textLen += n;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+class WeatherService;
+class OutdoorService;
+class MatrixDisplayService;
+class MqttService;
+
+// Prometheus / OpenMetrics exposition at /metrics. The text is rendered
+// into a fixed buffer and reused until the indoor sample sequence or the
+// outdoor cache revision changes (device gauges such as heap and RSSI are
+// sampled at that point, and at least every MAX_AGE_MS), so any number of
+// scrapers in between only pay for a copy. Only gauges are exposed, which
+// keeps the body valid in both the 0.0.4 text format and OpenMetrics. The
+// buffer is allocated (PSRAM first) on the first scrape.
+class MetricsExporter {
+public:
+  static constexpr size_t CAPACITY = 8192;
+  static constexpr uint32_t MAX_AGE_MS = 10000;
+
+  bool begin(WeatherService *weather, OutdoorService *outdoor, MatrixDisplayService *matrix, MqttService *mqtt);
+  void registerRoutes(AsyncWebServer &server);
+
+  // Copies the current exposition, rebuilding it first if stale.
+  bool render(String &out);
+  uint32_t rebuilds() const { return generation; }
+
+private:
+  void build();
+  void family(const char *name, const char *help);
+  void sample(const char *name, double value, uint8_t decimals = 0, const char *labels = nullptr);
+  void appendf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  WeatherService *weatherRef = nullptr;
+  OutdoorService *outdoorRef = nullptr;
+  MatrixDisplayService *matrixRef = nullptr;
+  MqttService *mqttRef = nullptr;
+  SemaphoreHandle_t mutex = nullptr;
+
+  char *text = nullptr;
+  size_t textLen = 0;
+  bool overflow = false;
+
+  bool built = false;
+  uint32_t builtSequence = 0;
+  uint32_t builtRevision = 0;
+  unsigned long builtAt = 0;
+  uint32_t generation = 0;
+};
@@ -0,0 +1,102 @@
+#include "OpenMeteoProvider.h"
+
+#include <string.h>
+
+namespace {
+constexpr const char *BASE_URL = "http://api.open-meteo.com/v1/forecast";
+
+struct Variable {
+  const char *name;
+  float OutdoorSnapshot::*member;
+};
+
+// Requested for both "current" and "hourly", in this order.
+constexpr Variable VARIABLES[] = {
+  {"temperature_2m", &OutdoorSnapshot::temperatureC},
+  {"relative_humidity_2m", &OutdoorSnapshot::humidity},
+  {"pressure_msl", &OutdoorSnapshot::pressureHpa},
+  {"wind_speed_10m", &OutdoorSnapshot::windSpeed},
+};
+
+float OutdoorSnapshot::*memberFor(const char *name) {
+  for (const Variable &v : VARIABLES) {
+    if (strcmp(v.name, name) == 0) return v.member;
+  }
+  return nullptr;
+}
+}
+
+String OpenMeteoProvider::requestUrl(const OutdoorConfig &cfg, uint16_t hours) const {
+  String vars;
+  for (const Variable &v : VARIABLES) {
+    if (vars.length()) vars += ',';
+    vars += v.name;
+  }
+  char head[96];
+  snprintf(head, sizeof(head), "%s?latitude=%.4f&longitude=%.4f", BASE_URL, cfg.lat, cfg.lon);
+  String url(head);
+  url += "&current=";
+  url += vars;
+  url += "&hourly=";
+  url += vars;
+  url += "&forecast_hours=";
+  url += static_cast<unsigned>(hours + 1);
+  url += "&wind_speed_unit=ms&timeformat=unixtime";
+  return url;
+}
+
+void OpenMeteoProvider::begin(OutdoorForecastBuffer &out) {
+  buffer = &out;
+  err = nullptr;
+  apiError = false;
+  reason[0] = '\0';
+  parser.begin(&OpenMeteoProvider::onEvent, this);
+}
+
+bool OpenMeteoProvider::feed(const uint8_t *data, size_t len) {
+  if (!parser.feed(reinterpret_cast<const char *>(data), len) && !err) err = parser.error();
+  return !err;
+}
+
+bool OpenMeteoProvider::finish() {
+  if (!parser.finish() && !err) err = parser.error();
+  if (!err && apiError) err = reason[0] ? reason : "error response";
+  const OutdoorSnapshot &now = buffer->current;
+  if (!err && isnan(now.temperatureC) && isnan(now.humidity) && isnan(now.pressureHpa)) err = "no current conditions";
+  return !err;
+}
+
+void OpenMeteoProvider::onEvent(void *ctx, const JsonStreamParser &p, JsonStreamParser::Event event) {
+  static_cast<OpenMeteoProvider *>(ctx)->handle(p, event);
+}
+
+void OpenMeteoProvider::handle(const JsonStreamParser &p, JsonStreamParser::Event event) {
+  if (err || event != JsonStreamParser::Event::Value) return;
+  const uint8_t depth = p.depth();
+  const char *section = p.key(0);
+  if (depth == 1 && p.type() == JsonStreamParser::ValueType::Bool && strcmp(section, "error") == 0) {
+    apiError = p.boolean();
+    return;
+  }
+  if (depth == 1 && p.type() == JsonStreamParser::ValueType::String && strcmp(section, "reason") == 0) {
+    strncpy(reason, p.string(), sizeof(reason) - 1);
+    reason[sizeof(reason) - 1] = '\0';
+    return;
+  }
+  if (p.type() != JsonStreamParser::ValueType::Number) return;
+  const float value = static_cast<float>(p.number());
+
+  if (depth == 1) {
+    if (strcmp(section, "elevation") == 0) buffer->current.altitudeM = value;
+  } else if (depth == 2 && strcmp(section, "current") == 0) {
+    float OutdoorSnapshot::*member = memberFor(p.key(1));
+    if (member) buffer->current.*member = value;
+  } else if (depth == 3 && p.isArray(2) && strcmp(section, "hourly") == 0) {
+    // Row 0 is the hour in progress; "current" stands for it.
+    const uint16_t hour = p.index(2);
+    float OutdoorSnapshot::*member = memberFor(p.key(1));
+    if (!member || hour == 0 || hour > MAX_FORECAST_HOURS) return;
+    buffer->hourly[hour - 1].*member = value;
+    if (hour > buffer->hours) buffer->hours = hour;
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "OutdoorProvider.h"
+#include "common/JsonStreamParser.h"
+
+// api.open-meteo.com: free, keyless, and small enough to parse as a stream.
+// The request asks for hourly rows starting at the current hour, metric
+// units and wind in m/s; "current" fills slot 0, "elevation" altitudeM.
+// Errors come back as {"error":true,"reason":"..."}.
+class OpenMeteoProvider : public OutdoorProvider {
+public:
+  const char *name() const override { return "open-meteo"; }
+  String requestUrl(const OutdoorConfig &cfg, uint16_t hours) const override;
+
+  void begin(OutdoorForecastBuffer &out) override;
+  bool feed(const uint8_t *data, size_t len) override;
+  bool finish() override;
+  const char *error() const override { return err; }
+  const char *errorReason() const override { return apiError ? reason : nullptr; }
+
+private:
+  static void onEvent(void *ctx, const JsonStreamParser &p, JsonStreamParser::Event event);
+  void handle(const JsonStreamParser &p, JsonStreamParser::Event event);
+
+  JsonStreamParser parser;
+  OutdoorForecastBuffer *buffer = nullptr;
+  const char *err = nullptr;
+  bool apiError = false;
+  char reason[JsonStreamParser::MAX_TOKEN + 1] = {};
+};
@@ -0,0 +1,218 @@
+#include "OutdoorCacheIngest.h"
+
+#include <string.h>
+
+namespace {
+struct FieldName {
+  const char *name;
+  float OutdoorSnapshot::*member;
+};
+
+constexpr FieldName FIELDS[] = {
+  {"tempC", &OutdoorSnapshot::temperatureC},
+  {"temperatureC", &OutdoorSnapshot::temperatureC},
+  {"humidity", &OutdoorSnapshot::humidity},
+  {"pressureHpa", &OutdoorSnapshot::pressureHpa},
+  {"pressureMmHg", &OutdoorSnapshot::pressureMmHg},
+  {"altitudeM", &OutdoorSnapshot::altitudeM},
+  {"windSpeed", &OutdoorSnapshot::windSpeed},
+};
+constexpr int8_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+// tempC, humidity, pressureHpa, windSpeed
+constexpr int8_t DEFAULT_COLUMNS[] = {0, 2, 3, 6};
+constexpr uint8_t DEFAULT_COLUMN_COUNT = sizeof(DEFAULT_COLUMNS);
+constexpr uint16_t MAX_STEP_HOURS = 24;
+
+int8_t fieldIndex(const char *name) {
+  for (int8_t i = 0; i < FIELD_COUNT; ++i) {
+    if (strcmp(FIELDS[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+// "h12" or "12"; 0 when not an hour.
+uint16_t parseHour(const char *key) {
+  if (*key == 'h') ++key;
+  if (!*key) return 0;
+  uint32_t h = 0;
+  for (; *key; ++key) {
+    if (*key < '0' || *key > '9') return 0;
+    h = h * 10 + (*key - '0');
+    if (h > 0xFFFF) return 0;
+  }
+  return static_cast<uint16_t>(h);
+}
+
+bool isEmpty(const OutdoorSnapshot &s) {
+  for (const FieldName &f : FIELDS) {
+    if (!isnan(s.*f.member)) return false;
+  }
+  return true;
+}
+}
+
+void OutdoorCacheIngest::begin() {
+  parser.begin(&OutdoorCacheIngest::onEvent, this);
+  memset(columns, -1, sizeof(columns));
+}
+
+bool OutdoorCacheIngest::feed(const uint8_t *data, size_t len) {
+  return parser.feed(reinterpret_cast<const char *>(data), len) && !err;
+}
+
+bool OutdoorCacheIngest::finish() {
+  if (!parser.finish() && !err) err = parser.error();
+  if (!err && !sawObject) err = "expected an object";
+  return !err;
+}
+
+void OutdoorCacheIngest::onEvent(void *ctx, const JsonStreamParser &p, JsonStreamParser::Event event) {
+  static_cast<OutdoorCacheIngest *>(ctx)->handle(p, event);
+}
+
+void OutdoorCacheIngest::handle(const JsonStreamParser &p, JsonStreamParser::Event event) {
+  if (err) return;
+  const uint8_t depth = p.depth();
+  if (!sawObject) {
+    if (event == JsonStreamParser::Event::BeginObject && depth == 1) {
+      sawObject = true;
+    } else {
+      err = "expected an object";
+    }
+    return;
+  }
+  if (event != JsonStreamParser::Event::Value) return;
+  const bool isNumber = p.type() == JsonStreamParser::ValueType::Number;
+  const char *section = p.key(0);
+
+  if (depth == 1) {
+    if (isNumber && strcmp(section, "fetchedAtMs") == 0) {
+      fetchedAtMs = static_cast<unsigned long>(p.number());
+      haveFetchedAt = true;
+    }
+  } else if (strcmp(section, "hourly") == 0) {
+    handleHourly(p, depth, p.number(), isNumber);
+  } else if (!isNumber) {
+    return;
+  } else if (depth == 2 && strcmp(section, "current") == 0 && !p.isArray(1)) {
+    set(0, fieldIndex(p.key(1)), p.number());
+  } else if (depth == 3 && strcmp(section, "outlook") == 0 && !p.isArray(1) && !p.isArray(2)) {
+    const uint16_t hour = parseHour(p.key(1));
+    if (hour) set(hour, fieldIndex(p.key(2)), p.number());
+  }
+}
+
+void OutdoorCacheIngest::handleHourly(const JsonStreamParser &p, uint8_t depth, double v, bool isNumber) {
+  if (p.isArray(1)) {
+    // Bare rows: "hourly": [[...], ...]
+    if (depth == 3 && p.isArray(2) && isNumber) setRow(p.index(1), p.index(2), v);
+    return;
+  }
+  const char *member = p.key(1);
+  if (depth == 2 && isNumber) {
+    if (strcmp(member, "start") == 0) {
+      if (v < 1 || v > MAX_FORECAST_HOURS) err = "bad hourly.start";
+      start = static_cast<uint16_t>(v);
+    } else if (strcmp(member, "step") == 0) {
+      if (v < 1 || v > MAX_STEP_HOURS) err = "bad hourly.step";
+      stepHours = static_cast<uint16_t>(v);
+    }
+  } else if (depth == 3 && p.isArray(2) && strcmp(member, "fields") == 0) {
+    const uint16_t column = p.index(2);
+    if (column >= MAX_COLUMNS) return;
+    if (p.type() == JsonStreamParser::ValueType::String) columns[column] = fieldIndex(p.string());
+    if (column + 1 > columnCount) columnCount = column + 1;
+  } else if (depth == 4 && isNumber && p.isArray(2) && p.isArray(3) && strcmp(member, "data") == 0) {
+    setRow(p.index(2), p.index(3), v);
+  }
+}
+
+void OutdoorCacheIngest::setRow(uint16_t row, uint16_t column, float value) {
+  int8_t field = -1;
+  if (columnCount) {
+    if (column < columnCount) field = columns[column];
+  } else if (column < DEFAULT_COLUMN_COUNT) {
+    field = DEFAULT_COLUMNS[column];
+  }
+  const uint32_t hour = start + static_cast<uint32_t>(row) * stepHours;
+  if (hour > MAX_FORECAST_HOURS) {
+    if (field >= 0) ++skipped;
+    return;
+  }
+  set(static_cast<uint16_t>(hour), field, value);
+}
+
+void OutdoorCacheIngest::set(uint16_t hour, int8_t field, float value) {
+  if (field < 0) return;
+  if (hour > MAX_FORECAST_HOURS) {
+    ++skipped;
+    return;
+  }
+  OutdoorSnapshot &slot = hour ? hourly[hour - 1] : current;
+  if (hour && isEmpty(slot)) ++filled;
+  slot.*FIELDS[field].member = value;
+}
+
+void OutdoorCacheIngest::load(JsonObjectConst obj) {
+  if (obj["fetchedAtMs"].is<double>()) {
+    fetchedAtMs = static_cast<unsigned long>(obj["fetchedAtMs"].as<double>());
+    haveFetchedAt = true;
+  }
+  for (JsonPairConst kv : obj["current"].as<JsonObjectConst>()) {
+    if (kv.value().is<double>()) set(0, fieldIndex(kv.key().c_str()), kv.value().as<float>());
+  }
+  for (JsonPairConst slot : obj["outlook"].as<JsonObjectConst>()) {
+    const uint16_t hour = parseHour(slot.key().c_str());
+    if (!hour) continue;
+    for (JsonPairConst kv : slot.value().as<JsonObjectConst>()) {
+      if (kv.value().is<double>()) set(hour, fieldIndex(kv.key().c_str()), kv.value().as<float>());
+    }
+  }
+
+  JsonVariantConst hourlyVar = obj["hourly"];
+  JsonArrayConst rows = hourlyVar.as<JsonArrayConst>();
+  if (hourlyVar.is<JsonObjectConst>()) {
+    uint8_t column = 0;
+    for (JsonVariantConst name : hourlyVar["fields"].as<JsonArrayConst>()) {
+      if (column >= MAX_COLUMNS) break;
+      columns[column++] = name.is<const char *>() ? fieldIndex(name.as<const char *>()) : -1;
+    }
+    columnCount = column;
+    if (hourlyVar["start"].is<double>()) {
+      const double v = hourlyVar["start"].as<double>();
+      if (v < 1 || v > MAX_FORECAST_HOURS) err = "bad hourly.start";
+      start = static_cast<uint16_t>(v);
+    }
+    if (hourlyVar["step"].is<double>()) {
+      const double v = hourlyVar["step"].as<double>();
+      if (v < 1 || v > MAX_STEP_HOURS) err = "bad hourly.step";
+      stepHours = static_cast<uint16_t>(v);
+    }
+    rows = hourlyVar["data"].as<JsonArrayConst>();
+  }
+  if (err) return;
+  uint16_t row = 0;
+  for (JsonVariantConst r : rows) {
+    uint16_t column = 0;
+    for (JsonVariantConst v : r.as<JsonArrayConst>()) {
+      if (v.is<double>()) setRow(row, column, v.as<float>());
+      if (++column == MAX_COLUMNS) break;
+    }
+    ++row;
+  }
+}
+
+void OutdoorCacheIngest::derivePressures() {
+  derivePressureMmHg(current);
+  for (OutdoorSnapshot &s : hourly) derivePressureMmHg(s);
+}
+
+OutdoorChange OutdoorCacheIngest::commit(OutdoorService &outdoor) {
+  derivePressures();
+  return outdoor.updateCache(current, hourly, MAX_FORECAST_HOURS, haveFetchedAt ? fetchedAtMs : millis());
+}
+
+OutdoorChange OutdoorCacheIngest::merge(OutdoorService &outdoor) {
+  derivePressures();
+  return outdoor.mergeCache(current, hourly, MAX_FORECAST_HOURS, haveFetchedAt ? fetchedAtMs : millis());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "OutdoorService.h"
+#include "common/JsonStreamParser.h"
+
+// Body of POST and PATCH /api/outdoor/cache and of the <base>/outdoor/patch
+// MQTT topic. The JSON form is parsed chunk by chunk from the body callback
+// into a fixed hourly table (MAX_FORECAST_HOURS slots), so memory does not
+// depend on the body size; the MessagePack form arrives as a document and
+// goes through load(). commit() replaces the cache with the result and
+// merge() writes only the fields and hours it names, each in one step, so
+// a rejected upload leaves the cache as it was. "fetchedAtMs" dates the
+// upload for merge()'s per-field age check.
+//
+// Accepted members (unknown ones are skipped):
+//   "fetchedAtMs": n
+//   "current": {"tempC"|"temperatureC", "humidity", "pressureHpa",
+//               "pressureMmHg", "altitudeM", "windSpeed"}
+//   "outlook": {"h<hours>"|"<hours>": {same fields}, ...}
+//   "hourly":  {"fields": [names], "start": h, "step": n, "data": [[row], ...]}
+//              or just [[row], ...]; rows are hour start, start + step, ...
+//              and the columns default to tempC, humidity, pressureHpa,
+//              windSpeed. "fields", "start" and "step" must precede "data".
+//
+// Trivially destructible on purpose: it lives in the request's raw
+// _tempObject storage, which the server releases with free().
+class OutdoorCacheIngest {
+public:
+  static constexpr uint8_t MAX_COLUMNS = 12;
+
+  void begin();
+  bool feed(const uint8_t *data, size_t len);
+  // Ends the JSON stream; false (see error()) if it was not a valid object.
+  bool finish();
+  void load(JsonObjectConst obj);
+  OutdoorChange commit(OutdoorService &outdoor);
+  OutdoorChange merge(OutdoorService &outdoor);
+
+  const char *error() const { return err; }
+  uint16_t hours() const { return filled; }
+  uint16_t dropped() const { return skipped; }
+
+private:
+  static void onEvent(void *ctx, const JsonStreamParser &p, JsonStreamParser::Event event);
+  void handle(const JsonStreamParser &p, JsonStreamParser::Event event);
+  void handleHourly(const JsonStreamParser &p, uint8_t depth, double v, bool isNumber);
+  // hour 0 is "current".
+  void set(uint16_t hour, int8_t field, float value);
+  void setRow(uint16_t row, uint16_t column, float value);
+  void derivePressures();
+
+  JsonStreamParser parser;
+  OutdoorSnapshot current;
+  OutdoorSnapshot hourly[MAX_FORECAST_HOURS];
+  int8_t columns[MAX_COLUMNS];
+  uint8_t columnCount = 0;
+  uint16_t start = 1;
+  uint16_t stepHours = 1;
+  unsigned long fetchedAtMs = 0;
+  bool haveFetchedAt = false;
+  bool sawObject = false;
+  uint16_t filled = 0;
+  uint16_t skipped = 0;
+  const char *err = nullptr;
+};
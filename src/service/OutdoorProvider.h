@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "HourlyForecast.h"
+
+struct OutdoorConfig {
+  bool enabled = true;
+  double lat = 0.0;
+  double lon = 0.0;
+  String city;
+  String country;
+  // Period of the on-device fetch; 0 leaves updates to pushes.
+  uint16_t fetchIntervalMin = 30;
+};
+
+// One fetch's worth of outdoor data as a provider parses it. hourly[i] is
+// the forecast i + 1 hours ahead; untouched fields stay NaN.
+struct OutdoorForecastBuffer {
+  OutdoorSnapshot current;
+  OutdoorSnapshot hourly[MAX_FORECAST_HOURS];
+  uint16_t hours = 0;
+};
+
+// A forecast source for OutdoorService's fetch task: builds the request and
+// parses the response body as it streams in, chunk by chunk, into a fixed
+// buffer. Only ever used from the fetch task, one fetch at a time.
+class OutdoorProvider {
+public:
+  virtual ~OutdoorProvider() {}
+
+  virtual const char *name() const = 0;
+  // GET request for cfg's location, covering hours hours ahead.
+  virtual String requestUrl(const OutdoorConfig &cfg, uint16_t hours) const = 0;
+
+  // Starts a response that fills out.
+  virtual void begin(OutdoorForecastBuffer &out) = 0;
+  // False (see error()) once the body cannot be used.
+  virtual bool feed(const uint8_t *data, size_t len) = 0;
+  virtual bool finish() = 0;
+  virtual const char *error() const = 0;
+  // Message the service put in an error response, once finish() has run
+  // on one; nullptr if it gave none.
+  virtual const char *errorReason() const { return nullptr; }
+};
@@ -1,76 +1,514 @@
 #include "OutdoorService.h"
 
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <time.h>
+
+#include "WeatherHistory.h"
+#include "common/Crc32.h"
 #include "setup/ManagedWiFi.h"
 
 namespace {
-constexpr const char *NS = "outdoor";
+constexpr const char *CACHE_PATH = "/outdoor.bin";
+constexpr const char *CACHE_TMP_PATH = "/outdoor.tmp";
+constexpr uint32_t CACHE_MAGIC = 0x4F585857; // "WXXO"
+constexpr uint16_t CACHE_VERSION = 1;
+// Pushes closer together than this share one flash write.
+constexpr unsigned long CACHE_PERSIST_MIN_MS = 5UL * 60UL * 1000UL;
+// How often loop() looks for forecast hours that have gone by.
+constexpr unsigned long FORECAST_AGE_CHECK_MS = 60UL * 1000UL;
+
+constexpr uint32_t FETCH_TASK_STACK = 8192;
+constexpr UBaseType_t FETCH_TASK_PRIORITY = 1;
+constexpr uint16_t FETCH_CONNECT_TIMEOUT_MS = 5000;
+constexpr uint16_t FETCH_READ_TIMEOUT_MS = 5000;
+
+// millis() and vTaskDelay() for streamBody().
+struct TaskClock {
+  unsigned long now() const { return millis(); }
+  void wait(uint32_t ms) const { vTaskDelay(pdMS_TO_TICKS(ms)); }
+};
+
+// Followed by usedSlots() floats for every field in fieldMask, in
+// ForecastField order. Slot 0 is the current conditions.
+struct CacheHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t fieldMask;
+  uint8_t reserved;
+  uint16_t slots;
+  uint16_t shiftedHours; // slot 0 is fetchedAt + shiftedHours hours
+  uint32_t fetchedAt;    // epoch seconds, 0 if the clock was not set
+  uint32_t crc;       // over the fields above and the columns
+};
+
+// Epoch seconds of a millis() timestamp; 0 while the clock is unset.
+uint32_t epochFor(unsigned long atMs) {
+  const time_t now = time(nullptr);
+  if (!WeatherHistory::clockValid(now)) return 0;
+  const unsigned long nowMs = millis();
+  const unsigned long agoS = atMs <= nowMs ? (nowMs - atMs) / 1000 : 0;
+  return static_cast<uint32_t>(now) - agoS;
 }
 
-void OutdoorService::begin(ManagedWiFi *wifi) {
+constexpr uint8_t ALL_FIELDS = (1u << FORECAST_FIELD_COUNT) - 1;
+
+uint8_t suppliedFields(const OutdoorSnapshot &s) {
+  uint8_t mask = 0;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    if (!isnan(s.*FORECAST_FIELD_MEMBERS[f])) mask |= 1u << f;
+  }
+  return mask;
+}
+
+// Those of fields that differ; bitwise, so NaN equals NaN.
+uint8_t snapshotChanges(const OutdoorSnapshot &prev, const OutdoorSnapshot &next, uint8_t fields) {
+  uint8_t mask = 0;
+  for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+    const uint8_t bit = 1u << f;
+    if ((fields & bit) && memcmp(&(prev.*FORECAST_FIELD_MEMBERS[f]), &(next.*FORECAST_FIELD_MEMBERS[f]), sizeof(float))) mask |= bit;
+  }
+  return mask;
+}
+
+// True when atMs is before storedMs; 0 means never stored.
+bool isOlder(unsigned long atMs, unsigned long storedMs) {
+  return storedMs && static_cast<long>(atMs - storedMs) < 0;
+}
+
+void noteChange(OutdoorData &d, const OutdoorChange &change) {
+  ++d.revision;
+  d.lastChange = change;
+  d.recentChanges[d.revision % OutdoorData::CHANGE_HISTORY] = change;
+}
+constexpr ConfigField<OutdoorConfig> OUTDOOR_FIELDS[] = {
+  CONFIG_FIELD(OutdoorConfig, enabled, "enabled", nullptr, "enabled", 0, 1),
+  CONFIG_FIELD(OutdoorConfig, lat, "lat", nullptr, "lat", -90, 90),
+  CONFIG_FIELD(OutdoorConfig, lon, "lon", nullptr, "lon", -180, 180),
+  CONFIG_FIELD(OutdoorConfig, city, "city", nullptr, "city", 0, 64),
+  CONFIG_FIELD(OutdoorConfig, country, "country", nullptr, "country", 0, 64),
+  CONFIG_FIELD(OutdoorConfig, fetchIntervalMin, "fetchIntervalMin", nullptr, "fetchInt", 0, 1440),
+};
+}
+
+const ConfigSchema<OutdoorConfig> outdoorConfigSchema(OUTDOOR_FIELDS);
+
+void OutdoorService::begin(ManagedWiFi *wifi, OutdoorProvider *source) {
   wifiRef = wifi;
+  provider = source;
   loadConfig();
+  restoreCache();
+  if (provider && !fetchHandle) {
+    if (xTaskCreate(fetchTask, "wx-fetch", FETCH_TASK_STACK, this, FETCH_TASK_PRIORITY, &fetchHandle) != pdPASS) {
+      fetchHandle = nullptr;
+      Serial.println("OutdoorService: fetch task start failed; relying on pushes");
+    }
+  }
 }
 
 void OutdoorService::loop() {
-  // Auto-fetch disabled: rely on UI/host to push cache to avoid blocking.
+  commands.drain([this](OutdoorCommand &cmd) { applyCommand(cmd); });
+  store.loop();
+
+  // A push that arrived before SNTP gets its wall-clock time once known.
+  uint32_t backfill = 0;
+  {
+    DataReader d = data();
+    if (d->fetchedAtMs && !d->fetchedAt) backfill = epochFor(d->fetchedAtMs);
+  }
+  if (backfill) {
+    cache.update([backfill](OutdoorData &d) {
+      if (d.fetchedAt) return;
+      d.fetchedAt = backfill;
+      noteChange(d, OutdoorChange());
+    });
+    cacheDirty = true;
+  }
+  if (!lastAgeCheckMs || millis() - lastAgeCheckMs >= FORECAST_AGE_CHECK_MS) {
+    lastAgeCheckMs = millis();
+    ageForecast();
+  }
+  if (cacheDirty && (!lastPersistMs || millis() - lastPersistMs >= CACHE_PERSIST_MIN_MS)) persistCache();
 }
 
-void OutdoorService::loadConfig() {
-  prefs.begin(NS, true);
-  config.enabled = prefs.getBool("enabled", true);
-  config.lat = prefs.getDouble("lat", 0.0);
-  config.lon = prefs.getDouble("lon", 0.0);
-  config.city = prefs.getString("city", "");
-  config.country = prefs.getString("country", "");
-  prefs.end();
-}
-
-bool OutdoorService::saveConfig(const OutdoorConfig &next) {
-  prefs.begin(NS, false);
-  prefs.putBool("enabled", next.enabled);
-  prefs.putDouble("lat", next.lat);
-  prefs.putDouble("lon", next.lon);
-  prefs.putString("city", next.city);
-  prefs.putString("country", next.country);
-  prefs.end();
-  config = next;
-  lastFetch = 0;
-  lastAttempt = 0;
-  lastStatus = 0;
-  lastErr = "";
-  clearForecast();
-  currentSnapshot = OutdoorSnapshot{};
+void OutdoorService::ageForecast() {
+  const time_t now = time(nullptr);
+  if (!WeatherHistory::clockValid(now)) return;
+  auto hoursDue = [now](const OutdoorData &d) -> uint32_t {
+    if (!d.fetchedAt || static_cast<uint32_t>(now) <= d.fetchedAt || !d.forecast.fieldMask()) return 0;
+    uint32_t passed = (static_cast<uint32_t>(now) - d.fetchedAt) / 3600;
+    if (passed > UINT16_MAX) passed = UINT16_MAX;
+    return passed > d.shiftedHours ? passed - d.shiftedHours : 0;
+  };
+  if (!hoursDue(*data())) return;
+  uint32_t dropped = 0;
+  cache.update([&](OutdoorData &d) {
+    dropped = hoursDue(d);
+    if (!dropped) return;
+    const uint16_t n = dropped < HourlyForecast::SLOTS ? dropped : HourlyForecast::SLOTS;
+    OutdoorChange change;
+    change.forecast = d.forecast.dropLeading(n);
+    // The forecast for this hour stands in for the old current conditions.
+    const OutdoorSnapshot nowSlot = d.forecast.at(static_cast<uint16_t>(0));
+    const uint8_t fields = suppliedFields(nowSlot);
+    change.current = snapshotChanges(d.current, nowSlot, fields);
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      if (fields & (1u << f)) d.current.*FORECAST_FIELD_MEMBERS[f] = nowSlot.*FORECAST_FIELD_MEMBERS[f];
+    }
+    d.shiftedHours = static_cast<uint16_t>(d.shiftedHours + dropped);
+    if (change.any()) noteChange(d, change);
+  });
+  // No flash write needed: the stored record carries its own shiftedHours.
+  if (dropped) Serial.printf("OutdoorService: forecast aged by %u h\n", static_cast<unsigned>(dropped));
+}
+
+void OutdoorService::flushCache() {
+  if (cacheDirty) persistCache();
+}
+
+uint32_t OutdoorService::ageSeconds(const OutdoorData &d) {
+  const time_t now = time(nullptr);
+  if (d.fetchedAt && WeatherHistory::clockValid(now)) {
+    return static_cast<uint32_t>(now) > d.fetchedAt ? static_cast<uint32_t>(now) - d.fetchedAt : 0;
+  }
+  if (d.fetchedAtMs) return (millis() - d.fetchedAtMs) / 1000;
+  return AGE_UNKNOWN;
+}
+
+bool OutdoorService::hasConfig() const {
+  RcuSnapshot<OutdoorConfig>::Reader c = config.read();
+  return c->enabled && !isnan(c->lat) && !isnan(c->lon) && c->lat != 0.0 && c->lon != 0.0;
+}
+
+void OutdoorService::restoreCache() {
+  File f = LittleFS.open(CACHE_PATH, "r");
+  if (!f) return;
+  CacheHeader h;
+  bool ok = f.read(reinterpret_cast<uint8_t *>(&h), sizeof(h)) == sizeof(h) && h.magic == CACHE_MAGIC &&
+            h.version == CACHE_VERSION && h.slots && h.slots <= HourlyForecast::SLOTS &&
+            !(h.fieldMask >> FORECAST_FIELD_COUNT);
+  // Read and checked in full before anything is published.
+  std::unique_ptr<float[]> columns;
+  if (ok) {
+    columns.reset(new (std::nothrow) float[FORECAST_FIELD_COUNT * h.slots]);
+    ok = static_cast<bool>(columns);
+  }
+  uint32_t crc = crc32Update(0, reinterpret_cast<const uint8_t *>(&h), offsetof(CacheHeader, crc));
+  const size_t columnBytes = h.slots * sizeof(float);
+  for (size_t field = 0; ok && field < FORECAST_FIELD_COUNT; ++field) {
+    if (!(h.fieldMask & (1u << field))) continue;
+    uint8_t *column = reinterpret_cast<uint8_t *>(columns.get() + field * h.slots);
+    ok = f.read(column, columnBytes) == columnBytes;
+    if (ok) crc = crc32Update(crc, column, columnBytes);
+  }
+  f.close();
+  if (!ok || crc != h.crc) {
+    Serial.println("OutdoorService: cached outdoor data unreadable, ignored");
+    return;
+  }
+  uint16_t horizon = 0;
+  cache.update([&](OutdoorData &d) {
+    d.forecast.clear();
+    for (size_t field = 0; field < FORECAST_FIELD_COUNT; ++field) {
+      if (h.fieldMask & (1u << field)) {
+        d.forecast.setColumn(static_cast<ForecastField>(field), columns.get() + field * h.slots, h.slots);
+      }
+    }
+    d.current = d.forecast.at(static_cast<uint16_t>(0));
+    OutdoorChange restored;
+    restored.current = suppliedFields(d.current);
+    restored.forecast = h.fieldMask;
+    noteChange(d, restored);
+    d.fetchedAtMs = 0;
+    d.fetchedAt = h.fetchedAt;
+    d.shiftedHours = h.shiftedHours;
+    d.lastStatus = 200;
+    d.lastError = "";
+    horizon = d.forecast.horizon();
+  });
+  Serial.printf("OutdoorService: restored outdoor data (%u h ahead) from flash\n", static_cast<unsigned>(horizon));
+  // Hours that went by while the device was off; with the clock unset
+  // this happens in loop() once SNTP has run.
+  ageForecast();
+}
+
+bool OutdoorService::persistCache() {
+  cacheDirty = false;
+  lastPersistMs = millis();
+
+  CacheHeader h = {};
+  h.magic = CACHE_MAGIC;
+  h.version = CACHE_VERSION;
+  // Columns are copied out of one pinned version so the CRC matches the
+  // bytes written; a push landing meanwhile marks the cache dirty again.
+  std::unique_ptr<uint8_t[]> payload;
+  size_t payloadBytes = 0;
+  {
+    DataReader d = data();
+    h.fieldMask = d->forecast.fieldMask();
+    h.slots = d->forecast.usedSlots();
+    h.fetchedAt = d->fetchedAt;
+    h.shiftedHours = d->shiftedHours;
+    for (size_t field = 0; field < FORECAST_FIELD_COUNT; ++field) {
+      if (h.fieldMask & (1u << field)) payloadBytes += h.slots * sizeof(float);
+    }
+    if (payloadBytes) {
+      payload.reset(new (std::nothrow) uint8_t[payloadBytes]);
+      if (!payload) {
+        cacheDirty = true;
+        return false;
+      }
+      size_t at = 0;
+      for (size_t field = 0; field < FORECAST_FIELD_COUNT; ++field) {
+        if (!(h.fieldMask & (1u << field))) continue;
+        memcpy(payload.get() + at, d->forecast.column(static_cast<ForecastField>(field)), h.slots * sizeof(float));
+        at += h.slots * sizeof(float);
+      }
+    }
+  }
+  if (!h.fieldMask) {
+    if (LittleFS.exists(CACHE_PATH)) LittleFS.remove(CACHE_PATH);
+    return true;
+  }
+  uint32_t crc = crc32Update(0, reinterpret_cast<const uint8_t *>(&h), offsetof(CacheHeader, crc));
+  h.crc = crc32Update(crc, payload.get(), payloadBytes);
+
+  File f = LittleFS.open(CACHE_TMP_PATH, "w");
+  bool ok = static_cast<bool>(f);
+  if (ok) {
+    ok = f.write(reinterpret_cast<const uint8_t *>(&h), sizeof(h)) == sizeof(h) &&
+         f.write(payload.get(), payloadBytes) == payloadBytes;
+    f.close();
+  }
+  // rename() replaces the old record in one step, so a reset mid-write
+  // leaves the previous one intact.
+  if (!ok || !LittleFS.rename(CACHE_TMP_PATH, CACHE_PATH)) {
+    Serial.println("OutdoorService: writing outdoor cache failed");
+    LittleFS.remove(CACHE_TMP_PATH);
+    cacheDirty = true;
+    return false;
+  }
   return true;
 }
 
-OutdoorSnapshot OutdoorService::forecastFor(uint16_t hours) const {
-  auto it = outlook.find(hours);
-  if (it == outlook.end()) return OutdoorSnapshot{};
-  return it->second;
+void OutdoorService::loadConfig() {
+  OutdoorConfig loaded;
+  store.load(outdoorConfigSchema, loaded);
+  config.publish(loaded);
 }
 
-void OutdoorService::clearForecast() {
-  outlook.clear();
+bool OutdoorService::saveConfig(const OutdoorConfig &next, uint32_t *revision) {
+  OutdoorCommand cmd;
+  cmd.kind = OutdoorCommand::Kind::SetConfig;
+  cmd.config = next;
+  cmd.configRevision = configSaves.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (revision) *revision = cmd.configRevision;
+  return commands.post(std::move(cmd));
+}
+
+void OutdoorService::applyCommand(OutdoorCommand &cmd) {
+  if (cmd.kind == OutdoorCommand::Kind::SetConfig) applyConfig(cmd.config, cmd.configRevision);
+}
+
+void OutdoorService::applyConfig(const OutdoorConfig &next, uint32_t revision) {
+  config.publish(next);
+  store.stage(outdoorConfigSchema, next);
+  // Data for the old location is dropped; fields are reset in place to
+  // avoid a forecast-sized temporary on the caller's stack.
+  cache.update([revision](OutdoorData &d) {
+    // Two posters may queue in the other order than they numbered; keep
+    // the newest so a poll for either one completes.
+    if (static_cast<int32_t>(revision - d.configRevision) > 0) d.configRevision = revision;
+    OutdoorChange dropped;
+    dropped.current = suppliedFields(d.current);
+    dropped.forecast = d.forecast.fieldMask();
+    noteChange(d, dropped);
+    d.current = OutdoorSnapshot{};
+    d.forecast.clear();
+    d.fetchedAtMs = 0;
+    d.fetchedAt = 0;
+    d.shiftedHours = 0;
+    d.lastAttemptMs = 0;
+    d.lastStatus = 0;
+    d.lastError = "";
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      d.currentAtMs[f] = 0;
+      d.forecastAtMs[f] = 0;
+    }
+  });
+  cacheDirty = true;
+  requestFetch();
 }
 
 bool OutdoorService::ensureFresh(bool force) {
-  (void)force;
-  return hasData();
+  const bool have = hasData();
+  if (force || !have) requestFetch();
+  return have;
+}
+
+void OutdoorService::requestFetch() {
+  if (fetchHandle) xTaskNotifyGive(fetchHandle);
+}
+
+void OutdoorService::fetchTask(void *arg) {
+  auto *self = static_cast<OutdoorService *>(arg);
+  uint32_t sleepMs = 0;
+  for (;;) {
+    const bool requested = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs)) > 0;
+    sleepMs = self->runFetchCycle(requested);
+  }
+}
+
+uint32_t OutdoorService::runFetchCycle(bool requested) {
+  if (requested) schedule.request();
+  if (!hasConfig() || !wifiRef || !wifiRef->isConnected()) return FetchSchedule::IDLE_CHECK_MS;
+
+  const unsigned long intervalMs = config.read()->fetchIntervalMin * 60000UL;
+  uint32_t sleepMs = 0;
+  if (!schedule.due(millis(), intervalMs, lastAttemptMs(), ageSeconds(), sleepMs)) return sleepMs;
+  const bool ok = fetch();
+  return schedule.finished(millis(), ok, intervalMs);
 }
 
 bool OutdoorService::fetch() {
-  lastAttempt = millis();
-  lastStatus = -99;
-  lastErr = "fetch_disabled";
-  return false;
+  const uint32_t configVersion = config.version();
+  const OutdoorConfig cfg = config.get();
+  std::unique_ptr<OutdoorForecastBuffer> buffer(new (std::nothrow) OutdoorForecastBuffer());
+  if (!buffer) {
+    recordFetchFailure(HTTPC_ERROR_TOO_LESS_RAM, "out of memory");
+    return false;
+  }
+
+  HTTPClient http;
+  http.setConnectTimeout(FETCH_CONNECT_TIMEOUT_MS);
+  http.setTimeout(FETCH_READ_TIMEOUT_MS);
+  // HTTP/1.0 keeps chunked framing out of the body stream.
+  http.useHTTP10(true);
+  if (!http.begin(provider->requestUrl(cfg, MAX_FORECAST_HOURS))) {
+    recordFetchFailure(HTTPC_ERROR_CONNECTION_REFUSED, "bad url");
+    return false;
+  }
+  const int code = http.GET();
+  if (code < 0) {
+    recordFetchFailure(code, HTTPClient::errorToString(code));
+    http.end();
+    return false;
+  }
+
+  // Parsed as it arrives; nothing but the buffer depends on the body size.
+  // Error responses go through the provider too, for the reason they give.
+  provider->begin(*buffer);
+  TaskClock clock;
+  const BodyEnd end = streamBody(*http.getStreamPtr(), http.getSize(), *provider, clock);
+  const bool complete = end == BodyEnd::Complete;
+  http.end();
+  if (code != HTTP_CODE_OK) {
+    String message = String("HTTP ") + code;
+    if (complete) {
+      provider->finish();
+      if (provider->errorReason()) message += String(": ") + provider->errorReason();
+    }
+    recordFetchFailure(code, message);
+    return false;
+  }
+  if (end == BodyEnd::ConnectionLost) {
+    recordFetchFailure(HTTPC_ERROR_CONNECTION_LOST, "connection lost");
+    return false;
+  }
+  if (end == BodyEnd::Timeout) {
+    recordFetchFailure(HTTPC_ERROR_READ_TIMEOUT, "read timeout");
+    return false;
+  }
+  if (!provider->finish()) {
+    recordFetchFailure(code, String("bad response: ") + provider->error());
+    return false;
+  }
+
+  // A location change while this was in flight makes it moot; the change
+  // has already asked for a new fetch.
+  if (config.version() != configVersion) return true;
+  derivePressureMmHg(buffer->current);
+  for (uint16_t h = 0; h < buffer->hours; ++h) derivePressureMmHg(buffer->hourly[h]);
+  updateCache(buffer->current, buffer->hourly, buffer->hours, millis());
+  Serial.printf("OutdoorService: fetched %u h ahead from %s\n", static_cast<unsigned>(buffer->hours), provider->name());
+  return true;
+}
+
+void OutdoorService::recordFetchFailure(int status, const String &error) {
+  const unsigned long at = millis();
+  cache.update([&](OutdoorData &d) {
+    // A retry failing the same way is not news.
+    if (d.lastStatus != status || d.lastError != error) noteChange(d, OutdoorChange());
+    d.lastAttemptMs = at;
+    d.lastStatus = status;
+    d.lastError = error;
+  });
+  Serial.printf("OutdoorService: fetch from %s failed (%d, %s)\n", provider->name(), status, error.c_str());
 }
 
-void OutdoorService::updateCache(const OutdoorSnapshot &current, const std::map<uint16_t, OutdoorSnapshot> &future, unsigned long fetchedAtMs) {
-  currentSnapshot = current;
-  outlook = future;
-  lastFetch = fetchedAtMs;
-  lastAttempt = fetchedAtMs;
-  lastStatus = 200;
-  lastErr = "";
+OutdoorChange OutdoorService::updateCache(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours, unsigned long fetchedAtMs) {
+  const uint32_t fetchedAt = epochFor(fetchedAtMs);
+  OutdoorChange change;
+  cache.update([&](OutdoorData &d) {
+    const bool statusMoved = d.lastStatus != 200 || d.lastError.length();
+    change.current = snapshotChanges(d.current, current, ALL_FIELDS);
+    change.forecast = d.forecast.assign(current, hourly, hours);
+    d.current = current;
+    d.fetchedAtMs = fetchedAtMs;
+    d.fetchedAt = fetchedAt;
+    d.shiftedHours = 0;
+    d.lastAttemptMs = fetchedAtMs;
+    d.lastStatus = 200;
+    d.lastError = "";
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      d.currentAtMs[f] = fetchedAtMs;
+      d.forecastAtMs[f] = fetchedAtMs;
+    }
+    if (change.any() || statusMoved) noteChange(d, change);
+  });
+  cacheDirty = true;
+  return change;
 }
 
+OutdoorChange OutdoorService::mergeCache(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours, unsigned long atMs) {
+  if (hours > MAX_FORECAST_HOURS) hours = MAX_FORECAST_HOURS;
+  uint8_t currentFields = suppliedFields(current);
+  uint8_t hourlyFields = 0;
+  for (size_t h = 0; h < hours && hourlyFields != ALL_FIELDS; ++h) hourlyFields |= suppliedFields(hourly[h]);
+  OutdoorChange change;
+  if (!currentFields && !hourlyFields) return change;
+
+  const uint32_t at = epochFor(atMs);
+  bool accepted = false;
+  cache.update([&](OutdoorData &d) {
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      const uint8_t bit = 1u << f;
+      if (isOlder(atMs, d.currentAtMs[f])) currentFields &= ~bit;
+      if (isOlder(atMs, d.forecastAtMs[f])) hourlyFields &= ~bit;
+    }
+    if (!currentFields && !hourlyFields) return;
+    accepted = true;
+    change.current = snapshotChanges(d.current, current, currentFields);
+    change.forecast = d.forecast.merge(current, hourly, hours, currentFields, hourlyFields);
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      const uint8_t bit = 1u << f;
+      if (currentFields & bit) {
+        d.current.*FORECAST_FIELD_MEMBERS[f] = current.*FORECAST_FIELD_MEMBERS[f];
+        d.currentAtMs[f] = atMs;
+      }
+      if (hourlyFields & bit) d.forecastAtMs[f] = atMs;
+    }
+    // The age reported for the cache is that of its newest update.
+    if (!d.fetchedAtMs || !isOlder(atMs, d.fetchedAtMs)) {
+      d.fetchedAtMs = atMs;
+      d.fetchedAt = at;
+      d.shiftedHours = 0;
+    }
+    if (change.any()) noteChange(d, change);
+  });
+  if (accepted) cacheDirty = true;
+  return change;
+}
@@ -1,67 +1,185 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Preferences.h>
-#include <map>
+#include <atomic>
 #include <vector>
 
+#include "FetchCycle.h"
+#include "HourlyForecast.h"
+#include "OutdoorProvider.h"
+#include "common/CommandQueue.h"
+#include "common/ConfigSchema.h"
+#include "common/ConfigStore.h"
+#include "common/RcuSnapshot.h"
+
 class ManagedWiFi;
 
-struct OutdoorConfig {
-  bool enabled = true;
-  double lat = 0.0;
-  double lon = 0.0;
-  String city;
-  String country;
+// Keys and ranges for the HTTP API and NVS.
+extern const ConfigSchema<OutdoorConfig> outdoorConfigSchema;
+
+// Fields an update changed in each section, one bit per ForecastField.
+// forecast covers the whole column, slot 0 and interpolated hours included.
+struct OutdoorChange {
+  uint8_t current = 0;
+  uint8_t forecast = 0;
+  bool any() const { return current || forecast; }
+  OutdoorChange &operator|=(const OutdoorChange &other) {
+    current |= other.current;
+    forecast |= other.forecast;
+    return *this;
+  }
 };
 
-struct OutdoorSnapshot {
-  float temperatureC = NAN;
-  float humidity = NAN;
-  float pressureHpa = NAN;
-  float pressureMmHg = NAN;
-  float altitudeM = NAN;
-  float windSpeed = NAN;
+// Everything a fetch or push replaces together. Readers pin one version
+// through OutdoorService::data(), so the current conditions, the forecast
+// and the fetch bookkeeping they see always belong to the same update.
+struct OutdoorData {
+  OutdoorSnapshot current;
+  HourlyForecast forecast;
+  unsigned long fetchedAtMs = 0;
+  // Wall-clock time of the data, epoch seconds; 0 until known.
+  uint32_t fetchedAt = 0;
+  // Forecast hours dropped since fetchedAt, so that slot h stays h hours
+  // from now while no new data arrives (e.g. after restoring from flash).
+  uint16_t shiftedHours = 0;
+  unsigned long lastAttemptMs = 0;
+  int lastStatus = 0;
+  String lastError;
+  // millis() of the newest update that carried each field; a merge older
+  // than that leaves the field alone. 0 until the field is pushed.
+  unsigned long currentAtMs[FORECAST_FIELD_COUNT] = {};
+  unsigned long forecastAtMs[FORECAST_FIELD_COUNT] = {};
+  // Moves only when values or the fetch status change; lastChange is what
+  // the update that moved it changed.
+  uint32_t revision = 0;
+  OutdoorChange lastChange;
+  // What each of the last CHANGE_HISTORY revisions changed, at
+  // revision % CHANGE_HISTORY, so a reader that skipped some can catch up.
+  static constexpr uint32_t CHANGE_HISTORY = 16;
+  OutdoorChange recentChanges[CHANGE_HISTORY];
+  // Everything revisions (since, revision] changed. A reader more than
+  // CHANGE_HISTORY behind gets every field and false.
+  bool changesSince(uint32_t since, OutdoorChange &out) const {
+    out = OutdoorChange();
+    const uint32_t behind = revision - since;
+    if (behind > CHANGE_HISTORY) {
+      out.current = out.forecast = (1u << FORECAST_FIELD_COUNT) - 1;
+      return false;
+    }
+    for (uint32_t r = since + 1; r != revision + 1; ++r) out |= recentChanges[r % CHANGE_HISTORY];
+    return true;
+  }
+  // Newest config save that loop() has applied; see saveConfig().
+  uint32_t configRevision = 0;
 };
 
-constexpr uint16_t OUTLOOK_HORIZONS[] = {1, 3, 6, 12, 24, 48, 72, 96};
-constexpr size_t OUTLOOK_HORIZON_COUNT = sizeof(OUTLOOK_HORIZONS) / sizeof(OUTLOOK_HORIZONS[0]);
+// A change posted from another task and applied by loop().
+struct OutdoorCommand {
+  enum class Kind : uint8_t { None, SetConfig };
+  Kind kind = Kind::None;
+  OutdoorConfig config;
+  uint32_t configRevision = 0;
+};
 
 class OutdoorService {
 public:
-  void begin(ManagedWiFi *wifi);
+  typedef RcuSnapshot<OutdoorData>::Reader DataReader;
+
+  // With a provider, a low-priority task fetches the forecast every
+  // fetchIntervalMin, unless pushes keep the data fresher than that.
+  void begin(ManagedWiFi *wifi, OutdoorProvider *provider = nullptr);
   void loop();
 
-  OutdoorConfig currentConfig() const { return config; }
-  bool saveConfig(const OutdoorConfig &next);
+  OutdoorConfig currentConfig() const { return config.get(); }
+  // Safe from any task: queues next and returns at once; loop() applies it
+  // (dropping the data for the old location). revision receives the
+  // configRevision that data() reports once it has landed. False when the
+  // queue is full.
+  bool saveConfig(const OutdoorConfig &next, uint32_t *revision = nullptr);
   void loadConfig();
+  void flushConfig() { store.flush(); }
+  // Writes a pending cache record now (e.g. before a planned restart).
+  void flushCache();
 
+  // Never blocks: asks the fetch task for a fetch when force is set or the
+  // data is missing, and reports whether there is data now.
   bool ensureFresh(bool force = false);
-  unsigned long lastFetchMs() const { return lastFetch; }
-  unsigned long lastAttemptMs() const { return lastAttempt; }
-  int lastStatusCode() const { return lastStatus; }
-  String lastError() const { return lastErr; }
+  // Wakes the fetch task for an immediate fetch; safe from any task.
+  void requestFetch();
+  // Pins the current data for a consistent multi-field read without a lock.
+  // Keep the guard short-lived; the next update waits for it.
+  DataReader data() const { return cache.read(); }
+
+  unsigned long lastFetchMs() const { return cache.read()->fetchedAtMs; }
+  uint32_t fetchedAtEpoch() const { return cache.read()->fetchedAt; }
+  // Age of the cached data in seconds, from the wall clock when it is set,
+  // else from millis(). AGE_UNKNOWN when there is no data, or when it was
+  // restored from flash and the clock has not been set yet.
+  static constexpr uint32_t AGE_UNKNOWN = FetchSchedule::AGE_UNKNOWN;
+  static uint32_t ageSeconds(const OutdoorData &d);
+  uint32_t ageSeconds() const { return ageSeconds(*cache.read()); }
+  unsigned long lastAttemptMs() const { return cache.read()->lastAttemptMs; }
+  int lastStatusCode() const { return cache.read()->lastStatus; }
+  String lastError() const { return cache.read()->lastError; }
+  // Bumped when the cached values, the fetch status or the config change;
+  // an update that repeats what is cached leaves it alone.
+  uint32_t revision() const { return cache.read()->revision; }
 
-  void updateCache(const OutdoorSnapshot &current, const std::map<uint16_t, OutdoorSnapshot> &future, unsigned long fetchedAtMs);
+  // Replaces the whole cache. hourly[i] is the forecast i + 1 hours ahead;
+  // NaN fields are gaps.
+  OutdoorChange updateCache(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours, unsigned long fetchedAtMs);
+  // Partial update: only the finite fields of current and hourly are
+  // written, hour by hour, and everything else keeps its value. A field
+  // already updated after atMs is skipped.
+  OutdoorChange mergeCache(const OutdoorSnapshot &current, const OutdoorSnapshot *hourly, size_t hours, unsigned long atMs);
 
-  OutdoorSnapshot current() const { return currentSnapshot; }
-  OutdoorSnapshot forecastFor(uint16_t hours) const;
+  OutdoorSnapshot current() const { return cache.read()->current; }
+  // Any hour up to MAX_FORECAST_HOURS; hours between pushed ones are
+  // interpolated, hours past the last one are NaN.
+  OutdoorSnapshot forecastFor(uint16_t hours) const { return cache.read()->forecast.at(hours); }
+  OutdoorSnapshot forecastAt(float hours, ForecastInterp mode = ForecastInterp::Linear) const { return cache.read()->forecast.at(hours, mode); }
+  // e.g. forecastWindow(ForecastField::TemperatureC, 1, 12).max
+  ForecastWindow forecastWindow(ForecastField field, uint16_t fromHour, uint16_t toHour) const { return cache.read()->forecast.window(field, fromHour, toHour); }
+  uint16_t forecastHorizon() const { return cache.read()->forecast.horizon(); }
 
-  bool hasConfig() const { return config.enabled && !isnan(config.lat) && !isnan(config.lon) && config.lat != 0.0 && config.lon != 0.0; }
-  bool hasData() const { return !isnan(currentSnapshot.temperatureC) || !isnan(currentSnapshot.humidity) || !isnan(currentSnapshot.pressureHpa); }
+  bool hasConfig() const;
+  static bool hasData(const OutdoorData &d) { return !isnan(d.current.temperatureC) || !isnan(d.current.humidity) || !isnan(d.current.pressureHpa); }
+  bool hasData() const { return hasData(*cache.read()); }
 
 private:
+  static void fetchTask(void *arg);
+  // Fetch task only: decides whether a fetch is due, runs it and schedules
+  // the next one. Returns how long the task may sleep.
+  uint32_t runFetchCycle(bool requested);
   bool fetch();
-  void clearForecast();
+  void recordFetchFailure(int status, const String &error);
+  void restoreCache();
+  bool persistCache();
+  // Drops the forecast hours that have passed since fetchedAt; no-op until
+  // the clock is set.
+  void ageForecast();
+  void applyCommand(OutdoorCommand &cmd);
+  void applyConfig(const OutdoorConfig &next, uint32_t revision);
 
   ManagedWiFi *wifiRef = nullptr;
-  Preferences prefs;
-  OutdoorConfig config;
-  OutdoorSnapshot currentSnapshot;
-  std::map<uint16_t, OutdoorSnapshot> outlook;
+  ConfigStore store{"outdoor"};
+  // Both are written by the web and MQTT tasks and read by the display and
+  // publisher tasks; see RcuSnapshot. OutdoorData is about 4.4 KB, nearly
+  // all of it the forecast table, so cache takes about 9 KB of RAM and each
+  // update (push, merge, fetch result, SNTP backfill) copies 4.4 KB.
+  // Updates arrive seconds to minutes apart, and the copy (tens of us) is
+  // small next to parsing the body that carried them.
+  RcuSnapshot<OutdoorConfig> config;
+  RcuSnapshot<OutdoorData> cache;
+  CommandQueue<OutdoorCommand, 4> commands;
+  std::atomic<uint32_t> configSaves{0};
 
-  unsigned long lastFetch = 0;
-  unsigned long lastAttempt = 0;
-  int lastStatus = 0;
-  String lastErr;
+  volatile bool cacheDirty = false;
+  unsigned long lastPersistMs = 0;
+  unsigned long lastAgeCheckMs = 0;
+
+  OutdoorProvider *provider = nullptr;
+  TaskHandle_t fetchHandle = nullptr;
+  // Fetch task only.
+  FetchSchedule schedule;
 };
@@ -0,0 +1,258 @@
+#include "ServicePayloads.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp32/spiram.h>
+#include <memory>
+
+#include "WeatherHistory.h"
+#include "HistoryLog.h"
+#include "OutdoorService.h"
+#include "MatrixDisplayService.h"
+#include "LiveEventStream.h"
+
+void buildResourcesJson(JsonObject root, const WeatherHistory &weatherHistory, const LiveEventStream *events) {
+  root["uptimeMs"] = millis();
+
+  JsonObject heap = root["heap"].to<JsonObject>();
+  heap["free"] = ESP.getFreeHeap();
+  heap["minFree"] = ESP.getMinFreeHeap();
+  heap["maxAlloc"] = ESP.getMaxAllocHeap();
+  heap["size"] = ESP.getHeapSize();
+
+  JsonObject psram = root["psram"].to<JsonObject>();
+  const bool hasPsram = psramFound() && ESP.getPsramSize() > 0;
+  psram["present"] = hasPsram;
+  psram["size"] = hasPsram ? ESP.getPsramSize() : 0;
+  if (hasPsram) {
+    psram["free"] = ESP.getFreePsram();
+    psram["minFree"] = ESP.getMinFreePsram();
+    psram["maxAlloc"] = ESP.getMaxAllocPsram();
+  } else {
+    psram["free"] = 0;
+    psram["minFree"] = 0;
+    psram["maxAlloc"] = 0;
+  }
+
+  JsonObject fs = root["fs"].to<JsonObject>();
+  fs["total"] = LittleFS.totalBytes();
+  fs["used"] = LittleFS.usedBytes();
+
+  JsonObject history = root["history"].to<JsonObject>();
+  history["psram"] = weatherHistory.usesPsram();
+  size_t historyBytes = 0;
+  for (size_t i = 0; i < HISTORY_TIER_COUNT; ++i) {
+    HistoryTierStats st = weatherHistory.stats(static_cast<HistoryTier>(i));
+    JsonObject tier = history[HISTORY_TIER_NAMES[i]].to<JsonObject>();
+    tier["capacity"] = st.capacity;
+    tier["used"] = st.used;
+    tier["usedBytes"] = st.usedBytes;
+    tier["oldest"] = st.oldest;
+    tier["newest"] = st.newest;
+    historyBytes += st.bytes;
+  }
+  history["bytes"] = historyBytes;
+  if (const HistoryLog *historyLog = weatherHistory.log()) {
+    HistoryLogStats ls = historyLog->stats();
+    JsonObject log = history["log"].to<JsonObject>();
+    log["segments"] = ls.segments;
+    log["bytesWritten"] = ls.bytesWritten;
+    log["copiedBytes"] = ls.copiedBytes;
+    log["bytesPerDay"] = ls.bytesPerDay;
+    log["pending"] = ls.pendingPoints;
+    log["restored"] = ls.restoredPoints;
+    log["corruptBlocks"] = ls.corruptBlocks;
+    log["recoveryUs"] = ls.recoveryUs;
+  }
+
+  if (events) {
+    LiveEventStats es = events->stats();
+    JsonObject live = root["events"].to<JsonObject>();
+    live["clients"] = es.clients;
+    live["sent"] = es.sent;
+    live["dropped"] = es.dropped;
+    live["rejected"] = es.rejected;
+  }
+
+  root["cpuFreqMhz"] = ESP.getCpuFreqMHz();
+  root["sdkVersion"] = ESP.getSdkVersion();
+  root["chipRevision"] = ESP.getChipRevision();
+}
+
+void buildMatrixConfigJson(JsonObject obj, const MatrixConfig &cfg) {
+  matrixConfigSchema.write(obj, cfg);
+  obj["orientationDegrees"] = static_cast<uint8_t>(cfg.orientation) * 90;
+  JsonArray order = obj["sceneOrder"].to<JsonArray>();
+  for (uint8_t i = 0; i < cfg.sceneCount && i < 4; ++i) {
+    order.add(cfg.sceneOrder[i]);
+  }
+}
+
+void applyMatrixConfigJson(JsonObjectConst obj, MatrixConfig &cfg) {
+  matrixConfigSchema.apply(obj, cfg);
+  // orientationIndex wins over degrees, an explicit order over sceneCount.
+  if (!obj["orientationIndex"].is<double>() && obj["orientationDegrees"].is<uint32_t>()) {
+    const uint32_t deg = obj["orientationDegrees"].as<uint32_t>();
+    if (deg % 90 == 0) cfg.orientation = static_cast<MatrixOrientation>((deg / 90) % 4);
+  }
+  if (obj["sceneOrder"].is<JsonArrayConst>()) {
+    uint8_t i = 0;
+    for (JsonVariantConst v : obj["sceneOrder"].as<JsonArrayConst>()) {
+      if (i >= 4) break;
+      cfg.sceneOrder[i++] = v.as<uint8_t>() % 4;
+    }
+    if (i >= 1) cfg.sceneCount = i;
+  }
+}
+
+template <typename Writer>
+void writeOutdoorStatus(Writer &w, const OutdoorService &outdoor) {
+  OutdoorConfig cfg = outdoor.currentConfig();
+  w.field("enabled", cfg.enabled);
+  w.field("configured", outdoor.hasConfig());
+  OutdoorService::DataReader data = outdoor.data();
+  w.field("lastFetchMs", data->fetchedAtMs);
+  w.field("fetchedAt", data->fetchedAt);
+  const uint32_t age = OutdoorService::ageSeconds(*data);
+  if (age == OutdoorService::AGE_UNKNOWN) {
+    w.key("ageS").null();
+  } else {
+    w.field("ageS", age);
+  }
+  w.field("lastAttemptMs", data->lastAttemptMs);
+  w.field("lastStatusCode", data->lastStatus);
+  w.field("lastError", data->lastError);
+  w.field("revision", data->revision);
+  w.field("configRevision", data->configRevision);
+  writeOutdoorChange(w, data->lastChange);
+}
+
+template <typename Writer>
+void writeOutdoorChange(Writer &w, const OutdoorChange &change) {
+  // ForecastField order, named as in writeOutdoorSnapshot(..., true).
+  static const char *const NAMES[FORECAST_FIELD_COUNT] = {
+    "temperatureC", "humidity", "pressureHpa", "pressureMmHg", "altitudeM", "windSpeed",
+  };
+  const uint8_t masks[2] = {change.current, change.forecast};
+  const char *const sections[2] = {"current", "forecast"};
+  w.beginObject("changed");
+  for (uint8_t s = 0; s < 2; ++s) {
+    w.beginArray(sections[s]);
+    for (size_t f = 0; f < FORECAST_FIELD_COUNT; ++f) {
+      if (masks[s] & (1u << f)) w.value(NAMES[f]);
+    }
+    w.endArray();
+  }
+  w.endObject();
+}
+
+template <typename Writer>
+void writeOutdoorConfig(Writer &w, const OutdoorConfig &cfg) {
+  w.field("lat", cfg.lat, 6);
+  w.field("lon", cfg.lon, 6);
+  w.field("city", cfg.city);
+  w.field("country", cfg.country);
+}
+
+template <typename Writer>
+void writeOutdoorSnapshot(Writer &w, const OutdoorSnapshot &snap, const char *tempKey, bool full) {
+  w.field(tempKey, snap.temperatureC, 2);
+  w.field("humidity", snap.humidity, 2);
+  w.field("pressureHpa", snap.pressureHpa, 2);
+  w.field("pressureMmHg", snap.pressureMmHg, 2);
+  if (full) w.field("altitudeM", snap.altitudeM, 1);
+  w.field("windSpeed", snap.windSpeed, 2);
+}
+
+OutdoorSummary summarizeOutdoor(const HourlyForecast &forecast) {
+  OutdoorSummary s;
+  s.temp = forecast.window(ForecastField::TemperatureC, 1, OUTLOOK_SUMMARY_HOURS);
+  s.humidity = forecast.window(ForecastField::Humidity, 1, OUTLOOK_SUMMARY_HOURS);
+  s.wind = forecast.window(ForecastField::WindSpeed, 1, OUTLOOK_SUMMARY_HOURS);
+  return s;
+}
+
+template <typename Writer>
+void writeOutdoorSummary(Writer &w, const OutdoorSummary &summary) {
+  w.field("hours", static_cast<uint32_t>(summary.temp.hours));
+  w.field("tempMinC", summary.temp.min, 2);
+  w.field("tempMaxC", summary.temp.max, 2);
+  w.field("tempMeanC", summary.temp.mean, 2);
+  w.field("humidityMean", summary.humidity.mean, 2);
+  w.field("windSpeedMax", summary.wind.max, 2);
+}
+
+void OutdoorView::capture(const OutdoorService &outdoor) {
+  OutdoorService::DataReader data = outdoor.data();
+  current = data->current;
+  for (size_t i = 0; i < OUTLOOK_HORIZON_COUNT; ++i) outlook[i] = data->forecast.at(OUTLOOK_HORIZONS[i]);
+  summary = summarizeOutdoor(data->forecast);
+}
+
+namespace {
+constexpr size_t FORECAST_STEPS = 4 + OUTLOOK_HORIZON_COUNT;
+
+// The data sections are captured on the first step.
+struct ForecastState {
+  JsonWriter json;
+  size_t step = 0;
+  OutdoorView view;
+
+  // Writes step `part` of FORECAST_STEPS: a section or one outlook slot.
+  template <typename Writer>
+  void write(Writer &w, size_t part, const OutdoorService &outdoor) {
+    if (part == 0) {
+      view.capture(outdoor);
+      w.beginObject();
+      writeOutdoorStatus(w, outdoor);
+    } else if (part == 1) {
+      w.beginObject("config");
+      writeOutdoorConfig(w, outdoor.currentConfig());
+      w.endObject();
+    } else if (part == 2) {
+      w.beginObject("current");
+      writeOutdoorSnapshot(w, view.current, "temperatureC", true);
+      w.endObject();
+    } else if (part < FORECAST_STEPS - 1) {
+      const size_t slot = part - 3;
+      if (slot == 0) w.beginObject("outlook");
+      char key[8];
+      snprintf(key, sizeof(key), "h%u", static_cast<unsigned>(OUTLOOK_HORIZONS[slot]));
+      w.beginObject(key);
+      writeOutdoorSnapshot(w, view.outlook[slot], "tempC", false);
+      w.endObject();
+    } else {
+      w.endObject();
+      w.beginObject("next12h");
+      writeOutdoorSummary(w, view.summary);
+      w.endObject();
+      w.endObject();
+    }
+  }
+};
+}
+
+RecordGenerator outdoorForecastRecords(const OutdoorService &outdoor) {
+  auto state = std::make_shared<ForecastState>();
+  return [&outdoor, state](StreamRecord &out) {
+    const size_t step = state->step++;
+    out.json(state->json, [&](JsonWriter &w) { state->write(w, step, outdoor); });
+    return step + 1 < FORECAST_STEPS;
+  };
+}
+
+void packOutdoorForecast(MsgPackWriter &w, const OutdoorService &outdoor) {
+  std::unique_ptr<ForecastState> state(new ForecastState());
+  for (size_t step = 0; step < FORECAST_STEPS; ++step) state->write(w, step, outdoor);
+}
+
+template void writeOutdoorStatus(JsonWriter &, const OutdoorService &);
+template void writeOutdoorStatus(MsgPackWriter &, const OutdoorService &);
+template void writeOutdoorChange(JsonWriter &, const OutdoorChange &);
+template void writeOutdoorChange(MsgPackWriter &, const OutdoorChange &);
+template void writeOutdoorConfig(JsonWriter &, const OutdoorConfig &);
+template void writeOutdoorConfig(MsgPackWriter &, const OutdoorConfig &);
+template void writeOutdoorSnapshot(JsonWriter &, const OutdoorSnapshot &, const char *, bool);
+template void writeOutdoorSnapshot(MsgPackWriter &, const OutdoorSnapshot &, const char *, bool);
+template void writeOutdoorSummary(JsonWriter &, const OutdoorSummary &);
+template void writeOutdoorSummary(MsgPackWriter &, const OutdoorSummary &);
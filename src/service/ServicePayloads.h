@@ -0,0 +1,68 @@
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include "HourlyForecast.h"
+#include "common/ResponseHelpers.h"
+
+class WeatherHistory;
+class OutdoorService;
+class LiveEventStream;
+struct OutdoorConfig;
+struct OutdoorChange;
+struct MatrixConfig;
+
+// Payload builders shared by the HTTP routes and the live event stream, so
+// a polled response and a pushed event carry the same document.
+
+// Fills root with the /api/system/resources document. events may be null.
+void buildResourcesJson(JsonObject root, const WeatherHistory &history, const LiveEventStream *events);
+
+// Fills obj with the /api/matrix/config document.
+void buildMatrixConfigJson(JsonObject obj, const MatrixConfig &cfg);
+// Applies a /api/matrix/config POST body: the schema fields plus the
+// orientationDegrees and sceneOrder forms.
+void applyMatrixConfigJson(JsonObjectConst obj, MatrixConfig &cfg);
+
+// Outdoor members, written into the object w currently has open. Writer is
+// JsonWriter or MsgPackWriter (both are instantiated).
+// "enabled" through "lastError", then "revision", "configRevision" and
+// "changed".
+template <typename Writer>
+void writeOutdoorStatus(Writer &w, const OutdoorService &outdoor);
+// "changed": {"current": [field names], "forecast": [...]}.
+template <typename Writer>
+void writeOutdoorChange(Writer &w, const OutdoorChange &change);
+// "lat", "lon", "city", "country".
+template <typename Writer>
+void writeOutdoorConfig(Writer &w, const OutdoorConfig &cfg);
+// One snapshot; full adds altitudeM (outlook slots omit it). NaN is null.
+template <typename Writer>
+void writeOutdoorSnapshot(Writer &w, const OutdoorSnapshot &snap, const char *tempKey, bool full);
+// Forecast min/max/mean over hours 1..OUTLOOK_SUMMARY_HOURS.
+struct OutdoorSummary {
+  ForecastWindow temp;
+  ForecastWindow humidity;
+  ForecastWindow wind;
+};
+OutdoorSummary summarizeOutdoor(const HourlyForecast &forecast);
+// "hours" through "windSpeedMax". NaN is null.
+template <typename Writer>
+void writeOutdoorSummary(Writer &w, const OutdoorSummary &summary);
+
+// Current conditions, outlook slots and summary copied out of one pinned
+// version, so a document streamed over several records describes a single
+// update without holding the reader across the response's chunks.
+struct OutdoorView {
+  OutdoorSnapshot current;
+  OutdoorSnapshot outlook[OUTLOOK_HORIZON_COUNT];
+  OutdoorSummary summary;
+
+  void capture(const OutdoorService &outdoor);
+};
+
+// Generator for the /api/outdoor/forecast document, one section or outlook
+// slot per record.
+RecordGenerator outdoorForecastRecords(const OutdoorService &outdoor);
+// The same document in one go, for MessagePack.
+void packOutdoorForecast(MsgPackWriter &w, const OutdoorService &outdoor);
@@ -4,60 +4,706 @@
 #include <LittleFS.h>
 #include <math.h>
 #include <AsyncJson.h>
-#include <esp32/spiram.h>
-#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <algorithm>
+#include <time.h>
+#include <vector>
 
 #include "WeatherService.h"
+#include "WeatherHistory.h"
+#include "HistoryDownsampler.h"
+#include "TelemetryFrameCache.h"
 #include "OutdoorService.h"
+#include "OutdoorCacheIngest.h"
 #include "MatrixDisplayService.h"
+#include "LiveEventStream.h"
+#include "ServicePayloads.h"
 #include "common/ResponseHelpers.h"
+#include "common/PerfStats.h"
+#include "assets/firmware_version.h"
+
+namespace {
+constexpr uint32_t HISTORY_DEFAULT_SPAN_S = 24UL * 60UL * 60UL;
+constexpr size_t HISTORY_DEFAULT_POINTS = 300;
+constexpr size_t OUTDOOR_CACHE_MAX_BYTES = 8192; // MessagePack only; JSON is streamed
+static_assert(std::is_trivially_destructible<OutdoorCacheIngest>::value, "freed with free() from _tempObject");
+
+bool parseHistoryMetric(const String &name, HistoryMetric &metric, const char *&unit) {
+  if (name == "temperature") {
+    metric = HistoryMetric::Temperature;
+    unit = "C";
+  } else if (name == "humidity") {
+    metric = HistoryMetric::Humidity;
+    unit = "%";
+  } else if (name == "pressure") {
+    metric = HistoryMetric::Pressure;
+    unit = "hPa";
+  } else {
+    return false;
+  }
+  return true;
+}
 
-void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherService, OutdoorService &outdoorService, MatrixDisplayService &matrixService) {
-  server.on("/api/weather/metrics", HTTP_GET, [&weatherService](AsyncWebServerRequest *request) {
-    WeatherReading reading;
-    bool ok = weatherService.read(reading);
-    sendJson(request, [&weatherService, ok, reading](JsonVariant json) {
-      JsonObject root = json.to<JsonObject>();
-      root["status"] = ok ? "ok" : "stale";
-      root["collectedAtMs"] = reading.collectedAtMs;
-      root["seaLevelPressureHpa"] = weatherService.seaLevelPressure();
-
-      JsonObject sensors = root["sensors"].to<JsonObject>();
-      JsonObject sht = sensors["sht31"].to<JsonObject>();
-      sht["present"] = weatherService.hasSHT();
-      sht["ok"] = reading.shtOk;
-
-      JsonObject bmp = sensors["bmp580"].to<JsonObject>();
-      bmp["present"] = weatherService.hasBMP();
-      bmp["ok"] = reading.bmpOk;
-
-      JsonObject metrics = root["metrics"].to<JsonObject>();
-      if (!isnan(reading.temperatureC)) {
-        metrics["temperatureC"] = reading.temperatureC;
-        metrics["temperatureF"] = reading.temperatureC * 9.0f / 5.0f + 32.0f;
+uint32_t uintParam(AsyncWebServerRequest *request, const char *name, uint32_t fallback) {
+  if (!request->hasParam(name)) return fallback;
+  return static_cast<uint32_t>(strtoul(request->getParam(name)->value().c_str(), nullptr, 10));
+}
+
+// Pulls stored rows in small batches between chunks; the history lock is only
+// held while a batch is copied out.
+struct HistoryExportState {
+  static constexpr size_t BATCH = 16;
+  enum class Stage : uint8_t { Header, Rows, Done };
+
+  const WeatherHistory *history = nullptr;
+  HistoryTier tier = HistoryTier::Minute;
+  // Resume point: the next batch starts at the row after the first `skip`
+  // rows stamped `cursor`, since raw points can share a timestamp.
+  uint32_t cursor = 0;
+  size_t skip = 0;
+  uint32_t to = 0;
+  bool csv = false;
+  Stage stage = Stage::Header;
+  HistoryRow batch[BATCH];
+  size_t count = 0;
+  size_t pos = 0;
+  bool exhausted = false;
+  bool firstRow = true;
+
+  bool refill() {
+    count = 0;
+    pos = 0;
+    if (exhausted) return false;
+    size_t skipped = 0;
+    history->visitRows(tier, cursor, to, [this, &skipped](const HistoryRow &row) {
+      if (row.t == cursor && skipped < skip) {
+        ++skipped;
+        return true;
       }
-      if (!isnan(reading.humidity)) {
-        metrics["humidity"] = reading.humidity;
+      batch[count++] = row;
+      return count < BATCH;
+    });
+    if (count < BATCH) exhausted = true;
+    if (count) {
+      const uint32_t last = batch[count - 1].t;
+      size_t same = 0;
+      while (same < count && batch[count - 1 - same].t == last) ++same;
+      skip = last == cursor ? skip + same : same;
+      cursor = last;
+    }
+    return count > 0;
+  }
+
+  bool next(StreamRecord &out) {
+    const bool quarter = tier == HistoryTier::Quarter;
+    if (stage == Stage::Header) {
+      stage = Stage::Rows;
+      if (csv) {
+        out.append("t,n,temperatureC,humidity,pressureHpa");
+        if (quarter) out.append(",temperatureMinC,temperatureMaxC,humidityMin,humidityMax,pressureMinHpa,pressureMaxHpa");
+        out.append("\n");
+      } else {
+        out.appendf("{\"tier\":\"%s\",\"from\":%lu,\"to\":%lu,\"columns\":[\"t\",\"n\",\"temperatureC\",\"humidity\",\"pressureHpa\"",
+                    HISTORY_TIER_NAMES[static_cast<size_t>(tier)], static_cast<unsigned long>(cursor), static_cast<unsigned long>(to));
+        if (quarter) out.append(",\"temperatureMinC\",\"temperatureMaxC\",\"humidityMin\",\"humidityMax\",\"pressureMinHpa\",\"pressureMaxHpa\"");
+        out.append("],\"rows\":[");
+      }
+      return true;
+    }
+    if (stage == Stage::Done) return false;
+    if (pos >= count && !refill()) {
+      stage = Stage::Done;
+      if (!csv) out.append("]}");
+      return false;
+    }
+
+    const HistoryRow &row = batch[pos++];
+    const char *missing = csv ? "" : "null";
+    static const float SCALE[HISTORY_METRIC_COUNT] = {1.0f, 1.0f, 0.01f};
+    static const uint8_t DECIMALS[HISTORY_METRIC_COUNT] = {2, 2, 2};
+    if (!csv) out.append(firstRow ? "[" : ",[");
+    firstRow = false;
+    out.appendf("%lu,%u", static_cast<unsigned long>(row.t), static_cast<unsigned>(row.n));
+    for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+      out.append(",");
+      out.appendFloat(row.mean[m] * SCALE[m], DECIMALS[m], missing);
+    }
+    if (quarter) {
+      for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+        out.append(",");
+        out.appendFloat(row.min[m] * SCALE[m], DECIMALS[m], missing);
+        out.append(",");
+        out.appendFloat(row.max[m] * SCALE[m], DECIMALS[m], missing);
       }
-      if (!isnan(reading.dewPointC)) {
-        metrics["dewPointC"] = reading.dewPointC;
-        metrics["dewPointF"] = reading.dewPointC * 9.0f / 5.0f + 32.0f;
+    }
+    out.append(csv ? "\n" : "]");
+    return true;
+  }
+};
+
+// Sections of /api/dashboard, one bit each; parts not selected are never built.
+enum DashboardPart : uint16_t {
+  PART_INDOOR = 1u << 0,
+  PART_OUTDOOR_STATUS = 1u << 1,
+  PART_OUTDOOR_CONFIG = 1u << 2,
+  PART_OUTDOOR_CURRENT = 1u << 3,
+  PART_OUTLOOK = 1u << 4,
+  PART_RESOURCES = 1u << 5,
+  PART_MATRIX = 1u << 6,
+  PART_VERSION = 1u << 7,
+};
+constexpr uint16_t PART_OUTDOOR = PART_OUTDOOR_STATUS | PART_OUTDOOR_CONFIG | PART_OUTDOOR_CURRENT;
+constexpr uint16_t PART_ALL = 0xFF;
+// "outdoor" members in document order.
+constexpr uint16_t OUTDOOR_MEMBERS[] = {PART_OUTDOOR_STATUS, PART_OUTDOOR_CONFIG, PART_OUTDOOR_CURRENT};
+
+struct DashboardField {
+  const char *name;
+  uint16_t parts;
+};
+constexpr DashboardField DASHBOARD_FIELDS[] = {
+    {"indoor", PART_INDOOR},
+    {"outdoor", PART_OUTDOOR},
+    {"outdoor.status", PART_OUTDOOR_STATUS},
+    {"outdoor.config", PART_OUTDOOR_CONFIG},
+    {"outdoor.current", PART_OUTDOOR_CURRENT},
+    {"outlook", PART_OUTLOOK},
+    {"resources", PART_RESOURCES},
+    {"matrix", PART_MATRIX},
+    {"version", PART_VERSION},
+};
+
+// MessagePack of doc into dst for MsgPackWriter::packed(); more than room
+// when it does not fit (serializeMsgPack() would silently truncate).
+size_t packDocument(const JsonDocument &doc, uint8_t *dst, size_t room) {
+  const size_t n = measureMsgPack(doc);
+  return n <= room ? serializeMsgPack(doc, dst, room) : n;
+}
+
+// Parses a comma-separated field list; an empty list selects everything.
+bool parseDashboardFields(const String &list, uint16_t &parts) {
+  parts = 0;
+  int start = 0;
+  while (start <= static_cast<int>(list.length())) {
+    int end = list.indexOf(',', start);
+    if (end < 0) end = list.length();
+    String name = list.substring(start, end);
+    name.trim();
+    if (name.length()) {
+      bool known = false;
+      for (const DashboardField &field : DASHBOARD_FIELDS) {
+        if (name == field.name) {
+          parts |= field.parts;
+          known = true;
+          break;
+        }
       }
-      if (!isnan(reading.pressurePa)) {
-        metrics["pressurePa"] = reading.pressurePa;
-        metrics["pressureHpa"] = reading.pressurePa / 100.0f;
-        metrics["pressureMmHg"] = reading.pressurePa / 133.322f;
+      if (!known) return false;
+    }
+    start = end + 1;
+  }
+  if (!parts) parts = PART_ALL;
+  return true;
+}
+
+// Emits the selected sections in a fixed order through one JsonWriter that
+// spans all records. Pre-serialized sections (the indoor frame, resources,
+// matrix) are copied on as raw text over as many records as they need.
+// pack() writes the same document as MessagePack.
+struct DashboardState {
+  enum class Stage : uint8_t { Open, Indoor, Outdoor, Outlook, Resources, Matrix, Version, Close, Done };
+
+  TelemetryFrameCache *frames = nullptr;
+  const OutdoorService *outdoor = nullptr;
+  const WeatherHistory *history = nullptr;
+  const LiveEventStream *events = nullptr;
+  const MatrixDisplayService *matrix = nullptr;
+  uint16_t parts = PART_ALL;
+
+  JsonWriter json;
+  Stage stage = Stage::Open;
+  size_t sub = 0;
+  String carry;
+  size_t carryPos = 0;
+  // "outdoor" and "outlook" come from one update, captured by whichever of
+  // them is written first.
+  OutdoorView view;
+  bool captured = false;
+
+  void captureOutdoor() {
+    if (captured) return;
+    view.capture(*outdoor);
+    captured = true;
+  }
+
+  void advance() {
+    stage = static_cast<Stage>(static_cast<uint8_t>(stage) + 1);
+    sub = 0;
+  }
+
+  // Writes key and queues body as its value.
+  void carryValue(StreamRecord &out, const char *key, String &&body) {
+    carry = std::move(body);
+    if (!carry.length()) carry = "null";
+    carryPos = 0;
+    out.json(json, [key](JsonWriter &w) { w.key(key).json("", 0); });
+  }
+
+  bool next(StreamRecord &out) {
+    if (carryPos < carry.length()) {
+      carryPos += out.append(carry.c_str() + carryPos, carry.length() - carryPos);
+      if (carryPos >= carry.length()) carry = String();
+      return true;
+    }
+    while (!out.size()) {
+      switch (stage) {
+      case Stage::Open:
+        out.json(json, [](JsonWriter &w) { w.beginObject(); });
+        advance();
+        break;
+      case Stage::Indoor:
+        if (parts & PART_INDOOR) {
+          String body;
+          String etag;
+          frames->metricsBody(body, etag);
+          carryValue(out, "indoor", std::move(body));
+        }
+        advance();
+        break;
+      case Stage::Outdoor:
+        nextOutdoor(out);
+        break;
+      case Stage::Outlook:
+        if (!(parts & PART_OUTLOOK)) {
+          advance();
+          break;
+        }
+        captureOutdoor();
+        out.json(json, [this](JsonWriter &w) { writeOutlook(w, sub); });
+        if (sub++ >= OUTLOOK_HORIZON_COUNT) advance();
+        break;
+      case Stage::Resources:
+        if (parts & PART_RESOURCES) {
+          JsonDocument doc;
+          buildResourcesJson(doc.to<JsonObject>(), *history, events);
+          String body;
+          serializeJson(doc, body);
+          carryValue(out, "resources", std::move(body));
+        }
+        advance();
+        break;
+      case Stage::Matrix:
+        if (parts & PART_MATRIX) {
+          JsonDocument doc;
+          buildMatrixConfigJson(doc.to<JsonObject>(), matrix->currentConfig());
+          String body;
+          serializeJson(doc, body);
+          carryValue(out, "matrix", std::move(body));
+        }
+        advance();
+        break;
+      case Stage::Version:
+        if (parts & PART_VERSION) {
+          out.json(json, [](JsonWriter &w) { w.field("version", FW_VERSION); });
+        }
+        advance();
+        break;
+      case Stage::Close:
+        out.json(json, [](JsonWriter &w) { w.endObject(); });
+        advance();
+        return false;
+      case Stage::Done:
+        return false;
       }
-      if (!isnan(reading.altitudeM)) {
-        metrics["altitudeM"] = reading.altitudeM;
-        metrics["altitudeFt"] = reading.altitudeM * 3.28084f;
+    }
+    return true;
+  }
+
+  // "outdoor":{"status":{...},"config":{...},"current":{...}}, selected members only.
+  void nextOutdoor(StreamRecord &out) {
+    if (!(parts & PART_OUTDOOR)) {
+      advance();
+      return;
+    }
+    captureOutdoor();
+    while (sub < 3 && !(parts & OUTDOOR_MEMBERS[sub])) ++sub;
+    const size_t member = sub++;
+    out.json(json, [this, member](JsonWriter &w) {
+      if (w.level() == 1) w.beginObject("outdoor");
+      writeOutdoorMember(w, member);
+    });
+    if (member >= 3) advance();
+  }
+
+  // Status, config or current by index; 3 closes "outdoor".
+  template <typename Writer>
+  void writeOutdoorMember(Writer &w, size_t member) {
+    if (member == 0) {
+      w.beginObject("status");
+      writeOutdoorStatus(w, *outdoor);
+      w.endObject();
+    } else if (member == 1) {
+      w.beginObject("config");
+      writeOutdoorConfig(w, outdoor->currentConfig());
+      w.endObject();
+    } else if (member == 2) {
+      w.beginObject("current");
+      writeOutdoorSnapshot(w, view.current, "temperatureC", true);
+      w.endObject();
+    } else {
+      w.endObject();
+    }
+  }
+
+  // One "outlook" slot by index; OUTLOOK_HORIZON_COUNT closes it and adds "next12h".
+  template <typename Writer>
+  void writeOutlook(Writer &w, size_t slot) {
+    if (slot == 0) w.beginObject("outlook");
+    if (slot < OUTLOOK_HORIZON_COUNT) {
+      char key[8];
+      snprintf(key, sizeof(key), "h%u", static_cast<unsigned>(OUTLOOK_HORIZONS[slot]));
+      w.beginObject(key);
+      writeOutdoorSnapshot(w, view.outlook[slot], "tempC", false);
+      w.endObject();
+    } else {
+      w.endObject();
+      w.beginObject("next12h");
+      writeOutdoorSummary(w, view.summary);
+      w.endObject();
+    }
+  }
+
+  // The whole document in one go, for MessagePack. The sections that the
+  // JSON form carries as text are encoded straight into the writer.
+  void pack(MsgPackWriter &w) {
+    w.beginObject();
+    if (parts & PART_INDOOR) {
+      w.packedField("indoor", [this](uint8_t *dst, size_t room) { return frames->copyPacked(dst, room); });
+    }
+    if (parts & (PART_OUTDOOR | PART_OUTLOOK)) captureOutdoor();
+    if (parts & PART_OUTDOOR) {
+      w.beginObject("outdoor");
+      for (size_t member = 0; member < 3; ++member) {
+        if (parts & OUTDOOR_MEMBERS[member]) writeOutdoorMember(w, member);
       }
-      if (!isnan(reading.bmpTemperatureC)) {
-        metrics["pressureTemperatureC"] = reading.bmpTemperatureC;
+      writeOutdoorMember(w, 3);
+    }
+    if (parts & PART_OUTLOOK) {
+      for (size_t slot = 0; slot <= OUTLOOK_HORIZON_COUNT; ++slot) writeOutlook(w, slot);
+    }
+    if (parts & PART_RESOURCES) {
+      JsonDocument doc;
+      buildResourcesJson(doc.to<JsonObject>(), *history, events);
+      w.packedField("resources", [&doc](uint8_t *dst, size_t room) { return packDocument(doc, dst, room); });
+    }
+    if (parts & PART_MATRIX) {
+      JsonDocument doc;
+      buildMatrixConfigJson(doc.to<JsonObject>(), matrix->currentConfig());
+      w.packedField("matrix", [&doc](uint8_t *dst, size_t room) { return packDocument(doc, dst, room); });
+    }
+    if (parts & PART_VERSION) w.field("version", FW_VERSION);
+    w.endObject();
+  }
+};
+
+bool parseHistoryTier(const String &name, HistoryTier &tier) {
+  for (size_t i = 0; i < HISTORY_TIER_COUNT; ++i) {
+    if (name == HISTORY_TIER_NAMES[i]) {
+      tier = static_cast<HistoryTier>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isJsonBody(AsyncWebServerRequest *request) {
+  return request->contentType().equalsIgnoreCase("application/json");
+}
+
+bool isMsgPackBody(AsyncWebServerRequest *request) {
+  return request->contentType().equalsIgnoreCase("application/msgpack");
+}
+
+// Hands the parsed upload to the cache and reports which fields moved.
+void applyOutdoorUpload(AsyncWebServerRequest *request, OutdoorCacheIngest &ingest, OutdoorService &outdoor, bool merge) {
+  const OutdoorChange change = merge ? ingest.merge(outdoor) : ingest.commit(outdoor);
+  char body[256];
+  JsonWriter w(body, sizeof(body));
+  w.beginObject();
+  w.field("status", merge ? "merged" : "cached");
+  w.field("hours", ingest.hours());
+  w.field("dropped", ingest.dropped());
+  writeOutdoorChange(w, change);
+  w.endObject();
+  request->send(200, "application/json", w.c_str());
+}
+
+// POST replaces the outdoor cache and PATCH merges into it; the body forms
+// are the same. JSON bodies are parsed as they arrive (see
+// OutdoorCacheIngest), so a week of hourly rows needs no more RAM than an
+// empty upload. MessagePack is small enough to buffer and goes through a
+// document.
+void handleOutdoorCacheUpload(AsyncWebServerRequest *request, OutdoorService &outdoor, bool merge) {
+  if (isJsonBody(request)) {
+    auto *ingest = static_cast<OutdoorCacheIngest *>(request->_tempObject);
+    // A body arrived but left no ingest behind: its allocation failed.
+    if (!ingest && request->contentLength()) {
+      request->send(503, "application/json", "{\"error\":\"out of memory\"}");
+      return;
+    }
+    if (!ingest || !ingest->finish()) {
+      char body[96];
+      snprintf(body, sizeof(body), "{\"error\":\"invalid json\",\"detail\":\"%s\"}",
+               ingest ? ingest->error() : "empty body");
+      request->send(400, "application/json", body);
+      return;
+    }
+    applyOutdoorUpload(request, *ingest, outdoor, merge);
+    return;
+  }
+  if (!isMsgPackBody(request)) {
+    request->send(415, "application/json", "{\"error\":\"expected application/json or application/msgpack\"}");
+    return;
+  }
+  if (request->contentLength() > OUTDOOR_CACHE_MAX_BYTES) {
+    request->send(413, "application/json", "{\"error\":\"too large\"}");
+    return;
+  }
+  if (!request->_tempObject && request->contentLength()) {
+    request->send(503, "application/json", "{\"error\":\"out of memory\"}");
+    return;
+  }
+  JsonDocument doc;
+  const DeserializationError err = request->_tempObject
+      ? deserializeMsgPack(doc, static_cast<const uint8_t *>(request->_tempObject), request->contentLength())
+      : DeserializationError(DeserializationError::EmptyInput);
+  if (err || !doc.is<JsonObject>()) {
+    request->send(400, "application/json", "{\"error\":\"invalid msgpack\"}");
+    return;
+  }
+  std::unique_ptr<OutdoorCacheIngest> ingest(new (std::nothrow) OutdoorCacheIngest());
+  if (!ingest) {
+    request->send(503, "application/json", "{\"error\":\"out of memory\"}");
+    return;
+  }
+  ingest->load(doc.as<JsonObjectConst>());
+  if (ingest->error()) {
+    char body[64];
+    snprintf(body, sizeof(body), "{\"error\":\"%s\"}", ingest->error());
+    request->send(400, "application/json", body);
+    return;
+  }
+  applyOutdoorUpload(request, *ingest, outdoor, merge);
+}
+
+void handleOutdoorCacheBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  // Whatever lives in _tempObject is released with free() along with the
+  // request, hence malloc + placement new for the ingest.
+  if (isJsonBody(request)) {
+    if (!index) {
+      void *mem = malloc(sizeof(OutdoorCacheIngest));
+      if (!mem) return;
+      request->_tempObject = mem;
+      new (mem) OutdoorCacheIngest();
+      static_cast<OutdoorCacheIngest *>(mem)->begin();
+    }
+    auto *ingest = static_cast<OutdoorCacheIngest *>(request->_tempObject);
+    if (ingest) ingest->feed(data, len);
+    return;
+  }
+  if (!isMsgPackBody(request) || total > OUTDOOR_CACHE_MAX_BYTES) return;
+  if (!index) request->_tempObject = malloc(total);
+  if (request->_tempObject) memcpy(static_cast<uint8_t *>(request->_tempObject) + index, data, len);
+}
+
+// /api/debug/perf, one route per record.
+struct PerfReportState {
+  JsonWriter json;
+  size_t index = 0;
+  bool started = false;
+
+  bool next(StreamRecord &out) {
+    if (!started) {
+      started = true;
+      out.json(json, [](JsonWriter &w) {
+        w.beginObject();
+        w.field("uptimeMs", static_cast<uint32_t>(millis()));
+        w.beginArray("routes");
+      });
+      return true;
+    }
+    RoutePerfSummary row;
+    if (!perfStats.summary(index++, row)) {
+      out.json(json, [](JsonWriter &w) {
+        w.endArray();
+        w.endObject();
+      });
+      return false;
+    }
+    out.json(json, [&row](JsonWriter &w) { writeRow(w, row); });
+    return true;
+  }
+
+  template <typename Writer>
+  static void writeRow(Writer &w, const RoutePerfSummary &row) {
+    w.beginObject();
+    w.field("route", row.label);
+    w.field("count", row.count);
+    w.field("inFlight", row.inFlight);
+    w.field("p50Us", row.p50Us);
+    w.field("p95Us", row.p95Us);
+    w.field("p99Us", row.p99Us);
+    w.field("maxUs", row.maxUs);
+    w.field("bytes", row.bytes);
+    w.field("heapDeltaAvg", row.heapDeltaAvg);
+    w.field("heapDeltaMin", row.heapDeltaMin);
+    w.endObject();
+  }
+
+  static void pack(MsgPackWriter &w) {
+    w.beginObject();
+    w.field("uptimeMs", static_cast<uint32_t>(millis()));
+    w.beginArray("routes");
+    RoutePerfSummary row;
+    for (size_t i = 0; perfStats.summary(i, row); ++i) writeRow(w, row);
+    w.endArray();
+    w.endObject();
+  }
+};
+}
+
+void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherService, WeatherHistory &weatherHistory, TelemetryFrameCache &frameCache, LiveEventStream &events, OutdoorService &outdoorService, MatrixDisplayService &matrixService) {
+  server.on("/api/weather/metrics", HTTP_GET, timed("GET /api/weather/metrics", [&frameCache](AsyncWebServerRequest *request) {
+    // Serialized once per sample; unchanged polls are answered with 304.
+    if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == frameCache.etag()) {
+      AsyncWebServerResponse *response = request->beginResponse(304);
+      response->addHeader("ETag", frameCache.etag());
+      response->addHeader("Cache-Control", "no-cache");
+      response->addHeader("Vary", "Accept");
+      request->send(response);
+      return;
+    }
+    if (wantsMsgPack(request)) {
+      sendMsgPack(request, [&frameCache](MsgPackWriter &w) {
+        w.packed([&frameCache](uint8_t *dst, size_t room) { return frameCache.copyPacked(dst, room); });
+      });
+      return;
+    }
+    String body;
+    String etag;
+    frameCache.metricsBody(body, etag);
+    perfStats.addBytes(body.length());
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", body);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("Vary", "Accept");
+    request->send(response);
+  }));
+
+  // Everything the service page needs on load in one streamed response.
+  server.on("/api/dashboard", HTTP_GET, timed("GET /api/dashboard", [&frameCache, &weatherHistory, &events, &outdoorService, &matrixService](AsyncWebServerRequest *request) {
+    auto state = std::make_shared<DashboardState>();
+    const String fields = request->hasParam("fields") ? request->getParam("fields")->value() : String();
+    if (!parseDashboardFields(fields, state->parts)) {
+      request->send(400, "application/json", "{\"error\":\"unknown field\"}");
+      return;
+    }
+    state->frames = &frameCache;
+    state->outdoor = &outdoorService;
+    state->history = &weatherHistory;
+    state->events = &events;
+    state->matrix = &matrixService;
+    sendJsonStream(request, [state](StreamRecord &out) {
+      return state->next(out);
+    }, [state](MsgPackWriter &w) {
+      state->pack(w);
+    });
+  }));
+
+  // Pushes metrics, outdoor cache and resources as they change; see LiveEventStream.
+  server.addHandler(&events.handler());
+
+  server.on("/api/weather/history", HTTP_GET, timed("GET /api/weather/history", [&weatherHistory](AsyncWebServerRequest *request) {
+    HistoryMetric metric;
+    const char *unit = nullptr;
+    const String metricName = request->hasParam("metric") ? request->getParam("metric")->value() : String("temperature");
+    if (!parseHistoryMetric(metricName, metric, unit)) {
+      request->send(400, "application/json", "{\"error\":\"unknown metric\"}");
+      return;
+    }
+    const time_t now = time(nullptr);
+    if (!WeatherHistory::clockValid(now)) {
+      request->send(503, "application/json", "{\"error\":\"clock not synced\"}");
+      return;
+    }
+    const uint32_t to = uintParam(request, "to", static_cast<uint32_t>(now));
+    const uint32_t from = uintParam(request, "from", to > HISTORY_DEFAULT_SPAN_S ? to - HISTORY_DEFAULT_SPAN_S : 0);
+    size_t points = uintParam(request, "points", HISTORY_DEFAULT_POINTS);
+    if (from >= to) {
+      request->send(400, "application/json", "{\"error\":\"from must be before to\"}");
+      return;
+    }
+    if (points > HistoryDownsampler::MAX_POINTS) points = HistoryDownsampler::MAX_POINTS;
+    const DownsampleMode mode = request->hasParam("mode") && request->getParam("mode")->value() == "minmax"
+                                    ? DownsampleMode::MinMax
+                                    : DownsampleMode::Lttb;
+    const HistoryTier tier = weatherHistory.tierFor(from, to, points);
+
+    // Reduce while visiting so only the output series is kept; JSON is built
+    // after the history lock is released.
+    std::vector<std::pair<uint32_t, float>> series;
+    series.reserve(points);
+    const float scale = metric == HistoryMetric::Pressure ? 0.01f : 1.0f;
+    HistoryDownsampler sampler(mode, from, to, points, [&series, scale](uint32_t t, float v) {
+      series.emplace_back(t, v * scale);
+    });
+    weatherHistory.visit(tier, metric, from, to, [&sampler](const HistorySample &sample) {
+      sampler.add(sample);
+      return true;
+    });
+    sampler.finish();
+
+    const size_t scanned = sampler.consumed();
+    // MessagePack cannot carry pre-formatted numbers, so it gets rounded floats.
+    const bool packed = wantsMsgPack(request);
+    sendJson(request, [&](JsonVariant json) {
+      JsonObject root = json.to<JsonObject>();
+      root["metric"] = metricName;
+      root["unit"] = unit;
+      root["tier"] = HISTORY_TIER_NAMES[static_cast<size_t>(tier)];
+      root["mode"] = mode == DownsampleMode::MinMax ? "minmax" : "lttb";
+      root["from"] = from;
+      root["to"] = to;
+      root["scanned"] = scanned;
+      JsonArray out = root["points"].to<JsonArray>();
+      for (const auto &p : series) {
+        JsonArray pt = out.add<JsonArray>();
+        pt.add(p.first);
+        if (packed) {
+          pt.add(roundf(p.second * 100.0f) / 100.0f);
+        } else {
+          pt.add(serialized(String(p.second, 2)));
+        }
       }
     });
-  });
+  }));
+
+  server.on("/api/weather/export", HTTP_GET, timed("GET /api/weather/export", [&weatherHistory](AsyncWebServerRequest *request) {
+    auto state = std::make_shared<HistoryExportState>();
+    state->history = &weatherHistory;
+    if (request->hasParam("tier") && !parseHistoryTier(request->getParam("tier")->value(), state->tier)) {
+      request->send(400, "application/json", "{\"error\":\"unknown tier\"}");
+      return;
+    }
+    state->cursor = uintParam(request, "from", 0);
+    state->to = uintParam(request, "to", UINT32_MAX);
+    state->csv = request->hasParam("format") && request->getParam("format")->value() == "csv";
+    sendStream(request, state->csv ? "text/csv" : "application/json", [state](StreamRecord &out) {
+      return state->next(out);
+    });
+  }));
 
   auto &serviceHandler = server.serveStatic("/service", LittleFS, "/service/");
   serviceHandler.setDefaultFile("main.html");
@@ -65,255 +711,96 @@ void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherServic
   // Direct file mapping for clients that request the full path.
   server.serveStatic("/service/main.html", LittleFS, "/service/main.html");
 
-  server.on("/main.html", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/main.html", HTTP_GET, timed("GET /main.html", [](AsyncWebServerRequest *request) {
     request->redirect("/service/main.html");
-  });
+  }));
 
-  server.on("/service", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/service", HTTP_GET, timed("GET /service", [](AsyncWebServerRequest *request) {
     request->redirect("/service/");
-  });
+  }));
 
-  server.on("/service.css", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/service.css", HTTP_GET, timed("GET /service.css", [](AsyncWebServerRequest *request) {
     request->redirect("/service/service.css");
-  });
+  }));
 
-  server.on("/api/system/resources", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/api/system/resources", HTTP_GET, timed("GET /api/system/resources", [&weatherHistory, &events](AsyncWebServerRequest *request) {
+    if (wantsMsgPack(request)) {
+      JsonDocument doc;
+      buildResourcesJson(doc.to<JsonObject>(), weatherHistory, &events);
+      sendDocument(request, doc);
+      return;
+    }
     auto *response = new AsyncJsonResponse(false);
     if (!response) {
       request->send(503, "application/json", "{\"error\":\"oom\"}");
       return;
     }
-
-    JsonObject root = response->getRoot();
-    root["uptimeMs"] = millis();
-
-    JsonObject heap = root["heap"].to<JsonObject>();
-    heap["free"] = ESP.getFreeHeap();
-    heap["minFree"] = ESP.getMinFreeHeap();
-    heap["maxAlloc"] = ESP.getMaxAllocHeap();
-    heap["size"] = ESP.getHeapSize();
-
-    JsonObject psram = root["psram"].to<JsonObject>();
-    const bool hasPsram = psramFound() && ESP.getPsramSize() > 0;
-    psram["present"] = hasPsram;
-    psram["size"] = hasPsram ? ESP.getPsramSize() : 0;
-    if (hasPsram) {
-      psram["free"] = ESP.getFreePsram();
-      psram["minFree"] = ESP.getMinFreePsram();
-      psram["maxAlloc"] = ESP.getMaxAllocPsram();
-    } else {
-      psram["free"] = 0;
-      psram["minFree"] = 0;
-      psram["maxAlloc"] = 0;
-    }
-
-    JsonObject fs = root["fs"].to<JsonObject>();
-    fs["total"] = LittleFS.totalBytes();
-    fs["used"] = LittleFS.usedBytes();
-
-    root["cpuFreqMhz"] = ESP.getCpuFreqMHz();
-    root["sdkVersion"] = ESP.getSdkVersion();
-    root["chipRevision"] = ESP.getChipRevision();
-
-    response->setLength();
+    buildResourcesJson(response->getRoot(), weatherHistory, &events);
+    perfStats.addBytes(response->setLength());
+    response->addHeader("Vary", "Accept");
     request->send(response);
-  });
+  }));
 
-  server.on("/api/outdoor/config", HTTP_GET, [&outdoorService](AsyncWebServerRequest *request) {
+  server.on("/api/outdoor/config", HTTP_GET, timed("GET /api/outdoor/config", [&outdoorService](AsyncWebServerRequest *request) {
     sendJson(request, [&outdoorService](JsonVariant json) {
       JsonObject obj = json.as<JsonObject>();
-      OutdoorConfig cfg = outdoorService.currentConfig();
-      obj["enabled"] = cfg.enabled;
-      obj["lat"] = cfg.lat;
-      obj["lon"] = cfg.lon;
-      obj["city"] = cfg.city;
-      obj["country"] = cfg.country;
+      outdoorConfigSchema.write(obj, outdoorService.currentConfig());
       obj["configured"] = outdoorService.hasConfig();
-      obj["lastFetchMs"] = outdoorService.lastFetchMs();
+      OutdoorService::DataReader data = outdoorService.data();
+      obj["lastFetchMs"] = data->fetchedAtMs;
+      obj["fetchedAt"] = data->fetchedAt;
+      obj["configRevision"] = data->configRevision;
     });
-  });
+  }));
 
-  server.on("/api/matrix/config", HTTP_GET, [&matrixService](AsyncWebServerRequest *request) {
+  server.on("/api/matrix/config", HTTP_GET, timed("GET /api/matrix/config", [&matrixService](AsyncWebServerRequest *request) {
     sendJson(request, [&matrixService](JsonVariant json) {
       JsonObject obj = json.as<JsonObject>();
-      MatrixConfig cfg = matrixService.currentConfig();
-      obj["enabled"] = cfg.enabled;
-      obj["pin"] = cfg.pin;
-      obj["width"] = cfg.width;
-      obj["height"] = cfg.height;
-      obj["serpentine"] = cfg.serpentine;
-      obj["startBottom"] = cfg.startBottom;
-      obj["flipX"] = cfg.flipX;
-      obj["orientationIndex"] = static_cast<uint8_t>(cfg.orientation);
-      obj["orientationDegrees"] = static_cast<uint8_t>(cfg.orientation) * 90;
-      obj["brightness"] = cfg.brightness;
-      obj["maxBrightness"] = cfg.maxBrightness;
-      obj["nightEnabled"] = cfg.nightEnabled;
-      obj["nightStartMin"] = cfg.nightStartMin;
-      obj["nightEndMin"] = cfg.nightEndMin;
-      obj["nightBrightness"] = cfg.nightBrightness;
-      obj["fps"] = cfg.fps;
-      obj["sceneDwellMs"] = cfg.sceneDwellMs;
-      obj["transitionMs"] = cfg.transitionMs;
-      JsonArray order = obj["sceneOrder"].to<JsonArray>();
-      for (uint8_t i = 0; i < cfg.sceneCount && i < 4; ++i) {
-        order.add(cfg.sceneOrder[i]);
-      }
-      obj["sceneCount"] = cfg.sceneCount;
-      obj["clockUse12h"] = cfg.clockUse12h;
-      obj["clockShowSeconds"] = cfg.clockShowSeconds;
-      obj["clockShowMillis"] = cfg.clockShowMillis;
-      obj["colorMode"] = static_cast<uint8_t>(cfg.colorMode);
-      {
-        JsonArray c1 = obj["color1"].to<JsonArray>();
-        c1.add(cfg.color1R);
-        c1.add(cfg.color1G);
-        c1.add(cfg.color1B);
-      }
-      {
-        JsonArray c2 = obj["color2"].to<JsonArray>();
-        c2.add(cfg.color2R);
-        c2.add(cfg.color2G);
-        c2.add(cfg.color2B);
-      }
+      buildMatrixConfigJson(obj, matrixService.currentConfig());
     });
-  });
+  }));
 
-  auto *outdoorSaveHandler = new AsyncCallbackJsonWebHandler("/api/outdoor/config", [&outdoorService](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *outdoorSaveHandler = new AsyncCallbackJsonWebHandler("/api/outdoor/config", timed("POST /api/outdoor/config", [&outdoorService](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!json.is<JsonObject>()) {
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
     }
-    JsonObject obj = json.as<JsonObject>();
     OutdoorConfig cfg = outdoorService.currentConfig();
-    if (obj["enabled"].is<bool>()) cfg.enabled = obj["enabled"].as<bool>();
-    if (obj["lat"].is<double>()) cfg.lat = obj["lat"].as<double>();
-    if (obj["lon"].is<double>()) cfg.lon = obj["lon"].as<double>();
-    if (obj["city"].is<const char *>()) cfg.city = obj["city"].as<const char *>();
-    if (obj["country"].is<const char *>()) cfg.country = obj["country"].as<const char *>();
-    outdoorService.saveConfig(cfg);
-    request->send(200, "application/json", "{\"status\":\"saved\"}");
-  });
+    outdoorConfigSchema.apply(json.as<JsonObjectConst>(), cfg);
+    uint32_t revision = 0;
+    if (!outdoorService.saveConfig(cfg, &revision)) {
+      request->send(503, "application/json", "{\"error\":\"busy\"}");
+      return;
+    }
+    // Applied by the loop task; the client polls configRevision in the
+    // outdoor status until it reaches this one.
+    char body[48];
+    snprintf(body, sizeof(body), "{\"status\":\"queued\",\"configRevision\":%lu}", static_cast<unsigned long>(revision));
+    request->send(202, "application/json", body);
+  }));
   outdoorSaveHandler->setMethod(HTTP_POST);
   server.addHandler(outdoorSaveHandler);
 
-  auto *matrixSaveHandler = new AsyncCallbackJsonWebHandler("/api/matrix/config", [&matrixService](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *matrixSaveHandler = new AsyncCallbackJsonWebHandler("/api/matrix/config", timed("POST /api/matrix/config", [&matrixService](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!json.is<JsonObject>()) {
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
     }
 
     MatrixConfig cfg = matrixService.currentConfig();
-    JsonObject obj = json.as<JsonObject>();
-
-    if (obj["enabled"].is<bool>()) cfg.enabled = obj["enabled"].as<bool>();
-    if (obj["pin"].is<unsigned long>() || obj["pin"].is<int>() || obj["pin"].is<double>()) {
-      uint32_t pin = obj["pin"].as<uint32_t>();
-      cfg.pin = pin <= 255 ? static_cast<uint8_t>(pin) : cfg.pin;
-    }
-    if (obj["width"].is<unsigned long>() || obj["width"].is<int>() || obj["width"].is<double>()) {
-      uint32_t w = obj["width"].as<uint32_t>();
-      cfg.width = (w > 0 && w <= 256) ? static_cast<uint16_t>(w) : cfg.width;
-    }
-    if (obj["height"].is<unsigned long>() || obj["height"].is<int>() || obj["height"].is<double>()) {
-      uint32_t h = obj["height"].as<uint32_t>();
-      cfg.height = (h > 0 && h <= 256) ? static_cast<uint16_t>(h) : cfg.height;
-    }
-    if (obj["serpentine"].is<bool>()) cfg.serpentine = obj["serpentine"].as<bool>();
-    if (obj["startBottom"].is<bool>()) cfg.startBottom = obj["startBottom"].as<bool>();
-    if (obj["flipX"].is<bool>()) cfg.flipX = obj["flipX"].as<bool>();
-    if (obj["orientationIndex"].is<unsigned long>() || obj["orientationIndex"].is<int>() || obj["orientationIndex"].is<double>()) {
-      uint32_t idx = obj["orientationIndex"].as<uint32_t>();
-      if (idx <= 3) cfg.orientation = static_cast<MatrixOrientation>(idx);
-    } else if (obj["orientationDegrees"].is<unsigned long>() || obj["orientationDegrees"].is<int>()) {
-      uint32_t deg = obj["orientationDegrees"].as<uint32_t>();
-      if (deg % 90 == 0) {
-        uint32_t idx = (deg / 90) % 4;
-        cfg.orientation = static_cast<MatrixOrientation>(idx);
-      }
-    }
-    if (obj["brightness"].is<unsigned long>() || obj["brightness"].is<int>() || obj["brightness"].is<double>()) {
-      uint32_t b = obj["brightness"].as<uint32_t>();
-      cfg.brightness = b <= 255 ? static_cast<uint8_t>(b) : cfg.brightness;
-    }
-    if (obj["maxBrightness"].is<unsigned long>() || obj["maxBrightness"].is<int>() || obj["maxBrightness"].is<double>()) {
-      uint32_t b = obj["maxBrightness"].as<uint32_t>();
-      cfg.maxBrightness = b <= 255 ? static_cast<uint8_t>(b) : cfg.maxBrightness;
-    }
-    if (obj["nightEnabled"].is<bool>()) cfg.nightEnabled = obj["nightEnabled"].as<bool>();
-    if (obj["nightStartMin"].is<unsigned long>() || obj["nightStartMin"].is<int>() || obj["nightStartMin"].is<double>()) {
-      uint32_t v = obj["nightStartMin"].as<uint32_t>();
-      cfg.nightStartMin = v <= 1440 ? static_cast<uint16_t>(v) : cfg.nightStartMin;
-    }
-    if (obj["nightEndMin"].is<unsigned long>() || obj["nightEndMin"].is<int>() || obj["nightEndMin"].is<double>()) {
-      uint32_t v = obj["nightEndMin"].as<uint32_t>();
-      cfg.nightEndMin = v <= 1440 ? static_cast<uint16_t>(v) : cfg.nightEndMin;
-    }
-    if (obj["nightBrightness"].is<unsigned long>() || obj["nightBrightness"].is<int>() || obj["nightBrightness"].is<double>()) {
-      uint32_t v = obj["nightBrightness"].as<uint32_t>();
-      cfg.nightBrightness = v <= 255 ? static_cast<uint8_t>(v) : cfg.nightBrightness;
-    }
-    if (obj["fps"].is<unsigned long>() || obj["fps"].is<int>() || obj["fps"].is<double>()) {
-      uint32_t f = obj["fps"].as<uint32_t>();
-      cfg.fps = (f >= 1 && f <= 200) ? static_cast<uint16_t>(f) : cfg.fps;
-    }
-    if (obj["sceneDwellMs"].is<unsigned long>() || obj["sceneDwellMs"].is<int>() || obj["sceneDwellMs"].is<double>()) {
-      uint32_t d = obj["sceneDwellMs"].as<uint32_t>();
-      cfg.sceneDwellMs = d <= 60000 ? static_cast<uint16_t>(d) : cfg.sceneDwellMs;
-    }
-    if (obj["transitionMs"].is<unsigned long>() || obj["transitionMs"].is<int>() || obj["transitionMs"].is<double>()) {
-      uint32_t t = obj["transitionMs"].as<uint32_t>();
-      cfg.transitionMs = t <= 5000 ? static_cast<uint16_t>(t) : cfg.transitionMs;
-    }
-
-    if (obj["sceneOrder"].is<JsonArray>()) {
-      JsonArray arr = obj["sceneOrder"].as<JsonArray>();
-      uint8_t i = 0;
-      for (JsonVariant v : arr) {
-        if (i >= 4) break;
-        uint8_t s = v.as<uint8_t>();
-        cfg.sceneOrder[i] = s % 4;
-        ++i;
-      }
-      if (i >= 1 && i <= 4) cfg.sceneCount = i;
-    } else if (obj["sceneCount"].is<unsigned long>() || obj["sceneCount"].is<int>()) {
-      uint32_t c = obj["sceneCount"].as<uint32_t>();
-      if (c >= 1 && c <= 4) cfg.sceneCount = static_cast<uint8_t>(c);
-    }
-
-    if (obj["clockUse12h"].is<bool>()) cfg.clockUse12h = obj["clockUse12h"].as<bool>();
-    if (obj["clockShowSeconds"].is<bool>()) cfg.clockShowSeconds = obj["clockShowSeconds"].as<bool>();
-    if (obj["clockShowMillis"].is<bool>()) cfg.clockShowMillis = obj["clockShowMillis"].as<bool>();
-
-    if (obj["colorMode"].is<unsigned long>() || obj["colorMode"].is<int>()) {
-      uint32_t m = obj["colorMode"].as<uint32_t>();
-      if (m <= 2) cfg.colorMode = static_cast<MatrixColorMode>(m);
-    }
-    if (obj["color1"].is<JsonArray>()) {
-      JsonArray c1 = obj["color1"].as<JsonArray>();
-      if (c1.size() >= 3) {
-        cfg.color1R = static_cast<uint8_t>(std::min<uint32_t>(255, c1[0].as<uint32_t>()));
-        cfg.color1G = static_cast<uint8_t>(std::min<uint32_t>(255, c1[1].as<uint32_t>()));
-        cfg.color1B = static_cast<uint8_t>(std::min<uint32_t>(255, c1[2].as<uint32_t>()));
-      }
-    }
-    if (obj["color2"].is<JsonArray>()) {
-      JsonArray c2 = obj["color2"].as<JsonArray>();
-      if (c2.size() >= 3) {
-        cfg.color2R = static_cast<uint8_t>(std::min<uint32_t>(255, c2[0].as<uint32_t>()));
-        cfg.color2G = static_cast<uint8_t>(std::min<uint32_t>(255, c2[1].as<uint32_t>()));
-        cfg.color2B = static_cast<uint8_t>(std::min<uint32_t>(255, c2[2].as<uint32_t>()));
-      }
+    applyMatrixConfigJson(json.as<JsonObjectConst>(), cfg);
+    // Applied by the render task before its next frame.
+    if (!matrixService.saveConfig(cfg)) {
+      request->send(503, "application/json", "{\"error\":\"busy\"}");
+      return;
     }
-
-    matrixService.saveConfig(cfg);
     request->send(200, "application/json", "{\"status\":\"saved\"}");
-  });
+  }));
   matrixSaveHandler->setMethod(HTTP_POST);
   matrixSaveHandler->setMaxContentLength(4096);
   server.addHandler(matrixSaveHandler);
 
-  auto *matrixActionHandler = new AsyncCallbackJsonWebHandler("/api/matrix/action", [&matrixService](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *matrixActionHandler = new AsyncCallbackJsonWebHandler("/api/matrix/action", timed("POST /api/matrix/action", [&matrixService](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!json.is<JsonObject>()) {
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
@@ -324,117 +811,43 @@ void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherServic
       request->send(400, "application/json", "{\"error\":\"missing action\"}");
       return;
     }
-    matrixService.performAction(String(action));
+    if (!matrixService.performAction(String(action))) {
+      request->send(503, "application/json", "{\"error\":\"busy\"}");
+      return;
+    }
     request->send(200, "application/json", "{\"status\":\"ok\"}");
-  });
+  }));
   matrixActionHandler->setMethod(HTTP_POST);
   matrixActionHandler->setMaxContentLength(1024);
   server.addHandler(matrixActionHandler);
 
-  server.on("/api/outdoor/forecast", HTTP_GET, [&outdoorService](AsyncWebServerRequest *request) {
-    bool force = request->hasParam("force");
-    // Avoid blocking the HTTP handler; rely on background updates/push cache.
-    (void)force;
-    sendJson(request, [&outdoorService](JsonVariant json) {
-      JsonObject root = json.to<JsonObject>();
-      OutdoorConfig cfg = outdoorService.currentConfig();
-      root["enabled"] = cfg.enabled;
-      root["configured"] = outdoorService.hasConfig();
-      root["lastFetchMs"] = outdoorService.lastFetchMs();
-      root["lastAttemptMs"] = outdoorService.lastAttemptMs();
-      root["lastStatusCode"] = outdoorService.lastStatusCode();
-      root["lastError"] = outdoorService.lastError();
-
-      JsonObject cfgObj = root["config"].to<JsonObject>();
-      cfgObj["lat"] = cfg.lat;
-      cfgObj["lon"] = cfg.lon;
-      cfgObj["city"] = cfg.city;
-      cfgObj["country"] = cfg.country;
-
-      OutdoorSnapshot cur = outdoorService.current();
-      JsonObject curObj = root["current"].to<JsonObject>();
-      curObj["temperatureC"] = cur.temperatureC;
-      curObj["humidity"] = cur.humidity;
-      curObj["pressureHpa"] = cur.pressureHpa;
-      curObj["pressureMmHg"] = cur.pressureMmHg;
-      curObj["altitudeM"] = cur.altitudeM;
-      curObj["windSpeed"] = cur.windSpeed;
-
-      JsonObject outlook = root["outlook"].to<JsonObject>();
-      for (uint16_t h : OUTLOOK_HORIZONS) {
-        OutdoorSnapshot snap = outdoorService.forecastFor(h);
-        JsonObject slot = outlook[String("h") + String(h)].to<JsonObject>();
-        slot["tempC"] = snap.temperatureC;
-        slot["humidity"] = snap.humidity;
-        slot["pressureHpa"] = snap.pressureHpa;
-        slot["pressureMmHg"] = snap.pressureMmHg;
-        slot["windSpeed"] = snap.windSpeed;
-      }
+  server.on("/api/outdoor/forecast", HTTP_GET, timed("GET /api/outdoor/forecast", [&outdoorService](AsyncWebServerRequest *request) {
+    // Never waits for the network: ?force only wakes the fetch task, and
+    // this reply carries whatever is cached now.
+    outdoorService.ensureFresh(request->hasParam("force"));
+    // Streamed section by section; one outlook slot per record.
+    sendJsonStream(request, outdoorForecastRecords(outdoorService), [&outdoorService](MsgPackWriter &w) {
+      packOutdoorForecast(w, outdoorService);
     });
-  });
-
-  auto *outdoorCacheHandler = new AsyncCallbackJsonWebHandler("/api/outdoor/cache", [&outdoorService](AsyncWebServerRequest *request, JsonVariant &json) {
-    if (!json.is<JsonObject>()) {
-      request->send(400, "application/json", "{\"error\":\"invalid json\"}");
-      return;
-    }
-
-    JsonObject obj = json.as<JsonObject>();
-    auto parseSnapshot = [](JsonObject snapObj) {
-      OutdoorSnapshot snap;
-      if (snapObj.isNull()) return snap;
-
-      auto setIfNumber = [&snapObj](const char *key, float &target) {
-        JsonVariant v = snapObj[key];
-        if (v.is<float>() || v.is<double>() || v.is<long>() || v.is<int>()) {
-          target = v.as<float>();
-        }
-      };
-
-      setIfNumber("temperatureC", snap.temperatureC);
-      setIfNumber("tempC", snap.temperatureC);
-      setIfNumber("humidity", snap.humidity);
-      setIfNumber("pressureHpa", snap.pressureHpa);
-      setIfNumber("pressureMmHg", snap.pressureMmHg);
-      setIfNumber("altitudeM", snap.altitudeM);
-      setIfNumber("windSpeed", snap.windSpeed);
-      if (isnan(snap.pressureMmHg) && !isnan(snap.pressureHpa)) {
-        snap.pressureMmHg = snap.pressureHpa / 1.33322f;
-      }
-      return snap;
-    };
-
-    OutdoorSnapshot current = parseSnapshot(obj["current"].as<JsonObject>());
-
-    std::map<uint16_t, OutdoorSnapshot> future;
-    JsonObject outlookObj = obj["outlook"].as<JsonObject>();
-    if (!outlookObj.isNull()) {
-      for (uint16_t h : OUTLOOK_HORIZONS) {
-        String key = String("h") + String(h);
-        JsonVariant slot = outlookObj[key];
-        if (!slot.isNull() && slot.is<JsonObject>()) {
-          future[h] = parseSnapshot(slot.as<JsonObject>());
-          continue;
-        }
-        slot = outlookObj[String(h)];
-        if (!slot.isNull() && slot.is<JsonObject>()) {
-          future[h] = parseSnapshot(slot.as<JsonObject>());
-        }
-      }
-    }
-
-    unsigned long fetchedAtMs = millis();
-    if (obj["fetchedAtMs"].is<unsigned long>()) {
-      fetchedAtMs = obj["fetchedAtMs"].as<unsigned long>();
-    } else if (obj["fetchedAtMs"].is<long>()) {
-      fetchedAtMs = static_cast<unsigned long>(obj["fetchedAtMs"].as<long>());
-    } else if (obj["fetchedAtMs"].is<double>()) {
-      fetchedAtMs = static_cast<unsigned long>(obj["fetchedAtMs"].as<double>());
-    }
-
-    outdoorService.updateCache(current, future, fetchedAtMs);
-    request->send(200, "application/json", "{\"status\":\"cached\"}");
-  });
-  outdoorCacheHandler->setMethod(HTTP_POST);
-  server.addHandler(outdoorCacheHandler);
+  }));
+
+  // Handler timings of every route wrapped with timed(); DELETE clears them.
+  server.on("/api/debug/perf", HTTP_GET, timed("GET /api/debug/perf", [](AsyncWebServerRequest *request) {
+    auto state = std::make_shared<PerfReportState>();
+    sendJsonStream(request, [state](StreamRecord &out) {
+      return state->next(out);
+    }, PerfReportState::pack);
+  }));
+
+  server.on("/api/debug/perf", HTTP_DELETE, timed("DELETE /api/debug/perf", [](AsyncWebServerRequest *request) {
+    perfStats.reset();
+    request->send(204);
+  }));
+
+  server.on("/api/outdoor/cache", HTTP_POST, timed("POST /api/outdoor/cache", [&outdoorService](AsyncWebServerRequest *request) {
+    handleOutdoorCacheUpload(request, outdoorService, false);
+  }), nullptr, handleOutdoorCacheBody);
+  server.on("/api/outdoor/cache", HTTP_PATCH, timed("PATCH /api/outdoor/cache", [&outdoorService](AsyncWebServerRequest *request) {
+    handleOutdoorCacheUpload(request, outdoorService, true);
+  }), nullptr, handleOutdoorCacheBody);
 }
@@ -3,8 +3,11 @@
 #include <ESPAsyncWebServer.h>
 
 class WeatherService;
+class WeatherHistory;
+class TelemetryFrameCache;
+class LiveEventStream;
 class OutdoorService;
 class MatrixDisplayService;
 
 // Registers weather API endpoints and service static assets.
-void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherService, OutdoorService &outdoorService, MatrixDisplayService &matrixService);
+void registerServiceRoutes(AsyncWebServer &server, WeatherService &weatherService, WeatherHistory &weatherHistory, TelemetryFrameCache &frameCache, LiveEventStream &events, OutdoorService &outdoorService, MatrixDisplayService &matrixService);
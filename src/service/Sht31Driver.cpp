@@ -0,0 +1,72 @@
+#include "Sht31Driver.h"
+
+namespace {
+constexpr uint16_t CMD_FETCH_DATA = 0xE000;
+constexpr uint16_t CMD_BREAK = 0x3093;
+constexpr uint16_t CMD_ART = 0x2B32;
+
+// Periodic start commands indexed by [rate][repeatability low/medium/high].
+constexpr uint16_t PERIODIC_CMDS[5][3] = {
+  {0x202F, 0x2024, 0x2032}, // 0.5 mps
+  {0x212D, 0x2126, 0x2130}, // 1 mps
+  {0x222B, 0x2220, 0x2236}, // 2 mps
+  {0x2329, 0x2322, 0x2334}, // 4 mps
+  {0x272A, 0x2721, 0x2737}, // 10 mps
+};
+}
+
+bool Sht31Driver::begin(TwoWire *wire, uint8_t address) {
+  wireRef = wire;
+  addr = address;
+  return wireRef != nullptr;
+}
+
+bool Sht31Driver::startPeriodic(Rate rate, Repeatability repeatability) {
+  // A running periodic mode must be stopped before switching schedules.
+  stopPeriodic();
+  if (rate == Rate::Art) return sendCommand(CMD_ART);
+  return sendCommand(PERIODIC_CMDS[static_cast<uint8_t>(rate)][static_cast<uint8_t>(repeatability)]);
+}
+
+bool Sht31Driver::stopPeriodic() {
+  bool ok = sendCommand(CMD_BREAK);
+  delay(1); // t_break
+  return ok;
+}
+
+Sht31Driver::FetchResult Sht31Driver::fetch(float &temperatureC, float &humidity) {
+  if (!sendCommand(CMD_FETCH_DATA)) return FetchResult::BusError;
+  uint8_t raw[6] = {};
+  if (wireRef->requestFrom(addr, static_cast<uint8_t>(sizeof(raw))) != sizeof(raw)) {
+    return FetchResult::NoData;
+  }
+  for (uint8_t &b : raw) {
+    b = static_cast<uint8_t>(wireRef->read());
+  }
+  if (crc8(raw, 2) != raw[2] || crc8(raw + 3, 2) != raw[5]) return FetchResult::CrcError;
+
+  uint16_t rawTemp = static_cast<uint16_t>((raw[0] << 8) | raw[1]);
+  uint16_t rawHum = static_cast<uint16_t>((raw[3] << 8) | raw[4]);
+  temperatureC = -45.0f + 175.0f * rawTemp / 65535.0f;
+  humidity = 100.0f * rawHum / 65535.0f;
+  return FetchResult::Ok;
+}
+
+uint8_t Sht31Driver::crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+bool Sht31Driver::sendCommand(uint16_t cmd) {
+  if (!wireRef) return false;
+  wireRef->beginTransmission(addr);
+  wireRef->write(static_cast<uint8_t>(cmd >> 8));
+  wireRef->write(static_cast<uint8_t>(cmd & 0xFF));
+  return wireRef->endTransmission() == 0;
+}
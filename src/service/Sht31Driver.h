@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// SHT31 periodic acquisition: the sensor measures on its own schedule and a
+// single FETCH DATA returns temperature and humidity together, CRC-checked,
+// without clock stretching. Detection still goes through Adafruit_SHT31.
+class Sht31Driver {
+public:
+  enum class Repeatability : uint8_t {
+    Low,
+    Medium,
+    High,
+  };
+
+  enum class Rate : uint8_t {
+    Mps0_5,
+    Mps1,
+    Mps2,
+    Mps4,
+    Mps10,
+    Art, // Accelerated response time, 4 Hz
+  };
+
+  enum class FetchResult : uint8_t {
+    Ok,
+    NoData,   // Sensor NACKed the read: no new measurement since the last fetch
+    BusError,
+    CrcError,
+  };
+
+  bool begin(TwoWire *wire, uint8_t address);
+  bool startPeriodic(Rate rate, Repeatability repeatability);
+  bool stopPeriodic();
+  FetchResult fetch(float &temperatureC, float &humidity);
+
+  static uint8_t crc8(const uint8_t *data, size_t len);
+
+private:
+  bool sendCommand(uint16_t cmd);
+
+  TwoWire *wireRef = nullptr;
+  uint8_t addr = 0;
+};
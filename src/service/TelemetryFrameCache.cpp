@@ -0,0 +1,159 @@
+#include "TelemetryFrameCache.h"
+
+#include "WeatherService.h"
+#include "common/JsonWriter.h"
+#include "common/MsgPackWriter.h"
+
+namespace {
+// The metrics body; start and end bracket the "metrics" object.
+template <typename Writer>
+void writeFrame(Writer &w, const WeatherService &weather, const WeatherReading &reading, bool ok, float seaLevel,
+                size_t &start, size_t &end) {
+  w.beginObject();
+  w.field("status", ok ? "ok" : "stale");
+  w.field("collectedAtMs", reading.collectedAtMs);
+  w.field("sequence", reading.sequence);
+  w.field("seaLevelPressureHpa", seaLevel, 2);
+  w.beginObject("sensors");
+  w.beginObject("sht31").field("present", weather.hasSHT()).field("ok", reading.shtOk).endObject();
+  w.beginObject("bmp580").field("present", weather.hasBMP()).field("ok", reading.bmpOk).endObject();
+  w.endObject();
+
+  w.key("metrics");
+  start = w.size();
+  w.beginObject();
+  if (!isnan(reading.temperatureC)) {
+    w.field("temperatureC", reading.temperatureC, 2);
+    w.field("temperatureF", reading.temperatureC * 9.0f / 5.0f + 32.0f, 2);
+  }
+  w.fieldIfFinite("humidity", reading.humidity, 2);
+  if (!isnan(reading.dewPointC)) {
+    w.field("dewPointC", reading.dewPointC, 2);
+    w.field("dewPointF", reading.dewPointC * 9.0f / 5.0f + 32.0f, 2);
+  }
+  if (!isnan(reading.pressurePa)) {
+    w.field("pressurePa", reading.pressurePa, 1);
+    w.field("pressureHpa", reading.pressurePa / 100.0f, 2);
+    w.field("pressureMmHg", reading.pressurePa / 133.322f, 2);
+  }
+  if (!isnan(reading.altitudeM)) {
+    w.field("altitudeM", reading.altitudeM, 1);
+    w.field("altitudeFt", reading.altitudeM * 3.28084f, 1);
+  }
+  if (!isnan(reading.bmpTemperatureC)) {
+    w.field("bmpTemperatureC", reading.bmpTemperatureC, 2);
+    w.field("pressureTemperatureC", reading.bmpTemperatureC, 2);
+  }
+  w.fieldIfFinite("seaLevelPressureHpa", seaLevel, 2);
+  w.field("sampleMs", reading.collectedAtMs);
+  w.endObject();
+  end = w.size();
+  w.endObject();
+}
+}
+
+bool TelemetryFrameCache::begin(WeatherService *weather) {
+  weatherRef = weather;
+  if (!mutex) mutex = xSemaphoreCreateMutex();
+  // Keeps ETags from a previous boot from matching after the sequence restarts.
+  bootId = esp_random();
+  return mutex != nullptr;
+}
+
+uint32_t TelemetryFrameCache::refresh() {
+  if (!mutex) return 0;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  refreshLocked();
+  const uint32_t gen = generation;
+  xSemaphoreGive(mutex);
+  return gen;
+}
+
+String TelemetryFrameCache::etag() {
+  if (!mutex) return String();
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  refreshLocked();
+  String tag = etagLocked();
+  xSemaphoreGive(mutex);
+  return tag;
+}
+
+bool TelemetryFrameCache::metricsBody(String &body, String &etagOut) {
+  if (!mutex) return false;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  refreshLocked();
+  body = String();
+  body.reserve(frameLen);
+  body.concat(frame, frameLen);
+  etagOut = etagLocked();
+  xSemaphoreGive(mutex);
+  return frameLen > 0;
+}
+
+size_t TelemetryFrameCache::copyIndoor(char *dst, size_t capacity) {
+  if (!mutex) return 0;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  refreshLocked();
+  const size_t n = indoorLen <= capacity ? indoorLen : 0;
+  if (n) memcpy(dst, frame + indoorStart, n);
+  xSemaphoreGive(mutex);
+  return n;
+}
+
+size_t TelemetryFrameCache::copyPacked(uint8_t *dst, size_t capacity) {
+  if (!mutex) return 0;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  refreshLocked();
+  const size_t n = packedLen <= capacity ? packedLen : 0;
+  if (n) memcpy(dst, packed, n);
+  xSemaphoreGive(mutex);
+  return n;
+}
+
+void TelemetryFrameCache::refreshLocked() {
+  if (!weatherRef) return;
+  const uint32_t seq = weatherRef->sequence();
+  const float seaLevel = weatherRef->seaLevelPressure();
+  if (built && seq == builtSequence && seaLevel == builtSeaLevel) return;
+  build();
+}
+
+void TelemetryFrameCache::build() {
+  WeatherReading reading;
+  const bool ok = weatherRef->read(reading);
+  const float seaLevel = weatherRef->seaLevelPressure();
+
+  // The measurement object is also handed out on its own, so remember where it sits.
+  size_t start = 0;
+  size_t end = 0;
+  JsonWriter w(frame, CAPACITY);
+  writeFrame(w, *weatherRef, reading, ok, seaLevel, start, end);
+
+  if (!w.ok()) {
+    // Cannot happen with the fixed field set; keep the frame valid regardless.
+    frameLen = snprintf(frame, CAPACITY, "{\"status\":\"error\",\"metrics\":{}}");
+    indoorStart = frameLen - 3;
+    indoorLen = 2;
+  } else {
+    frameLen = w.size();
+    indoorStart = start;
+    indoorLen = end - start;
+  }
+
+  size_t packedStart = 0;
+  size_t packedEnd = 0;
+  MsgPackWriter p(packed, CAPACITY);
+  writeFrame(p, *weatherRef, reading, ok, seaLevel, packedStart, packedEnd);
+  packedLen = p.ok() ? p.size() : 0;
+
+  built = true;
+  builtSequence = reading.sequence;
+  builtSeaLevel = seaLevel;
+  ++generation;
+}
+
+String TelemetryFrameCache::etagLocked() const {
+  char tag[24];
+  snprintf(tag, sizeof(tag), "\"%08lx-%lx\"", static_cast<unsigned long>(bootId), static_cast<unsigned long>(generation));
+  return String(tag);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+class WeatherService;
+
+// Serializes each new WeatherService sample once and hands out copies of the
+// result. The buffer holds the /api/weather/metrics body; its "metrics"
+// object doubles as the "indoor" object of the MQTT telemetry payload. The
+// same body is kept as MessagePack for binary clients.
+// Entries are keyed by snapshot sequence (and sea-level pressure, which is
+// reported alongside); the ETag changes exactly when the body does.
+class TelemetryFrameCache {
+public:
+  static constexpr size_t CAPACITY = 768;
+
+  bool begin(WeatherService *weather);
+
+  // Rebuilds if a new sample is available; returns the frame generation.
+  uint32_t refresh();
+  // Current ETag (quoted), rebuilding first if a new sample is available.
+  String etag();
+  // Copies the metrics body and the ETag it was built under.
+  bool metricsBody(String &body, String &etagOut);
+  // Copies just the measurement object into dst for embedding in other
+  // payloads; returns its length, or 0 if it does not fit.
+  size_t copyIndoor(char *dst, size_t capacity);
+  // Copies the MessagePack metrics body into dst; returns its length, or 0
+  // if it does not fit.
+  size_t copyPacked(uint8_t *dst, size_t capacity);
+
+  uint32_t rebuilds() const { return generation; }
+
+private:
+  void refreshLocked();
+  void build();
+  String etagLocked() const;
+
+  WeatherService *weatherRef = nullptr;
+  SemaphoreHandle_t mutex = nullptr;
+
+  char frame[CAPACITY] = {};
+  size_t frameLen = 0;
+  size_t indoorStart = 0;
+  size_t indoorLen = 0;
+  uint8_t packed[CAPACITY] = {};
+  size_t packedLen = 0;
+
+  bool built = false;
+  uint32_t builtSequence = 0;
+  float builtSeaLevel = NAN;
+  uint32_t generation = 0;
+  uint32_t bootId = 0;
+};
@@ -0,0 +1,356 @@
+#include "WeatherHistory.h"
+
+#include <time.h>
+
+namespace {
+constexpr uint32_t MINUTE_S = 60;
+constexpr uint32_t QUARTER_S = 15 * 60;
+constexpr time_t CLOCK_VALID_AFTER = 1104537600; // 2005-01-01, same cut-off as the matrix clock
+
+uint32_t bucketStart(uint32_t epoch, uint32_t width) { return epoch - (epoch % width); }
+}
+
+bool WeatherHistory::begin(WeatherService *weather) {
+  weatherRef = weather;
+  if (!mutex) mutex = xSemaphoreCreateMutex();
+  if (!mutex) return false;
+
+#if defined(HISTORY_USE_PSRAM)
+  const bool preferPsram = psramFound();
+#else
+  const bool preferPsram = false;
+#endif
+  bool ok = raw.allocate(HISTORY_RAW_BLOCKS, preferPsram);
+  ok = minute.allocate(HISTORY_MINUTE_BLOCKS, preferPsram) && ok;
+  ok = quarter.allocate(HISTORY_QUARTER_CAPACITY, preferPsram) && ok;
+  Serial.printf("History: %u/%u blocks + %u points, %u bytes in %s%s\n",
+                HISTORY_RAW_BLOCKS, HISTORY_MINUTE_BLOCKS, static_cast<unsigned>(quarter.capacity()),
+                static_cast<unsigned>(raw.bytes() + minute.bytes() + quarter.bytes()), raw.psram() ? "PSRAM" : "internal RAM",
+                ok ? "" : " (allocation failed)");
+  return ok;
+}
+
+bool HistoryBlockRing::allocate(size_t blocks, bool preferPsram) {
+  const size_t dataBytes = blocks * HISTORY_BLOCK_BYTES;
+  void *mem = nullptr;
+  inPsram = false;
+  if (preferPsram) {
+    mem = heap_caps_malloc(dataBytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    inPsram = mem != nullptr;
+  }
+  if (!mem) mem = heap_caps_malloc(dataBytes, MALLOC_CAP_8BIT);
+  // Block metadata is small and searched on every query; keep it in internal RAM.
+  meta = static_cast<BlockMeta *>(heap_caps_malloc(blocks * sizeof(BlockMeta), MALLOC_CAP_8BIT));
+  data = static_cast<uint8_t *>(mem);
+  blockCount = data && meta ? blocks : 0;
+  head = 0;
+  used = 0;
+  points = 0;
+  return blockCount != 0;
+}
+
+void HistoryBlockRing::startBlock() {
+  if (used == blockCount) {
+    points -= meta[head].count;
+    head = (head + 1) % blockCount;
+    --used;
+  }
+  const size_t idx = (head + used) % blockCount;
+  ++used;
+  meta[idx] = BlockMeta{};
+  encoder.reset(data + idx * HISTORY_BLOCK_BYTES, HISTORY_BLOCK_BYTES);
+}
+
+void HistoryBlockRing::push(const HistoryPoint &point) {
+  if (!blockCount) return;
+  uint16_t ch[CHANNELS];
+  HistoryBlockRing::toChannels(point, ch);
+  if (!used) startBlock();
+  if (!encoder.append(point.t, ch)) {
+    startBlock();
+    encoder.append(point.t, ch);
+  }
+  BlockMeta &m = meta[(head + used - 1) % blockCount];
+  if (!m.count) m.firstT = point.t;
+  m.lastT = point.t;
+  m.count = static_cast<uint16_t>(encoder.count());
+  m.bytes = static_cast<uint16_t>(encoder.bytes());
+  ++points;
+}
+
+size_t HistoryBlockRing::usedBytes() const {
+  size_t total = 0;
+  for (size_t b = 0; b < used; ++b) total += metaAt(b).bytes;
+  return total;
+}
+
+size_t HistoryBlockRing::capacity() const {
+  const size_t usedB = usedBytes();
+  if (!usedB) return 0;
+  return static_cast<size_t>(static_cast<uint64_t>(points) * blockCount * HISTORY_BLOCK_BYTES / usedB);
+}
+
+bool WeatherHistory::clockValid(time_t now) {
+  return now > CLOCK_VALID_AFTER;
+}
+
+void WeatherHistory::loop() {
+  if (!weatherRef || !mutex) return;
+  const uint32_t seq = weatherRef->sequence();
+  if (seq == lastSequence) return;
+
+  WeatherReading reading;
+  bool ok = weatherRef->read(reading);
+  lastSequence = reading.sequence;
+  // Failed samples republish the last good values; do not record them twice.
+  if (!ok) return;
+  time_t now = time(nullptr);
+  if (!clockValid(now)) return;
+  add(reading, static_cast<uint32_t>(now));
+}
+
+uint16_t WeatherHistory::pack(HistoryMetric metric, float value) {
+  if (isnan(value)) return HISTORY_MISSING;
+  float scaled;
+  switch (metric) {
+    case HistoryMetric::Temperature:
+      scaled = (value + 100.0f) * 100.0f;
+      break;
+    case HistoryMetric::Humidity:
+      scaled = value * 100.0f;
+      break;
+    case HistoryMetric::Pressure:
+    default:
+      scaled = value / 2.0f;
+      break;
+  }
+  if (scaled < 0.0f) scaled = 0.0f;
+  if (scaled > HISTORY_MISSING - 1) scaled = HISTORY_MISSING - 1;
+  return static_cast<uint16_t>(lroundf(scaled));
+}
+
+float WeatherHistory::unpack(HistoryMetric metric, uint16_t packed) {
+  if (packed == HISTORY_MISSING) return NAN;
+  switch (metric) {
+    case HistoryMetric::Temperature:
+      return packed / 100.0f - 100.0f;
+    case HistoryMetric::Humidity:
+      return packed / 100.0f;
+    case HistoryMetric::Pressure:
+    default:
+      return packed * 2.0f;
+  }
+}
+
+void WeatherHistory::Accumulator::reset(uint32_t start) {
+  *this = Accumulator{};
+  bucket = start;
+}
+
+void WeatherHistory::Accumulator::add(const uint16_t *v) {
+  for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+    if (v[m] == HISTORY_MISSING) continue;
+    sum[m] += v[m];
+    ++count[m];
+    if (v[m] < min[m]) min[m] = v[m];
+    if (v[m] > max[m]) max[m] = v[m];
+  }
+  ++n;
+}
+
+uint16_t WeatherHistory::Accumulator::mean(size_t metric) const {
+  if (!count[metric]) return HISTORY_MISSING;
+  return static_cast<uint16_t>((sum[metric] + count[metric] / 2) / count[metric]);
+}
+
+void WeatherHistory::flushMinute() {
+  if (!minuteAcc.n) return;
+  HistoryPoint p;
+  p.t = minuteAcc.bucket;
+  for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) p.v[m] = minuteAcc.mean(m);
+  p.n = minuteAcc.n;
+  minute.push(p);
+  if (minuteSink) minuteSink(p);
+}
+
+void WeatherHistory::flushQuarter() {
+  if (!quarterAcc.n) return;
+  HistoryAggregate a;
+  a.t = quarterAcc.bucket;
+  for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+    a.mean[m] = quarterAcc.mean(m);
+    a.min[m] = quarterAcc.count[m] ? quarterAcc.min[m] : HISTORY_MISSING;
+    a.max[m] = quarterAcc.count[m] ? quarterAcc.max[m] : HISTORY_MISSING;
+  }
+  a.n = quarterAcc.n;
+  quarter.push(a);
+}
+
+void WeatherHistory::add(const WeatherReading &reading, uint32_t epoch) {
+  if (!mutex || epoch < lastEpoch) return;
+
+  HistoryPoint p;
+  p.t = epoch;
+  p.n = 1;
+  if (reading.shtOk) {
+    p.v[static_cast<size_t>(HistoryMetric::Temperature)] = pack(HistoryMetric::Temperature, reading.temperatureC);
+    p.v[static_cast<size_t>(HistoryMetric::Humidity)] = pack(HistoryMetric::Humidity, reading.humidity);
+  }
+  if (reading.bmpOk) {
+    p.v[static_cast<size_t>(HistoryMetric::Pressure)] = pack(HistoryMetric::Pressure, reading.pressurePa);
+  }
+
+  lock();
+  lastEpoch = epoch;
+  raw.push(p);
+
+  const uint32_t minuteBucket = bucketStart(epoch, MINUTE_S);
+  if (minuteAcc.n && minuteAcc.bucket != minuteBucket) flushMinute();
+  if (!minuteAcc.n) minuteAcc.reset(minuteBucket);
+  minuteAcc.add(p.v);
+
+  const uint32_t quarterBucket = bucketStart(epoch, QUARTER_S);
+  if (quarterAcc.n && quarterAcc.bucket != quarterBucket) flushQuarter();
+  if (!quarterAcc.n) quarterAcc.reset(quarterBucket);
+  quarterAcc.add(p.v);
+  unlock();
+}
+
+void WeatherHistory::restoreMinute(const HistoryPoint &point) {
+  if (!mutex || point.t < lastEpoch) return;
+  lock();
+  lastEpoch = point.t;
+  minute.push(point);
+  const uint32_t quarterBucket = bucketStart(point.t, QUARTER_S);
+  if (quarterAcc.n && quarterAcc.bucket != quarterBucket) flushQuarter();
+  if (!quarterAcc.n) quarterAcc.reset(quarterBucket);
+  quarterAcc.add(point.v);
+  unlock();
+}
+
+size_t WeatherHistory::visit(HistoryTier tier, HistoryMetric metric, uint32_t from, uint32_t to, const Visitor &fn) const {
+  const size_t m = static_cast<size_t>(metric);
+  return visitRows(tier, from, to, [m, &fn](const HistoryRow &row) {
+    HistorySample s;
+    s.t = row.t;
+    s.mean = row.mean[m];
+    s.min = row.min[m];
+    s.max = row.max[m];
+    return fn(s);
+  });
+}
+
+size_t WeatherHistory::visitRows(HistoryTier tier, uint32_t from, uint32_t to, const RowVisitor &fn) const {
+  if (!mutex) return 0;
+  size_t visited = 0;
+  lock();
+  if (tier == HistoryTier::Quarter) {
+    // Timestamps are monotonic within a ring, so binary search the first point >= from.
+    size_t lo = 0;
+    size_t hi = quarter.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (quarter.at(mid).t < from) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    for (size_t i = lo; i < quarter.size(); ++i) {
+      const HistoryAggregate &a = quarter.at(i);
+      if (a.t > to) break;
+      HistoryRow row;
+      row.t = a.t;
+      row.n = a.n;
+      for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+        const HistoryMetric metric = static_cast<HistoryMetric>(m);
+        row.mean[m] = unpack(metric, a.mean[m]);
+        row.min[m] = unpack(metric, a.min[m]);
+        row.max[m] = unpack(metric, a.max[m]);
+      }
+      ++visited;
+      if (!fn(row)) break;
+    }
+  } else {
+    const HistoryBlockRing &ring = tier == HistoryTier::Raw ? raw : minute;
+    ring.forEachFrom(from, [&](const HistoryPoint &p) {
+      if (p.t > to) return false;
+      HistoryRow row;
+      row.t = p.t;
+      row.n = p.n;
+      for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) {
+        row.mean[m] = unpack(static_cast<HistoryMetric>(m), p.v[m]);
+        row.min[m] = row.mean[m];
+        row.max[m] = row.mean[m];
+      }
+      ++visited;
+      return fn(row);
+    });
+  }
+  unlock();
+  return visited;
+}
+
+HistoryTier WeatherHistory::tierFor(uint32_t from, uint32_t to, size_t points) const {
+  static const HistoryTier COARSE_TO_FINE[HISTORY_TIER_COUNT] = {HistoryTier::Quarter, HistoryTier::Minute, HistoryTier::Raw};
+  static const uint32_t PERIOD_S[HISTORY_TIER_COUNT] = {QUARTER_S, MINUTE_S, 0};
+  HistoryTierStats st[HISTORY_TIER_COUNT];
+  for (size_t i = 0; i < HISTORY_TIER_COUNT; ++i) st[i] = stats(COARSE_TO_FINE[i]);
+
+  // Coarsest tier whose stored part of the range still has enough points.
+  for (size_t i = 0; i + 1 < HISTORY_TIER_COUNT; ++i) {
+    if (!st[i].used) continue;
+    const uint32_t start = st[i].oldest > from ? st[i].oldest : from;
+    if (to > start && (to - start) / PERIOD_S[i] >= points) return COARSE_TO_FINE[i];
+  }
+  // Otherwise the finest tier that reaches back to from, else the one reaching furthest.
+  size_t best = HISTORY_TIER_COUNT;
+  for (size_t i = HISTORY_TIER_COUNT; i-- > 0;) {
+    if (!st[i].used) continue;
+    if (st[i].oldest <= from) return COARSE_TO_FINE[i];
+    if (best == HISTORY_TIER_COUNT || st[i].oldest < st[best].oldest) best = i;
+  }
+  return best == HISTORY_TIER_COUNT ? HistoryTier::Raw : COARSE_TO_FINE[best];
+}
+
+HistoryTierStats WeatherHistory::stats(HistoryTier tier) const {
+  HistoryTierStats st;
+  if (!mutex) return st;
+  lock();
+  auto fillBlocks = [&st](const HistoryBlockRing &ring) {
+    st.capacity = ring.capacity();
+    st.used = ring.size();
+    st.bytes = ring.bytes();
+    st.usedBytes = ring.usedBytes();
+    st.oldest = ring.oldest();
+    st.newest = ring.newest();
+  };
+  switch (tier) {
+    case HistoryTier::Raw:
+      fillBlocks(raw);
+      break;
+    case HistoryTier::Minute:
+      fillBlocks(minute);
+      break;
+    case HistoryTier::Quarter:
+      st.capacity = quarter.capacity();
+      st.used = quarter.size();
+      st.bytes = quarter.bytes();
+      st.usedBytes = quarter.size() * sizeof(HistoryAggregate);
+      if (quarter.size()) {
+        st.oldest = quarter.at(0).t;
+        st.newest = quarter.back().t;
+      }
+      break;
+  }
+  unlock();
+  return st;
+}
+
+void WeatherHistory::lock() const {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void WeatherHistory::unlock() const {
+  xSemaphoreGive(mutex);
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <functional>
+
+#include "WeatherService.h"
+#include "../common/TimeSeriesCodec.h"
+
+class HistoryLog;
+
+// Tier sizes are fixed at build time so memory use is predictable. Raw and
+// 1-minute tiers are rings of compressed blocks (TimeSeriesCodec, typically
+// 2-4 bytes per point instead of 12); the 15-minute tier stays unpacked.
+// Envs with PSRAM define HISTORY_USE_PSRAM and get deeper tiers.
+#ifndef HISTORY_BLOCK_BYTES
+#define HISTORY_BLOCK_BYTES 256
+#endif
+#if defined(HISTORY_USE_PSRAM)
+#ifndef HISTORY_RAW_BLOCKS
+#define HISTORY_RAW_BLOCKS 384         // 96 KB, ~1 day at the 2 s sample rate
+#endif
+#ifndef HISTORY_MINUTE_BLOCKS
+#define HISTORY_MINUTE_BLOCKS 136      // 34 KB, ~1 week
+#endif
+#ifndef HISTORY_QUARTER_CAPACITY
+#define HISTORY_QUARTER_CAPACITY 2880  // 30 days
+#endif
+#else
+#ifndef HISTORY_RAW_BLOCKS
+#define HISTORY_RAW_BLOCKS 48          // 12 KB, ~3 h at the 2 s sample rate
+#endif
+#ifndef HISTORY_MINUTE_BLOCKS
+#define HISTORY_MINUTE_BLOCKS 68       // 17 KB, ~3 days
+#endif
+#ifndef HISTORY_QUARTER_CAPACITY
+#define HISTORY_QUARTER_CAPACITY 768   // 8 days
+#endif
+#endif
+
+enum class HistoryMetric : uint8_t {
+  Temperature = 0,
+  Humidity = 1,
+  Pressure = 2,
+};
+constexpr size_t HISTORY_METRIC_COUNT = 3;
+
+enum class HistoryTier : uint8_t {
+  Raw = 0,     // every sample
+  Minute = 1,  // 1-minute means
+  Quarter = 2, // 15-minute min/mean/max
+};
+constexpr size_t HISTORY_TIER_COUNT = 3;
+constexpr const char *HISTORY_TIER_NAMES[HISTORY_TIER_COUNT] = {"raw", "minute", "quarter"};
+
+// Values are packed as unsigned 16-bit fixed point per metric; 0xFFFF marks
+// a missing value. Temperature: (C + 100) * 100, humidity: % * 100,
+// pressure: Pa / 2.
+constexpr uint16_t HISTORY_MISSING = 0xFFFF;
+
+struct HistoryPoint {
+  uint32_t t = 0;                          // epoch seconds
+  uint16_t v[HISTORY_METRIC_COUNT] = {HISTORY_MISSING, HISTORY_MISSING, HISTORY_MISSING};
+  uint16_t n = 0;                          // samples folded into this point
+};
+
+struct HistoryAggregate {
+  uint32_t t = 0;                          // bucket start, epoch seconds
+  uint16_t min[HISTORY_METRIC_COUNT] = {HISTORY_MISSING, HISTORY_MISSING, HISTORY_MISSING};
+  uint16_t mean[HISTORY_METRIC_COUNT] = {HISTORY_MISSING, HISTORY_MISSING, HISTORY_MISSING};
+  uint16_t max[HISTORY_METRIC_COUNT] = {HISTORY_MISSING, HISTORY_MISSING, HISTORY_MISSING};
+  uint16_t n = 0;
+};
+
+// One metric of one stored point, unpacked for consumers.
+struct HistorySample {
+  uint32_t t = 0;
+  float mean = NAN;
+  float min = NAN;
+  float max = NAN;
+};
+
+// All metrics of one stored point, unpacked. min/max equal mean below the
+// 15-minute tier.
+struct HistoryRow {
+  uint32_t t = 0;
+  uint16_t n = 0;
+  float mean[HISTORY_METRIC_COUNT] = {NAN, NAN, NAN};
+  float min[HISTORY_METRIC_COUNT] = {NAN, NAN, NAN};
+  float max[HISTORY_METRIC_COUNT] = {NAN, NAN, NAN};
+};
+
+struct HistoryTierStats {
+  size_t capacity = 0;  // points; estimated from the current ratio for compressed tiers
+  size_t used = 0;
+  size_t bytes = 0;     // allocated
+  size_t usedBytes = 0;
+  uint32_t oldest = 0;
+  uint32_t newest = 0;
+};
+
+// Fixed-capacity ring over a single allocation; index 0 is the oldest entry.
+template <typename T>
+class HistoryRing {
+public:
+  bool allocate(size_t capacity, bool preferPsram) {
+    void *mem = nullptr;
+    inPsram = false;
+    if (preferPsram) {
+      mem = heap_caps_malloc(capacity * sizeof(T), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+      inPsram = mem != nullptr;
+    }
+    if (!mem) mem = heap_caps_malloc(capacity * sizeof(T), MALLOC_CAP_8BIT);
+    buf = static_cast<T *>(mem);
+    cap = buf ? capacity : 0;
+    head = 0;
+    count = 0;
+    return buf != nullptr;
+  }
+
+  void push(const T &value) {
+    if (!cap) return;
+    buf[(head + count) % cap] = value;
+    if (count < cap) {
+      ++count;
+    } else {
+      head = (head + 1) % cap;
+    }
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+
+  const T &at(size_t i) const { return buf[(head + i) % cap]; }
+  const T &back() const { return at(count - 1); }
+  size_t size() const { return count; }
+  size_t capacity() const { return cap; }
+  size_t bytes() const { return cap * sizeof(T); }
+  bool psram() const { return inPsram; }
+
+private:
+  T *buf = nullptr;
+  size_t cap = 0;
+  size_t head = 0;
+  size_t count = 0;
+  bool inPsram = false;
+};
+
+// Ring of fixed-size compressed blocks holding HistoryPoints. Points are
+// appended to the newest block; when the ring is full the oldest block is
+// dropped whole. Reads decode sequentially from the first block that can
+// contain the requested start time.
+class HistoryBlockRing {
+public:
+  static constexpr size_t CHANNELS = HISTORY_METRIC_COUNT + 1; // values + n
+
+  static void toChannels(const HistoryPoint &p, uint16_t *ch) {
+    for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) ch[m] = p.v[m];
+    ch[HISTORY_METRIC_COUNT] = p.n;
+  }
+  static void fromChannels(const uint16_t *ch, HistoryPoint &p) {
+    for (size_t m = 0; m < HISTORY_METRIC_COUNT; ++m) p.v[m] = ch[m];
+    p.n = ch[HISTORY_METRIC_COUNT];
+  }
+
+  bool allocate(size_t blocks, bool preferPsram);
+  void push(const HistoryPoint &point);
+
+  // Calls fn(const HistoryPoint &) for points with t >= from, oldest first,
+  // until fn returns false.
+  template <typename Fn>
+  void forEachFrom(uint32_t from, Fn fn) const {
+    // Blocks are time-ordered, so binary search the first one ending at or after from.
+    size_t lo = 0;
+    size_t hi = used;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (metaAt(mid).lastT < from) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    for (size_t b = lo; b < used; ++b) {
+      const size_t idx = (head + b) % blockCount;
+      TimeSeriesDecoder<CHANNELS> decoder(data + idx * HISTORY_BLOCK_BYTES, meta[idx].bytes, meta[idx].count);
+      HistoryPoint p;
+      uint16_t ch[CHANNELS];
+      while (decoder.next(p.t, ch)) {
+        if (p.t < from) continue;
+        fromChannels(ch, p);
+        if (!fn(p)) return;
+      }
+    }
+  }
+
+  size_t size() const { return points; }
+  size_t capacity() const;
+  size_t bytes() const { return blockCount * (HISTORY_BLOCK_BYTES + sizeof(BlockMeta)); }
+  size_t usedBytes() const;
+  uint32_t oldest() const { return used ? metaAt(0).firstT : 0; }
+  uint32_t newest() const { return used ? metaAt(used - 1).lastT : 0; }
+  bool psram() const { return inPsram; }
+
+private:
+  struct BlockMeta {
+    uint32_t firstT = 0;
+    uint32_t lastT = 0;
+    uint16_t count = 0;
+    uint16_t bytes = 0;
+  };
+
+  const BlockMeta &metaAt(size_t i) const { return meta[(head + i) % blockCount]; }
+  void startBlock();
+
+  uint8_t *data = nullptr;
+  BlockMeta *meta = nullptr;
+  size_t blockCount = 0;
+  size_t head = 0;   // oldest block
+  size_t used = 0;   // blocks in use, the newest one being filled
+  size_t points = 0;
+  bool inPsram = false;
+  TimeSeriesEncoder<CHANNELS> encoder;
+};
+
+// Bounded on-device history fed by WeatherService snapshots. Raw samples,
+// 1-minute means and 15-minute min/mean/max are kept in separate rings.
+// The main loop appends; HTTP handlers read under the same mutex.
+class WeatherHistory {
+public:
+  using Visitor = std::function<bool(const HistorySample &)>;
+  using RowVisitor = std::function<bool(const HistoryRow &)>;
+  using MinuteSink = std::function<void(const HistoryPoint &)>;
+
+  bool begin(WeatherService *weather);
+  void loop();
+
+  // Appends one reading stamped with epoch seconds (ignored if time runs backwards).
+  void add(const WeatherReading &reading, uint32_t epoch);
+
+  // Calls fn for every stored point of tier in [from, to], oldest first,
+  // until fn returns false. Returns the number of points visited.
+  size_t visit(HistoryTier tier, HistoryMetric metric, uint32_t from, uint32_t to, const Visitor &fn) const;
+  // Same, with every metric of each point.
+  size_t visitRows(HistoryTier tier, uint32_t from, uint32_t to, const RowVisitor &fn) const;
+
+  // Called (under the history mutex) for every completed 1-minute point.
+  void setMinuteSink(const MinuteSink &sink) { minuteSink = sink; }
+  // Re-inserts a persisted 1-minute point and folds it into the 15-minute tier.
+  void restoreMinute(const HistoryPoint &point);
+  void attachLog(const HistoryLog *log) { logRef = log; }
+  const HistoryLog *log() const { return logRef; }
+
+  // Coarsest tier that still yields `points` samples over [from, to], or
+  // else the finest tier that reaches back to from.
+  HistoryTier tierFor(uint32_t from, uint32_t to, size_t points) const;
+
+  HistoryTierStats stats(HistoryTier tier) const;
+  bool usesPsram() const { return raw.psram(); }
+  bool ready() const { return mutex != nullptr; }
+
+  static uint16_t pack(HistoryMetric metric, float value);
+  static float unpack(HistoryMetric metric, uint16_t raw);
+  static bool clockValid(time_t now);
+
+private:
+  struct Accumulator {
+    uint32_t bucket = 0;
+    uint32_t sum[HISTORY_METRIC_COUNT] = {};
+    uint16_t min[HISTORY_METRIC_COUNT] = {HISTORY_MISSING, HISTORY_MISSING, HISTORY_MISSING};
+    uint16_t max[HISTORY_METRIC_COUNT] = {0, 0, 0};
+    uint16_t count[HISTORY_METRIC_COUNT] = {};
+    uint16_t n = 0;
+
+    void reset(uint32_t start);
+    void add(const uint16_t *v);
+    uint16_t mean(size_t metric) const;
+  };
+
+  void lock() const;
+  void unlock() const;
+  void flushMinute();
+  void flushQuarter();
+
+  WeatherService *weatherRef = nullptr;
+  const HistoryLog *logRef = nullptr;
+  MinuteSink minuteSink;
+  SemaphoreHandle_t mutex = nullptr;
+  uint32_t lastSequence = 0;
+  uint32_t lastEpoch = 0;
+
+  HistoryBlockRing raw;
+  HistoryBlockRing minute;
+  HistoryRing<HistoryAggregate> quarter;
+  Accumulator minuteAcc;
+  Accumulator quarterAcc;
+};
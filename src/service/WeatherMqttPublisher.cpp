@@ -1,29 +1,75 @@
 #include "WeatherMqttPublisher.h"
 
-#include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <WiFi.h>
+#include <memory>
+#include <new>
 #include "../common/DeviceHelpers.h"
 #include <esp32/spiram.h>
 
 #include "setup/MqttService.h"
 #include "WeatherService.h"
 #include "OutdoorService.h"
+#include "OutdoorCacheIngest.h"
+#include "ServicePayloads.h"
+#include "TelemetryFrameCache.h"
+#include "common/JsonWriter.h"
 
 namespace {
 constexpr unsigned long DISCOVERY_REFRESH_MS = 300000;
 }
 
-void WeatherMqttPublisher::begin(MqttService *mqtt, WeatherService *weather, OutdoorService *outdoor) {
+void WeatherMqttPublisher::begin(MqttService *mqtt, WeatherService *weather, OutdoorService *outdoor, TelemetryFrameCache *frames) {
   mqttRef = mqtt;
   weatherRef = weather;
   outdoorRef = outdoor;
+  framesRef = frames;
+  if (mqttRef && outdoorRef) {
+    outdoorRevision = outdoorRef->revision();
+    mqttRef->subscribe("outdoor/patch", &WeatherMqttPublisher::onOutdoorPatch, this);
+  }
+}
+
+void WeatherMqttPublisher::onOutdoorPatch(void *ctx, const uint8_t *payload, unsigned int length) {
+  auto *self = static_cast<WeatherMqttPublisher *>(ctx);
+  // The hourly table is too big for the loop task's stack.
+  std::unique_ptr<OutdoorCacheIngest> ingest(new (std::nothrow) OutdoorCacheIngest());
+  if (!ingest) return;
+  ingest->begin();
+  ingest->feed(payload, length);
+  if (!ingest->finish()) {
+    Serial.printf("MQTT: outdoor patch rejected (%s)\n", ingest->error());
+    return;
+  }
+  // Anything it moved goes out through publishOutdoorChange().
+  ingest->merge(*self->outdoorRef);
+}
+
+// Sent on <base>/outdoor/changed only when cached values moved, naming the
+// fields that did; a push or fetch that repeats the cache sends nothing.
+// Updates landing between two loop() passes are reported together: the
+// fields of every revision since the last message.
+void WeatherMqttPublisher::publishOutdoorChange() {
+  JsonWriter w(payload, sizeof(payload));
+  {
+    OutdoorService::DataReader data = outdoorRef->data();
+    const uint32_t since = outdoorRevision;
+    outdoorRevision = data->revision;
+    OutdoorChange change;
+    data->changesSince(since, change);
+    if (!change.any()) return;
+    w.beginObject();
+    w.field("revision", data->revision);
+    w.field("since", since);
+    writeOutdoorChange(w, change);
+    w.endObject();
+  }
+  if (!w.ok()) return;
+  publishBuffer(DeviceHelpers::makeTopic(mqttRef->baseTopic(), "outdoor/changed"), w.size(), false);
 }
 
-bool WeatherMqttPublisher::addFinite(JsonObject obj, const char *key, float value) {
-  if (isnan(value)) return false;
-  obj[key] = value;
-  return true;
+void WeatherMqttPublisher::publishBuffer(const String &topic, size_t length, bool retain) {
+  mqttRef->publish(topic, reinterpret_cast<const uint8_t *>(payload), length, retain);
 }
 
 String WeatherMqttPublisher::discoveryPrefix() const {
@@ -32,26 +78,27 @@ String WeatherMqttPublisher::discoveryPrefix() const {
 
 void WeatherMqttPublisher::publishSensorConfig(const String &id, const String &name, const String &templatePath, const char *unit, const char *deviceClass, const char *icon) {
   if (!mqttRef) return;
-  JsonDocument doc;
-  doc["name"] = name;
-  doc["state_topic"] = mqttRef->stateTopic();
-  doc["unique_id"] = id;
-  doc["value_template"] = templatePath;
-  if (unit) doc["unit_of_measurement"] = unit;
-  if (deviceClass) doc["device_class"] = deviceClass;
-  if (icon) doc["icon"] = icon;
-
   MqttConfig cfg = mqttRef->currentConfig();
-  JsonObject device = doc["device"].to<JsonObject>();
-  device["identifiers"] = mqttRef->deviceId();
-  device["name"] = cfg.deviceName;
-  device["model"] = "ESP32 Weather Station";
-  device["manufacturer"] = "Custom";
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  w.field("name", name);
+  w.field("state_topic", mqttRef->stateTopic());
+  w.field("unique_id", id);
+  w.field("value_template", templatePath);
+  if (unit) w.field("unit_of_measurement", unit);
+  if (deviceClass) w.field("device_class", deviceClass);
+  if (icon) w.field("icon", icon);
+  w.beginObject("device");
+  w.field("identifiers", mqttRef->deviceId());
+  w.field("name", cfg.deviceName);
+  w.field("model", "ESP32 Weather Station");
+  w.field("manufacturer", "Custom");
+  w.endObject();
+  w.endObject();
+  if (!w.ok()) return;
 
   String topic = discoveryPrefix() + "/sensor/" + mqttRef->deviceId() + "/" + id + "/config";
-  String payload;
-  serializeJson(doc, payload);
-  mqttRef->publish(topic, payload, true);
+  publishBuffer(topic, w.size(), true);
 }
 
 void WeatherMqttPublisher::publishDiscovery() {
@@ -86,6 +133,8 @@ void WeatherMqttPublisher::publishDiscovery() {
     publishSensorConfig("fc_hum_" + suffix, cfg.deviceName + " Forecast Hum +" + suffix, "{{ value_json.outlook.h" + String(h) + ".humidity }}", "%", "humidity");
     publishSensorConfig("fc_press_" + suffix, cfg.deviceName + " Forecast Press +" + suffix, "{{ value_json.outlook.h" + String(h) + ".pressureHpa }}", "hPa", "pressure");
   }
+  publishSensorConfig("fc_temp_min_12h", cfg.deviceName + " Forecast Temp Min 12h", "{{ value_json.next12h.tempMinC }}", "°C", "temperature");
+  publishSensorConfig("fc_temp_max_12h", cfg.deviceName + " Forecast Temp Max 12h", "{{ value_json.next12h.tempMaxC }}", "°C", "temperature");
 
   discoverySent = true;
   lastDiscovery = now;
@@ -97,114 +146,134 @@ void WeatherMqttPublisher::publishTelemetry() {
   WeatherReading reading;
   weatherRef->read(reading);
 
-  JsonDocument doc;
-  if (cfg.city.length()) doc["city"] = cfg.city;
-  if (cfg.country.length()) doc["country"] = cfg.country;
-
-  JsonObject sensors = doc["sensors"].to<JsonObject>();
-  sensors["sht31"].to<JsonObject>()["present"] = reading.shtPresent;
-  sensors["sht31"].to<JsonObject>()["ok"] = reading.shtOk;
-  sensors["bmp580"].to<JsonObject>()["present"] = reading.bmpPresent;
-  sensors["bmp580"].to<JsonObject>()["ok"] = reading.bmpOk;
-
-  JsonObject indoor = doc["indoor"].to<JsonObject>();
-  addFinite(indoor, "temperatureC", reading.temperatureC);
-  addFinite(indoor, "temperatureF", isnan(reading.temperatureC) ? NAN : reading.temperatureC * 9.0f / 5.0f + 32.0f);
-  addFinite(indoor, "humidity", reading.humidity);
-  addFinite(indoor, "dewPointC", reading.dewPointC);
-  addFinite(indoor, "dewPointF", isnan(reading.dewPointC) ? NAN : reading.dewPointC * 9.0f / 5.0f + 32.0f);
-  addFinite(indoor, "pressurePa", reading.pressurePa);
-  addFinite(indoor, "pressureHpa", isnan(reading.pressurePa) ? NAN : reading.pressurePa / 100.0f);
-  addFinite(indoor, "pressureMmHg", isnan(reading.pressurePa) ? NAN : reading.pressurePa / 133.322f);
-  addFinite(indoor, "altitudeM", reading.altitudeM);
-  addFinite(indoor, "bmpTemperatureC", reading.bmpTemperatureC);
-  addFinite(indoor, "seaLevelPressureHpa", weatherRef->seaLevelPressure());
-  indoor["sampleMs"] = reading.collectedAtMs;
-
-  JsonObject system = doc["system"].to<JsonObject>();
-  system["uptimeMs"] = millis();
-
-  JsonObject heap = system["heap"].to<JsonObject>();
+  const bool outdoorOn = outdoorRef && outdoorRef->hasConfig();
+  OutdoorConfig ocfg;
+  if (outdoorOn) {
+    outdoorRef->ensureFresh(false);
+    ocfg = outdoorRef->currentConfig();
+  }
+
+  JsonWriter w(payload, sizeof(payload));
+  w.beginObject();
+  // The outdoor location takes precedence over the MQTT profile's.
+  if (outdoorOn || cfg.city.length()) w.field("city", outdoorOn ? ocfg.city : cfg.city);
+  if (outdoorOn || cfg.country.length()) w.field("country", outdoorOn ? ocfg.country : cfg.country);
+
+  w.beginObject("sensors");
+  w.beginObject("sht31").field("present", reading.shtPresent).field("ok", reading.shtOk).endObject();
+  w.beginObject("bmp580").field("present", reading.bmpPresent).field("ok", reading.bmpOk).endObject();
+  w.endObject();
+
+  // The indoor object is shared with /api/weather/metrics and serialized once per sample.
+  if (framesRef) {
+    w.jsonField("indoor", [this](char *dst, size_t room) { return framesRef->copyIndoor(dst, room); });
+  }
+
+  w.beginObject("system");
+  w.field("uptimeMs", millis());
+
+  w.beginObject("heap");
   uint32_t heapFree = ESP.getFreeHeap();
   uint32_t heapSize = ESP.getHeapSize();
   uint32_t heapUsed = heapSize >= heapFree ? heapSize - heapFree : 0;
-  heap["free"] = heapFree;
-  heap["size"] = heapSize;
-  heap["usedPct"] = heapSize ? (heapUsed * 100.0f / heapSize) : 0.0f;
-  heap["minFree"] = ESP.getMinFreeHeap();
-  heap["maxAlloc"] = ESP.getMaxAllocHeap();
-
-  JsonObject psram = system["psram"].to<JsonObject>();
+  w.field("free", heapFree);
+  w.field("size", heapSize);
+  w.field("usedPct", heapSize ? (heapUsed * 100.0f / heapSize) : 0.0f, 1);
+  w.field("minFree", ESP.getMinFreeHeap());
+  w.field("maxAlloc", ESP.getMaxAllocHeap());
+  w.endObject();
+
+  w.beginObject("psram");
   bool psramPresent = psramFound() && ESP.getPsramSize() > 0;
-  psram["present"] = psramPresent;
-  psram["size"] = psramPresent ? ESP.getPsramSize() : 0;
-  psram["free"] = psramPresent ? ESP.getFreePsram() : 0;
-  psram["minFree"] = psramPresent ? ESP.getMinFreePsram() : 0;
-  psram["maxAlloc"] = psramPresent ? ESP.getMaxAllocPsram() : 0;
-  psram["usedPct"] = (psramPresent && ESP.getPsramSize()) ? ((ESP.getPsramSize() - ESP.getFreePsram()) * 100.0f / ESP.getPsramSize()) : 0.0f;
-
-  JsonObject fs = system["fs"].to<JsonObject>();
+  w.field("present", psramPresent);
+  w.field("size", psramPresent ? ESP.getPsramSize() : 0);
+  w.field("free", psramPresent ? ESP.getFreePsram() : 0);
+  w.field("minFree", psramPresent ? ESP.getMinFreePsram() : 0);
+  w.field("maxAlloc", psramPresent ? ESP.getMaxAllocPsram() : 0);
+  w.field("usedPct", (psramPresent && ESP.getPsramSize()) ? ((ESP.getPsramSize() - ESP.getFreePsram()) * 100.0f / ESP.getPsramSize()) : 0.0f, 1);
+  w.endObject();
+
+  w.beginObject("fs");
   size_t fsTotal = LittleFS.totalBytes();
   size_t fsUsed = LittleFS.usedBytes();
-  fs["total"] = fsTotal;
-  fs["used"] = fsUsed;
-  fs["usedPct"] = fsTotal ? (fsUsed * 100.0f / fsTotal) : 0.0f;
-
-  system["cpuMhz"] = ESP.getCpuFreqMHz();
-  system["sdk"] = ESP.getSdkVersion();
-  system["chipRevision"] = ESP.getChipRevision();
-
-  JsonObject net = doc["network"].to<JsonObject>();
-  net["connected"] = weatherRef && mqttRef && mqttRef->isConnected();
-  net["ssid"] = WiFi.SSID();
-  net["apSSID"] = WiFi.softAPSSID();
-  net["ip"] = WiFi.localIP().toString();
-  net["apIP"] = WiFi.softAPIP().toString();
-  net["mac"] = DeviceHelpers::getMacAddress();
-  net["bssid"] = WiFi.BSSIDstr();
-  addFinite(net, "rssi", WiFi.RSSI());
-
-  if (outdoorRef && outdoorRef->hasConfig()) {
-    outdoorRef->ensureFresh(false);
-    OutdoorConfig ocfg = outdoorRef->currentConfig();
-    OutdoorSnapshot out = outdoorRef->current();
-
-    doc["outdoorCity"] = ocfg.city;
-    doc["outdoorCountry"] = ocfg.country;
-    doc["outdoorLat"] = ocfg.lat;
-    doc["outdoorLon"] = ocfg.lon;
-    doc["lat"] = ocfg.lat;
-    doc["lon"] = ocfg.lon;
-    doc["city"] = ocfg.city;
-    doc["country"] = ocfg.country;
-
-    JsonObject outdoor = doc["outdoor"].to<JsonObject>();
-    outdoor["city"] = ocfg.city;
-    outdoor["country"] = ocfg.country;
-    outdoor["lat"] = ocfg.lat;
-    outdoor["lon"] = ocfg.lon;
-    addFinite(outdoor, "temperatureC", out.temperatureC);
-    addFinite(outdoor, "humidity", out.humidity);
-    addFinite(outdoor, "pressureHpa", out.pressureHpa);
-    addFinite(outdoor, "pressureMmHg", out.pressureMmHg);
-    addFinite(outdoor, "altitudeM", out.altitudeM);
-    addFinite(outdoor, "windSpeed", out.windSpeed);
-
-    JsonObject outlook = doc["outlook"].to<JsonObject>();
+  w.field("total", fsTotal);
+  w.field("used", fsUsed);
+  w.field("usedPct", fsTotal ? (fsUsed * 100.0f / fsTotal) : 0.0f, 1);
+  w.endObject();
+
+  w.field("cpuMhz", ESP.getCpuFreqMHz());
+  w.field("sdk", ESP.getSdkVersion());
+  w.field("chipRevision", ESP.getChipRevision());
+  w.endObject();
+
+  w.beginObject("network");
+  w.field("connected", weatherRef && mqttRef && mqttRef->isConnected());
+  w.field("ssid", WiFi.SSID());
+  w.field("apSSID", WiFi.softAPSSID());
+  w.field("ip", WiFi.localIP().toString());
+  w.field("apIP", WiFi.softAPIP().toString());
+  w.field("mac", DeviceHelpers::getMacAddress());
+  w.field("bssid", WiFi.BSSIDstr());
+  w.field("rssi", WiFi.RSSI());
+  w.endObject();
+
+  if (outdoorOn) {
+    // One pinned version for the current values, outlook and summary; the
+    // writer only formats into the buffer while holding it.
+    OutdoorService::DataReader data = outdoorRef->data();
+    const OutdoorSnapshot &out = data->current;
+
+    w.field("outdoorCity", ocfg.city);
+    w.field("outdoorCountry", ocfg.country);
+    w.field("outdoorLat", ocfg.lat, 6);
+    w.field("outdoorLon", ocfg.lon, 6);
+    w.field("lat", ocfg.lat, 6);
+    w.field("lon", ocfg.lon, 6);
+
+    w.beginObject("outdoor");
+    w.field("city", ocfg.city);
+    w.field("country", ocfg.country);
+    w.field("lat", ocfg.lat, 6);
+    w.field("lon", ocfg.lon, 6);
+    w.fieldIfFinite("temperatureC", out.temperatureC, 2);
+    w.fieldIfFinite("humidity", out.humidity, 2);
+    w.fieldIfFinite("pressureHpa", out.pressureHpa, 2);
+    w.fieldIfFinite("pressureMmHg", out.pressureMmHg, 2);
+    w.fieldIfFinite("altitudeM", out.altitudeM, 1);
+    w.fieldIfFinite("windSpeed", out.windSpeed, 2);
+    w.endObject();
+
+    w.beginObject("outlook");
     for (uint16_t h : OUTLOOK_HORIZONS) {
-      OutdoorSnapshot snap = outdoorRef->forecastFor(h);
-      JsonObject slot = outlook[String("h") + String(h)].to<JsonObject>();
-      addFinite(slot, "tempC", snap.temperatureC);
-      addFinite(slot, "humidity", snap.humidity);
-      addFinite(slot, "pressureHpa", snap.pressureHpa);
-      addFinite(slot, "pressureMmHg", snap.pressureMmHg);
-      addFinite(slot, "windSpeed", snap.windSpeed);
+      OutdoorSnapshot snap = data->forecast.at(h);
+      char key[8];
+      snprintf(key, sizeof(key), "h%u", static_cast<unsigned>(h));
+      w.beginObject(key);
+      w.fieldIfFinite("tempC", snap.temperatureC, 2);
+      w.fieldIfFinite("humidity", snap.humidity, 2);
+      w.fieldIfFinite("pressureHpa", snap.pressureHpa, 2);
+      w.fieldIfFinite("pressureMmHg", snap.pressureMmHg, 2);
+      w.fieldIfFinite("windSpeed", snap.windSpeed, 2);
+      w.endObject();
     }
+    w.endObject();
+
+    const ForecastWindow temp = data->forecast.window(ForecastField::TemperatureC, 1, OUTLOOK_SUMMARY_HOURS);
+    const ForecastWindow wind = data->forecast.window(ForecastField::WindSpeed, 1, OUTLOOK_SUMMARY_HOURS);
+    w.beginObject("next12h");
+    w.fieldIfFinite("tempMinC", temp.min, 2);
+    w.fieldIfFinite("tempMaxC", temp.max, 2);
+    w.fieldIfFinite("tempMeanC", temp.mean, 2);
+    w.fieldIfFinite("windSpeedMax", wind.max, 2);
+    w.endObject();
   }
+  w.endObject();
 
-  String payload;
-  serializeJson(doc, payload);
-  mqttRef->publish(mqttRef->stateTopic(), payload, false);
+  if (!w.ok()) {
+    Serial.println("MQTT: telemetry payload truncated, not published");
+    return;
+  }
+  publishBuffer(mqttRef->stateTopic(), w.size(), false);
 }
 
 void WeatherMqttPublisher::loop() {
@@ -213,6 +282,8 @@ void WeatherMqttPublisher::loop() {
   if (!cfg.enabled) return;
   if (!mqttRef->isConnected()) return;
 
+  if (outdoorRef && outdoorRef->revision() != outdoorRevision) publishOutdoorChange();
+
   unsigned long now = millis();
   unsigned long interval = cfg.publishIntervalMs > 0 ? cfg.publishIntervalMs : 30000;
   if (now - lastPublish >= interval) {
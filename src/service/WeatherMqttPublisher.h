@@ -1,29 +1,38 @@
 #pragma once
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 
 class WeatherService;
 class OutdoorService;
 class MqttService;
+class TelemetryFrameCache;
 
 class WeatherMqttPublisher {
 public:
-  void begin(MqttService *mqtt, WeatherService *weather, OutdoorService *outdoor);
+  // Discovery configs and telemetry are written into one reused buffer.
+  static constexpr size_t PAYLOAD_CAPACITY = 2560;
+
+  void begin(MqttService *mqtt, WeatherService *weather, OutdoorService *outdoor, TelemetryFrameCache *frames);
   void loop();
 
 private:
   void publishDiscovery();
   void publishTelemetry();
+  void publishOutdoorChange();
+  // <base>/outdoor/patch: a JSON partial update, merged into the cache.
+  static void onOutdoorPatch(void *ctx, const uint8_t *payload, unsigned int length);
   void publishSensorConfig(const String &id, const String &name, const String &templatePath, const char *unit, const char *deviceClass, const char *icon = nullptr);
-  bool addFinite(JsonObject obj, const char *key, float value);
+  void publishBuffer(const String &topic, size_t length, bool retain);
   String discoveryPrefix() const;
 
   MqttService *mqttRef = nullptr;
   WeatherService *weatherRef = nullptr;
   OutdoorService *outdoorRef = nullptr;
+  TelemetryFrameCache *framesRef = nullptr;
 
   unsigned long lastPublish = 0;
   unsigned long lastDiscovery = 0;
   bool discoverySent = false;
+  uint32_t outdoorRevision = 0;
+  char payload[PAYLOAD_CAPACITY];
 };
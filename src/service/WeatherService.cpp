@@ -7,10 +7,13 @@ namespace {
   constexpr uint8_t SHT31_I2C_ADDR = 0x44;
   constexpr uint8_t BMP5XX_ADDR_PRIMARY = 0x47;
   constexpr uint8_t BMP5XX_ADDR_SECONDARY = 0x46;
+  constexpr uint32_t MIN_SAMPLE_INTERVAL_MS = 250;
 }
 
-bool WeatherService::begin(TwoWire &wire){
+bool WeatherService::begin(TwoWire &wire, const WeatherSamplingConfig &cfg){
   wireRef = &wire;
+  samplingCfg = cfg;
+  setSampleInterval(cfg.sampleIntervalMs);
 #if defined(ARDUINO_ARCH_ESP32)
   wireRef->begin();
 #else
@@ -22,6 +25,13 @@ bool WeatherService::begin(TwoWire &wire){
   if(shtAvailable){
     sht31.heater(false);
     Serial.println("SHT31 detected");
+    shtPeriodic = false;
+    if(cfg.shtMode == ShtAcquisition::Periodic && shtDriver.begin(wireRef, SHT31_I2C_ADDR)){
+      shtPeriodic = shtDriver.startPeriodic(cfg.shtRate, cfg.shtRepeatability);
+      if(!shtPeriodic){
+        Serial.println("SHT31 periodic mode start failed; using single-shot reads");
+      }
+    }
   } else {
     Serial.println("SHT31 not detected");
   }
@@ -41,6 +51,32 @@ bool WeatherService::begin(TwoWire &wire){
     bmp5.setPressureOversampling(BMP5XX_OVERSAMPLING_16X);
     bmp5.setIIRFilterCoeff(BMP5XX_IIR_FILTER_COEFF_7);
     Serial.printf("BMP580 detected at 0x%02X\n", bmpAddress);
+    if(!bmpDriver.begin(wireRef, bmpAddress)){
+      Serial.println("BMP580 register setup failed; disabling barometer");
+      bmpAvailable = false;
+    }
+  }
+  if(bmpAvailable){
+    baroState = BaroState::Idle;
+    baroFailures = 0;
+    if(cfg.bmpMode == BmpAcquisition::Fifo){
+      // A FIFO that fills up between drains drops the oldest frames.
+      const uint8_t odr = Bmp580Driver::fifoOdrFor(cfg.bmpFifoOdr, sampleIntervalMs.load());
+      if(odr != cfg.bmpFifoOdr){
+        Serial.printf("BMP580 ODR 0x%02X overflows the FIFO every %lu ms; using 0x%02X\n",
+                      cfg.bmpFifoOdr, static_cast<unsigned long>(sampleIntervalMs.load()), odr);
+        samplingCfg.bmpFifoOdr = odr;
+      }
+      if(bmpDriver.startFifo(samplingCfg.bmpFifoOdr)){
+        baroCollectedAt = millis();
+        Serial.printf("BMP580 FIFO mode, ODR code 0x%02X\n", samplingCfg.bmpFifoOdr);
+      } else {
+        failBarometer(millis(), "fifo start");
+      }
+    } else if(cfg.bmpDrdyPin >= 0 && bmpDriver.enableDataReadyInterrupt(true)){
+      pinMode(cfg.bmpDrdyPin, INPUT);
+      attachInterruptArg(cfg.bmpDrdyPin, onBaroDataReady, this, RISING);
+    }
   } else {
     Serial.println("BMP580 not detected");
     Serial.println("Running fallback I2C scan to assist debugging...");
@@ -53,26 +89,211 @@ bool WeatherService::begin(TwoWire &wire){
     }
   }
 
-  lastReading = WeatherReading{};
-  lastSampleTimestamp = 0;
+  lastGood = WeatherReading{};
+  hasGood = false;
+
+  // Take the first sample inline so readers never see an empty snapshot,
+  // then hand the bus over to the sampler task for good.
+  sampleOnce();
+  if(!samplerHandle){
+    BaseType_t created = xTaskCreate(samplerTask, "wx-sampler", cfg.taskStackBytes, this, cfg.taskPriority, &samplerHandle);
+    if(created != pdPASS){
+      samplerHandle = nullptr;
+      // read() may then run on any task; the mutex keeps one sampler on the
+      // bus and one writer on the snapshot.
+      if(!inlineMutex) inlineMutex = xSemaphoreCreateMutex();
+      Serial.println(inlineMutex ? "Sampler task start failed; sampling inline on read()"
+                                 : "Sampler task start failed; readings will not update");
+    }
+  }
   return shtAvailable || bmpAvailable;
 }
 
 void WeatherService::setSeaLevelPressure(float hPa){
   if(hPa > 0.0f){
-    seaLevelPressureHpa = hPa;
+    seaLevelPressureHpa.store(hPa);
+  }
+}
+
+void WeatherService::setSampleInterval(uint32_t ms){
+  if(ms < MIN_SAMPLE_INTERVAL_MS) ms = MIN_SAMPLE_INTERVAL_MS;
+  sampleIntervalMs.store(ms);
+  // The running ODR is only chosen in begin(); say so rather than lose frames silently.
+  if(bmpAvailable && samplingCfg.bmpMode == BmpAcquisition::Fifo &&
+     Bmp580Driver::fifoFramesPer(samplingCfg.bmpFifoOdr, ms) > Bmp580Driver::FIFO_DEPTH){
+    Serial.printf("BMP580 FIFO overflows at ODR 0x%02X every %lu ms; older frames are dropped\n",
+                  samplingCfg.bmpFifoOdr, static_cast<unsigned long>(ms));
   }
 }
 
 bool WeatherService::read(WeatherReading &out){
-  WeatherReading reading;
-  bool ok = performReadings(reading);
-  if(ok || lastSampleTimestamp == 0){
-    lastReading = reading;
-    lastSampleTimestamp = reading.collectedAtMs;
+  if(!samplerHandle && inlineMutex){
+    xSemaphoreTake(inlineMutex, portMAX_DELAY);
+    sampleOnce();
+    xSemaphoreGive(inlineMutex);
+  }
+  Sample sample;
+  uint32_t seq = snapshot.read(sample);
+  out = sample.reading;
+  out.sequence = seq;
+  return sample.ok;
+}
+
+WeatherReading WeatherService::latest() const {
+  Sample sample;
+  uint32_t seq = snapshot.read(sample);
+  WeatherReading out = sample.reading;
+  out.sequence = seq;
+  return out;
+}
+
+void WeatherService::samplerTask(void *arg){
+  auto *self = static_cast<WeatherService *>(arg);
+  TickType_t lastWake = xTaskGetTickCount();
+  for(;;){
+    self->sampleOnce();
+    TickType_t period = pdMS_TO_TICKS(self->sampleIntervalMs.load());
+    vTaskDelayUntil(&lastWake, period ? period : 1);
+  }
+}
+
+void IRAM_ATTR WeatherService::onBaroDataReady(void *arg){
+  auto *self = static_cast<WeatherService *>(arg);
+  self->baroIrq.store(true);
+  if(self->samplerHandle){
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->samplerHandle, &woken);
+    if(woken) portYIELD_FROM_ISR();
+  }
+}
+
+void WeatherService::stepBarometer(unsigned long now){
+  switch(baroState){
+    case BaroState::Backoff:
+      if(static_cast<long>(now - baroRetryAt) < 0) return;
+      baroState = BaroState::Idle;
+      // fall through
+    case BaroState::Idle:
+      baroIrq.store(false);
+      if(!bmpDriver.triggerForced()){
+        failBarometer(now, "trigger");
+        return;
+      }
+      baroTriggeredAt = now;
+      baroState = BaroState::Converting;
+      return;
+    case BaroState::Converting: {
+      bool ready = baroIrq.exchange(false);
+      if(!ready && now - baroTriggeredAt >= samplingCfg.bmpConversionMs){
+        if(!bmpDriver.pollDataReady(ready)){
+          failBarometer(now, "status");
+          return;
+        }
+      }
+      if(ready){
+        float temperatureC = NAN;
+        float pressurePa = NAN;
+        if(!bmpDriver.readData(temperatureC, pressurePa)){
+          failBarometer(now, "data");
+          return;
+        }
+        baroTemperatureC = temperatureC;
+        baroPressurePa = pressurePa;
+        baroCollectedAt = now;
+        baroValid = true;
+        baroFailures = 0;
+        baroState = BaroState::Idle;
+        return;
+      }
+      if(now - baroTriggeredAt > samplingCfg.bmpTimeoutMs){
+        failBarometer(now, "timeout");
+      }
+      return;
+    }
+  }
+}
+
+void WeatherService::awaitBarometer(){
+  // Sampler task only: sleep (or wait for the DRDY notification) instead of
+  // spinning on the status register.
+  while(baroState == BaroState::Converting){
+    unsigned long elapsed = millis() - baroTriggeredAt;
+    uint32_t waitMs = elapsed < samplingCfg.bmpConversionMs ? samplingCfg.bmpConversionMs - elapsed : 5;
+    TickType_t ticks = pdMS_TO_TICKS(waitMs);
+    if(ticks == 0) ticks = 1;
+    if(samplingCfg.bmpDrdyPin >= 0){
+      ulTaskNotifyTake(pdTRUE, ticks);
+    } else {
+      vTaskDelay(ticks);
+    }
+    stepBarometer(millis());
+  }
+}
+
+void WeatherService::drainBarometerFifo(unsigned long now){
+  if(baroState == BaroState::Backoff){
+    if(static_cast<long>(now - baroRetryAt) < 0) return;
+    if(!bmpDriver.startFifo(samplingCfg.bmpFifoOdr)){
+      failBarometer(now, "fifo start");
+      return;
+    }
+    baroState = BaroState::Idle;
+    baroCollectedAt = now;
+    return; // nothing queued yet after a restart
+  }
+
+  Bmp580Driver::FifoAccumulator acc;
+  if(!bmpDriver.drainFifo(acc)){
+    failBarometer(now, "fifo read");
+    return;
+  }
+  float temperatureC = NAN;
+  float pressurePa = NAN;
+  if(!acc.result(temperatureC, pressurePa)){
+    // An empty FIFO for several intervals means the sensor left normal mode.
+    if(now - baroCollectedAt > 4 * sampleIntervalMs.load()){
+      failBarometer(now, "fifo stalled");
+    }
+    return;
+  }
+  baroTemperatureC = temperatureC;
+  baroPressurePa = pressurePa;
+  baroCollectedAt = now;
+  baroFrames = acc.frames;
+  baroValid = true;
+  baroFailures = 0;
+}
+
+void WeatherService::failBarometer(unsigned long now, const char *reason){
+  if(baroFailures < UINT16_MAX) ++baroFailures;
+  uint8_t shift = baroFailures > 10 ? 10 : baroFailures - 1;
+  uint32_t backoff = static_cast<uint32_t>(samplingCfg.bmpBackoffMinMs) << shift;
+  if(backoff > samplingCfg.bmpBackoffMaxMs) backoff = samplingCfg.bmpBackoffMaxMs;
+  baroRetryAt = now + backoff;
+  baroState = BaroState::Backoff;
+
+  static unsigned long lastLog = 0;
+  if(now - lastLog > 5000){
+    Serial.printf("BMP580 conversion %s failed (%u in a row), retry in %lu ms\n", reason, baroFailures, static_cast<unsigned long>(backoff));
+    lastLog = now;
   }
-  out = lastReading;
-  return ok;
+}
+
+void WeatherService::sampleOnce(){
+  Sample sample;
+  if(bmpAvailable && samplingCfg.bmpMode == BmpAcquisition::Forced){
+    // Kick the barometer first so its conversion overlaps the SHT31 read.
+    stepBarometer(millis());
+  }
+  sample.ok = performReadings(sample.reading);
+  if(sample.ok || !hasGood){
+    lastGood = sample.reading;
+    hasGood = true;
+  } else {
+    // Keep serving the last good values but report the failed attempt.
+    sample.reading = lastGood;
+  }
+  snapshot.publish(sample);
 }
 
 bool WeatherService::performReadings(WeatherReading &reading){
@@ -81,9 +302,15 @@ bool WeatherService::performReadings(WeatherReading &reading){
   reading.bmpPresent = bmpAvailable;
 
   if(shtAvailable){
-    float temperature = sht31.readTemperature();
-    float humidity = sht31.readHumidity();
-    bool valid = !isnan(temperature) && !isnan(humidity);
+    float temperature = NAN;
+    float humidity = NAN;
+    bool valid;
+    if(shtPeriodic){
+      valid = fetchHygrometer(reading.collectedAtMs, temperature, humidity);
+    } else {
+      // One measurement for both values instead of one per readTemperature()/readHumidity().
+      valid = sht31.readBoth(&temperature, &humidity) && !isnan(temperature) && !isnan(humidity);
+    }
     reading.shtOk = valid;
     if(valid){
       reading.temperatureC = temperature;
@@ -93,23 +320,24 @@ bool WeatherService::performReadings(WeatherReading &reading){
   }
 
   if(bmpAvailable){
-    bool valid = bmp5.performReading();
+    if(samplingCfg.bmpMode == BmpAcquisition::Fifo){
+      drainBarometerFifo(millis());
+    } else if(samplerHandle){
+      awaitBarometer();
+    } else {
+      stepBarometer(millis());
+    }
+    // Accept the latest collected conversion while it is younger than two
+    // sample periods; otherwise report the barometer as not ok.
+    long age = static_cast<long>(reading.collectedAtMs - baroCollectedAt);
+    bool valid = baroValid && age <= static_cast<long>(2 * sampleIntervalMs.load());
     reading.bmpOk = valid;
     if(valid){
-      // Library returns pressure in hPa, convert to Pa for internal math.
-      float pressureHpa = bmp5.pressure;
-      float pressurePa = pressureHpa * 100.0f;
+      float pressurePa = baroPressurePa;
       reading.pressurePa = pressurePa;
-      reading.bmpTemperatureC = bmp5.temperature;
+      reading.bmpTemperatureC = baroTemperatureC;
       if(!isnan(pressurePa)){
-        reading.altitudeM = computeAltitude(pressurePa, seaLevelPressureHpa);
-      }
-    } else {
-      static unsigned long lastLog = 0;
-      unsigned long now = millis();
-      if(now - lastLog > 5000){
-        Serial.println("BMP580 performReading() timed out or failed");
-        lastLog = now;
+        reading.altitudeM = computeAltitude(pressurePa, seaLevelPressureHpa.load());
       }
     }
   }
@@ -118,6 +346,35 @@ bool WeatherService::performReadings(WeatherReading &reading){
   return hasValid;
 }
 
+bool WeatherService::fetchHygrometer(unsigned long now, float &temperatureC, float &humidity){
+  float t = NAN;
+  float h = NAN;
+  switch(shtDriver.fetch(t, h)){
+    case Sht31Driver::FetchResult::Ok:
+      shtTemperatureC = t;
+      shtHumidity = h;
+      shtCollectedAt = now;
+      shtValid = true;
+      shtErrors = 0;
+      break;
+    case Sht31Driver::FetchResult::NoData:
+      break; // sensor has not finished its next measurement yet
+    case Sht31Driver::FetchResult::BusError:
+    case Sht31Driver::FetchResult::CrcError:
+      if(++shtErrors >= 3){
+        Serial.println("SHT31 fetch failing, restarting periodic mode");
+        shtDriver.startPeriodic(samplingCfg.shtRate, samplingCfg.shtRepeatability);
+        shtErrors = 0;
+      }
+      break;
+  }
+  long age = static_cast<long>(now - shtCollectedAt);
+  if(!shtValid || age > static_cast<long>(2 * sampleIntervalMs.load())) return false;
+  temperatureC = shtTemperatureC;
+  humidity = shtHumidity;
+  return true;
+}
+
 float WeatherService::computeDewPoint(float temperatureC, float humidity){
   if(isnan(temperatureC) || isnan(humidity) || humidity <= 0.0f || humidity > 100.0f){
     return NAN;
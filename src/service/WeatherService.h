@@ -4,6 +4,11 @@
 #include <Wire.h>
 #include <Adafruit_SHT31.h>
 #include <Adafruit_BMP5xx.h>
+#include <atomic>
+
+#include "common/SeqSnapshot.h"
+#include "Bmp580Driver.h"
+#include "Sht31Driver.h"
 
 struct WeatherReading {
   bool shtPresent = false;
@@ -17,34 +22,123 @@ struct WeatherReading {
   float altitudeM = NAN;
   float bmpTemperatureC = NAN;
   unsigned long collectedAtMs = 0;
+  uint32_t sequence = 0;     // Snapshot sequence, 0 until the first sample
+};
+
+enum class BmpAcquisition : uint8_t {
+  Forced, // One triggered conversion per sample
+  Fifo,   // Normal mode at bmpFifoOdr, FIFO drained and decimated per sample
+};
+
+enum class ShtAcquisition : uint8_t {
+  SingleShot, // One clock-stretched measurement per sample
+  Periodic,   // Sensor-paced measurements, one FETCH DATA per sample
+};
+
+struct WeatherSamplingConfig {
+  uint32_t sampleIntervalMs = 2000; // Sampler task period
+  uint32_t taskStackBytes = 4096;
+  UBaseType_t taskPriority = 1;
+  int8_t bmpDrdyPin = -1;           // GPIO wired to BMP580 INT, -1 to poll
+  uint16_t bmpConversionMs = 45;    // Expected forced conversion time (OSR 8x/16x)
+  uint16_t bmpTimeoutMs = 250;      // Give up on a conversion after this long
+  uint16_t bmpBackoffMinMs = 500;   // First retry delay after a failure
+  uint32_t bmpBackoffMaxMs = 30000; // Retry delay ceiling
+  BmpAcquisition bmpMode = BmpAcquisition::Forced;
+  uint8_t bmpFifoOdr = 0x18;        // BMP580 ODR code, 0x18 = 5 Hz; begin() slows it so ODR x interval fits the 16-frame FIFO
+  ShtAcquisition shtMode = ShtAcquisition::Periodic;
+  Sht31Driver::Rate shtRate = Sht31Driver::Rate::Mps1; // Keep at least one measurement per sample interval
+  Sht31Driver::Repeatability shtRepeatability = Sht31Driver::Repeatability::High;
+};
+
+enum class BaroState : uint8_t {
+  Idle,
+  Converting,
+  Backoff,
 };
 
 class WeatherService {
 public:
-  bool begin(TwoWire &wire = Wire);
+  bool begin(TwoWire &wire = Wire, const WeatherSamplingConfig &cfg = WeatherSamplingConfig{});
+
+  // Copies the latest published sample; never touches the I2C bus when the
+  // sampler task is running, otherwise samples first under a mutex. Returns
+  // false if that sample failed.
   bool read(WeatherReading &out);
+  uint32_t sequence() const { return snapshot.sequence(); }
 
   bool hasSHT() const { return shtAvailable; }
   bool hasBMP() const { return bmpAvailable; }
 
   void setSeaLevelPressure(float hPa);
-  float seaLevelPressure() const { return seaLevelPressureHpa; }
+  float seaLevelPressure() const { return seaLevelPressureHpa.load(); }
+
+  void setSampleInterval(uint32_t ms);
+  uint32_t sampleInterval() const { return sampleIntervalMs.load(); }
+  bool samplerRunning() const { return samplerHandle != nullptr; }
 
-  const WeatherReading &latest() const { return lastReading; }
-  unsigned long lastSampleMs() const { return lastSampleTimestamp; }
+  WeatherReading latest() const;
+  unsigned long lastSampleMs() const { return latest().collectedAtMs; }
+
+  BaroState barometerState() const { return baroState; }
+  uint16_t barometerFailures() const { return baroFailures; }
+  uint16_t barometerFramesPerSample() const { return baroFrames; }
 
 private:
+  struct Sample {
+    WeatherReading reading;
+    bool ok = false;
+  };
+
+  static void samplerTask(void *arg);
+  static void IRAM_ATTR onBaroDataReady(void *arg);
+  void sampleOnce();
+  void stepBarometer(unsigned long now);
+  void awaitBarometer();
+  void drainBarometerFifo(unsigned long now);
+  void failBarometer(unsigned long now, const char *reason);
+  bool fetchHygrometer(unsigned long now, float &temperatureC, float &humidity);
   bool performReadings(WeatherReading &reading);
   static float computeDewPoint(float temperatureC, float humidity);
   static float computeAltitude(float pressurePa, float seaLevelHpa);
 
   bool shtAvailable = false;
   bool bmpAvailable = false;
-  float seaLevelPressureHpa = 1013.25f;
-  unsigned long lastSampleTimestamp = 0;
+  std::atomic<float> seaLevelPressureHpa{1013.25f};
+  std::atomic<uint32_t> sampleIntervalMs{2000};
 
   TwoWire *wireRef = nullptr;
   Adafruit_SHT31 sht31;
   Adafruit_BMP5xx bmp5;
-  WeatherReading lastReading;
+  TaskHandle_t samplerHandle = nullptr;
+  SemaphoreHandle_t inlineMutex = nullptr; // Serialises read() sampling when no task runs
+  WeatherSamplingConfig samplingCfg;
+
+  // Forced-conversion state machine; stepped only by the sampling context.
+  Bmp580Driver bmpDriver;
+  BaroState baroState = BaroState::Idle;
+  unsigned long baroTriggeredAt = 0;
+  unsigned long baroRetryAt = 0;
+  uint16_t baroFailures = 0;
+  std::atomic<bool> baroIrq{false};
+  bool baroValid = false;
+  float baroTemperatureC = NAN;
+  float baroPressurePa = NAN;
+  unsigned long baroCollectedAt = 0;
+  uint16_t baroFrames = 0;
+
+  // Periodic SHT31 state; latest fetched pair is reused until it goes stale.
+  Sht31Driver shtDriver;
+  bool shtPeriodic = false;
+  uint8_t shtErrors = 0;
+  float shtTemperatureC = NAN;
+  float shtHumidity = NAN;
+  unsigned long shtCollectedAt = 0;
+  bool shtValid = false;
+
+  // Owned by the sampler task (or read() under inlineMutex when no task runs).
+  WeatherReading lastGood;
+  bool hasGood = false;
+
+  SeqSnapshot<Sample> snapshot;
 };
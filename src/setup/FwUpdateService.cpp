@@ -8,6 +8,8 @@
 #include <HTTPClient.h>
 #include <AsyncJson.h>
 
+#include "common/PerfStats.h"
+
 FwUpdateService::FwUpdateService() {
   config.repo = "";
   config.board = "";
@@ -40,23 +42,23 @@ bool FwUpdateService::save() {
 }
 
 void FwUpdateService::registerRoutes(AsyncWebServer& server) {
-  server.on("/api/fwupdate/config", HTTP_GET, [this](AsyncWebServerRequest* req) {
+  server.on("/api/fwupdate/config", HTTP_GET, timed("GET /api/fwupdate/config", [this](AsyncWebServerRequest* req) {
       DynamicJsonDocument doc(256);
     doc["repo"] = config.repo;
     doc["board"] = config.board;
     String out;
     serializeJson(doc, out);
     req->send(200, "application/json", out);
-  });
+  }));
     // Use AsyncCallbackJsonWebHandler for JSON POST
-    server.addHandler(new AsyncCallbackJsonWebHandler("/api/fwupdate/config", [this](AsyncWebServerRequest *req, JsonVariant &json) {
+    server.addHandler(new AsyncCallbackJsonWebHandler("/api/fwupdate/config", timed("POST /api/fwupdate/config", [this](AsyncWebServerRequest *req, JsonVariant &json) {
       JsonObject obj = json.as<JsonObject>();
       config.repo = obj["repo"] | config.repo;
       config.board = obj["board"] | config.board;
       save();
       req->send(200, "application/json", "{\"ok\":true}");
-    }));
-  server.on("/api/fwupdate/check", HTTP_GET, [this](AsyncWebServerRequest* req) {
+    })));
+  server.on("/api/fwupdate/check", HTTP_GET, timed("GET /api/fwupdate/check", [this](AsyncWebServerRequest* req) {
     String newVersion, assetUrl, errorMsg;
     DynamicJsonDocument doc(512);
     doc["repo"] = config.repo;
@@ -75,8 +77,8 @@ void FwUpdateService::registerRoutes(AsyncWebServer& server) {
     String out;
     serializeJson(doc, out);
     req->send(200, "application/json", out);
-  });
-  server.addHandler(new AsyncCallbackJsonWebHandler("/api/fwupdate/update", [this](AsyncWebServerRequest *req, JsonVariant &json) {
+  }));
+  server.addHandler(new AsyncCallbackJsonWebHandler("/api/fwupdate/update", timed("POST /api/fwupdate/update", [this](AsyncWebServerRequest *req, JsonVariant &json) {
     JsonObject obj = json.as<JsonObject>();
     String version = obj["version"] | "";
     String newVersion, assetUrl, errorMsg;
@@ -99,7 +101,7 @@ void FwUpdateService::registerRoutes(AsyncWebServer& server) {
     } else {
       req->send(400, "application/json", String("{\"error\":\"") + errorMsg + "\"}");
     }
-  }));
+  })));
 }
 
 // --- GitHub API logic ---
@@ -189,6 +191,10 @@ bool FwUpdateService::downloadAndUpdate(const String& assetUrl, String& errorMsg
   config.lastCheck = millis()/1000;
   save();
   http.end();
-  ESP.restart();
+  if (requestRestart) {
+    requestRestart();
+  } else {
+    ESP.restart();
+  }
   return true;
 }
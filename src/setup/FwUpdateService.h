@@ -2,6 +2,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
+#include <functional>
 
 struct FwUpdateConfig {
   String repo;
@@ -19,6 +20,9 @@ public:
   FwUpdateConfig config;
   bool checkForUpdate(String& newVersion, String& assetUrl, String& errorMsg);
   bool downloadAndUpdate(const String& assetUrl, String& errorMsg);
+  // Asks the owner for the post-update restart, which it runs from its own
+  // task once buffers are flushed; without it the update restarts at once.
+  std::function<void()> requestRestart;
 private:
   String _configPath = "/fwupdate.json";
 };
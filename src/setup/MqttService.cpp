@@ -8,55 +8,51 @@
 #include "ManagedWiFi.h"
 
 namespace {
-constexpr const char *NS = "mqtt";
 constexpr unsigned long RECONNECT_INTERVAL_MS = 5000;
+
+constexpr ConfigField<MqttConfig> MQTT_FIELDS[] = {
+  CONFIG_FIELD(MqttConfig, enabled, "enabled", nullptr, "enabled", 0, 1),
+  CONFIG_FIELD(MqttConfig, haDiscovery, "haDiscovery", nullptr, "ha", 0, 1),
+  CONFIG_FIELD(MqttConfig, publishIntervalMs, "publishIntervalMs", nullptr, "pubInt", 1000, 86400000),
+  CONFIG_FIELD(MqttConfig, host, "host", nullptr, "host", 0, 128),
+  CONFIG_FIELD(MqttConfig, port, "port", nullptr, "port", 1, 65535),
+  CONFIG_FIELD(MqttConfig, username, "username", nullptr, "user", 0, 64),
+  CONFIG_FIELD(MqttConfig, password, "password", nullptr, "pass", 0, 64),
+  CONFIG_FIELD(MqttConfig, baseTopic, "baseTopic", nullptr, "base", 0, 128),
+  CONFIG_FIELD(MqttConfig, deviceName, "deviceName", nullptr, "name", 0, 64),
+  CONFIG_FIELD(MqttConfig, city, "city", nullptr, "city", 0, 64),
+  CONFIG_FIELD(MqttConfig, country, "country", nullptr, "country", 0, 64),
+};
+
+void sanitizeBaseTopic(MqttConfig &config) {
+  while (config.baseTopic.endsWith("/")) {
+    config.baseTopic.remove(config.baseTopic.length() - 1);
+  }
+}
 }
 
+const ConfigSchema<MqttConfig> mqttConfigSchema(MQTT_FIELDS);
+
 void MqttService::begin(ManagedWiFi *wifi) {
   wifiRef = wifi;
   loadConfig();
-  sanitizeBaseTopic();
-}
-
-void MqttService::sanitizeBaseTopic() {
-  while (config.baseTopic.endsWith("/")) {
-    config.baseTopic.remove(config.baseTopic.length() - 1);
-  }
+  mqttClient.setCallback([this](char *topic, uint8_t *payload, unsigned int length) {
+    dispatch(topic, payload, length);
+  });
 }
 
 void MqttService::loadConfig() {
-  prefs.begin(NS, true);
-  config.enabled = prefs.getBool("enabled", false);
-  config.haDiscovery = prefs.getBool("ha", true);
-  config.publishIntervalMs = prefs.getULong("pubInt", 30000);
-  config.host = prefs.getString("host", "");
-  config.port = static_cast<uint16_t>(prefs.getUShort("port", 1883));
-  config.username = prefs.getString("user", "");
-  config.password = prefs.getString("pass", "");
-  config.baseTopic = prefs.getString("base", "homeassistant/weatherstation");
-  config.deviceName = prefs.getString("name", "ESP Weather Station");
-  config.city = prefs.getString("city", "");
-  config.country = prefs.getString("country", "");
-  prefs.end();
-  sanitizeBaseTopic();
+  MqttConfig loaded;
+  store.load(mqttConfigSchema, loaded);
+  sanitizeBaseTopic(loaded);
+  config.publish(loaded);
 }
 
 bool MqttService::saveConfig(const MqttConfig &next) {
-  prefs.begin(NS, false);
-  prefs.putBool("enabled", next.enabled);
-  prefs.putBool("ha", next.haDiscovery);
-  prefs.putULong("pubInt", next.publishIntervalMs);
-  prefs.putString("host", next.host);
-  prefs.putUShort("port", next.port);
-  prefs.putString("user", next.username);
-  prefs.putString("pass", next.password);
-  prefs.putString("base", next.baseTopic);
-  prefs.putString("name", next.deviceName);
-  prefs.putString("city", next.city);
-  prefs.putString("country", next.country);
-  prefs.end();
-  config = next;
-  sanitizeBaseTopic();
+  MqttConfig sanitized = next;
+  sanitizeBaseTopic(sanitized);
+  config.publish(sanitized);
+  store.stage(mqttConfigSchema, sanitized);
   lastReconnectAttempt = 0;
   return true;
 }
@@ -69,11 +65,11 @@ String MqttService::deviceId() const {
 }
 
 String MqttService::stateTopic() const {
-  return config.baseTopic + "/telemetry";
+  return baseTopic() + "/telemetry";
 }
 
 String MqttService::statusTopic() const {
-  return config.baseTopic + "/status";
+  return baseTopic() + "/status";
 }
 
 bool MqttService::publishStatus(const char *status, bool retain) {
@@ -81,12 +77,17 @@ bool MqttService::publishStatus(const char *status, bool retain) {
 }
 
 bool MqttService::publish(const String &topic, const String &payload, bool retain) {
+  return publish(topic, reinterpret_cast<const uint8_t *>(payload.c_str()), payload.length(), retain);
+}
+
+bool MqttService::publish(const String &topic, const uint8_t *payload, size_t length, bool retain) {
   if (!mqttClient.connected()) return false;
-  return mqttClient.publish(topic.c_str(), reinterpret_cast<const uint8_t *>(payload.c_str()), payload.length(), retain);
+  return mqttClient.publish(topic.c_str(), payload, length, retain);
 }
 
 bool MqttService::ensureConnected() {
-  if (!config.enabled || !wifiRef || !wifiRef->isConnected()) {
+  const MqttConfig cfg = config.get();
+  if (!cfg.enabled || !wifiRef || !wifiRef->isConnected()) {
     return false;
   }
   if (mqttClient.connected()) {
@@ -97,23 +98,53 @@ bool MqttService::ensureConnected() {
     return false;
   }
   lastReconnectAttempt = now;
-  mqttClient.setServer(config.host.c_str(), config.port);
-  mqttClient.setBufferSize(2048);
+  serverHost = cfg.host;
+  mqttClient.setServer(serverHost.c_str(), cfg.port);
+  // Telemetry with the full outlook runs past 2 KB; topic and header need room too.
+  mqttClient.setBufferSize(3072);
   mqttClient.setKeepAlive(30);
   mqttClient.setSocketTimeout(10);
   String clientId = String("esp32-") + deviceId();
-  const char *user = config.username.length() ? config.username.c_str() : nullptr;
-  const char *pass = config.password.length() ? config.password.c_str() : nullptr;
+  const char *user = cfg.username.length() ? cfg.username.c_str() : nullptr;
+  const char *pass = cfg.password.length() ? cfg.password.c_str() : nullptr;
   String willTopic = statusTopic();
   bool ok = mqttClient.connect(clientId.c_str(), user, pass, willTopic.c_str(), 1, true, "offline");
   if (ok) {
     publishStatus("online", true);
+    resubscribe();
   }
   return ok;
 }
 
+bool MqttService::subscribe(const char *suffix, MessageHandler handler, void *ctx) {
+  if (subscriptionCount >= MAX_SUBSCRIPTIONS) return false;
+  subscriptions[subscriptionCount++] = Subscription{suffix, handler, ctx};
+  if (mqttClient.connected()) {
+    mqttClient.subscribe(DeviceHelpers::makeTopic(baseTopic(), suffix).c_str());
+  }
+  return true;
+}
+
+void MqttService::resubscribe() {
+  const String base = baseTopic();
+  for (uint8_t i = 0; i < subscriptionCount; ++i) {
+    mqttClient.subscribe(DeviceHelpers::makeTopic(base, subscriptions[i].suffix).c_str());
+  }
+}
+
+void MqttService::dispatch(const char *topic, const uint8_t *payload, unsigned int length) {
+  const String base = baseTopic();
+  for (uint8_t i = 0; i < subscriptionCount; ++i) {
+    const Subscription &sub = subscriptions[i];
+    if (DeviceHelpers::makeTopic(base, sub.suffix) == topic) {
+      sub.handler(sub.ctx, payload, length);
+      return;
+    }
+  }
+}
+
 bool MqttService::isConnected() {
-  if (!config.enabled || !wifiRef || !wifiRef->isConnected()) {
+  if (!config.read()->enabled || !wifiRef || !wifiRef->isConnected()) {
     return false;
   }
   if (!mqttClient.connected()) {
@@ -130,7 +161,8 @@ void MqttService::disconnect() {
 }
 
 void MqttService::loop() {
-  if (!config.enabled) {
+  store.loop();
+  if (!config.read()->enabled) {
     disconnect();
     return;
   }
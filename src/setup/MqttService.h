@@ -4,7 +4,10 @@
 #include <WiFiClient.h>
 #include "../common/DeviceHelpers.h"
 #include <PubSubClient.h>
-#include <Preferences.h>
+
+#include "common/ConfigSchema.h"
+#include "common/ConfigStore.h"
+#include "common/RcuSnapshot.h"
 
 class ManagedWiFi;
 
@@ -22,36 +25,62 @@ struct MqttConfig {
   String country;
 };
 
+// Keys and ranges for the HTTP API and NVS.
+extern const ConfigSchema<MqttConfig> mqttConfigSchema;
+
 // Handles MQTT config persistence and connection management.
 class MqttService {
 public:
+  // Runs on the loop task, from loop(), for a message on a subscribed topic.
+  typedef void (*MessageHandler)(void *ctx, const uint8_t *payload, unsigned int length);
+  static constexpr size_t MAX_SUBSCRIPTIONS = 4;
+
   void begin(ManagedWiFi *wifi);
   void loop();
 
-  MqttConfig currentConfig() const { return config; }
+  MqttConfig currentConfig() const { return config.get(); }
   bool saveConfig(const MqttConfig &next);
   void loadConfig();
+  void flushConfig() { store.flush(); }
   bool isConnected();
 
   PubSubClient &client() { return mqttClient; }
 
   String deviceId() const;
-  String baseTopic() const { return config.baseTopic; }
+  String baseTopic() const { return config.read()->baseTopic; }
   String statusTopic() const;
   String stateTopic() const; // kept for compatibility with publishers
 
   bool publish(const String &topic, const String &payload, bool retain = false);
+  // Publishes straight from the caller's buffer.
+  bool publish(const String &topic, const uint8_t *payload, size_t length, bool retain = false);
   bool publishStatus(const char *status, bool retain = true);
+  // Routes <baseTopic>/<suffix> to handler; the topic is subscribed again
+  // on every (re)connect. Register during setup; false when the table is
+  // full.
+  bool subscribe(const char *suffix, MessageHandler handler, void *ctx);
 
 private:
+  struct Subscription {
+    const char *suffix;
+    MessageHandler handler;
+    void *ctx;
+  };
+
   bool ensureConnected();
   void disconnect();
-  void sanitizeBaseTopic();
+  void resubscribe();
+  void dispatch(const char *topic, const uint8_t *payload, unsigned int length);
 
   ManagedWiFi *wifiRef = nullptr;
-  Preferences prefs;
+  ConfigStore store{"mqtt"};
   WiFiClient wifiClient;
   PubSubClient mqttClient{wifiClient};
-  MqttConfig config;
-  unsigned long lastReconnectAttempt = 0;
+  // Read from the web, MQTT and publisher tasks; see RcuSnapshot.
+  RcuSnapshot<MqttConfig> config;
+  // PubSubClient keeps the host pointer, so it points here, not into config.
+  String serverHost;
+  volatile unsigned long lastReconnectAttempt = 0;
+  Subscription subscriptions[MAX_SUBSCRIPTIONS];
+  uint8_t subscriptionCount = 0;
 };
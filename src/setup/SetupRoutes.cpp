@@ -11,6 +11,7 @@
 
 #include "ManagedWiFi.h"
 #include "common/ResponseHelpers.h"
+#include "common/PerfStats.h"
 #include "setup/MqttService.h"
 #include "setup/FwUpdateService.h"
 
@@ -33,12 +34,12 @@ FwUpdateService fwUpdateService;
 void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::function<void()> onOtaSuccess, MqttService *mqtt) {
       // (logs endpoint removed)
     // Healthcheck endpoint for OTA scripts
-    server.on("/api/hc", HTTP_GET, [](AsyncWebServerRequest *request) {
+    server.on("/api/hc", HTTP_GET, timed("GET /api/hc", [](AsyncWebServerRequest *request) {
       request->send(204);
-    });
+    }));
   fwUpdateService.load();
   fwUpdateService.registerRoutes(server);
-  server.on("/api/system/state", HTTP_GET, [&wifiManager](AsyncWebServerRequest *request) {
+  server.on("/api/system/state", HTTP_GET, timed("GET /api/system/state", [&wifiManager](AsyncWebServerRequest *request) {
     sendJson(request, [&wifiManager](JsonVariant json) {
       JsonObject obj = json.as<JsonObject>();
       obj["connected"] = wifiManager.isConnected();
@@ -59,9 +60,9 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
         obj["bssid"] = nullptr;
       }
     });
-  });
+  }));
 
-  auto *hostNameHandler = new AsyncCallbackJsonWebHandler("/api/system/hostname", [&wifiManager](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *hostNameHandler = new AsyncCallbackJsonWebHandler("/api/system/hostname", timed("POST /api/system/hostname", [&wifiManager](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!json.is<JsonObject>()) {
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
@@ -83,34 +84,23 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
       return;
     }
     request->send(200, "application/json", "{\"status\":\"saved\"}");
-  });
+  }));
   hostNameHandler->setMethod(HTTP_POST);
   server.addHandler(hostNameHandler);
 
-  server.on("/api/mqtt/config", HTTP_GET, [mqtt](AsyncWebServerRequest *request) {
+  server.on("/api/mqtt/config", HTTP_GET, timed("GET /api/mqtt/config", [mqtt](AsyncWebServerRequest *request) {
     if (!mqtt) {
       request->send(500, "application/json", "{\"error\":\"mqtt not available\"}");
       return;
     }
     sendJson(request, [mqtt](JsonVariant json) {
       JsonObject obj = json.as<JsonObject>();
-      MqttConfig cfg = mqtt->currentConfig();
-      obj["enabled"] = cfg.enabled;
-      obj["haDiscovery"] = cfg.haDiscovery;
-      obj["publishIntervalMs"] = cfg.publishIntervalMs;
-      obj["host"] = cfg.host;
-      obj["port"] = cfg.port;
-      obj["username"] = cfg.username;
-      obj["password"] = cfg.password;
-      obj["baseTopic"] = cfg.baseTopic;
-      obj["deviceName"] = cfg.deviceName;
-      obj["city"] = cfg.city;
-      obj["country"] = cfg.country;
+      mqttConfigSchema.write(obj, mqtt->currentConfig());
       obj["connected"] = mqtt->isConnected();
     });
-  });
+  }));
 
-  auto *mqttSaveHandler = new AsyncCallbackJsonWebHandler("/api/mqtt/config", [mqtt](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *mqttSaveHandler = new AsyncCallbackJsonWebHandler("/api/mqtt/config", timed("POST /api/mqtt/config", [mqtt](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!mqtt) {
       request->send(500, "application/json", "{\"error\":\"mqtt not available\"}");
       return;
@@ -119,31 +109,20 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
     }
-    JsonObject obj = json.as<JsonObject>();
     MqttConfig cfg = mqtt->currentConfig();
-    cfg.enabled = obj["enabled"].is<bool>() ? obj["enabled"].as<bool>() : cfg.enabled;
-    cfg.haDiscovery = obj["haDiscovery"].is<bool>() ? obj["haDiscovery"].as<bool>() : cfg.haDiscovery;
-    if (obj["publishIntervalMs"].is<unsigned>()) cfg.publishIntervalMs = obj["publishIntervalMs"].as<unsigned>();
-    if (obj["host"].is<const char *>()) cfg.host = obj["host"].as<const char *>();
-    if (obj["port"].is<unsigned>()) cfg.port = obj["port"].as<unsigned>();
-    if (obj["username"].is<const char *>()) cfg.username = obj["username"].as<const char *>();
-    if (obj["password"].is<const char *>()) cfg.password = obj["password"].as<const char *>();
-    if (obj["baseTopic"].is<const char *>()) cfg.baseTopic = obj["baseTopic"].as<const char *>();
-    if (obj["deviceName"].is<const char *>()) cfg.deviceName = obj["deviceName"].as<const char *>();
-    if (obj["city"].is<const char *>()) cfg.city = obj["city"].as<const char *>();
-    if (obj["country"].is<const char *>()) cfg.country = obj["country"].as<const char *>();
+    mqttConfigSchema.apply(json.as<JsonObjectConst>(), cfg);
     mqtt->saveConfig(cfg);
     request->send(200, "application/json", "{\"status\":\"saved\"}");
-  });
+  }));
   mqttSaveHandler->setMethod(HTTP_POST);
   server.addHandler(mqttSaveHandler);
 
-  server.on("/api/wifi/scan", HTTP_POST, [&wifiManager](AsyncWebServerRequest *request) {
+  server.on("/api/wifi/scan", HTTP_POST, timed("POST /api/wifi/scan", [&wifiManager](AsyncWebServerRequest *request) {
     wifiManager.requestScan();
     request->send(202, "application/json", "{\"status\":\"started\"}");
-  });
+  }));
 
-  server.on("/api/wifi/scan", HTTP_GET, [&wifiManager](AsyncWebServerRequest *request) {
+  server.on("/api/wifi/scan", HTTP_GET, timed("GET /api/wifi/scan", [&wifiManager](AsyncWebServerRequest *request) {
     sendJson(request, [&wifiManager](JsonVariant json) {
       JsonObject obj = json.as<JsonObject>();
       obj["inProgress"] = wifiManager.scanInProgress();
@@ -156,9 +135,9 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
         item["channel"] = net.channel;
       }
     });
-  });
+  }));
 
-  auto *wifiConnectHandler = new AsyncCallbackJsonWebHandler("/api/wifi/connect", [&wifiManager](AsyncWebServerRequest *request, JsonVariant &json) {
+  auto *wifiConnectHandler = new AsyncCallbackJsonWebHandler("/api/wifi/connect", timed("POST /api/wifi/connect", [&wifiManager](AsyncWebServerRequest *request, JsonVariant &json) {
     if (!json.is<JsonObject>()) {
       request->send(400, "application/json", "{\"error\":\"invalid json\"}");
       return;
@@ -176,17 +155,17 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
     } else {
       request->send(400, "application/json", "{\"error\":\"save failed\"}");
     }
-  });
+  }));
   wifiConnectHandler->setMethod(HTTP_POST);
   server.addHandler(wifiConnectHandler);
 
-  server.on("/api/wifi/forget", HTTP_POST, [&wifiManager](AsyncWebServerRequest *request) {
+  server.on("/api/wifi/forget", HTTP_POST, timed("POST /api/wifi/forget", [&wifiManager](AsyncWebServerRequest *request) {
     wifiManager.forgetCredentials();
     request->send(200, "application/json", "{\"status\":\"cleared\"}");
-  });
+  }));
 
   server.on("/api/ota/upload", HTTP_POST,
-            [onOtaSuccess](AsyncWebServerRequest *request) {
+            timed("POST /api/ota/upload", [onOtaSuccess](AsyncWebServerRequest *request) {
               bool success = Update.isFinished() && !Update.hasError();
               String body;
               int code = success ? 200 : 500;
@@ -201,7 +180,7 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
               if (success && onOtaSuccess) {
                 onOtaSuccess();
               }
-            },
+            }),
             [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
               if (!index) {
                 Serial.printf("OTA update started: %s\n", filename.c_str());
@@ -224,7 +203,7 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
             });
 
   server.on("/api/fs/upload", HTTP_POST,
-            [onOtaSuccess](AsyncWebServerRequest *request) {
+            timed("POST /api/fs/upload", [onOtaSuccess](AsyncWebServerRequest *request) {
               bool success = Update.isFinished() && !Update.hasError();
               String body;
               int code = success ? 200 : 500;
@@ -239,7 +218,7 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
               if (success && onOtaSuccess) {
                 onOtaSuccess();
               }
-            },
+            }),
             [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
               if (!index) {
                 Serial.printf("FS OTA update started: %s\n", filename.c_str());
@@ -271,23 +250,23 @@ void registerSetupRoutes(AsyncWebServer &server, ManagedWiFi &wifiManager, std::
   setupHandler.setDefaultFile("wifi.html");
   server.serveStatic("/setup/setup.css", LittleFS, "/setup/setup.css");
 
-  server.on("/wifi.html", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/wifi.html", HTTP_GET, timed("GET /wifi.html", [](AsyncWebServerRequest *request) {
     request->redirect("/setup/wifi.html");
-  });
+  }));
 
-  server.on("/setup", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/setup", HTTP_GET, timed("GET /setup", [](AsyncWebServerRequest *request) {
     request->redirect("/setup/");
-  });
+  }));
 
-  server.on("/ota.html", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/ota.html", HTTP_GET, timed("GET /ota.html", [](AsyncWebServerRequest *request) {
     request->redirect("/setup/ota.html");
-  });
+  }));
 
-  server.on("/styles.css", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/styles.css", HTTP_GET, timed("GET /styles.css", [](AsyncWebServerRequest *request) {
     request->redirect("/setup/setup.css");
-  });
+  }));
 
-  server.on("/ui.js", HTTP_GET, [](AsyncWebServerRequest *request) {
+  server.on("/ui.js", HTTP_GET, timed("GET /ui.js", [](AsyncWebServerRequest *request) {
     request->redirect("/setup/setup.js");
-  });
+  }));
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core that the sources built
+// by the native test env use: String, NAN/isnan, millis(), Serial.printf
+// and FreeRTOS mutexes. Wire.h and Preferences.h next to it replace
+// TwoWire and NVS.
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <math.h>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+class String {
+public:
+  String() = default;
+  String(const char *s) : str(s ? s : "") {}
+  explicit String(int v) : str(std::to_string(v)) {}
+  explicit String(unsigned v) : str(std::to_string(v)) {}
+
+  unsigned length() const { return static_cast<unsigned>(str.size()); }
+  const char *c_str() const { return str.c_str(); }
+  bool concat(const char *s, unsigned n) {
+    str.append(s, n);
+    return true;
+  }
+
+  String &operator+=(const String &s) { str += s.str; return *this; }
+  String &operator+=(const char *s) { str += s; return *this; }
+  String &operator+=(char c) { str += c; return *this; }
+  String &operator+=(int v) { str += std::to_string(v); return *this; }
+  String &operator+=(unsigned v) { str += std::to_string(v); return *this; }
+
+  bool operator==(const char *s) const { return str == s; }
+  bool operator==(const String &s) const { return str == s.str; }
+  bool operator!=(const String &s) const { return str != s.str; }
+
+  friend String operator+(String a, const String &b) { return a += b; }
+  friend String operator+(String a, const char *b) { return a += b; }
+  friend String operator+(String a, int b) { return a += b; }
+
+private:
+  std::string str;
+};
+
+// Tests that need to step time set this; 0 follows the host clock.
+inline unsigned long &fakeMillis() {
+  static unsigned long t = 0;
+  return t;
+}
+
+inline unsigned long millis() {
+  using namespace std::chrono;
+  if (fakeMillis()) return fakeMillis();
+  return static_cast<unsigned long>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+struct HostSerial {
+  int printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+  }
+};
+static HostSerial Serial;
+
+typedef std::mutex *SemaphoreHandle_t;
+constexpr uint32_t portMAX_DELAY = UINT32_MAX;
+// Never deleted on the device either; kept for the life of the process.
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+  static std::deque<std::mutex> pool;
+  return &pool.emplace_back();
+}
+inline bool xSemaphoreTake(SemaphoreHandle_t m, uint32_t) {
+  m->lock();
+  return true;
+}
+inline bool xSemaphoreGive(SemaphoreHandle_t m) {
+  m->unlock();
+  return true;
+}
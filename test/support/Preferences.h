@@ -0,0 +1,109 @@
+#pragma once
+
+// Host stand-in for the ESP32 Preferences (NVS) API: every namespace lives
+// in one process-wide map that tests can inspect, corrupt or wipe, with
+// counters for the reads and writes ConfigStore is meant to keep low.
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+  typedef std::vector<uint8_t> Bytes;
+  struct Flash {
+    std::map<std::string, std::map<std::string, Bytes>> spaces;
+    unsigned blobReads = 0; // getBytes()
+    unsigned keyReads = 0;  // typed getters
+    unsigned writes = 0;    // successful puts
+    bool failWrites = false;
+
+    void clear() { *this = Flash(); }
+  };
+  static Flash &flash() {
+    static Flash f;
+    return f;
+  }
+
+  // Like NVS, a read-only open of a namespace never written fails.
+  bool begin(const char *name, bool readOnly = false) {
+    if (readOnly && !flash().spaces.count(name)) return false;
+    ns = name;
+    if (!readOnly) flash().spaces[ns];
+    open = true;
+    return true;
+  }
+  void end() { open = false; }
+
+  size_t getBytes(const char *key, void *buf, size_t maxLen) {
+    ++flash().blobReads;
+    const Bytes *v = find(key);
+    if (!v || v->size() > maxLen) return 0;
+    memcpy(buf, v->data(), v->size());
+    return v->size();
+  }
+  size_t putBytes(const char *key, const void *value, size_t len) {
+    const uint8_t *p = static_cast<const uint8_t *>(value);
+    return put(key, Bytes(p, p + len)) ? len : 0;
+  }
+
+  bool getBool(const char *key, bool def = false) { return get<uint8_t>(key, def) != 0; }
+  uint8_t getUChar(const char *key, uint8_t def = 0) { return get(key, def); }
+  uint16_t getUShort(const char *key, uint16_t def = 0) { return get(key, def); }
+  uint32_t getULong(const char *key, uint32_t def = 0) { return get(key, def); }
+  double getDouble(const char *key, double def = NAN) { return get(key, def); }
+  String getString(const char *key, const String &def = String()) {
+    ++flash().keyReads;
+    const Bytes *v = find(key);
+    if (!v) return def;
+    String s;
+    s.concat(reinterpret_cast<const char *>(v->data()), static_cast<unsigned>(v->size()));
+    return s;
+  }
+
+  size_t putBool(const char *key, bool v) { return putValue(key, static_cast<uint8_t>(v)); }
+  size_t putUChar(const char *key, uint8_t v) { return putValue(key, v); }
+  size_t putUShort(const char *key, uint16_t v) { return putValue(key, v); }
+  size_t putULong(const char *key, uint32_t v) { return putValue(key, v); }
+  size_t putDouble(const char *key, double v) { return putValue(key, v); }
+  size_t putString(const char *key, const String &v) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(v.c_str());
+    return put(key, Bytes(p, p + v.length())) ? v.length() : 0;
+  }
+
+private:
+  const Bytes *find(const char *key) const {
+    auto space = flash().spaces.find(ns);
+    if (!open || space == flash().spaces.end()) return nullptr;
+    auto it = space->second.find(key);
+    return it == space->second.end() ? nullptr : &it->second;
+  }
+  bool put(const char *key, Bytes value) {
+    if (!open || flash().failWrites) return false;
+    flash().spaces[ns][key] = std::move(value);
+    ++flash().writes;
+    return true;
+  }
+  template <typename V>
+  V get(const char *key, V def) {
+    ++flash().keyReads;
+    const Bytes *v = find(key);
+    if (!v || v->size() != sizeof(V)) return def;
+    V out;
+    memcpy(&out, v->data(), sizeof(V));
+    return out;
+  }
+  template <typename V>
+  size_t putValue(const char *key, V v) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+    return put(key, Bytes(p, p + sizeof(V))) ? sizeof(V) : 0;
+  }
+
+  std::string ns;
+  bool open = false;
+};
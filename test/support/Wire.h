@@ -0,0 +1,49 @@
+#pragma once
+
+// Host stand-in for TwoWire: a register read (write of the register
+// address, repeated start, requestFrom) is answered by onRead, and
+// single-register writes are recorded.
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class TwoWire {
+public:
+  // Fills len bytes starting at reg; false makes requestFrom() return 0.
+  std::function<bool(uint8_t reg, uint8_t *dst, size_t len)> onRead;
+  std::vector<std::pair<uint8_t, uint8_t>> writes;
+  // Length of every requestFrom(), in order.
+  std::vector<size_t> reads;
+
+  void beginTransmission(uint8_t) { tx.clear(); }
+  size_t write(uint8_t b) {
+    tx.push_back(b);
+    return 1;
+  }
+  uint8_t endTransmission(bool stop = true) {
+    if (tx.empty()) return 4;
+    reg = tx[0];
+    if (stop && tx.size() == 2) writes.emplace_back(tx[0], tx[1]);
+    return 0;
+  }
+  size_t requestFrom(uint8_t, uint8_t len) {
+    reads.push_back(len);
+    rx.assign(len, 0);
+    pos = 0;
+    if (!onRead || !onRead(reg, rx.data(), len)) {
+      rx.clear();
+      return 0;
+    }
+    return len;
+  }
+  int read() { return pos < rx.size() ? rx[pos++] : -1; }
+
+private:
+  std::vector<uint8_t> tx;
+  std::vector<uint8_t> rx;
+  size_t pos = 0;
+  uint8_t reg = 0;
+};
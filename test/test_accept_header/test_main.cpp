@@ -0,0 +1,56 @@
+#include <unity.h>
+
+#include "common/AcceptHeader.h"
+
+// Accept header parsing behind wantsMsgPack().
+
+void setUp() {}
+void tearDown() {}
+
+void test_quality_of_most_specific_range() {
+  const char *accept = "text/html, application/*;q=0.4, */*;q=0.1, application/json;q=0.8";
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.8f, acceptQuality(accept, "application/json"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.4f, acceptQuality(accept, "application/msgpack"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality(accept, "text/html"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.1f, acceptQuality(accept, "image/png"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, acceptQuality("text/html", "application/json"));
+}
+
+void test_missing_header_accepts_everything() {
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality(nullptr, "application/json"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality("", "application/json"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality("  ", "application/json"));
+}
+
+void test_parameters_and_case() {
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5f, acceptQuality("Application/MsgPack ; charset=x ;Q=0.5", "application/msgpack"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality("application/msgpack;level=1", "application/msgpack"));
+  // Malformed and out-of-range q values.
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality("application/json;q=", "application/json"));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, acceptQuality("application/json;q=7", "application/json"));
+  // A substring is not a match.
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, acceptQuality("application/msgpack-ext", "application/msgpack"));
+}
+
+void test_prefers_msgpack() {
+  TEST_ASSERT_TRUE(prefersMsgPack("application/msgpack"));
+  TEST_ASSERT_TRUE(prefersMsgPack("application/x-msgpack, application/json;q=0.5"));
+  TEST_ASSERT_TRUE(prefersMsgPack("application/vnd.msgpack, */*;q=0.1"));
+  TEST_ASSERT_FALSE(prefersMsgPack(nullptr));
+  TEST_ASSERT_FALSE(prefersMsgPack("*/*"));
+  TEST_ASSERT_FALSE(prefersMsgPack("application/msgpack;q=0"));
+  TEST_ASSERT_FALSE(prefersMsgPack("application/msgpack;q=0, */*"));
+  TEST_ASSERT_FALSE(prefersMsgPack("application/msgpack, application/json"));
+  TEST_ASSERT_FALSE(prefersMsgPack("application/json, application/msgpack;q=0.9"));
+  TEST_ASSERT_FALSE(prefersMsgPack("application/cbor"));
+  TEST_ASSERT_FALSE(prefersMsgPack("text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_quality_of_most_specific_range);
+  RUN_TEST(test_missing_header_accepts_everything);
+  RUN_TEST(test_parameters_and_case);
+  RUN_TEST(test_prefers_msgpack);
+  return UNITY_END();
+}
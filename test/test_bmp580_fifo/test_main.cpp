@@ -0,0 +1,249 @@
+#include <unity.h>
+
+#include <deque>
+#include <vector>
+
+#include "service/Bmp580Driver.h"
+
+// Canned BMP580 FIFO contents replayed through the frame decoder, the
+// burst reads of drainFifo() and the trimmed-mean accumulator.
+
+namespace {
+
+constexpr uint8_t REG_FIFO_COUNT = 0x17;
+constexpr uint8_t REG_FIFO_DATA = 0x29;
+constexpr size_t WIRE_BUFFER = 128;
+
+using Bytes = std::vector<uint8_t>;
+
+// One frame as the sensor sends it: temperature (signed, 1/65536 C) then
+// pressure (1/64 Pa), each 24 bit little endian.
+void pushFrame(Bytes &out, float temperatureC, float pressurePa) {
+  const int32_t t = static_cast<int32_t>(lroundf(temperatureC * 65536.0f));
+  const uint32_t p = static_cast<uint32_t>(lroundf(pressurePa * 64.0f));
+  for (int i = 0; i < 3; ++i) out.push_back(static_cast<uint8_t>(static_cast<uint32_t>(t) >> (8 * i)));
+  for (int i = 0; i < 3; ++i) out.push_back(static_cast<uint8_t>(p >> (8 * i)));
+}
+
+void pushEmptyFrame(Bytes &out) { out.insert(out.end(), Bmp580Driver::FIFO_FRAME_BYTES, 0x7F); }
+
+// A sensor whose FIFO holds `fifo`; the count register reports `countReg`.
+struct FakeFifo {
+  TwoWire wire;
+  std::deque<uint8_t> fifo;
+  uint8_t countReg = 0;
+  bool failData = false;
+
+  FakeFifo() {
+    wire.onRead = [this](uint8_t reg, uint8_t *dst, size_t len) {
+      if (reg == REG_FIFO_COUNT) {
+        dst[0] = countReg;
+        return true;
+      }
+      if (reg != REG_FIFO_DATA || failData) return reg != REG_FIFO_DATA;
+      // Reading past the queued frames returns the empty pattern.
+      for (size_t i = 0; i < len; ++i) {
+        dst[i] = fifo.empty() ? 0x7F : fifo.front();
+        if (!fifo.empty()) fifo.pop_front();
+      }
+      return true;
+    };
+  }
+
+  void load(const Bytes &frames, uint8_t count) {
+    fifo.assign(frames.begin(), frames.end());
+    countReg = count;
+  }
+
+  // FIFO data bursts only, in order.
+  std::vector<size_t> dataBursts() const {
+    std::vector<size_t> out(wire.reads.begin(), wire.reads.end());
+    out.erase(out.begin()); // the count register
+    return out;
+  }
+};
+
+// Bmp580Driver only talks to the bus once attached; begin() on the fake
+// bus does the register setup against default zeros.
+Bmp580Driver attach(FakeFifo &fake) {
+  Bmp580Driver driver;
+  TEST_ASSERT_TRUE(driver.begin(&fake.wire, 0x47));
+  fake.wire.reads.clear();
+  return driver;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_decode_frames() {
+  Bytes raw;
+  pushFrame(raw, 21.5f, 100125.0f);
+  pushFrame(raw, -3.25f, 99000.5f);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_EQUAL(2u, Bmp580Driver::decodeFifo(raw.data(), raw.size(), acc));
+  float t = 0, p = 0;
+  TEST_ASSERT_TRUE(acc.result(t, p));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, (21.5f - 3.25f) / 2, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.02, (100125.0f + 99000.5f) / 2, p);
+}
+
+// A burst cut inside a frame: the whole frames count, the tail does not.
+void test_partial_frame_is_ignored() {
+  Bytes raw;
+  for (int i = 0; i < 3; ++i) pushFrame(raw, 20.0f, 100000.0f + i);
+  pushFrame(raw, 90.0f, 50000.0f);
+  raw.resize(raw.size() - 2);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_EQUAL(3u, Bmp580Driver::decodeFifo(raw.data(), raw.size(), acc));
+  TEST_ASSERT_EQUAL_UINT16(3, acc.frames);
+  TEST_ASSERT_EQUAL(0u, Bmp580Driver::decodeFifo(raw.data(), 5, acc));
+}
+
+void test_empty_and_zero_frames_are_skipped() {
+  Bytes raw;
+  pushEmptyFrame(raw);
+  pushFrame(raw, 20.0f, 100000.0f);
+  pushFrame(raw, 20.0f, 0.0f);
+  pushEmptyFrame(raw);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_EQUAL(1u, Bmp580Driver::decodeFifo(raw.data(), raw.size(), acc));
+  TEST_ASSERT_EQUAL_UINT16(1, acc.frames);
+}
+
+// A full FIFO (16 frames with both channels) fits one Wire transaction;
+// the trimmed mean drops the highest and lowest pressure frame together
+// with their temperatures.
+void test_full_fifo_burst() {
+  TEST_ASSERT_EQUAL_UINT8(16, Bmp580Driver::FIFO_DEPTH);
+  Bytes raw;
+  for (int i = 0; i < 16; ++i) {
+    float p = 100000.0f + (i % 2 ? 1.0f : -1.0f);
+    float t = 20.0f;
+    if (i == 7) {
+      p = 100400.0f; // spike
+      t = 60.0f;
+    } else if (i == 12) {
+      p = 99500.0f;
+      t = -20.0f;
+    }
+    pushFrame(raw, t, p);
+  }
+  FakeFifo fake;
+  fake.load(raw, 16);
+  Bmp580Driver driver = attach(fake);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_TRUE(driver.drainFifo(acc));
+  TEST_ASSERT_EQUAL(1u, fake.dataBursts().size());
+  TEST_ASSERT_EQUAL(96u, fake.dataBursts()[0]);
+  TEST_ASSERT_TRUE(fake.dataBursts()[0] <= WIRE_BUFFER);
+  TEST_ASSERT_EQUAL_UINT16(16, acc.frames);
+  float t = 0, p = 0;
+  TEST_ASSERT_TRUE(acc.result(t, p));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 20.0f, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.05, 100000.0f, p);
+  TEST_ASSERT_TRUE(fake.fifo.empty());
+}
+
+// The count register's upper bits are not part of the count, and a count
+// above the FIFO size never reads past the 16 frames it can hold.
+void test_count_is_capped_at_fifo_size() {
+  Bytes raw;
+  for (int i = 0; i < 16; ++i) pushFrame(raw, 10.0f + i * 0.01f, 95000.0f + i);
+  // What a second read would return if the drain overran.
+  pushFrame(raw, 99.0f, 50000.0f);
+  FakeFifo fake;
+  fake.load(raw, 0xC0 | 0x3F);
+  Bmp580Driver driver = attach(fake);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_TRUE(driver.drainFifo(acc));
+  size_t total = 0;
+  for (size_t len : fake.dataBursts()) {
+    TEST_ASSERT_TRUE(len <= WIRE_BUFFER);
+    TEST_ASSERT_EQUAL(0u, len % Bmp580Driver::FIFO_FRAME_BYTES);
+    total += len;
+  }
+  TEST_ASSERT_EQUAL(96u, total);
+  TEST_ASSERT_EQUAL_UINT16(16, acc.frames);
+  TEST_ASSERT_EQUAL(Bmp580Driver::FIFO_FRAME_BYTES, fake.fifo.size());
+  float t = 0, p = 0;
+  TEST_ASSERT_TRUE(acc.result(t, p));
+  // Dropping the two extremes of a linear ramp leaves its mean.
+  TEST_ASSERT_FLOAT_WITHIN(0.02, 95007.5f, p);
+}
+
+// The ODR is slowed until one sample interval's frames fit the FIFO.
+void test_fifo_odr_fits_interval() {
+  TEST_ASSERT_EQUAL_UINT32(20, Bmp580Driver::fifoFramesPer(0x17, 2000)); // 10 Hz
+  TEST_ASSERT_EQUAL_UINT32(10, Bmp580Driver::fifoFramesPer(0x18, 2000)); // 5 Hz
+  TEST_ASSERT_EQUAL_UINT32(1, Bmp580Driver::fifoFramesPer(0x1F, 1));     // rounded up
+  TEST_ASSERT_EQUAL_UINT8(0x18, Bmp580Driver::fifoOdrFor(0x17, 2000));
+  TEST_ASSERT_EQUAL_UINT8(0x18, Bmp580Driver::fifoOdrFor(0x18, 2000));
+  // 16 frames exactly still fit: 8 Hz is not a code, 4 Hz x 4 s is.
+  TEST_ASSERT_EQUAL_UINT8(0x19, Bmp580Driver::fifoOdrFor(0x00, 4000));
+  TEST_ASSERT_EQUAL_UINT8(0x0A, Bmp580Driver::fifoOdrFor(0x0A, 150)); // 100.2 Hz x 150 ms = 15.03 -> 16
+  TEST_ASSERT_EQUAL_UINT8(Bmp580Driver::ODR_SLOWEST, Bmp580Driver::fifoOdrFor(0x00, 600000));
+  for (uint32_t ms : {250u, 1000u, 2000u, 5000u, 60000u}) {
+    const uint8_t odr = Bmp580Driver::fifoOdrFor(0x00, ms);
+    TEST_ASSERT_TRUE(Bmp580Driver::fifoFramesPer(odr, ms) <= Bmp580Driver::FIFO_DEPTH);
+    // The next faster code would overflow.
+    if (odr) TEST_ASSERT_TRUE(Bmp580Driver::fifoFramesPer(odr - 1, ms) > Bmp580Driver::FIFO_DEPTH);
+  }
+}
+
+void test_empty_fifo() {
+  FakeFifo fake;
+  fake.load(Bytes(), 0);
+  Bmp580Driver driver = attach(fake);
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_TRUE(driver.drainFifo(acc));
+  TEST_ASSERT_EQUAL(0u, fake.dataBursts().size());
+  float t = 0, p = 0;
+  TEST_ASSERT_FALSE(acc.result(t, p));
+
+  // A count ahead of the data reads back as empty frames.
+  fake.load(Bytes(), 3);
+  TEST_ASSERT_TRUE(driver.drainFifo(acc));
+  TEST_ASSERT_EQUAL_UINT16(0, acc.frames);
+}
+
+// Fewer than five frames: plain mean, nothing trimmed.
+void test_short_drain_is_plain_mean() {
+  Bytes raw;
+  pushFrame(raw, 10.0f, 100000.0f);
+  pushFrame(raw, 20.0f, 100100.0f);
+  pushFrame(raw, 30.0f, 100200.0f);
+  Bmp580Driver::FifoAccumulator acc;
+  Bmp580Driver::decodeFifo(raw.data(), raw.size(), acc);
+  float t = 0, p = 0;
+  TEST_ASSERT_TRUE(acc.result(t, p));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 20.0f, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.02, 100100.0f, p);
+}
+
+void test_bus_error_stops_drain() {
+  Bytes raw;
+  for (int i = 0; i < 16; ++i) pushFrame(raw, 20.0f, 100000.0f);
+  FakeFifo fake;
+  fake.load(raw, 16);
+  Bmp580Driver driver = attach(fake);
+  fake.failData = true;
+  Bmp580Driver::FifoAccumulator acc;
+  TEST_ASSERT_FALSE(driver.drainFifo(acc));
+  TEST_ASSERT_EQUAL_UINT16(0, acc.frames);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_decode_frames);
+  RUN_TEST(test_partial_frame_is_ignored);
+  RUN_TEST(test_empty_and_zero_frames_are_skipped);
+  RUN_TEST(test_full_fifo_burst);
+  RUN_TEST(test_count_is_capped_at_fifo_size);
+  RUN_TEST(test_fifo_odr_fits_interval);
+  RUN_TEST(test_empty_fifo);
+  RUN_TEST(test_short_drain_is_plain_mean);
+  RUN_TEST(test_bus_error_stops_drain);
+  return UNITY_END();
+}
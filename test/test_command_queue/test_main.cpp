@@ -0,0 +1,154 @@
+#include <unity.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/CommandQueue.h"
+
+// CommandQueue from one task and from many: commands come out once each, in
+// posting order per producer, and a full queue refuses instead of blocking.
+
+namespace {
+
+// The string owns heap memory, like the config payloads MatrixCommand
+// carries, so a cell reused before it was moved out shows up under ASan.
+struct Cmd {
+  uint32_t producer = 0;
+  uint32_t seq = 0;
+  std::string label;
+};
+
+Cmd make(uint32_t producer, uint32_t seq) {
+  Cmd c;
+  c.producer = producer;
+  c.seq = seq;
+  c.label = "p" + std::to_string(producer) + "#" + std::to_string(seq) + std::string(seq % 24, 'x');
+  return c;
+}
+
+bool intact(const Cmd &c) {
+  return c.label == "p" + std::to_string(c.producer) + "#" + std::to_string(c.seq) + std::string(c.seq % 24, 'x');
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_full_queue_refuses_post() {
+  CommandQueue<Cmd, 8> q;
+  for (uint32_t i = 0; i < 8; ++i) TEST_ASSERT_TRUE(q.post(make(0, i)));
+  TEST_ASSERT_FALSE(q.post(make(0, 8)));
+  TEST_ASSERT_FALSE(q.post(make(0, 9)));
+
+  // One slot freed takes exactly one more.
+  uint32_t next = 0;
+  TEST_ASSERT_EQUAL(1u, q.drain([&](Cmd &c) { TEST_ASSERT_EQUAL_UINT32(next++, c.seq); }, 1));
+  TEST_ASSERT_TRUE(q.post(make(0, 8)));
+  TEST_ASSERT_FALSE(q.post(make(0, 9)));
+
+  TEST_ASSERT_EQUAL(8u, q.drain([&](Cmd &c) {
+    TEST_ASSERT_EQUAL_UINT32(next++, c.seq);
+    TEST_ASSERT_TRUE(intact(c));
+  }));
+  TEST_ASSERT_EQUAL(0u, q.drain([](Cmd &) { TEST_FAIL_MESSAGE("queue should be empty"); }));
+}
+
+// Positions run far past N, with the fill level varying, so every cell is
+// reused many times at every offset of the ring.
+void test_wraparound_keeps_order() {
+  CommandQueue<Cmd, 4> q;
+  uint32_t posted = 0;
+  uint32_t applied = 0;
+  for (uint32_t round = 0; round < 1000; ++round) {
+    const uint32_t burst = 1 + round % 4;
+    for (uint32_t i = 0; i < burst; ++i) {
+      const bool room = posted - applied < 4;
+      TEST_ASSERT_EQUAL(room, q.post(make(0, posted)));
+      if (room) ++posted;
+    }
+    q.drain([&](Cmd &c) {
+      TEST_ASSERT_EQUAL_UINT32(applied++, c.seq);
+      TEST_ASSERT_TRUE(intact(c));
+    }, 1 + round % 3);
+  }
+  q.drain([&](Cmd &c) { TEST_ASSERT_EQUAL_UINT32(applied++, c.seq); });
+  TEST_ASSERT_EQUAL_UINT32(posted, applied);
+  TEST_ASSERT_GREATER_THAN(400u, posted / 4); // wrapped hundreds of times
+}
+
+// A command posted from inside apply() waits for the next drain.
+void test_post_during_drain_waits() {
+  CommandQueue<Cmd, 8> q;
+  q.post(make(0, 0));
+  size_t calls = 0;
+  TEST_ASSERT_EQUAL(1u, q.drain([&](Cmd &c) {
+    ++calls;
+    if (c.seq == 0) q.post(make(0, 1));
+  }));
+  TEST_ASSERT_EQUAL(1u, calls);
+  TEST_ASSERT_EQUAL(1u, q.drain([](Cmd &c) { TEST_ASSERT_EQUAL_UINT32(1, c.seq); }));
+}
+
+// Several producers against one draining owner. A refused post is retried,
+// as a caller that gets false could; nothing may be lost, duplicated,
+// reordered within a producer or torn.
+void test_producers_against_one_owner() {
+  static CommandQueue<Cmd, 64> q;
+  const unsigned producers = std::thread::hardware_concurrency() > 2 ? std::thread::hardware_concurrency() - 1 : 3;
+  constexpr uint32_t EACH = 20000;
+  std::atomic<unsigned> running{0};
+  std::atomic<uint32_t> refused{0};
+  std::vector<std::thread> threads;
+  for (unsigned p = 0; p < producers; ++p) {
+    threads.emplace_back([p, &running, &refused] {
+      running.fetch_add(1);
+      for (uint32_t i = 0; i < EACH; ++i) {
+        while (!q.post(make(p, i))) {
+          refused.fetch_add(1, std::memory_order_relaxed);
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  while (running.load() < producers) std::this_thread::yield();
+
+  std::vector<uint32_t> expected(producers, 0);
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+  uint64_t total = 0;
+  const uint64_t want = static_cast<uint64_t>(producers) * EACH;
+  while (total < want) {
+    const size_t n = q.drain([&](Cmd &c) {
+      if (c.producer >= producers || !intact(c)) {
+        ++torn;
+        return;
+      }
+      if (c.seq != expected[c.producer]) ++outOfOrder;
+      expected[c.producer] = c.seq + 1;
+    });
+    total += n;
+    if (!n) std::this_thread::yield();
+  }
+  for (std::thread &t : threads) t.join();
+
+  char line[96];
+  snprintf(line, sizeof(line), "%u producers, %llu commands, %u refused posts", producers,
+           static_cast<unsigned long long>(total), refused.load());
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  for (unsigned p = 0; p < producers; ++p) TEST_ASSERT_EQUAL_UINT32(EACH, expected[p]);
+  TEST_ASSERT_EQUAL(0u, q.drain([](Cmd &) {}));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_full_queue_refuses_post);
+  RUN_TEST(test_wraparound_keeps_order);
+  RUN_TEST(test_post_during_drain_waits);
+  RUN_TEST(test_producers_against_one_owner);
+  return UNITY_END();
+}
@@ -0,0 +1,348 @@
+#include <unity.h>
+
+#include "common/ConfigStore.h"
+
+// ConfigStore and the packed ConfigSchema form against a fake NVS (see
+// test/support/Preferences.h) and a stepped millis(): legacy per-key
+// migration, one read per boot, debounced commits, corrupt blobs and
+// blobs written by a firmware with a different field table.
+
+namespace {
+
+struct TestConfig {
+  bool enabled = true;
+  uint8_t level = 5;
+  uint16_t interval = 30;
+  uint32_t color = 0x112233;
+  double lat = 0.0;
+  String city;
+  uint8_t brightness = 77; // only in the v2 table
+};
+
+bool sameConfig(const TestConfig &a, const TestConfig &b) {
+  return a.enabled == b.enabled && a.level == b.level && a.interval == b.interval && a.color == b.color &&
+         a.lat == b.lat && a.city == b.city && a.brightness == b.brightness;
+}
+
+constexpr ConfigField<TestConfig> FIELDS_V1[] = {
+  CONFIG_FIELD(TestConfig, enabled, "enabled", nullptr, "en", 0, 1),
+  CONFIG_FIELD(TestConfig, level, "level", nullptr, "lvl", 0, 10),
+  CONFIG_FIELD(TestConfig, interval, "interval", nullptr, "int", 1, 1440),
+  CONFIG_FIELD(TestConfig, color, "color", nullptr, "col", 0, 0xFFFFFF),
+  CONFIG_FIELD(TestConfig, lat, "lat", nullptr, "lat", -90, 90),
+  CONFIG_FIELD(TestConfig, city, "city", nullptr, "city", 0, 32),
+};
+const ConfigSchema<TestConfig> schemaV1(FIELDS_V1);
+
+// v2 drops "lvl", adds "bri" and counts interval in half-minutes.
+uint8_t migratedFrom = 0;
+void migrateV2(TestConfig &cfg, uint8_t fromVersion) {
+  migratedFrom = fromVersion;
+  cfg.interval *= 2;
+}
+constexpr ConfigField<TestConfig> FIELDS_V2[] = {
+  CONFIG_FIELD(TestConfig, enabled, "enabled", nullptr, "en", 0, 1),
+  CONFIG_FIELD(TestConfig, interval, "interval", nullptr, "int", 1, 2880),
+  CONFIG_FIELD(TestConfig, color, "color", nullptr, "col", 0, 0xFFFFFF),
+  CONFIG_FIELD(TestConfig, lat, "lat", nullptr, "lat", -90, 90),
+  CONFIG_FIELD(TestConfig, city, "city", nullptr, "city", 0, 32),
+  CONFIG_FIELD(TestConfig, brightness, "brightness", nullptr, "bri", 0, 255),
+};
+const ConfigSchema<TestConfig> schemaV2(FIELDS_V2, 2, migrateV2);
+
+Preferences::Flash &flash() { return Preferences::flash(); }
+
+void resetCounters() {
+  flash().blobReads = flash().keyReads = flash().writes = 0;
+}
+
+TestConfig sample() {
+  TestConfig c;
+  c.enabled = false;
+  c.level = 7;
+  c.interval = 90;
+  c.color = 0xABCDEF;
+  c.lat = 50.0755;
+  c.city = "Prague";
+  return c;
+}
+
+// What an older firmware left: one key per field.
+void writeLegacy(const char *ns, const TestConfig &c) {
+  Preferences prefs;
+  prefs.begin(ns, false);
+  schemaV1.save(prefs, c);
+  prefs.end();
+}
+
+Preferences::Bytes &blob(const char *ns) { return flash().spaces[ns]["cfg"]; }
+
+void advance(unsigned long ms) { fakeMillis() += ms; }
+
+} // namespace
+
+void setUp() {
+  flash().clear();
+  fakeMillis() = 1000;
+  migratedFrom = 0;
+}
+void tearDown() { fakeMillis() = 0; }
+
+// First boot after the update reads the old keys, writes the blob at once
+// and leaves the keys for a downgrade; the next boot is one blob read.
+void test_legacy_keys_migrate_to_blob() {
+  writeLegacy("t", sample());
+  resetCounters();
+  {
+    ConfigStore store("t");
+    TestConfig cfg;
+    store.load(schemaV1, cfg);
+    TEST_ASSERT_TRUE(sameConfig(sample(), cfg));
+    TEST_ASSERT_EQUAL_UINT32(1, store.commits());
+    TEST_ASSERT_FALSE(store.pending());
+    TEST_ASSERT_EQUAL(1u, flash().writes);
+    TEST_ASSERT_TRUE(flash().spaces["t"].count("lvl"));
+    TEST_ASSERT_EQUAL_HEX8(0xC5, blob("t")[0]);
+  }
+  resetCounters();
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  TEST_ASSERT_TRUE(sameConfig(sample(), cfg));
+  TEST_ASSERT_EQUAL(1u, flash().blobReads);
+  TEST_ASSERT_EQUAL(0u, flash().keyReads);
+  TEST_ASSERT_EQUAL(0u, flash().writes);
+  TEST_ASSERT_FALSE(store.pending());
+}
+
+// A fresh device has neither: defaults are kept and written once.
+void test_empty_flash_keeps_defaults() {
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  TEST_ASSERT_TRUE(sameConfig(TestConfig(), cfg));
+  TEST_ASSERT_EQUAL_UINT32(1, store.commits());
+}
+
+void test_unchanged_payload_is_skipped() {
+  ConfigStore store("t");
+  TestConfig cfg = sample();
+  writeLegacy("t", cfg);
+  store.load(schemaV1, cfg);
+  resetCounters();
+
+  store.stage(schemaV1, cfg);
+  TEST_ASSERT_FALSE(store.pending());
+  // Changed and changed back before the commit: nothing to write.
+  TestConfig moved = cfg;
+  moved.level = 3;
+  store.stage(schemaV1, moved);
+  TEST_ASSERT_TRUE(store.pending());
+  store.stage(schemaV1, cfg);
+  TEST_ASSERT_FALSE(store.pending());
+  advance(ConfigStore::MAX_DEFER_MS * 2);
+  store.loop();
+  TEST_ASSERT_EQUAL(0u, flash().writes);
+  // Fields without an NVS key do not count either.
+  TEST_ASSERT_EQUAL_UINT32(1, store.commits());
+}
+
+// A slider dragged for half a second: 50 updates, one write of the last.
+void test_burst_coalesces_into_one_write() {
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  resetCounters();
+  for (uint16_t i = 1; i <= 50; ++i) {
+    cfg.interval = 100 + i;
+    store.stage(schemaV1, cfg);
+    store.loop();
+    advance(10);
+  }
+  TEST_ASSERT_EQUAL(0u, flash().writes);
+  advance(ConfigStore::DEBOUNCE_MS - 20);
+  store.loop();
+  TEST_ASSERT_EQUAL(0u, flash().writes);
+  advance(20);
+  store.loop();
+  TEST_ASSERT_EQUAL(1u, flash().writes);
+  TEST_ASSERT_FALSE(store.pending());
+
+  ConfigStore reboot("t");
+  TestConfig back;
+  reboot.load(schemaV1, back);
+  TEST_ASSERT_EQUAL_UINT16(150, back.interval);
+}
+
+// Updates that never pause still commit MAX_DEFER_MS after the first one.
+void test_continuous_updates_commit_at_the_cap() {
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  resetCounters();
+  const unsigned long first = fakeMillis();
+  unsigned long committedAt = 0;
+  for (uint16_t i = 1; i <= 30 && !committedAt; ++i) {
+    cfg.interval = 200 + i;
+    store.stage(schemaV1, cfg);
+    store.loop();
+    if (flash().writes) committedAt = fakeMillis();
+    advance(ConfigStore::DEBOUNCE_MS / 2);
+  }
+  TEST_ASSERT_TRUE(committedAt != 0);
+  TEST_ASSERT_TRUE(committedAt - first >= ConfigStore::MAX_DEFER_MS);
+  TEST_ASSERT_TRUE(committedAt - first < ConfigStore::MAX_DEFER_MS + ConfigStore::DEBOUNCE_MS);
+}
+
+// A blob that fails its CRC or length check is ignored in favour of the
+// per-key layout, then replaced.
+void test_corrupt_blob_falls_back_to_keys() {
+  TestConfig legacy = sample();
+  legacy.city = "Brno";
+  writeLegacy("t", legacy);
+  {
+    ConfigStore store("t");
+    TestConfig cfg = sample();
+    cfg.city = "Ostrava";
+    store.load(schemaV1, cfg);
+    store.stage(schemaV1, cfg);
+    store.flush();
+  }
+  blob("t")[10] ^= 0x40;
+  resetCounters();
+  {
+    ConfigStore store("t");
+    TestConfig cfg;
+    store.load(schemaV1, cfg);
+    TEST_ASSERT_EQUAL_STRING("Brno", cfg.city.c_str());
+    TEST_ASSERT_EQUAL(1u, flash().writes);
+  }
+
+  // Cut short: the header's length no longer matches.
+  blob("t").resize(blob("t").size() - 3);
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  TEST_ASSERT_EQUAL_STRING("Brno", cfg.city.c_str());
+
+  ConfigStore reboot("t");
+  TestConfig back;
+  resetCounters();
+  reboot.load(schemaV1, back);
+  TEST_ASSERT_EQUAL(0u, flash().keyReads);
+  TEST_ASSERT_TRUE(sameConfig(legacy, back));
+}
+
+// A v1 blob under the v2 table: the dropped field is skipped, the new one
+// keeps its default, and the migration hook sees the old version. The
+// re-encoded v2 payload is staged for the next commit.
+void test_blob_from_other_table_decodes() {
+  {
+    ConfigStore store("t");
+    TestConfig cfg = sample();
+    writeLegacy("t", cfg);
+    store.load(schemaV1, cfg);
+  }
+  ConfigStore store("t");
+  TestConfig cfg;
+  cfg.level = 9;
+  store.load(schemaV2, cfg);
+  TEST_ASSERT_EQUAL_UINT8(1, migratedFrom);
+  TEST_ASSERT_EQUAL_UINT16(180, cfg.interval);
+  TEST_ASSERT_EQUAL_UINT8(9, cfg.level);
+  TEST_ASSERT_EQUAL_UINT8(77, cfg.brightness);
+  TEST_ASSERT_EQUAL_STRING("Prague", cfg.city.c_str());
+  TEST_ASSERT_TRUE(cfg.lat == 50.0755);
+  TEST_ASSERT_TRUE(store.pending());
+  store.flush();
+  TEST_ASSERT_EQUAL_HEX8(2, blob("t")[1]);
+
+  // And back: the v1 table ignores "bri" and keeps its own "lvl" default.
+  ConfigStore older("t");
+  TestConfig old;
+  older.load(schemaV1, old);
+  TEST_ASSERT_EQUAL_UINT8(5, old.level);
+  TEST_ASSERT_EQUAL_UINT16(180, old.interval);
+}
+
+// Entries are bounded by their own sizes; a cut or unknown entry ends the
+// decode, and stored values outside the field's range are ignored.
+void test_packed_entries_are_checked() {
+  uint8_t buf[ConfigStore::CAPACITY];
+  TestConfig src = sample();
+  const size_t len = schemaV1.encode(src, buf, sizeof(buf));
+  TEST_ASSERT_TRUE(len > 0);
+  TEST_ASSERT_EQUAL(0u, schemaV1.encode(src, buf, len - 1));
+
+  // Every prefix decodes the entries it holds in full and nothing else.
+  for (size_t cut = 0; cut <= len; ++cut) {
+    TestConfig dst;
+    schemaV1.decode(buf, cut, dst);
+    TEST_ASSERT_TRUE(dst.city == "" || dst.city == "Prague");
+  }
+  TestConfig whole;
+  schemaV1.decode(buf, len, whole);
+  TEST_ASSERT_TRUE(sameConfig(src, whole));
+
+  uint16_t hash;
+  ConfigType type;
+  const uint8_t *value;
+  TEST_ASSERT_EQUAL(3u + 1u, ConfigBinding::nextPacked(buf, len, hash, type, value)); // "en", bool
+  TEST_ASSERT_EQUAL_UINT16(configKeyHash("en"), hash);
+  TEST_ASSERT_EQUAL(0u, ConfigBinding::nextPacked(buf, 3, hash, type, value));
+  const uint8_t unknownType[] = {0x12, 0x34, 0x7F, 0, 0, 0, 0};
+  TEST_ASSERT_EQUAL(0u, ConfigBinding::nextPacked(unknownType, sizeof(unknownType), hash, type, value));
+
+  // "lvl" = 200 is outside 0..10.
+  uint8_t level = 200;
+  uint8_t entry[8];
+  const size_t n = ConfigBinding::pack(ConfigType::U8, &level, configKeyHash("lvl"), entry, sizeof(entry));
+  TestConfig dst;
+  schemaV1.decode(entry, n, dst);
+  TEST_ASSERT_EQUAL_UINT8(5, dst.level);
+  // Same key with another type is not this field.
+  uint16_t wide = 3;
+  const size_t m = ConfigBinding::pack(ConfigType::U16, &wide, configKeyHash("lvl"), entry, sizeof(entry));
+  schemaV1.decode(entry, m, dst);
+  TEST_ASSERT_EQUAL_UINT8(5, dst.level);
+
+  // Strings over 255 bytes do not fit the length byte.
+  String longName;
+  for (int i = 0; i < 300; ++i) longName += 'x';
+  TEST_ASSERT_EQUAL(0u, ConfigBinding::pack(ConfigType::Str, &longName, 1, buf, sizeof(buf)));
+}
+
+// A failed NVS write keeps the payload staged and retries after the
+// debounce window.
+void test_failed_write_is_retried() {
+  ConfigStore store("t");
+  TestConfig cfg;
+  store.load(schemaV1, cfg);
+  cfg.level = 2;
+  store.stage(schemaV1, cfg);
+  flash().failWrites = true;
+  store.flush();
+  TEST_ASSERT_TRUE(store.pending());
+  const uint32_t before = store.commits();
+  flash().failWrites = false;
+  store.loop();
+  TEST_ASSERT_EQUAL_UINT32(before, store.commits());
+  advance(ConfigStore::DEBOUNCE_MS);
+  store.loop();
+  TEST_ASSERT_EQUAL_UINT32(before + 1, store.commits());
+  TEST_ASSERT_FALSE(store.pending());
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_legacy_keys_migrate_to_blob);
+  RUN_TEST(test_empty_flash_keeps_defaults);
+  RUN_TEST(test_unchanged_payload_is_skipped);
+  RUN_TEST(test_burst_coalesces_into_one_write);
+  RUN_TEST(test_continuous_updates_commit_at_the_cap);
+  RUN_TEST(test_corrupt_blob_falls_back_to_keys);
+  RUN_TEST(test_blob_from_other_table_decodes);
+  RUN_TEST(test_packed_entries_are_checked);
+  RUN_TEST(test_failed_write_is_retried);
+  return UNITY_END();
+}
@@ -0,0 +1,265 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "service/FetchCycle.h"
+
+// The fetch task without the network: FetchSchedule on a fake clock, and
+// streamBody() reading a scripted server response, the way OutdoorService
+// drives them with millis() and the HTTPClient stream.
+
+namespace {
+
+constexpr unsigned long MIN = 60UL * 1000UL;
+
+// Time only moves when the reader waits.
+struct FakeClock {
+  unsigned long t = 1000;
+  unsigned long now() const { return t; }
+  void wait(uint32_t ms) { t += ms; }
+};
+
+// A server that sends each piece at its time and closes at closeAt.
+struct ScriptedStream {
+  struct Piece {
+    unsigned long at;
+    std::string bytes;
+  };
+  const FakeClock &clock;
+  std::vector<Piece> pieces;
+  unsigned long closeAt = ~0UL;
+  std::string buffered;
+  size_t nextPiece = 0;
+  std::vector<size_t> readSizes;
+
+  explicit ScriptedStream(const FakeClock &c) : clock(c) {}
+
+  void arrive() {
+    while (nextPiece < pieces.size() && pieces[nextPiece].at <= clock.now()) buffered += pieces[nextPiece++].bytes;
+  }
+  int available() {
+    arrive();
+    return static_cast<int>(buffered.size());
+  }
+  // Data already received stays readable after the close, as with lwIP.
+  bool connected() const { return clock.now() < closeAt; }
+  int read(uint8_t *dst, size_t len) {
+    arrive();
+    if (len > buffered.size()) len = buffered.size();
+    memcpy(dst, buffered.data(), len);
+    buffered.erase(0, len);
+    readSizes.push_back(len);
+    return static_cast<int>(len);
+  }
+};
+
+// Keeps the body; gives up after stopAfter bytes when set.
+struct RecordingProvider : OutdoorProvider {
+  std::string body;
+  size_t stopAfter = 0;
+
+  const char *name() const override { return "test"; }
+  String requestUrl(const OutdoorConfig &, uint16_t) const override { return String(); }
+  void begin(OutdoorForecastBuffer &) override { body.clear(); }
+  bool feed(const uint8_t *data, size_t len) override {
+    body.append(reinterpret_cast<const char *>(data), len);
+    return !stopAfter || body.size() < stopAfter;
+  }
+  bool finish() override { return true; }
+  const char *error() const override { return nullptr; }
+};
+
+std::string bytes(size_t n, char c = 'x') { return std::string(n, c); }
+
+// Runs the fetch task's loop on a fake clock until `until`: each due fetch
+// gets the next outcome (true = ok), the task then sleeps as told. Returns
+// the attempt times.
+std::vector<unsigned long> runTask(FetchSchedule &s, unsigned long &t, unsigned long until, unsigned long intervalMs,
+                                   const std::vector<bool> &outcomes, uint32_t ageS = FetchSchedule::AGE_UNKNOWN) {
+  std::vector<unsigned long> attempts;
+  while (t < until) {
+    uint32_t sleepMs = 0;
+    if (s.due(t, intervalMs, 0, ageS, sleepMs)) {
+      const bool ok = attempts.size() < outcomes.size() ? outcomes[attempts.size()] : true;
+      attempts.push_back(t);
+      sleepMs = s.finished(t, ok, intervalMs);
+    }
+    TEST_ASSERT_TRUE(sleepMs > 0 && sleepMs <= FetchSchedule::IDLE_CHECK_MS);
+    t += sleepMs;
+  }
+  return attempts;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// --- streamBody ---
+
+void test_body_in_pieces_with_length() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  server.pieces = {{1000, bytes(700, 'a')}, {1200, bytes(300, 'b')}, {3000, bytes(1000, 'c')}};
+  RecordingProvider provider;
+  TEST_ASSERT_TRUE(streamBody(server, 2000, provider, clock) == BodyEnd::Complete);
+  TEST_ASSERT_EQUAL(2000u, provider.body.size());
+  TEST_ASSERT_EQUAL('c', provider.body.back());
+  for (size_t n : server.readSizes) TEST_ASSERT_TRUE(n <= FETCH_CHUNK_BYTES);
+  // Waited for the last piece, no longer.
+  TEST_ASSERT_TRUE(clock.t >= 3000 && clock.t < 3000 + 20);
+}
+
+// HTTP/1.0 without Content-Length: the close ends the body.
+void test_body_without_length_ends_at_close() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  server.pieces = {{1000, bytes(900)}, {1500, bytes(100)}};
+  server.closeAt = 1600;
+  RecordingProvider provider;
+  TEST_ASSERT_TRUE(streamBody(server, -1, provider, clock) == BodyEnd::Complete);
+  TEST_ASSERT_EQUAL(1000u, provider.body.size());
+}
+
+void test_close_before_length_is_connection_lost() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  server.pieces = {{1000, bytes(600)}};
+  server.closeAt = 2000;
+  RecordingProvider provider;
+  TEST_ASSERT_TRUE(streamBody(server, 1000, provider, clock) == BodyEnd::ConnectionLost);
+  // What did arrive was still handed on.
+  TEST_ASSERT_EQUAL(600u, provider.body.size());
+}
+
+void test_stalled_server_times_out() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  server.pieces = {{1000, bytes(100)}};
+  RecordingProvider provider;
+  TEST_ASSERT_TRUE(streamBody(server, 1000, provider, clock) == BodyEnd::Timeout);
+  TEST_ASSERT_TRUE(clock.t - 1000 > FETCH_BODY_TIMEOUT_MS && clock.t - 1000 <= FETCH_BODY_TIMEOUT_MS + 20);
+}
+
+// The timeout covers the whole body, not the gap between bytes.
+void test_trickling_body_times_out() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  for (unsigned long at = 1000; at < 40000; at += 1000) server.pieces.push_back({at, bytes(10)});
+  RecordingProvider provider;
+  TEST_ASSERT_TRUE(streamBody(server, 1000, provider, clock) == BodyEnd::Timeout);
+  TEST_ASSERT_TRUE(provider.body.size() < 1000);
+}
+
+// A provider that has what it needs (or an unusable body) stops the read.
+void test_provider_stop_ends_read() {
+  FakeClock clock;
+  ScriptedStream server(clock);
+  server.pieces = {{1000, bytes(4000)}};
+  RecordingProvider provider;
+  provider.stopAfter = 1024;
+  TEST_ASSERT_TRUE(streamBody(server, 4000, provider, clock) == BodyEnd::Complete);
+  TEST_ASSERT_EQUAL(1024u, provider.body.size());
+}
+
+// --- FetchSchedule ---
+
+// Failures retry after 30 s, doubling to the one hour cap; a success goes
+// back to the interval.
+void test_backoff_doubles_to_an_hour() {
+  FetchSchedule s;
+  unsigned long t = 1000;
+  const std::vector<bool> outcomes(10, false);
+  std::vector<unsigned long> attempts = runTask(s, t, 1000 + 6 * 3600UL * 1000UL, 30 * MIN, outcomes);
+  TEST_ASSERT_TRUE(attempts.size() > 10);
+  const unsigned long expected[] = {30, 60, 120, 240, 480, 960, 1920, 3600, 3600};
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+    TEST_ASSERT_EQUAL_UINT32(expected[i] * 1000UL, attempts[i + 1] - attempts[i]);
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, s.failures()); // the 11th fetch succeeded
+  TEST_ASSERT_EQUAL_UINT32(30 * MIN, attempts[11] - attempts[10]);
+}
+
+void test_success_waits_one_interval() {
+  FetchSchedule s;
+  uint32_t sleepMs = 0;
+  TEST_ASSERT_TRUE(s.due(5000, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::IDLE_CHECK_MS, s.finished(5000, true, 30 * MIN));
+  TEST_ASSERT_FALSE(s.due(5000 + 10 * MIN, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::IDLE_CHECK_MS, sleepMs);
+  TEST_ASSERT_FALSE(s.due(5000 + 30 * MIN - 100, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(100, sleepMs);
+  TEST_ASSERT_TRUE(s.due(5000 + 30 * MIN, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+}
+
+// Pushes keep the data young: the fetch moves to one interval after the
+// data's time, and happens only once nothing newer arrived.
+void test_push_suppresses_fetch() {
+  FetchSchedule s;
+  uint32_t sleepMs = 0;
+  const unsigned long t = 100 * MIN;
+  TEST_ASSERT_FALSE(s.due(t, 30 * MIN, 0, 5 * 60, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(t + 25 * MIN, s.nextFetchMs());
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::IDLE_CHECK_MS, sleepMs);
+  // Another push at t + 20 min: still nothing due at t + 25 min.
+  TEST_ASSERT_FALSE(s.due(t + 25 * MIN, 30 * MIN, 0, 5 * 60, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(t + 50 * MIN, s.nextFetchMs());
+  // No pushes since: due once the data is an interval old.
+  TEST_ASSERT_TRUE(s.due(t + 50 * MIN, 30 * MIN, 0, 30 * 60, sleepMs));
+
+  // While fetches fail, young data does not push the retry out.
+  FetchSchedule f;
+  TEST_ASSERT_TRUE(f.due(t, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  f.finished(t, false, 30 * MIN);
+  TEST_ASSERT_TRUE(f.due(t + 30000, 30 * MIN, t, 10, sleepMs));
+}
+
+// A request (config change, ?force) skips the interval but not the spacing
+// after the last attempt, and is kept until it has run.
+void test_requested_fetch_keeps_min_spacing() {
+  FetchSchedule s;
+  uint32_t sleepMs = 0;
+  const unsigned long t = 100 * MIN;
+  TEST_ASSERT_TRUE(s.due(t, 30 * MIN, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  s.finished(t, false, 30 * MIN);
+  s.request();
+  TEST_ASSERT_FALSE(s.due(t + 10000, 30 * MIN, t, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::MIN_SPACING_MS - 10000, sleepMs);
+  TEST_ASSERT_TRUE(s.requested());
+  TEST_ASSERT_TRUE(s.due(t + FetchSchedule::MIN_SPACING_MS, 30 * MIN, t, 0, sleepMs));
+  TEST_ASSERT_FALSE(s.requested());
+
+  // Fresh pushed data does not cancel a request either.
+  s.finished(t + FetchSchedule::MIN_SPACING_MS, true, 30 * MIN);
+  s.request();
+  TEST_ASSERT_TRUE(s.due(t + 2 * FetchSchedule::MIN_SPACING_MS, 30 * MIN, 0, 1, sleepMs));
+}
+
+// fetchIntervalMin = 0 leaves updates to pushes and explicit requests.
+void test_zero_interval_fetches_only_on_request() {
+  FetchSchedule s;
+  uint32_t sleepMs = 0;
+  TEST_ASSERT_FALSE(s.due(5000, 0, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::IDLE_CHECK_MS, sleepMs);
+  s.request();
+  TEST_ASSERT_TRUE(s.due(5000, 0, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+  TEST_ASSERT_EQUAL_UINT32(FetchSchedule::IDLE_CHECK_MS, s.finished(5000, true, 0));
+  TEST_ASSERT_FALSE(s.due(5000 + 24 * 60 * MIN, 0, 0, FetchSchedule::AGE_UNKNOWN, sleepMs));
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_body_in_pieces_with_length);
+  RUN_TEST(test_body_without_length_ends_at_close);
+  RUN_TEST(test_close_before_length_is_connection_lost);
+  RUN_TEST(test_stalled_server_times_out);
+  RUN_TEST(test_trickling_body_times_out);
+  RUN_TEST(test_provider_stop_ends_read);
+  RUN_TEST(test_backoff_doubles_to_an_hour);
+  RUN_TEST(test_success_waits_one_interval);
+  RUN_TEST(test_push_suppresses_fetch);
+  RUN_TEST(test_requested_fetch_keeps_min_spacing);
+  RUN_TEST(test_zero_interval_fetches_only_on_request);
+  return UNITY_END();
+}
@@ -0,0 +1,221 @@
+#include <unity.h>
+
+#include <memory>
+
+#include "service/HourlyForecast.h"
+
+// HourlyForecast gap filling, value() and window() lookups, and
+// dropLeading(), which OutdoorService uses to keep restored forecasts lined
+// up with the current hour.
+
+namespace {
+
+OutdoorSnapshot temp(float c) {
+  OutdoorSnapshot s;
+  s.temperatureC = c;
+  return s;
+}
+
+// Hours 1..hours at 10 + h, with only every third hour pushed.
+std::unique_ptr<HourlyForecast> sparseForecast(size_t hours) {
+  std::unique_ptr<HourlyForecast> f(new HourlyForecast());
+  std::unique_ptr<OutdoorSnapshot[]> hourly(new OutdoorSnapshot[hours]);
+  for (size_t h = 1; h <= hours; ++h) {
+    if (h % 3 == 0 || h == hours) hourly[h - 1] = temp(10.0f + h);
+  }
+  f->assign(temp(10.0f), hourly.get(), hours);
+  return f;
+}
+
+float tempAt(const HourlyForecast &f, uint16_t hour) { return f.at(hour).temperatureC; }
+
+// Temperature h * h pushed for hours 2..6 only; humidity pushed at 0
+// (50), 4 (90) and 8 (30) and filled in between.
+std::unique_ptr<HourlyForecast> spanForecast() {
+  std::unique_ptr<HourlyForecast> f(new HourlyForecast());
+  OutdoorSnapshot current;
+  current.humidity = 50.0f;
+  OutdoorSnapshot hourly[8];
+  for (uint16_t h = 2; h <= 6; ++h) hourly[h - 1].temperatureC = static_cast<float>(h * h);
+  hourly[3].humidity = 90.0f;
+  hourly[7].humidity = 30.0f;
+  f->assign(current, hourly, 8);
+  return f;
+}
+
+constexpr ForecastField TEMP = ForecastField::TemperatureC;
+constexpr ForecastField HUMIDITY = ForecastField::Humidity;
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_assign_fills_gaps_linearly() {
+  auto f = sparseForecast(24);
+  for (uint16_t h = 0; h <= 24; ++h) TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.0f + h, tempAt(*f, h));
+  TEST_ASSERT_TRUE(isnan(tempAt(*f, 25)));
+  TEST_ASSERT_EQUAL_UINT16(24, f->horizon());
+}
+
+void test_drop_leading_moves_slots_towards_now() {
+  auto f = sparseForecast(24);
+  const uint8_t moved = f->dropLeading(4);
+  TEST_ASSERT_EQUAL_UINT8(1u << static_cast<uint8_t>(ForecastField::TemperatureC), moved);
+  for (uint16_t h = 0; h <= 20; ++h) TEST_ASSERT_FLOAT_WITHIN(1e-4, 14.0f + h, tempAt(*f, h));
+  TEST_ASSERT_TRUE(isnan(tempAt(*f, 21)));
+  TEST_ASSERT_EQUAL_UINT16(20, f->horizon());
+  TEST_ASSERT_EQUAL_UINT16(21, f->usedSlots());
+}
+
+// Old hour 4 was interpolated; as the new slot 0 it anchors the line, so
+// a merge elsewhere does not blank it.
+void test_dropped_to_slot_zero_survives_merge() {
+  auto f = sparseForecast(24);
+  f->dropLeading(4);
+  OutdoorSnapshot hourly[10];
+  hourly[9] = temp(50.0f); // hour 10
+  f->merge(OutdoorSnapshot(), hourly, 10, 0, 1u << static_cast<uint8_t>(ForecastField::TemperatureC));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 14.0f, tempAt(*f, 0));
+  // Hours 0 (pushed by the drop) and 2 (old hour 6) bracket hour 1.
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 15.0f, tempAt(*f, 1));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 50.0f, tempAt(*f, 10));
+}
+
+void test_drop_past_horizon_empties_table() {
+  auto f = sparseForecast(12);
+  TEST_ASSERT_NOT_EQUAL(0, f->dropLeading(13));
+  TEST_ASSERT_EQUAL_UINT8(0, f->fieldMask());
+  TEST_ASSERT_EQUAL_UINT16(0, f->usedSlots());
+  TEST_ASSERT_TRUE(isnan(tempAt(*f, 0)));
+
+  auto g = sparseForecast(12);
+  g->dropLeading(HourlyForecast::SLOTS + 5);
+  TEST_ASSERT_EQUAL_UINT8(0, g->fieldMask());
+}
+
+void test_drop_zero_changes_nothing() {
+  auto f = sparseForecast(12);
+  TEST_ASSERT_EQUAL_UINT8(0, f->dropLeading(0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.0f, tempAt(*f, 0));
+  TEST_ASSERT_EQUAL_UINT16(12, f->horizon());
+
+  HourlyForecast empty;
+  TEST_ASSERT_EQUAL_UINT8(0, empty.dropLeading(3));
+}
+
+// Persistence round trip of a dropped table: setColumn(column()) of the
+// used slots gives back the same values.
+void test_dropped_table_round_trips_through_columns() {
+  auto f = sparseForecast(30);
+  f->dropLeading(7);
+  std::unique_ptr<HourlyForecast> g(new HourlyForecast());
+  const ForecastField field = ForecastField::TemperatureC;
+  g->setColumn(field, f->column(field), f->usedSlots());
+  TEST_ASSERT_EQUAL_UINT16(f->horizon(), g->horizon());
+  for (uint16_t h = 0; h < HourlyForecast::SLOTS; ++h) {
+    const float a = tempAt(*f, h);
+    const float b = tempAt(*g, h);
+    TEST_ASSERT_TRUE((isnan(a) && isnan(b)) || fabsf(a - b) < 1e-4f);
+  }
+}
+
+void test_value_interpolates_linearly() {
+  auto f = spanForecast();
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 4.0f, f->value(TEMP, 2.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.75f, f->value(TEMP, 3.25f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 12.5f, f->value(TEMP, 3.5f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 36.0f, f->value(TEMP, 6.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 55.0f, f->value(HUMIDITY, 0.5f));
+}
+
+// Catmull-Rom is exact on a quadratic away from the ends; in the first and
+// last segment the missing neighbour is the end value itself.
+void test_value_interpolates_cubic() {
+  auto f = spanForecast();
+  const ForecastInterp cubic = ForecastInterp::Cubic;
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 12.25f, f->value(TEMP, 3.5f, cubic));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 9.0f, f->value(TEMP, 3.0f, cubic));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 97.0f / 16.0f, f->value(TEMP, 2.5f, cubic));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 497.0f / 16.0f, f->value(TEMP, 5.5f, cubic));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 36.0f, f->value(TEMP, 6.0f, cubic));
+}
+
+// Outside a field's own span value() is NaN in either mode, even where
+// other fields have data.
+void test_value_outside_span_is_nan() {
+  auto f = spanForecast();
+  for (ForecastInterp mode : {ForecastInterp::Linear, ForecastInterp::Cubic}) {
+    TEST_ASSERT_TRUE(isnan(f->value(TEMP, 0.0f, mode)));
+    TEST_ASSERT_TRUE(isnan(f->value(TEMP, 1.99f, mode)));
+    TEST_ASSERT_TRUE(isnan(f->value(TEMP, 6.01f, mode)));
+    TEST_ASSERT_TRUE(isnan(f->value(TEMP, -1.0f, mode)));
+    TEST_ASSERT_TRUE(isnan(f->value(TEMP, NAN, mode)));
+    TEST_ASSERT_TRUE(isnan(f->value(ForecastField::WindSpeed, 3.0f, mode)));
+  }
+  const OutdoorSnapshot s = f->at(7.5f, ForecastInterp::Linear);
+  TEST_ASSERT_TRUE(isnan(s.temperatureC));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 37.5f, s.humidity);
+}
+
+void test_window_inside_span() {
+  auto f = spanForecast();
+  const ForecastWindow w = f->window(TEMP, 3, 5);
+  TEST_ASSERT_EQUAL_UINT16(3, w.hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 9.0f, w.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 25.0f, w.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 50.0f / 3.0f, w.mean);
+
+  // Interpolated hours count; the peak is in the middle.
+  const ForecastWindow h = f->window(HUMIDITY, 2, 6);
+  TEST_ASSERT_EQUAL_UINT16(5, h.hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 60.0f, h.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 90.0f, h.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 75.0f, h.mean);
+}
+
+// Windows reaching past the known span cover only the known hours.
+void test_window_is_cut_to_span() {
+  auto f = spanForecast();
+  ForecastWindow w = f->window(TEMP, 0, 3);
+  TEST_ASSERT_EQUAL_UINT16(2, w.hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 4.0f, w.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 9.0f, w.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 6.5f, w.mean);
+
+  w = f->window(TEMP, 5, 100);
+  TEST_ASSERT_EQUAL_UINT16(2, w.hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 25.0f, w.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 36.0f, w.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 30.5f, w.mean);
+
+  w = f->window(TEMP, 0, MAX_FORECAST_HOURS);
+  TEST_ASSERT_EQUAL_UINT16(5, w.hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 18.0f, w.mean);
+}
+
+void test_window_without_known_hours_is_empty() {
+  auto f = spanForecast();
+  for (const ForecastWindow &w : {f->window(TEMP, 0, 1), f->window(TEMP, 7, 20), f->window(TEMP, 5, 3),
+                                  f->window(ForecastField::WindSpeed, 0, 8)}) {
+    TEST_ASSERT_EQUAL_UINT16(0, w.hours);
+    TEST_ASSERT_TRUE(isnan(w.min) && isnan(w.max) && isnan(w.mean));
+  }
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_assign_fills_gaps_linearly);
+  RUN_TEST(test_value_interpolates_linearly);
+  RUN_TEST(test_value_interpolates_cubic);
+  RUN_TEST(test_value_outside_span_is_nan);
+  RUN_TEST(test_window_inside_span);
+  RUN_TEST(test_window_is_cut_to_span);
+  RUN_TEST(test_window_without_known_hours_is_empty);
+  RUN_TEST(test_drop_leading_moves_slots_towards_now);
+  RUN_TEST(test_dropped_to_slot_zero_survives_merge);
+  RUN_TEST(test_drop_past_horizon_empties_table);
+  RUN_TEST(test_drop_zero_changes_nothing);
+  RUN_TEST(test_dropped_table_round_trips_through_columns);
+  return UNITY_END();
+}
@@ -0,0 +1,316 @@
+#include <unity.h>
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+#include "common/JsonWriter.h"
+
+// JsonWriter commas, escapes, number formatting and overflow, plus a
+// benchmark against ArduinoJson on a document shaped like the metrics frame.
+
+namespace {
+
+std::string write(void (*fn)(JsonWriter &), size_t capacity = 512) {
+  std::string buf(capacity, '\0');
+  JsonWriter w(&buf[0], capacity);
+  fn(w);
+  TEST_ASSERT_TRUE(w.ok());
+  return std::string(w.c_str(), w.size());
+}
+
+std::string fixed(double v, uint8_t decimals) {
+  char buf[64];
+  JsonWriter w(buf, sizeof(buf));
+  w.value(v, decimals);
+  return std::string(buf, w.size());
+}
+
+void nested(JsonWriter &w) {
+  w.beginObject();
+  w.field("a", 1);
+  w.beginArray("list");
+  w.value(1).value(2);
+  w.beginArray().endArray();
+  w.beginObject().endObject();
+  w.beginArray().value("x").beginArray().value(true).endArray().endArray();
+  w.endArray();
+  w.beginObject("o").endObject();
+  w.key("n").null();
+  w.field("s", "t");
+  w.endObject();
+}
+
+// The same document written one call per record, each into a fresh buffer.
+using Step = void (*)(JsonWriter &);
+const Step NESTED_STEPS[] = {
+  [](JsonWriter &w) { w.beginObject(); },
+  [](JsonWriter &w) { w.field("a", 1); },
+  [](JsonWriter &w) { w.beginArray("list"); },
+  [](JsonWriter &w) { w.value(1); },
+  [](JsonWriter &w) { w.value(2); },
+  [](JsonWriter &w) { w.beginArray(); },
+  [](JsonWriter &w) { w.endArray(); },
+  [](JsonWriter &w) { w.beginObject().endObject(); },
+  [](JsonWriter &w) { w.beginArray().value("x"); },
+  [](JsonWriter &w) { w.beginArray().value(true).endArray(); },
+  [](JsonWriter &w) { w.endArray(); },
+  [](JsonWriter &w) { w.endArray(); },
+  [](JsonWriter &w) { w.beginObject("o"); },
+  [](JsonWriter &w) { w.endObject(); },
+  [](JsonWriter &w) { w.key("n"); },
+  [](JsonWriter &w) { w.null(); },
+  [](JsonWriter &w) { w.field("s", "t").endObject(); },
+};
+
+struct Reading {
+  float temperatureC;
+  float humidity;
+  float pressurePa;
+  float altitudeM;
+  uint32_t sequence;
+  uint32_t collectedAtMs;
+};
+
+size_t metricsWithWriter(const Reading &r, char *buf, size_t capacity) {
+  JsonWriter w(buf, capacity);
+  w.beginObject();
+  w.field("status", "ok");
+  w.field("collectedAtMs", r.collectedAtMs);
+  w.field("sequence", r.sequence);
+  w.beginObject("sensors");
+  w.beginObject("sht31").field("present", true).field("ok", true).endObject();
+  w.beginObject("bmp580").field("present", true).field("ok", true).endObject();
+  w.endObject();
+  w.beginObject("metrics");
+  w.field("temperatureC", r.temperatureC, 2);
+  w.field("temperatureF", r.temperatureC * 9.0f / 5.0f + 32.0f, 2);
+  w.field("humidity", r.humidity, 2);
+  w.field("pressurePa", r.pressurePa, 1);
+  w.field("pressureHpa", r.pressurePa / 100.0f, 2);
+  w.field("pressureMmHg", r.pressurePa / 133.322f, 2);
+  w.field("altitudeM", r.altitudeM, 1);
+  w.field("sampleMs", r.collectedAtMs);
+  w.endObject();
+  w.endObject();
+  return w.size();
+}
+
+// The same document the way the routes built it before JsonWriter: rounded
+// floats in a JsonDocument, then serializeJson().
+size_t metricsWithArduinoJson(const Reading &r, char *buf, size_t capacity) {
+  auto round2 = [](float v) { return roundf(v * 100.0f) / 100.0f; };
+  JsonDocument doc;
+  doc["status"] = "ok";
+  doc["collectedAtMs"] = r.collectedAtMs;
+  doc["sequence"] = r.sequence;
+  JsonObject sensors = doc["sensors"].to<JsonObject>();
+  JsonObject sht = sensors["sht31"].to<JsonObject>();
+  sht["present"] = true;
+  sht["ok"] = true;
+  JsonObject bmp = sensors["bmp580"].to<JsonObject>();
+  bmp["present"] = true;
+  bmp["ok"] = true;
+  JsonObject metrics = doc["metrics"].to<JsonObject>();
+  metrics["temperatureC"] = round2(r.temperatureC);
+  metrics["temperatureF"] = round2(r.temperatureC * 9.0f / 5.0f + 32.0f);
+  metrics["humidity"] = round2(r.humidity);
+  metrics["pressurePa"] = roundf(r.pressurePa * 10.0f) / 10.0f;
+  metrics["pressureHpa"] = round2(r.pressurePa / 100.0f);
+  metrics["pressureMmHg"] = round2(r.pressurePa / 133.322f);
+  metrics["altitudeM"] = roundf(r.altitudeM * 10.0f) / 10.0f;
+  metrics["sampleMs"] = r.collectedAtMs;
+  return serializeJson(doc, buf, capacity);
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_commas_and_nesting() {
+  TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"list\":[1,2,[],{},[\"x\",[true]]],\"o\":{},\"n\":null,\"s\":\"t\"}",
+                           write(nested).c_str());
+  TEST_ASSERT_EQUAL_STRING("[]", write([](JsonWriter &w) { w.beginArray().endArray(); }).c_str());
+  TEST_ASSERT_EQUAL_STRING("[{\"k\":[]},{}]", write([](JsonWriter &w) {
+                             w.beginArray().beginObject().beginArray("k").endArray().endObject().beginObject().endObject().endArray();
+                           }).c_str());
+}
+
+// rebind() keeps the per-level comma state: the pieces concatenate to the
+// one-shot document, with every comma in the piece that starts the element.
+void test_commas_across_rebind() {
+  JsonWriter w;
+  std::string joined;
+  for (Step step : NESTED_STEPS) {
+    char piece[64];
+    w.rebind(piece, sizeof(piece));
+    step(w);
+    TEST_ASSERT_TRUE(w.ok());
+    joined.append(w.c_str(), w.size());
+  }
+  TEST_ASSERT_EQUAL_UINT8(0, w.level());
+  TEST_ASSERT_EQUAL_STRING(write(nested).c_str(), joined.c_str());
+}
+
+void test_escapes() {
+  TEST_ASSERT_EQUAL_STRING("\"q\\\"b\\\\n\\nc\\u0001\\u001f\\u0009\"", write([](JsonWriter &w) {
+                             w.value("q\"b\\n\nc\x01\x1f\t");
+                           }).c_str());
+  // UTF-8 and DEL pass through unescaped.
+  TEST_ASSERT_EQUAL_STRING("{\"\xc2\xb0" "C\":\"\x7f\"}", write([](JsonWriter &w) { w.beginObject().field("\xc2\xb0" "C", "\x7f").endObject(); }).c_str());
+  TEST_ASSERT_EQUAL_STRING("[null,\"\"]", write([](JsonWriter &w) {
+                             w.beginArray().value(static_cast<const char *>(nullptr)).value("").endArray();
+                           }).c_str());
+}
+
+void test_integers() {
+  TEST_ASSERT_EQUAL_STRING("[0,-1,255,-128,4294967295,18446744073709551615,-9223372036854775808,9223372036854775807]",
+                           write([](JsonWriter &w) {
+                             w.beginArray();
+                             w.value(0).value(-1).value(static_cast<uint8_t>(255)).value(static_cast<int8_t>(-128));
+                             w.value(UINT32_MAX).value(UINT64_MAX).value(INT64_MIN).value(INT64_MAX);
+                             w.endArray();
+                           }).c_str());
+}
+
+void test_fixed_rounding_edges() {
+  TEST_ASSERT_EQUAL_STRING("21.35", fixed(21.354, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("10.00", fixed(9.9999, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("-10.00", fixed(-9.9999, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.01", fixed(0.005, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("3", fixed(2.5, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("-3", fixed(-2.5, 0).c_str());
+  TEST_ASSERT_EQUAL_STRING("0.05", fixed(0.05, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("1.000001", fixed(1.0000005, 6).c_str());
+  // Leading zeros of the fraction survive.
+  TEST_ASSERT_EQUAL_STRING("7.007", fixed(7.007, 3).c_str());
+  // No "-0.00": a value that rounds to zero loses its sign.
+  TEST_ASSERT_EQUAL_STRING("0.00", fixed(-0.004, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("0", fixed(-0.0, 0).c_str());
+  // More than six decimals are clamped.
+  TEST_ASSERT_EQUAL_STRING("0.333333", fixed(1.0 / 3.0, 9).c_str());
+  // Past 1e18 scaled units it falls back to printf.
+  char expected[64];
+  snprintf(expected, sizeof(expected), "%.2f", 1e20);
+  TEST_ASSERT_EQUAL_STRING(expected, fixed(1e20, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("null", fixed(NAN, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("null", fixed(-INFINITY, 1).c_str());
+}
+
+// Sensor-range values print as printf would, apart from the -0 case above.
+void test_fixed_matches_printf() {
+  uint32_t state = 12345u;
+  size_t mismatches = 0;
+  for (int i = 0; i < 20000; ++i) {
+    state = state * 1664525u + 1013904223u;
+    const double v = (static_cast<int32_t>(state) / 2147483648.0) * 1100.0;
+    const uint8_t decimals = static_cast<uint8_t>(state >> 29) % 4;
+    char ref[64];
+    snprintf(ref, sizeof(ref), "%.*f", decimals, v);
+    if (fixed(v, decimals) != ref && std::string("-") + fixed(v, decimals) != ref) ++mismatches;
+  }
+  TEST_ASSERT_EQUAL(0u, mismatches);
+}
+
+void test_overflow() {
+  char buf[16];
+  JsonWriter w(buf, sizeof(buf));
+  w.beginObject().field("temperature", 21.5, 1);
+  TEST_ASSERT_FALSE(w.ok());
+  TEST_ASSERT_EQUAL(sizeof(buf) - 1, w.size());
+  TEST_ASSERT_EQUAL(strlen(buf), w.size());
+  // Later output is dropped, the flag stays.
+  w.endObject();
+  TEST_ASSERT_FALSE(w.ok());
+  TEST_ASSERT_EQUAL(sizeof(buf) - 1, w.size());
+
+  // jsonField() with a fill bigger than the room writes null or nothing.
+  char small[24];
+  JsonWriter j(small, sizeof(small));
+  j.beginObject().jsonField("x", [](char *, size_t room) { return room + 1; });
+  TEST_ASSERT_FALSE(j.ok());
+  TEST_ASSERT_EQUAL(strlen(small), j.size());
+
+  // rebind() does not clear the flag: the document is already broken.
+  char next[32];
+  w.rebind(next, sizeof(next));
+  w.value(1);
+  TEST_ASSERT_FALSE(w.ok());
+
+  // Nesting past MAX_DEPTH is an overflow too.
+  char deep[128];
+  JsonWriter d(deep, sizeof(deep));
+  for (int i = 0; i <= JsonWriter::MAX_DEPTH; ++i) d.beginArray();
+  TEST_ASSERT_FALSE(d.ok());
+}
+
+void test_json_field_embeds_text() {
+  TEST_ASSERT_EQUAL_STRING("{\"a\":{\"t\":1},\"b\":null,\"c\":2}", write([](JsonWriter &w) {
+                             w.beginObject();
+                             w.jsonField("a", [](char *dst, size_t) {
+                               memcpy(dst, "{\"t\":1}", 7);
+                               return size_t(7);
+                             });
+                             w.jsonField("b", [](char *, size_t) { return size_t(0); });
+                             w.field("c", 2);
+                             w.endObject();
+                           }).c_str());
+}
+
+void test_benchmark_against_arduinojson() {
+  constexpr int N = 20000;
+  char buf[512];
+  Reading r{21.37f, 48.2f, 100132.4f, 212.3f, 1, 1000};
+  using Clock = std::chrono::steady_clock;
+  size_t writerBytes = 0;
+  size_t docBytes = 0;
+
+  const auto t0 = Clock::now();
+  for (int i = 0; i < N; ++i) {
+    r.sequence = i;
+    r.temperatureC += 0.01f;
+    writerBytes += metricsWithWriter(r, buf, sizeof(buf));
+  }
+  const auto t1 = Clock::now();
+  for (int i = 0; i < N; ++i) {
+    r.sequence = i;
+    r.temperatureC -= 0.01f;
+    docBytes += metricsWithArduinoJson(r, buf, sizeof(buf));
+  }
+  const auto t2 = Clock::now();
+
+  // Both must describe the same document.
+  char a[512];
+  char b[512];
+  metricsWithWriter(r, a, sizeof(a));
+  metricsWithArduinoJson(r, b, sizeof(b));
+  JsonDocument da;
+  JsonDocument db;
+  TEST_ASSERT_FALSE(deserializeJson(da, a));
+  TEST_ASSERT_FALSE(deserializeJson(db, b));
+  TEST_ASSERT_EQUAL(db["metrics"].as<JsonObject>().size(), da["metrics"].as<JsonObject>().size());
+  TEST_ASSERT_FLOAT_WITHIN(0.006, db["metrics"]["temperatureC"].as<float>(), da["metrics"]["temperatureC"].as<float>());
+
+  const double writerNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  const double docNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+  char line[160];
+  snprintf(line, sizeof(line), "metrics frame: JsonWriter %.0f ns (%zu B), ArduinoJson %.0f ns (%zu B), %.1fx",
+           writerNs, writerBytes / N, docNs, docBytes / N, docNs / writerNs);
+  TEST_MESSAGE(line);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_commas_and_nesting);
+  RUN_TEST(test_commas_across_rebind);
+  RUN_TEST(test_escapes);
+  RUN_TEST(test_integers);
+  RUN_TEST(test_fixed_rounding_edges);
+  RUN_TEST(test_fixed_matches_printf);
+  RUN_TEST(test_overflow);
+  RUN_TEST(test_json_field_embeds_text);
+  RUN_TEST(test_benchmark_against_arduinojson);
+  return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "common/JsonWriter.h"
+#include "common/MsgPackWriter.h"
+
+// MsgPackWriter encodings, and that a builder templated on the writer gives
+// the same document through JsonWriter and MsgPackWriter.
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+Bytes bytesOf(const MsgPackWriter &w) { return Bytes(w.data(), w.data() + w.size()); }
+
+uint64_t readBig(const uint8_t *&p, size_t n) {
+  uint64_t v = 0;
+  while (n--) v = (v << 8) | *p++;
+  return v;
+}
+
+// Decodes the subset MsgPackWriter emits back into compact JSON; floats are
+// not part of the comparison and come out as "f".
+void toJson(const uint8_t *&p, std::string &out) {
+  const uint8_t b = *p++;
+  auto str = [&](size_t n) {
+    out += '"';
+    out.append(reinterpret_cast<const char *>(p), n);
+    out += '"';
+    p += n;
+  };
+  auto container = [&](size_t n, bool map) {
+    out += map ? '{' : '[';
+    for (size_t i = 0; i < n; ++i) {
+      if (i) out += ',';
+      toJson(p, out);
+      if (map) {
+        out += ':';
+        toJson(p, out);
+      }
+    }
+    out += map ? '}' : ']';
+  };
+  if (b < 0x80) {
+    out += std::to_string(b);
+  } else if (b >= 0xE0) {
+    out += std::to_string(static_cast<int8_t>(b));
+  } else if ((b & 0xE0) == 0xA0) {
+    str(b & 0x1F);
+  } else if (b == 0xC0) {
+    out += "null";
+  } else if (b == 0xC2 || b == 0xC3) {
+    out += b == 0xC3 ? "true" : "false";
+  } else if (b >= 0xCC && b <= 0xCF) {
+    out += std::to_string(readBig(p, 1u << (b - 0xCC)));
+  } else if (b >= 0xD0 && b <= 0xD3) {
+    const size_t n = 1u << (b - 0xD0);
+    const uint64_t raw = readBig(p, n);
+    const int64_t v = n == 8 ? static_cast<int64_t>(raw) : static_cast<int64_t>(raw << (64 - 8 * n)) >> (64 - 8 * n);
+    out += std::to_string(v);
+  } else if (b == 0xCA || b == 0xCB) {
+    p += b == 0xCA ? 4 : 8;
+    out += "f";
+  } else if (b == 0xD9 || b == 0xDA) {
+    str(readBig(p, b == 0xD9 ? 1 : 2));
+  } else if (b == 0xDC || b == 0xDE) {
+    container(readBig(p, 2), b == 0xDE);
+  } else {
+    out += "?";
+  }
+}
+
+template <typename Writer>
+void sample(Writer &w) {
+  w.beginObject();
+  w.field("name", "station north");
+  w.field("count", 300u);
+  w.field("offset", -70);
+  w.field("big", static_cast<uint64_t>(5000000000ull));
+  w.field("min", static_cast<int64_t>(-40000));
+  w.field("on", true);
+  w.key("missing").null();
+  w.beginArray("empty").endArray();
+  w.beginArray("list");
+  for (int i = -2; i < 3; ++i) w.value(i * 100);
+  w.beginObject().field("x", 1).endObject();
+  w.endArray();
+  w.beginObject("nested").beginObject("deeper").field("k", "v").endObject().endObject();
+  w.field("rounded", 20.0, 0);
+  w.endObject();
+}
+
+float decodeFloat32(const uint8_t *p) {
+  const uint32_t bits = static_cast<uint32_t>(readBig(p, 4));
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_scalars() {
+  uint8_t buf[64];
+  MsgPackWriter w(buf, sizeof(buf));
+  w.beginArray();
+  w.value(0).value(127).value(128).value(65535).value(65536u).value(-1).value(-32).value(-33).value(-129);
+  w.value(false).value(true).null().value(static_cast<const char *>(nullptr)).value("ab");
+  w.endArray();
+  const Bytes expected = {0xDC, 0x00, 0x0E, 0x00, 0x7F, 0xCC, 0x80, 0xCD, 0xFF, 0xFF, 0xCE, 0x00, 0x01, 0x00,
+                          0x00, 0xFF, 0xE0, 0xD0, 0xDF, 0xD1, 0xFF, 0x7F, 0xC2, 0xC3, 0xC0, 0xC0, 0xA2, 'a', 'b'};
+  TEST_ASSERT_TRUE(w.ok());
+  TEST_ASSERT_TRUE(expected == bytesOf(w));
+}
+
+void test_map_counts_are_patched() {
+  uint8_t buf[64];
+  MsgPackWriter w(buf, sizeof(buf));
+  w.beginObject();
+  w.field("a", 1);
+  w.beginObject("b").field("c", 2).field("d", 3).endObject();
+  w.beginArray("e").value(4).endArray();
+  w.endObject();
+  const Bytes expected = {0xDE, 0x00, 0x03, 0xA1, 'a', 0x01, 0xA1, 'b', 0xDE, 0x00, 0x02, 0xA1, 'c', 0x02,
+                          0xA1, 'd', 0x03, 0xA1, 'e', 0xDC, 0x00, 0x01, 0x04};
+  TEST_ASSERT_TRUE(expected == bytesOf(w));
+  TEST_ASSERT_EQUAL_UINT8(0, w.level());
+}
+
+void test_same_document_as_json() {
+  char text[512];
+  JsonWriter j(text, sizeof(text));
+  sample(j);
+  uint8_t buf[512];
+  MsgPackWriter m(buf, sizeof(buf));
+  sample(m);
+  TEST_ASSERT_TRUE(j.ok());
+  TEST_ASSERT_TRUE(m.ok());
+
+  const uint8_t *p = m.data();
+  std::string decoded;
+  toJson(p, decoded);
+  TEST_ASSERT_EQUAL(m.size(), static_cast<size_t>(p - m.data()));
+  TEST_ASSERT_EQUAL_STRING(j.c_str(), decoded.c_str());
+}
+
+void test_long_strings() {
+  std::vector<uint8_t> buf(70000);
+  const std::string s32(32, 'x');
+  const std::string s300(300, 'y');
+  MsgPackWriter w(buf.data(), buf.size());
+  w.value(s32.c_str());
+  TEST_ASSERT_EQUAL_HEX8(0xD9, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(32, buf[1]);
+  MsgPackWriter v(buf.data(), buf.size());
+  v.value(s300.c_str());
+  TEST_ASSERT_EQUAL_HEX8(0xDA, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x2C, buf[2]);
+  TEST_ASSERT_EQUAL(303u, v.size());
+}
+
+void test_floats() {
+  uint8_t buf[32];
+  MsgPackWriter w(buf, sizeof(buf));
+  w.value(21.354, 2);
+  // float32 of 21.35, the value the JSON form prints.
+  TEST_ASSERT_EQUAL_HEX8(0xCA, buf[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 21.35f, decodeFloat32(buf + 1));
+
+  // Six decimals of a coordinate do not survive float32.
+  MsgPackWriter c(buf, sizeof(buf));
+  c.value(50.075512, 6);
+  TEST_ASSERT_EQUAL_HEX8(0xCB, buf[0]);
+  TEST_ASSERT_EQUAL(9u, c.size());
+
+  MsgPackWriter n(buf, sizeof(buf));
+  n.value(NAN, 2).value(INFINITY, 1).value(-2.6, 0);
+  const Bytes expected = {0xC0, 0xC0, 0xFD};
+  TEST_ASSERT_TRUE(expected == bytesOf(n));
+
+  MsgPackWriter f(buf, sizeof(buf));
+  f.beginObject().fieldIfFinite("gone", NAN, 2).fieldIfFinite("kept", 1.5, 1).endObject();
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[2]);
+}
+
+void test_packed_values() {
+  uint8_t buf[16];
+  MsgPackWriter w(buf, sizeof(buf));
+  w.beginObject();
+  w.packedField("a", [](uint8_t *dst, size_t) {
+    dst[0] = 0x92;
+    dst[1] = 0x01;
+    dst[2] = 0x02;
+    return size_t(3);
+  });
+  w.packedField("b", [](uint8_t *, size_t) { return size_t(0); });
+  w.endObject();
+  const Bytes expected = {0xDE, 0x00, 0x02, 0xA1, 'a', 0x92, 0x01, 0x02, 0xA1, 'b', 0xC0};
+  TEST_ASSERT_TRUE(w.ok());
+  TEST_ASSERT_TRUE(expected == bytesOf(w));
+
+  // A fill that reports more than the room it had overflows the writer.
+  MsgPackWriter o(buf, sizeof(buf));
+  o.packed([](uint8_t *, size_t room) { return room + 1; });
+  TEST_ASSERT_FALSE(o.ok());
+}
+
+void test_overflow_is_sticky() {
+  uint8_t buf[8];
+  MsgPackWriter w(buf, sizeof(buf));
+  w.beginObject().field("abcdef", 1).endObject();
+  TEST_ASSERT_FALSE(w.ok());
+  TEST_ASSERT_TRUE(w.size() <= sizeof(buf));
+
+  uint8_t fits[3];
+  MsgPackWriter e(fits, sizeof(fits));
+  e.beginArray().endArray();
+  TEST_ASSERT_TRUE(e.ok());
+  e.value(1);
+  TEST_ASSERT_FALSE(e.ok());
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_scalars);
+  RUN_TEST(test_map_counts_are_patched);
+  RUN_TEST(test_same_document_as_json);
+  RUN_TEST(test_long_strings);
+  RUN_TEST(test_floats);
+  RUN_TEST(test_packed_values);
+  RUN_TEST(test_overflow_is_sticky);
+  return UNITY_END();
+}
@@ -0,0 +1,192 @@
+#include <unity.h>
+
+#include <memory>
+#include <string>
+
+#include "service/OpenMeteoProvider.h"
+
+// Canned api.open-meteo.com responses fed to OpenMeteoProvider the way the
+// fetch task does: in arbitrary chunks, then finish().
+
+namespace {
+
+float rowTemp(unsigned h) { return 5.0f + 0.25f * h; }
+
+// A response shaped like the real one for the URL requestUrl() builds,
+// with rows hours 0..rows-1 (row 0 is the hour in progress).
+std::string cannedBody(unsigned rows, bool withCurrent = true) {
+  std::string b = "{\"latitude\":50.08,\"longitude\":14.42,\"generationtime_ms\":0.05,\"utc_offset_seconds\":0,"
+                  "\"timezone\":\"GMT\",\"timezone_abbreviation\":\"GMT\",\"elevation\":212.0,";
+  if (withCurrent) {
+    b += "\"current_units\":{\"time\":\"unixtime\",\"interval\":\"seconds\",\"temperature_2m\":\"\\u00b0C\","
+         "\"relative_humidity_2m\":\"%\",\"pressure_msl\":\"hPa\",\"wind_speed_10m\":\"m/s\"},"
+         "\"current\":{\"time\":1700000000,\"interval\":900,\"temperature_2m\":7.3,\"relative_humidity_2m\":81,"
+         "\"pressure_msl\":1012.4,\"wind_speed_10m\":3.2},";
+  }
+  b += "\"hourly_units\":{\"time\":\"unixtime\",\"temperature_2m\":\"\\u00b0C\"},\"hourly\":{\"time\":[";
+  for (unsigned h = 0; h < rows; ++h) b += (h ? "," : "") + std::to_string(1699999200u + h * 3600u);
+  b += "],\"temperature_2m\":[";
+  for (unsigned h = 0; h < rows; ++h) b += (h ? "," : "") + std::to_string(rowTemp(h));
+  b += "],\"relative_humidity_2m\":[";
+  // Open-Meteo sends null for hours it has no value for.
+  for (unsigned h = 0; h < rows; ++h) b += (h ? "," : "") + (h == 5 ? std::string("null") : std::to_string(60 + h % 30));
+  b += "],\"pressure_msl\":[";
+  for (unsigned h = 0; h < rows; ++h) b += (h ? "," : "") + std::to_string(1000.5 + h);
+  b += "],\"wind_speed_10m\":[";
+  for (unsigned h = 0; h < rows; ++h) b += (h ? "," : "") + std::to_string(h % 7);
+  b += "]}}";
+  return b;
+}
+
+// Feeds body in pieces of chunk bytes (0 = all at once).
+bool run(OpenMeteoProvider &p, OutdoorForecastBuffer &out, const std::string &body, size_t chunk = 0) {
+  p.begin(out);
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(body.data());
+  const size_t step = chunk ? chunk : body.size();
+  for (size_t at = 0; at < body.size(); at += step) {
+    const size_t n = body.size() - at < step ? body.size() - at : step;
+    if (!p.feed(data + at, n)) break;
+  }
+  return p.finish();
+}
+
+bool sameBuffer(const OutdoorForecastBuffer &a, const OutdoorForecastBuffer &b) {
+  // NaN never compares equal, so compare the bits.
+  return a.hours == b.hours && memcmp(&a.current, &b.current, sizeof(a.current)) == 0 &&
+         memcmp(a.hourly, b.hourly, sizeof(a.hourly)) == 0;
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_full_response() {
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  TEST_ASSERT_TRUE(run(p, *out, cannedBody(MAX_FORECAST_HOURS + 1)));
+  TEST_ASSERT_NULL(p.error());
+  TEST_ASSERT_NULL(p.errorReason());
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 7.3f, out->current.temperatureC);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 81.0f, out->current.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 1012.4f, out->current.pressureHpa);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 3.2f, out->current.windSpeed);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 212.0f, out->current.altitudeM);
+  TEST_ASSERT_TRUE(isnan(out->current.pressureMmHg));
+
+  // Row 0 is covered by "current"; hourly[i] is row i + 1.
+  TEST_ASSERT_EQUAL_UINT16(MAX_FORECAST_HOURS, out->hours);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, rowTemp(1), out->hourly[0].temperatureC);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, rowTemp(MAX_FORECAST_HOURS), out->hourly[MAX_FORECAST_HOURS - 1].temperatureC);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 1000.5f + 24, out->hourly[23].pressureHpa);
+  TEST_ASSERT_TRUE(isnan(out->hourly[4].humidity)); // null at row 5
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 66.0f, out->hourly[5].humidity);
+  TEST_ASSERT_TRUE(isnan(out->hourly[0].altitudeM));
+}
+
+// The body arrives in whatever pieces TCP delivers; every split must parse
+// to the same buffer as the whole body.
+void test_split_chunks_match_whole_body() {
+  const std::string body = cannedBody(49);
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> whole(new OutdoorForecastBuffer());
+  TEST_ASSERT_TRUE(run(p, *whole, body));
+  const size_t chunks[] = {1, 2, 3, 7, 16, 63, 64, 65, 512};
+  for (size_t chunk : chunks) {
+    std::unique_ptr<OutdoorForecastBuffer> split(new OutdoorForecastBuffer());
+    TEST_ASSERT_TRUE(run(p, *split, body, chunk));
+    TEST_ASSERT_TRUE(sameBuffer(*whole, *split));
+  }
+}
+
+void test_extra_rows_are_ignored() {
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  TEST_ASSERT_TRUE(run(p, *out, cannedBody(MAX_FORECAST_HOURS + 40), 100));
+  TEST_ASSERT_EQUAL_UINT16(MAX_FORECAST_HOURS, out->hours);
+}
+
+// A connection that closes early leaves an incomplete document: finish()
+// must fail wherever the cut falls.
+void test_truncated_body_fails() {
+  const std::string body = cannedBody(25);
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  for (size_t cut = 0; cut < body.size(); cut += 37) {
+    *out = OutdoorForecastBuffer();
+    TEST_ASSERT_FALSE(run(p, *out, body.substr(0, cut), 16));
+    TEST_ASSERT_NOT_NULL(p.error());
+  }
+  TEST_ASSERT_FALSE(run(p, *out, body.substr(0, body.size() - 1)));
+}
+
+// What api.open-meteo.com returns with HTTP 400.
+void test_http_error_body_reports_reason() {
+  const std::string body = "{\"error\":true,\"reason\":\"Latitude must be in range of -90 to 90\\u00b0. Given: 91.0.\"}";
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  TEST_ASSERT_FALSE(run(p, *out, body, 5));
+  TEST_ASSERT_NOT_NULL(p.errorReason());
+  TEST_ASSERT_EQUAL_STRING("Latitude must be in range of -90 to 90\xc2\xb0. Given: 91.0.", p.errorReason());
+  TEST_ASSERT_EQUAL_STRING(p.errorReason(), p.error());
+
+  // Without a reason the error still says what happened.
+  TEST_ASSERT_FALSE(run(p, *out, "{\"error\":true}"));
+  TEST_ASSERT_EQUAL_STRING("error response", p.error());
+
+  // An HTML error page is not JSON at all.
+  TEST_ASSERT_FALSE(run(p, *out, "<html><body>502 Bad Gateway</body></html>"));
+  TEST_ASSERT_NULL(p.errorReason());
+  TEST_ASSERT_NOT_NULL(p.error());
+}
+
+void test_missing_current_fails() {
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  TEST_ASSERT_FALSE(run(p, *out, cannedBody(13, false), 32));
+  TEST_ASSERT_EQUAL_STRING("no current conditions", p.error());
+  // The hourly rows were still read; the caller just must not use them.
+  TEST_ASSERT_EQUAL_UINT16(12, out->hours);
+
+  TEST_ASSERT_FALSE(run(p, *out, "{}"));
+  TEST_ASSERT_EQUAL_STRING("no current conditions", p.error());
+}
+
+// begin() resets the state of the previous response.
+void test_reuse_after_failure() {
+  OpenMeteoProvider p;
+  std::unique_ptr<OutdoorForecastBuffer> out(new OutdoorForecastBuffer());
+  TEST_ASSERT_FALSE(run(p, *out, "{\"error\":true,\"reason\":\"x\"}"));
+  *out = OutdoorForecastBuffer();
+  TEST_ASSERT_TRUE(run(p, *out, cannedBody(3), 9));
+  TEST_ASSERT_NULL(p.error());
+  TEST_ASSERT_NULL(p.errorReason());
+  TEST_ASSERT_EQUAL_UINT16(2, out->hours);
+}
+
+void test_request_url() {
+  OpenMeteoProvider p;
+  OutdoorConfig cfg;
+  cfg.lat = 50.0755;
+  cfg.lon = -14.4378;
+  const String url = p.requestUrl(cfg, MAX_FORECAST_HOURS);
+  const std::string s = url.c_str();
+  TEST_ASSERT_EQUAL(0u, s.find("http://api.open-meteo.com/v1/forecast?latitude=50.0755&longitude=-14.4378"));
+  TEST_ASSERT_TRUE(s.find("&current=temperature_2m,relative_humidity_2m,pressure_msl,wind_speed_10m") != std::string::npos);
+  TEST_ASSERT_TRUE(s.find("&forecast_hours=169") != std::string::npos);
+  TEST_ASSERT_TRUE(s.find("timeformat=unixtime") != std::string::npos);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_full_response);
+  RUN_TEST(test_split_chunks_match_whole_body);
+  RUN_TEST(test_extra_rows_are_ignored);
+  RUN_TEST(test_truncated_body_fails);
+  RUN_TEST(test_http_error_body_reports_reason);
+  RUN_TEST(test_missing_current_fails);
+  RUN_TEST(test_reuse_after_failure);
+  RUN_TEST(test_request_url);
+  return UNITY_END();
+}
@@ -0,0 +1,289 @@
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "common/TimeSeriesCodec.h"
+
+// Round-trip and size tests for TimeSeriesCodec, plus a throughput and
+// bytes/point benchmark on synthetic 2 s weather data. Channel layout
+// matches HistoryBlockRing: three packed metrics and the sample count.
+
+namespace {
+
+constexpr size_t CHANNELS = 4;
+constexpr size_t BLOCK_BYTES = 256; // HISTORY_BLOCK_BYTES
+
+struct Point {
+  uint32_t t;
+  uint16_t v[CHANNELS];
+};
+
+// xorshift32: deterministic across hosts so failures reproduce.
+struct Rng {
+  uint32_t s;
+  uint32_t next() {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+  }
+  int32_t range(int32_t lo, int32_t hi) { return lo + static_cast<int32_t>(next() % static_cast<uint32_t>(hi - lo + 1)); }
+};
+
+// A signed magnitude that lands in prefix class c of the given payload widths
+// (class 4 goes beyond the widest payload).
+int32_t magnitudeForClass(Rng &rng, uint8_t c, const int32_t *limits) {
+  if (c == 0) return 0;
+  const int32_t lo = c == 1 ? 1 : limits[c - 2] + 1;
+  const int32_t hi = c == 4 ? limits[2] * 8 : limits[c - 1];
+  const int32_t m = rng.range(lo, hi);
+  return (rng.next() & 1) ? m : -m;
+}
+
+// Largest |dod| per class 1..3, and |delta| per class 1..3 (zig-zag halves the range).
+constexpr int32_t DOD_LIMITS[3] = {63, 255, 2047};
+constexpr int32_t DELTA_LIMITS[3] = {7, 127, 2047};
+
+// Encodes points into consecutive blocks, starting a new block whenever
+// append refuses a point. Returns the number of blocks used.
+size_t encodeBlocks(const Point *pts, size_t n, uint8_t (*blocks)[BLOCK_BYTES], size_t *bytes, size_t *counts, size_t maxBlocks) {
+  TimeSeriesEncoder<CHANNELS> enc;
+  size_t used = 0;
+  enc.reset(blocks[0], BLOCK_BYTES);
+  for (size_t i = 0; i < n; ++i) {
+    if (!enc.append(pts[i].t, pts[i].v)) {
+      bytes[used] = enc.bytes();
+      counts[used] = enc.count();
+      if (++used == maxBlocks) return used;
+      enc.reset(blocks[used], BLOCK_BYTES);
+      TEST_ASSERT_TRUE(enc.append(pts[i].t, pts[i].v));
+    }
+  }
+  bytes[used] = enc.bytes();
+  counts[used] = enc.count();
+  return used + 1;
+}
+
+void expectDecodes(const uint8_t *block, size_t bytes, size_t count, const Point *expected) {
+  TimeSeriesDecoder<CHANNELS> dec(block, bytes, count);
+  uint32_t t;
+  uint16_t v[CHANNELS];
+  for (size_t i = 0; i < count; ++i) {
+    TEST_ASSERT_TRUE(dec.next(t, v));
+    TEST_ASSERT_EQUAL_UINT32(expected[i].t, t);
+    TEST_ASSERT_EQUAL_MEMORY(expected[i].v, v, sizeof(v));
+  }
+  TEST_ASSERT_FALSE(dec.next(t, v));
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_zigzag_round_trip() {
+  const int32_t cases[] = {0, 1, -1, 2, -2, 63, -64, 65535, -65535, 0x7FFFFFFF, static_cast<int32_t>(0x80000000)};
+  for (int32_t v : cases) TEST_ASSERT_EQUAL_INT32(v, tscodec::unzigzag(tscodec::zigzag(v)));
+  TEST_ASSERT_EQUAL_UINT32(1, tscodec::zigzag(-1));
+  TEST_ASSERT_EQUAL_UINT32(2, tscodec::zigzag(1));
+}
+
+void test_class_boundaries() {
+  TEST_ASSERT_EQUAL_UINT8(0, tscodec::dodClass(0));
+  TEST_ASSERT_EQUAL_UINT8(1, tscodec::dodClass(63));
+  TEST_ASSERT_EQUAL_UINT8(1, tscodec::dodClass(-64));
+  TEST_ASSERT_EQUAL_UINT8(2, tscodec::dodClass(64));
+  TEST_ASSERT_EQUAL_UINT8(2, tscodec::dodClass(-256));
+  TEST_ASSERT_EQUAL_UINT8(3, tscodec::dodClass(256));
+  TEST_ASSERT_EQUAL_UINT8(3, tscodec::dodClass(-2048));
+  TEST_ASSERT_EQUAL_UINT8(4, tscodec::dodClass(2048));
+  TEST_ASSERT_EQUAL_UINT8(4, tscodec::dodClass(-2049));
+  TEST_ASSERT_EQUAL_UINT8(1, tscodec::deltaClass(15));
+  TEST_ASSERT_EQUAL_UINT8(2, tscodec::deltaClass(16));
+  TEST_ASSERT_EQUAL_UINT8(3, tscodec::deltaClass(4095));
+  TEST_ASSERT_EQUAL_UINT8(4, tscodec::deltaClass(4096));
+}
+
+// Random walk that picks every prefix class for both timestamps and values,
+// including backwards steps and 16-bit wrap, across many full blocks.
+void test_random_round_trip_all_classes() {
+  constexpr size_t N = 4000;
+  static Point pts[N];
+  Rng rng{0x9E3779B9u};
+  uint32_t seenDod[5] = {};
+  uint32_t seenDelta[5] = {};
+
+  int64_t prevDelta = 0;
+  pts[0].t = 1700000000u;
+  for (size_t c = 0; c < CHANNELS; ++c) pts[0].v[c] = static_cast<uint16_t>(rng.next());
+  for (size_t i = 1; i < N; ++i) {
+    const int64_t dod = magnitudeForClass(rng, static_cast<uint8_t>(rng.next() % 5), DOD_LIMITS);
+    const int64_t delta = prevDelta + dod;
+    pts[i].t = static_cast<uint32_t>(pts[i - 1].t + delta);
+    ++seenDod[tscodec::dodClass(static_cast<int64_t>(pts[i].t) - pts[i - 1].t - prevDelta)];
+    prevDelta = static_cast<int64_t>(pts[i].t) - pts[i - 1].t;
+    for (size_t c = 0; c < CHANNELS; ++c) {
+      const int32_t d = magnitudeForClass(rng, static_cast<uint8_t>(rng.next() % 5), DELTA_LIMITS);
+      pts[i].v[c] = static_cast<uint16_t>(pts[i - 1].v[c] + d);
+      ++seenDelta[tscodec::deltaClass(tscodec::zigzag(static_cast<int32_t>(pts[i].v[c]) - pts[i - 1].v[c]))];
+    }
+  }
+  for (size_t c = 0; c < 5; ++c) {
+    TEST_ASSERT_GREATER_THAN(0, seenDod[c]);
+    TEST_ASSERT_GREATER_THAN(0, seenDelta[c]);
+  }
+
+  static uint8_t blocks[N][BLOCK_BYTES];
+  static size_t bytes[N], counts[N];
+  const size_t used = encodeBlocks(pts, N, blocks, bytes, counts, N);
+  TEST_ASSERT_GREATER_THAN(1, used);
+  size_t offset = 0;
+  for (size_t b = 0; b < used; ++b) {
+    TEST_ASSERT_LESS_OR_EQUAL(BLOCK_BYTES, bytes[b]);
+    expectDecodes(blocks[b], bytes[b], counts[b], pts + offset);
+    offset += counts[b];
+  }
+  TEST_ASSERT_EQUAL(N, offset);
+}
+
+// The first point is verbatim: exactly 32 + 16 * CHANNELS bits must fit, one byte less must not.
+void test_first_point_exact_fit() {
+  constexpr size_t FIRST_BYTES = (32 + 16 * CHANNELS) / 8;
+  uint8_t buf[FIRST_BYTES];
+  const Point p = {1234567u, {1, 2, 3, 4}};
+  TimeSeriesEncoder<CHANNELS> enc;
+
+  enc.reset(buf, FIRST_BYTES - 1);
+  TEST_ASSERT_FALSE(enc.append(p.t, p.v));
+  TEST_ASSERT_EQUAL(0, enc.count());
+
+  enc.reset(buf, FIRST_BYTES);
+  TEST_ASSERT_TRUE(enc.append(p.t, p.v));
+  TEST_ASSERT_EQUAL(FIRST_BYTES, enc.bytes());
+  // No room left even for an all-zero repeat ('0' per field).
+  TEST_ASSERT_FALSE(enc.append(p.t, p.v));
+  expectDecodes(buf, enc.bytes(), enc.count(), &p);
+}
+
+// Filling a block: every append before nearlyFull() succeeds, the refused
+// point leaves earlier bits intact, and the block never exceeds its capacity.
+void test_block_full_boundary() {
+  Rng rng{12345u};
+  for (int round = 0; round < 200; ++round) {
+    uint8_t buf[BLOCK_BYTES];
+    memset(buf, 0xA5, sizeof(buf));
+    static Point pts[BLOCK_BYTES * 8];
+    TimeSeriesEncoder<CHANNELS> enc;
+    enc.reset(buf, BLOCK_BYTES);
+    size_t n = 0;
+    uint32_t t = 1700000000u;
+    uint16_t v[CHANNELS] = {12000, 5000, 50000, 1};
+    while (true) {
+      // Mostly cheap points with occasional escapes, so blocks end at varied bit offsets.
+      t += static_cast<uint32_t>(rng.range(1, (rng.next() % 8) ? 3 : 5000));
+      for (size_t c = 0; c < CHANNELS; ++c) v[c] = static_cast<uint16_t>(v[c] + rng.range(-((rng.next() % 4) ? 3 : 3000), 3));
+      const bool roomy = !enc.nearlyFull();
+      const size_t bitsBefore = enc.bits();
+      if (!enc.append(t, v)) {
+        TEST_ASSERT_FALSE(roomy);
+        TEST_ASSERT_EQUAL(bitsBefore, enc.bits());
+        break;
+      }
+      pts[n].t = t;
+      memcpy(pts[n].v, v, sizeof(v));
+      ++n;
+    }
+    TEST_ASSERT_EQUAL(n, enc.count());
+    TEST_ASSERT_LESS_OR_EQUAL(BLOCK_BYTES, enc.bytes());
+    // Within one worst-case point of the end.
+    TEST_ASSERT_GREATER_THAN(BLOCK_BYTES * 8 - TimeSeriesEncoder<CHANNELS>::MAX_POINT_BITS, enc.bits());
+    expectDecodes(buf, enc.bytes(), enc.count(), pts);
+  }
+}
+
+void test_decoder_stops_on_truncated_block() {
+  uint8_t buf[BLOCK_BYTES];
+  TimeSeriesEncoder<CHANNELS> enc;
+  enc.reset(buf, sizeof(buf));
+  uint16_t v[CHANNELS] = {100, 200, 300, 1};
+  for (uint32_t i = 0; i < 20; ++i) {
+    v[0] = static_cast<uint16_t>(v[0] + 5000);  // raw escapes: 20 bits per channel
+    TEST_ASSERT_TRUE(enc.append(1000 + i * 7919, v));
+  }
+  TimeSeriesDecoder<CHANNELS> dec(buf, enc.bytes() / 2, enc.count());
+  uint32_t t;
+  size_t decoded = 0;
+  while (dec.next(t, v)) ++decoded;
+  TEST_ASSERT_GREATER_THAN(0, decoded);
+  TEST_ASSERT_LESS_THAN(enc.count(), decoded);
+}
+
+// Indoor readings every 2 s with sensor noise and a slow drift, packed like
+// WeatherHistory (temperature (C+100)*100, humidity %*100, pressure Pa/2, n=1).
+void test_benchmark_synthetic_weather() {
+  constexpr size_t N = 43200; // one day at 2 s
+  static Point pts[N];
+  Rng rng{42u};
+  uint32_t t = 1700000000u;
+  for (size_t i = 0; i < N; ++i) {
+    t += (rng.next() % 50) ? 2 : 3; // sampler jitter
+    const double hours = i * 2.0 / 3600.0;
+    const double tempC = 22.0 + 1.5 * sin(hours / 24.0 * 2 * M_PI) + (rng.range(-3, 3)) * 0.01;
+    const double hum = 45.0 + 5.0 * cos(hours / 24.0 * 2 * M_PI) + (rng.range(-5, 5)) * 0.01;
+    const double pa = 101325.0 + 300.0 * sin(hours / 12.0) + rng.range(-4, 4);
+    pts[i].t = t;
+    pts[i].v[0] = static_cast<uint16_t>(lround((tempC + 100.0) * 100.0));
+    pts[i].v[1] = static_cast<uint16_t>(lround(hum * 100.0));
+    pts[i].v[2] = static_cast<uint16_t>(lround(pa / 2.0));
+    pts[i].v[3] = 1;
+  }
+
+  constexpr size_t MAX_BLOCKS = 2048;
+  static uint8_t blocks[MAX_BLOCKS][BLOCK_BYTES];
+  static size_t bytes[MAX_BLOCKS], counts[MAX_BLOCKS];
+
+  using Clock = std::chrono::steady_clock;
+  const auto e0 = Clock::now();
+  const size_t used = encodeBlocks(pts, N, blocks, bytes, counts, MAX_BLOCKS);
+  const auto e1 = Clock::now();
+
+  size_t decoded = 0, payload = 0;
+  uint32_t checksum = 0;
+  for (size_t b = 0; b < used; ++b) {
+    TimeSeriesDecoder<CHANNELS> dec(blocks[b], bytes[b], counts[b]);
+    uint32_t dt;
+    uint16_t dv[CHANNELS];
+    while (dec.next(dt, dv)) {
+      checksum += dt + dv[0] + dv[2];
+      ++decoded;
+    }
+    payload += bytes[b];
+  }
+  const auto d1 = Clock::now();
+  TEST_ASSERT_EQUAL(N, decoded);
+  TEST_ASSERT_GREATER_THAN(0, checksum);
+
+  const double perPoint = static_cast<double>(used * BLOCK_BYTES) / N;
+  const double encNs = std::chrono::duration<double, std::nano>(e1 - e0).count() / N;
+  const double decNs = std::chrono::duration<double, std::nano>(d1 - e1).count() / N;
+  char line[160];
+  snprintf(line, sizeof(line), "%zu points, %zu blocks: %.2f B/point in blocks (%.2f payload), encode %.0f ns/point, decode %.0f ns/point",
+           N, used, perPoint, static_cast<double>(payload) / N, encNs, decNs);
+  TEST_MESSAGE(line);
+  // Packed HistoryPoint is 12 bytes; the codec is expected to stay well under a third of that.
+  TEST_ASSERT_LESS_THAN(4.0, perPoint);
+}
+
+int main(int, char **) {
+  UNITY_BEGIN();
+  RUN_TEST(test_zigzag_round_trip);
+  RUN_TEST(test_class_boundaries);
+  RUN_TEST(test_random_round_trip_all_classes);
+  RUN_TEST(test_first_point_exact_fit);
+  RUN_TEST(test_block_full_boundary);
+  RUN_TEST(test_decoder_stops_on_truncated_block);
+  RUN_TEST(test_benchmark_synthetic_weather);
+  return UNITY_END();
+}